@@ -251,6 +251,13 @@ int oval_agent_eval_system(oval_agent_session_t * ag_sess, agent_reporter cb, vo
 	int ret = 0;
 
 	dI("OVAL agent started to evaluate OVAL definitions on your system.");
+
+	/* probe objects of all definitions concurrently */
+	if (oval_probe_query_definitions(ag_sess->psess) == -2) {
+		dI("OVAL agent finished evaluation.");
+		return 1;
+	}
+
 	oval_def_it = oval_definition_model_get_definitions(ag_sess->def_model);
 	while (oval_definition_iterator_has_more(oval_def_it)) {
 		oval_def = oval_definition_iterator_next(oval_def_it);
@@ -537,6 +544,10 @@ oval_agent_eval_multi_check(oval_agent_session_t *sess)
 		// which is not explicitly covered in SCAP 1.2 Specification, we are
 		// better to report error.
 		final_result = XCCDF_RESULT_ERROR;
+	} else {
+		// Probe objects of all the definitions concurrently.
+		assume_r(oval_probe_query_definitions(sess->psess) != -2, -1,
+		         oval_definition_iterator_free(oval_def_it););
 	}
 	while (oval_definition_iterator_has_more(oval_def_it)) {
 		oval_def = oval_definition_iterator_next(oval_def_it);
@@ -54,6 +54,7 @@
 #include "oval_glob_to_regex.h"
 #if defined USE_REGEX_PCRE
 #include <pcre.h>
+#include "results/oval_pcre_cache_impl.h"
 #elif defined USE_REGEX_POSIX
 #include <regex.h>
 #endif
@@ -1942,12 +1943,14 @@ static bool _match(const char *pattern, const char *string)
 {
 	bool match = false;
 #if defined USE_REGEX_PCRE
-	pcre *re;
+	const oval_pcre_t *re;
 	const char *error;
 	int erroffset = -1, ovector[60], ovector_len = sizeof (ovector) / sizeof (ovector[0]);
-	re = pcre_compile(pattern, PCRE_UTF8, &error, &erroffset, NULL);
-	match = (pcre_exec(re, NULL, string, strlen(string), 0, 0, ovector, ovector_len) >= 0);
-	pcre_free(re);
+	re = oval_pcre_get(pattern, PCRE_UTF8, &error, &erroffset);
+	if (re == NULL)
+		return false;
+	match = (oval_pcre_exec(re, string, strlen(string), ovector, ovector_len) >= 0);
+	oval_pcre_release(re);
 #elif defined USE_REGEX_POSIX
 	regex_t re;
 	regcomp(&re, pattern, REG_EXTENDED);
@@ -2176,11 +2179,11 @@ static oval_syschar_collection_flag_t _oval_component_evaluate_REGEX_CAPTURE(ova
 	char *pattern;
 #if defined USE_REGEX_PCRE
 	int erroffset = -1;
-	pcre *re = NULL;
+	const oval_pcre_t *re = NULL;
 	const char *error;
 
 	pattern = oval_component_get_regex_pattern(component);
-	re = pcre_compile(pattern, PCRE_UTF8, &error, &erroffset, NULL);
+	re = oval_pcre_get(pattern, PCRE_UTF8, &error, &erroffset);
 	if (re == NULL) {
 		dE("pcre_compile() failed: \"%s\".", error);
 		return SYSCHAR_FLAG_ERROR;
@@ -2210,7 +2213,7 @@ static oval_syschar_collection_flag_t _oval_component_evaluate_REGEX_CAPTURE(ova
 			for (i = 0; i < ovector_len; ++i)
 				ovector[i] = -1;
 
-			rc = pcre_exec(re, NULL, text, strlen(text), 0, 0, ovector, ovector_len);
+			rc = oval_pcre_exec(re, text, strlen(text), ovector, ovector_len);
 			if (rc < -1) {
 				dE("pcre_exec() failed: %d.", rc);
 				flag = SYSCHAR_FLAG_ERROR;
@@ -2256,7 +2259,7 @@ static oval_syschar_collection_flag_t _oval_component_evaluate_REGEX_CAPTURE(ova
 	}
 	oval_component_iterator_free(subcomps);
 #if defined USE_REGEX_PCRE
-        pcre_free(re);
+        oval_pcre_release(re);
 #endif
 	return flag;
 }
@@ -26,6 +26,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
 #include <limits.h>
 #include <errno.h>
@@ -36,6 +37,7 @@
 #include "oval_probe.h"
 #include "oval_system_characteristics.h"
 #include "common/_error.h"
+#include "common/alloc.h"
 #include "common/assume.h"
 
 #include "oval_probe_impl.h"
@@ -259,7 +261,8 @@ int oval_probe_query_object(oval_probe_session_t *psess, struct oval_object *obj
 			const char *flag_text = oval_syschar_collection_flag_get_text(sc_flg);
 			dI("System characteristics for %s_object '%s' already exist, flag: %s.", type_name, oid, flag_text);
 
-			if (sc_flg != SYSCHAR_FLAG_UNKNOWN || (flags & OVAL_PDFLAG_NOREPLY)) {
+			if (sc_flg != SYSCHAR_FLAG_UNKNOWN || (flags & OVAL_PDFLAG_NOREPLY) ||
+			    oval_probe_ext_pipe_done(psess->pext, oid)) {
 				if (out_syschar)
 					*out_syschar = sysc;
 				return 0;
@@ -491,6 +494,169 @@ static int oval_probe_query_criteria(oval_probe_session_t *sess, struct oval_cri
         return -1;
 }
 
+/*
+ * Objects collected for the pipelined evaluation
+ */
+struct oval_probe_objset {
+	struct oval_string_map *seen;  /**< ids of visited definitions and objects */
+	struct oval_syschar   **sysc;
+	size_t                  count;
+	size_t                  size;
+};
+
+static bool oval_probe_object_pipelinable(oval_probe_session_t *sess, struct oval_object *object)
+{
+	struct oval_object_content_iterator *cit;
+	struct oval_string_map *vm;
+	struct oval_iterator *vit;
+	oval_ph_t *ph;
+	bool ret;
+
+	ph = oval_probe_handler_get(sess->ph, oval_object_get_subtype(object));
+
+	if (ph == NULL || ph->func != &oval_probe_ext_handler)
+		return false;
+
+	/*
+	 * Set objects are evaluated using other objects and objects
+	 * referencing variables depend on other objects too. Both are
+	 * left for the regular evaluation.
+	 */
+	ret = true;
+	cit = oval_object_get_object_contents(object);
+	while (oval_object_content_iterator_has_more(cit)) {
+		struct oval_object_content *content = oval_object_content_iterator_next(cit);
+
+		if (oval_object_content_get_type(content) == OVAL_OBJECTCONTENT_SET) {
+			ret = false;
+			break;
+		}
+	}
+	oval_object_content_iterator_free(cit);
+
+	if (!ret)
+		return false;
+
+	vm = oval_string_map_new();
+	oval_obj_collect_var_refs(object, vm);
+	vit = oval_string_map_values(vm);
+	ret = !oval_collection_iterator_has_more(vit);
+	oval_collection_iterator_free(vit);
+	oval_string_map_free(vm, NULL);
+
+	return ret;
+}
+
+static void oval_probe_collect_object(oval_probe_session_t *sess, struct oval_object *object, struct oval_probe_objset *set)
+{
+	char *oid = oval_object_get_id(object);
+
+	if (oval_string_map_get_value(set->seen, oid) != NULL)
+		return;
+
+	oval_string_map_put(set->seen, oid, object);
+
+	if (oval_syschar_model_get_syschar(sess->sys_model, oid) != NULL)
+		return;
+	if (!oval_probe_object_pipelinable(sess, object))
+		return;
+
+	if (set->count == set->size) {
+		set->size = set->size > 0 ? set->size * 2 : 64;
+		set->sysc = oscap_realloc(set->sysc, sizeof(struct oval_syschar *) * set->size);
+	}
+
+	set->sysc[set->count++] = oval_syschar_new(sess->sys_model, object);
+}
+
+static void oval_probe_collect_criteria(oval_probe_session_t *sess, struct oval_criteria_node *cnode, struct oval_probe_objset *set)
+{
+	switch (oval_criteria_node_get_type(cnode)) {
+	case OVAL_NODETYPE_CRITERION:{
+		struct oval_test *test = oval_criteria_node_get_test(cnode);
+		struct oval_object *object;
+
+		if (test == NULL)
+			return;
+
+		object = oval_test_get_object(test);
+
+		if (object == NULL || oval_test_get_subtype(test) != oval_object_get_subtype(object))
+			return;
+
+		oval_probe_collect_object(sess, object, set);
+		}
+		break;
+	case OVAL_NODETYPE_CRITERIA:{
+		struct oval_criteria_node_iterator *cnode_it = oval_criteria_node_get_subnodes(cnode);
+
+		if (cnode_it == NULL)
+			return;
+
+		while (oval_criteria_node_iterator_has_more(cnode_it))
+			oval_probe_collect_criteria(sess, oval_criteria_node_iterator_next(cnode_it), set);
+		oval_criteria_node_iterator_free(cnode_it);
+		}
+		break;
+	case OVAL_NODETYPE_EXTENDDEF:{
+		struct oval_definition *definition = oval_criteria_node_get_definition(cnode);
+		char *id;
+
+		if (definition == NULL)
+			return;
+
+		id = oval_definition_get_id(definition);
+
+		if (oval_string_map_get_value(set->seen, id) != NULL)
+			return;
+
+		oval_string_map_put(set->seen, id, definition);
+
+		if (oval_definition_get_criteria(definition) != NULL)
+			oval_probe_collect_criteria(sess, oval_definition_get_criteria(definition), set);
+		}
+		break;
+	case OVAL_NODETYPE_UNKNOWN:
+		break;
+	}
+}
+
+int oval_probe_query_definitions(oval_probe_session_t *sess)
+{
+	struct oval_definition_model *definition_model;
+	struct oval_definition_iterator *def_it;
+	struct oval_probe_objset set;
+	int ret;
+
+	if (sess->pext->pipe_depth == 0)
+		return 0;
+
+	definition_model = oval_syschar_model_get_definition_model(sess->sys_model);
+
+	set.seen  = oval_string_map_new();
+	set.sysc  = NULL;
+	set.count = 0;
+	set.size  = 0;
+
+	def_it = oval_definition_model_get_definitions(definition_model);
+	while (oval_definition_iterator_has_more(def_it)) {
+		struct oval_definition *definition = oval_definition_iterator_next(def_it);
+		struct oval_criteria_node *cnode = oval_definition_get_criteria(definition);
+
+		if (cnode != NULL)
+			oval_probe_collect_criteria(sess, cnode, &set);
+	}
+	oval_definition_iterator_free(def_it);
+	oval_string_map_free(set.seen, NULL);
+
+	dI("Collected %zu objects for the pipelined evaluation.", set.count);
+
+	ret = oval_probe_ext_eval_pipelined(sess->pext, set.sysc, set.count);
+	oscap_free(set.sysc);
+
+	return ret;
+}
+
 #if 0
 const oval_probe_meta_t * const oval_probe_meta_get(void)
 {
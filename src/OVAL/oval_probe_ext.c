@@ -43,6 +43,7 @@
 #include "oval_probe_ext.h"
 #include "oval_sexp.h"
 #include "oval_probe_meta.h"
+#include "probes/fscache.h"
 
 #define __ERRBUF_SIZE 128
 
@@ -79,6 +80,14 @@ oval_pext_t *oval_pext_new(void)
         pext->pdsc      = NULL;
         pext->pdsc_cnt  = 0;
 
+        pext->pipe_depth  = OVAL_PROBE_PIPELINE_DEPTH;
+        pext->fscache_dir = NULL;
+        pext->set_objs    = NULL;
+        pext->pipe_done   = NULL;
+
+        if (getenv(OVAL_PROBE_PIPELINE_DEPTH_ENV) != NULL)
+                pext->pipe_depth = strtoul(getenv(OVAL_PROBE_PIPELINE_DEPTH_ENV), NULL, 10);
+
         return(pext);
 }
 
@@ -92,6 +101,13 @@ void oval_pext_free(oval_pext_t *pext)
                 oval_pdtbl_free(pext->pdtbl);
         }
 
+        fscache_store_free(pext->fscache_dir);
+
+        if (pext->set_objs != NULL)
+                oval_string_map_free(pext->set_objs, NULL);
+        if (pext->pipe_done != NULL)
+                oval_string_map_free(pext->pipe_done, NULL);
+
         pthread_mutex_destroy(&pext->lock);
         oscap_free(pext);
 }
@@ -430,7 +446,18 @@ static inline int _handle_SEAP_receive_failure(SEAP_CTX_t *ctx, oval_pd_t *pd, S
 	return (-1);
 }
 
-static int oval_probe_comm(SEAP_CTX_t *ctx, oval_pd_t *pd, const SEXP_t *s_iobj, int flags, SEXP_t **out_sexp)
+/*
+ * Consumer of partial replies (see PROBE_MSGATTR_CHUNK). If a consumer
+ * is passed to oval_probe_comm, the probe is allowed to send the items
+ * of the collected object in several partial replies. The consumer is
+ * called for each of them as soon as it's received, the final reply is
+ * returned the usual way. Before the request is sent again, the consumer
+ * is called with NULL to discard the partial replies received so far.
+ */
+typedef int (oval_probe_chunkfn_t)(SEXP_t *s_part, void *arg);
+
+static int oval_probe_comm(SEAP_CTX_t *ctx, oval_pd_t *pd, const SEXP_t *s_iobj, int flags,
+                           oval_probe_chunkfn_t *chunkfn, void *chunkarg, SEXP_t **out_sexp)
 {
 	int retry, ret;
 
@@ -441,6 +468,8 @@ static int oval_probe_comm(SEAP_CTX_t *ctx, oval_pd_t *pd, const SEXP_t *s_iobj,
         assume_d (s_iobj != NULL, -1);
 
 	for (retry = 0;;) {
+		if (retry > 0 && chunkfn != NULL)
+			chunkfn(NULL, chunkarg);
 		/*
 		 * Establish connection to probe. The connection may be
 		 * already set up by previous calls to this function or
@@ -486,6 +515,17 @@ static int oval_probe_comm(SEAP_CTX_t *ctx, oval_pd_t *pd, const SEXP_t *s_iobj,
                                 SEAP_msg_free(s_omsg);
                                 oscap_seterr (OSCAP_EFAMILY_OVAL, "OVAL_EPROBEUNKNOWN");
 
+				return (-1);
+			}
+		} else if (chunkfn != NULL) {
+			if (SEAP_msgattr_set(s_omsg, PROBE_MSGATTR_CHUNKED, NULL) != 0) {
+                                protect_errno {
+                                        dE("Can't set the %s attribute.", PROBE_MSGATTR_CHUNKED);
+                                }
+
+                                SEAP_msg_free(s_omsg);
+                                oscap_seterr (OSCAP_EFAMILY_OVAL, "OVAL_EPROBEUNKNOWN");
+
 				return (-1);
 			}
 		}
@@ -551,10 +591,29 @@ static int oval_probe_comm(SEAP_CTX_t *ctx, oval_pd_t *pd, const SEXP_t *s_iobj,
 
 		dD("Waiting for reply.");
 
-		/* recv_retry: */
+	recv_next:
 		s_imsg = NULL;
 
 		ret = SEAP_recvmsg(ctx, pd->sd, &s_imsg);
+		if (ret == 0 && chunkfn != NULL && SEAP_msgattr_exists(s_imsg, PROBE_MSGATTR_CHUNK)) {
+			SEXP_t *s_part;
+
+			dD("Partial reply received.");
+
+			s_part = SEAP_msg_get(s_imsg);
+			SEAP_msg_free(s_imsg);
+			ret = chunkfn(s_part, chunkarg);
+			SEXP_free(s_part);
+
+			if (ret == 0)
+				goto recv_next;
+
+			SEAP_msg_free(s_omsg);
+			oscap_seterr(OSCAP_EFAMILY_OVAL, "Unable to process a partial reply from probe");
+
+			return (-1);
+		}
+
 		if (ret != 0) {
 			protect_errno {
 				ret = _handle_SEAP_receive_failure(ctx, pd, s_omsg, flags);
@@ -637,7 +696,7 @@ static int oval_probe_sys_eval(SEAP_CTX_t *ctx, oval_pd_t *pd, struct oval_sysch
                 SEXP_free (r0);
         }
 
-        ret = oval_probe_comm(ctx, pd, s_obj, 0, &r0);
+        ret = oval_probe_comm(ctx, pd, s_obj, 0, NULL, NULL, &r0);
         SEXP_free(s_obj);
 
 	if (ret != 0)
@@ -817,6 +876,72 @@ int oval_probe_sys_handler(oval_subtype_t type, void *ptr, int act, ...)
         return(ret);
 }
 
+/*
+ * Drop all probe connections after an abort. The probes are started
+ * again when they are needed.
+ */
+static void oval_probe_ext_restart(oval_pext_t *pext)
+{
+	if (!pext->do_init) {
+		oval_pdtbl_free(pext->pdtbl);
+	}
+
+	pext->do_init  = true;
+	pext->pdtbl    = NULL;
+	pext->pdsc     = NULL;
+	pext->pdsc_cnt = 0;
+
+	oval_probe_ext_init(pext);
+}
+
+/*
+ * Get the descriptor of the probe for objects of the given subtype.
+ * The probe is added to the descriptor table if it's not there yet.
+ * @return 0 on success, 1 if the subtype is not supported, -1 on error
+ */
+static int oval_probe_ext_getpd(oval_pext_t *pext, oval_subtype_t type, oval_pd_t **out_pd)
+{
+        oval_pd_t *pd;
+
+        pd = oval_pdtbl_get(pext->pdtbl, type);
+
+        if (pd == NULL) {
+                char         probe_uri[PATH_MAX + 1];
+                size_t       probe_urilen;
+                char        *probe_dir;
+                oval_pdsc_t *probe_dsc;
+
+                probe_dir = pext->probe_dir;
+                probe_dsc = oval_pdsc_lookup(pext->pdsc, pext->pdsc_cnt, type);
+
+		if (probe_dsc == NULL)
+			return (1);
+
+                probe_urilen = snprintf(probe_uri, sizeof probe_uri,
+                                        "%s://%s/%s", OVAL_PROBE_SCHEME, probe_dir, probe_dsc->file);
+
+                if (probe_urilen >= sizeof probe_uri) {
+                        oscap_seterr (OSCAP_EFAMILY_GLIBC, "probe URI too long");
+                        return (-1);
+                }
+
+                dI("Starting probe on URI '%s'.", probe_uri);
+
+                if (oval_pdtbl_add(pext->pdtbl, type, -1, probe_uri) != 0)
+			return (1);
+
+		pd = oval_pdtbl_get(pext->pdtbl, type);
+
+                if (pd == NULL) {
+                        oscap_seterr (OSCAP_EFAMILY_OVAL, "internal error");
+                        return (-1);
+                }
+        }
+
+        *out_pd = pd;
+        return (0);
+}
+
 int oval_probe_ext_handler(oval_subtype_t type, void *ptr, int act, ...)
 {
         int          ret = 0;
@@ -836,50 +961,16 @@ int oval_probe_ext_handler(oval_subtype_t type, void *ptr, int act, ...)
 		sys = va_arg(ap, struct oval_syschar *);
 		flags = va_arg(ap, int);
 		obj = oval_syschar_get_object(sys);
-                pd = oval_pdtbl_get(pext->pdtbl, oval_object_get_subtype(obj));
-
-                if (pd == NULL) {
-                        char         probe_uri[PATH_MAX + 1];
-                        size_t       probe_urilen;
-                        char        *probe_dir;
-                        oval_pdsc_t *probe_dsc;
-
-                        probe_dir = pext->probe_dir;
-                        probe_dsc = oval_pdsc_lookup(pext->pdsc, pext->pdsc_cnt, oval_object_get_subtype(obj));
+		ret = oval_probe_ext_getpd(pext, oval_object_get_subtype(obj), &pd);
 
-			if (probe_dsc == NULL) {
-				oval_syschar_add_new_message(sys, "OVAL object not supported", OVAL_MESSAGE_LEVEL_WARNING);
-				oval_syschar_set_flag(sys, SYSCHAR_FLAG_NOT_COLLECTED);
-				va_end(ap);
-				return (1);
-			}
-
-                        probe_urilen = snprintf(probe_uri, sizeof probe_uri,
-                                                "%s://%s/%s", OVAL_PROBE_SCHEME, probe_dir, probe_dsc->file);
-
-                        if (probe_urilen >= sizeof probe_uri) {
-                                oscap_seterr (OSCAP_EFAMILY_GLIBC, "probe URI too long");
-				va_end(ap);
-                                return (-1);
-                        }
-
-                        dI("Starting probe on URI '%s'.", probe_uri);
-
-                        if (oval_pdtbl_add(pext->pdtbl, oval_object_get_subtype(obj), -1, probe_uri) != 0) {
+		if (ret != 0) {
+			if (ret > 0) {
 				oval_syschar_add_new_message(sys, "OVAL object not supported", OVAL_MESSAGE_LEVEL_WARNING);
 				oval_syschar_set_flag(sys, SYSCHAR_FLAG_NOT_COLLECTED);
-				va_end(ap);
-                                return (1);
 			}
-
-			pd = oval_pdtbl_get(pext->pdtbl, oval_object_get_subtype(obj));
-
-                        if (pd == NULL) {
-                                oscap_seterr (OSCAP_EFAMILY_OVAL, "internal error");
-				va_end(ap);
-                                return (-1);
-                        }
-                }
+			va_end(ap);
+			return (ret);
+		}
 
 		ret = oval_probe_ext_eval(pext->pdtbl->ctx, pd, pext, sys, flags);
 
@@ -888,17 +979,7 @@ int oval_probe_ext_handler(oval_subtype_t type, void *ptr, int act, ...)
 
 		if (ret < 0 && errno == ECONNABORTED) {
 			if (!(flags & OVAL_PDFLAG_SLAVE)) {
-				if (!pext->do_init) {
-					oval_pdtbl_free(pext->pdtbl);
-				}
-
-				pext->do_init  = true;
-				pext->pdtbl    = NULL;
-				pext->pdsc     = NULL;
-				pext->pdsc_cnt = 0;
-
-				oval_probe_ext_init(pext);
-
+				oval_probe_ext_restart(pext);
 				errno = ECONNABORTED;
 			}
 		}
@@ -915,6 +996,16 @@ int oval_probe_ext_handler(oval_subtype_t type, void *ptr, int act, ...)
 	case PROBE_HANDLER_ACT_ABORT:
         {
                 if (type == OVAL_SUBTYPE_ALL) {
+			/* the objects will be collected into a new model */
+			if (act == PROBE_HANDLER_ACT_RESET && pext->pipe_done != NULL) {
+				oval_string_map_free(pext->pipe_done, NULL);
+				pext->pipe_done = NULL;
+			}
+
+			/* ... from a system which may have changed since */
+			if (act == PROBE_HANDLER_ACT_RESET)
+				fscache_store_clear(pext->fscache_dir);
+
                         /*
                          * Iterate thru probe descriptor table and execute the reset operation
                          * for each probe descriptor.
@@ -1036,6 +1127,12 @@ int oval_probe_ext_init(oval_pext_t *pext)
 
                 pext->pdtbl = oval_pdtbl_new();
 
+                /* kept across restarts of the probes */
+                if (pext->fscache_dir == NULL)
+                        pext->fscache_dir = fscache_store_new();
+                if (pext->fscache_dir != NULL)
+                        SEAP_CTX_setenv(pext->pdtbl->ctx, FSCACHE_DIR_ENV, pext->fscache_dir);
+
                 if (oval_probe_cmd_init(pext) != 0)
                         ret = -1;
                 else
@@ -1047,10 +1144,101 @@ _ret:
         return(ret);
 }
 
+/*
+ * Items of partial replies are converted as soon as they're received,
+ * but they're added to the syschar only when the final reply arrives.
+ * If the probe fails or the request is sent again, they're discarded.
+ */
+struct oval_probe_chunkarg {
+	struct oval_syschar    *syschar;
+	struct oval_string_map *itm_id_map;
+	struct oval_collection *pending;
+};
+
+static int oval_probe_ext_chunk(SEXP_t *s_part, void *arg)
+{
+	struct oval_probe_chunkarg *chunk = (struct oval_probe_chunkarg *)arg;
+
+	if (s_part == NULL) {
+		oval_string_map_free(chunk->itm_id_map, NULL);
+		oval_collection_free(chunk->pending);
+		chunk->itm_id_map = oval_string_map_new();
+		chunk->pending    = oval_collection_new();
+
+		return (0);
+	}
+
+	return oval_sexp_to_sysch_items(s_part, chunk->syschar, chunk->itm_id_map, chunk->pending);
+}
+
+static void oval_probe_ext_setrefs(struct oval_string_map *set_objs, struct oval_setobject *set)
+{
+	if (oval_setobject_get_type(set) == OVAL_SET_AGGREGATE) {
+		struct oval_setobject_iterator *subsets = oval_setobject_get_subsets(set);
+
+		while (oval_setobject_iterator_has_more(subsets))
+			oval_probe_ext_setrefs(set_objs, oval_setobject_iterator_next(subsets));
+		oval_setobject_iterator_free(subsets);
+	} else {
+		struct oval_object_iterator *objects = oval_setobject_get_objects(set);
+
+		while (oval_object_iterator_has_more(objects)) {
+			char *id = oval_object_get_id(oval_object_iterator_next(objects));
+
+			if (oval_string_map_get_value(set_objs, id) == NULL)
+				oval_string_map_put(set_objs, id, id);
+		}
+		oval_object_iterator_free(objects);
+	}
+}
+
+/*
+ * The probe doesn't cache the result of an object whose items were sent
+ * in partial replies. A set object is evaluated by the probe using the
+ * cached results of the objects it references, so those objects are
+ * never collected in chunks.
+ */
+static bool oval_probe_ext_chunked(oval_pext_t *pext, struct oval_object *object)
+{
+	bool chunked;
+
+	pthread_mutex_lock(&pext->lock);
+
+	if (pext->set_objs == NULL) {
+		struct oval_definition_model *defs;
+		struct oval_object_iterator *objects;
+
+		pext->set_objs = oval_string_map_new();
+		defs    = oval_syschar_model_get_definition_model(*(pext->model));
+		objects = oval_definition_model_get_objects(defs);
+
+		while (oval_object_iterator_has_more(objects)) {
+			struct oval_object_content_iterator *contents;
+
+			contents = oval_object_get_object_contents(oval_object_iterator_next(objects));
+
+			while (oval_object_content_iterator_has_more(contents)) {
+				struct oval_object_content *content = oval_object_content_iterator_next(contents);
+
+				if (oval_object_content_get_type(content) == OVAL_OBJECTCONTENT_SET)
+					oval_probe_ext_setrefs(pext->set_objs, oval_object_content_get_setobject(content));
+			}
+			oval_object_content_iterator_free(contents);
+		}
+		oval_object_iterator_free(objects);
+	}
+
+	chunked = oval_string_map_get_value(pext->set_objs, oval_object_get_id(object)) == NULL;
+	pthread_mutex_unlock(&pext->lock);
+
+	return (chunked);
+}
+
 int oval_probe_ext_eval(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext, struct oval_syschar *syschar, int flags)
 {
         SEXP_t *s_obj, *s_sys;
 	struct oval_object *object;
+	struct oval_probe_chunkarg chunk;
 	int ret;
 
 	if (syschar == NULL) {
@@ -1064,10 +1252,23 @@ int oval_probe_ext_eval(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext, struc
 	if (ret != 0)
 		return (1);
 
-	ret = oval_probe_comm(ctx, pd, s_obj, flags, &s_sys);
+	/*
+	 * Items received in partial replies are converted while the probe
+	 * is still collecting the rest of them.
+	 */
+	chunk.syschar    = syschar;
+	chunk.itm_id_map = oval_string_map_new();
+	chunk.pending    = oval_collection_new();
+
+	ret = oval_probe_comm(ctx, pd, s_obj, flags,
+	                      oval_probe_ext_chunked(pext, object) ? &oval_probe_ext_chunk : NULL,
+	                      &chunk, &s_sys);
 	SEXP_free(s_obj);
 
 	if (ret != 0) {
+		oval_string_map_free(chunk.itm_id_map, NULL);
+		oval_collection_free(chunk.pending);
+
 		switch (errno) {
 		case ECONNABORTED:
 			dI("Closing sd=%d (pd=%p) after abort", pd->sd, pd);
@@ -1088,18 +1289,326 @@ int oval_probe_ext_eval(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext, struc
                         dW("Obtrusive data from probe!");
                         SEXP_free(s_sys);
 		}
+		oval_string_map_free(chunk.itm_id_map, NULL);
+		oval_collection_free(chunk.pending);
 		return (0);
 	}
 
+	{
+		struct oval_iterator *it = oval_collection_iterator(chunk.pending);
+
+		while (oval_collection_iterator_has_more(it))
+			oval_syschar_add_sysitem(syschar, oval_collection_iterator_next(it));
+		oval_collection_iterator_free(it);
+	}
+
         /*
 	 * Convert the received S-exp to OVAL system characteristic.
 	 */
-	ret = oval_sexp_to_sysch(s_sys, syschar);
+	ret = oval_sexp_to_sysch_r(s_sys, syschar, chunk.itm_id_map);
+	SEXP_free(s_sys);
+	oval_string_map_free(chunk.itm_id_map, NULL);
+	oval_collection_free(chunk.pending);
+
+	return (ret);
+}
+
+/*
+ * Pipelined evaluation. The objects are sent to their probes without
+ * waiting for the replies, at most pext->pipe_depth requests per probe
+ * are in flight at a time. The probes evaluate the requests concurrently
+ * and the replies are matched with the requests using the reply-id
+ * message attribute. All the replies are converted in the calling thread,
+ * so the system characteristics model is never accessed concurrently.
+ */
+struct oval_probe_pipereq {
+	struct oval_syschar *syschar;
+	SEAP_msgid_t         id;
+};
+
+struct oval_probe_pipe {
+	oval_pd_t                  *pd;
+	struct oval_syschar       **queue;     /**< objects which weren't sent yet */
+	size_t                      queue_cnt;
+	struct oval_probe_pipereq  *req;       /**< requests in flight */
+	size_t                      req_cnt;
+	bool                        failed;
+};
+
+static int oval_syschar_subtypecmp(struct oval_syschar **a, struct oval_syschar **b)
+{
+	return (oval_object_get_subtype(oval_syschar_get_object(*a)) -
+	        oval_object_get_subtype(oval_syschar_get_object(*b)));
+}
+
+static void oval_probe_pipe_close(SEAP_CTX_t *ctx, struct oval_probe_pipe *pipe)
+{
+	/*
+	 * Late replies to the requests in flight would be taken as replies
+	 * by the regular evaluation, so the connection has to be closed.
+	 */
+	if (pipe->pd->sd != -1) {
+		SEAP_close(ctx, pipe->pd->sd);
+		pipe->pd->sd = -1;
+	}
+
+	pipe->req_cnt = 0;
+	pipe->failed  = true;
+}
+
+static int oval_probe_pipe_send(oval_pext_t *pext, struct oval_probe_pipe *pipe)
+{
+	SEAP_CTX_t *ctx = pext->pdtbl->ctx;
+	SEAP_msg_t *s_omsg;
+	SEXP_t *s_obj;
+	struct oval_syschar *syschar;
+	struct oval_object *object;
+	int ret;
+
+	syschar = pipe->queue[0];
+	pipe->queue++;
+	pipe->queue_cnt--;
+
+	if (pipe->pd->sd == -1) {
+		pipe->pd->sd = SEAP_connect(ctx, pipe->pd->uri, 0);
+
+		if (pipe->pd->sd < 0) {
+			protect_errno {
+				dW("Can't connect: %u, %s.", errno, strerror(errno));
+			}
+			pipe->pd->sd = -1;
+			pipe->failed = true;
+			return (-1);
+		}
+	}
+
+	object = oval_syschar_get_object(syschar);
+
+	if (oval_object_to_sexp(pext->sess_ptr, oval_subtype_to_str(oval_object_get_subtype(object)), syschar, &s_obj) != 0)
+		return (0); /* left for the regular evaluation */
+
+	s_omsg = SEAP_msg_new();
+	SEAP_msg_set(s_omsg, s_obj);
+
+	ret = SEAP_sendmsg(ctx, pipe->pd->sd, s_omsg);
+
+	if (ret == 0) {
+		pipe->req[pipe->req_cnt].syschar = syschar;
+		pipe->req[pipe->req_cnt].id      = SEAP_msg_id(s_omsg);
+		pipe->req_cnt++;
+	} else {
+		protect_errno {
+			dW("Can't send message: %u, %s.", errno, strerror(errno));
+			oval_probe_pipe_close(ctx, pipe);
+		}
+	}
+
+	SEAP_msg_free(s_omsg);
+	SEXP_free(s_obj);
+
+	return (ret);
+}
+
+static int oval_probe_pipe_recv(oval_pext_t *pext, struct oval_probe_pipe *pipe)
+{
+	SEAP_CTX_t *ctx = pext->pdtbl->ctx;
+	SEAP_msg_t *s_imsg;
+	SEAP_msgid_t id;
+	SEXP_t *s_id, *s_sys;
+	struct oval_syschar *syschar;
+	size_t i;
+
+	s_imsg = NULL;
+
+	if (SEAP_recvmsg(ctx, pipe->pd->sd, &s_imsg) != 0) {
+		if (errno == ECANCELED) {
+			/*
+			 * The probe failed to evaluate one of the objects. The object
+			 * is left for the regular evaluation which reports the error.
+			 */
+			for (i = 0; i < pipe->req_cnt; ++i) {
+				SEAP_err_t *err = NULL;
+
+				if (SEAP_recverr_byid(ctx, pipe->pd->sd, &err, pipe->req[i].id) == 0) {
+					SEAP_error_free(err);
+					pipe->req[i] = pipe->req[--pipe->req_cnt];
+					return (0);
+				}
+			}
+		}
+
+		protect_errno {
+			dW("Can't receive message: %u, %s.", errno, strerror(errno));
+			SEAP_msg_free(s_imsg);
+			oval_probe_pipe_close(ctx, pipe);
+		}
+		return (-1);
+	}
+
+	s_id = SEAP_msgattr_get(s_imsg, "reply-id");
+
+	if (s_id == NULL) {
+		dW("Dropping a message without reply-id.");
+		SEAP_msg_free(s_imsg);
+		return (0);
+	}
+
+	id = (SEAP_msgid_t)SEXP_number_getu_64(s_id);
+	SEXP_free(s_id);
+
+	for (i = 0; i < pipe->req_cnt; ++i)
+		if (pipe->req[i].id == id)
+			break;
+
+	if (i == pipe->req_cnt) {
+		dW("Dropping a reply to an unknown request: id=%u.", (unsigned int)id);
+		SEAP_msg_free(s_imsg);
+		return (0);
+	}
+
+	syschar = pipe->req[i].syschar;
+	pipe->req[i] = pipe->req[--pipe->req_cnt];
+
+	s_sys = SEAP_msg_get(s_imsg);
+	SEAP_msg_free(s_imsg);
+
+	oval_string_map_put(pext->pipe_done, oval_object_get_id(oval_syschar_get_object(syschar)), syschar);
+
+	if (oval_sexp_to_sysch(s_sys, syschar) != 0) {
+		/*
+		 * Some of the items might be already converted, so the object
+		 * can't be simply queried again.
+		 */
+		oval_syschar_add_new_message(syschar, "Unable to process the reply from probe", OVAL_MESSAGE_LEVEL_ERROR);
+		oval_syschar_set_flag(syschar, SYSCHAR_FLAG_ERROR);
+	}
+
 	SEXP_free(s_sys);
 
+	return (0);
+}
+
+int oval_probe_ext_eval_pipelined(oval_pext_t *pext, struct oval_syschar *syschar[], size_t count)
+{
+	struct oval_probe_pipe *pipes;
+	size_t pipe_cnt, i, n, k, *idx;
+	SEAP_CTX_t *ctx;
+	oval_subtype_t type;
+	oval_pd_t *pd;
+	bool *ready;
+	int *sds, ret = 0;
+
+	if (pext->pipe_depth == 0 || count == 0 || pext->pdtbl == NULL)
+		return (0);
+
+	ctx = pext->pdtbl->ctx;
+
+	if (pext->pipe_done != NULL)
+		oval_string_map_free(pext->pipe_done, NULL);
+	pext->pipe_done = oval_string_map_new();
+
+	/*
+	 * One pipe per probe, each one gets a slice of the sorted array.
+	 */
+	qsort(syschar, count, sizeof(struct oval_syschar *),
+	      (int(*)(const void *, const void *))oval_syschar_subtypecmp);
+
+	pipes    = oscap_alloc(sizeof(struct oval_probe_pipe) * count);
+	pipe_cnt = 0;
+
+	for (i = 0; i < count; i += n) {
+		type = oval_object_get_subtype(oval_syschar_get_object(syschar[i]));
+
+		for (n = 1; i + n < count; ++n)
+			if (oval_object_get_subtype(oval_syschar_get_object(syschar[i + n])) != type)
+				break;
+
+		if (oval_probe_ext_getpd(pext, type, &pd) != 0)
+			continue; /* reported by the regular evaluation */
+
+		pipes[pipe_cnt].pd        = pd;
+		pipes[pipe_cnt].queue     = syschar + i;
+		pipes[pipe_cnt].queue_cnt = n;
+		pipes[pipe_cnt].req       = oscap_alloc(sizeof(struct oval_probe_pipereq) * pext->pipe_depth);
+		pipes[pipe_cnt].req_cnt   = 0;
+		pipes[pipe_cnt].failed    = false;
+		pipe_cnt++;
+	}
+
+	dI("Pipelined evaluation of %zu objects, %zu probes, depth %zu.", count, pipe_cnt, pext->pipe_depth);
+
+	sds   = oscap_alloc(sizeof(int) * (pipe_cnt + 1));
+	idx   = oscap_alloc(sizeof(size_t) * (pipe_cnt + 1));
+	ready = oscap_alloc(sizeof(bool) * (pipe_cnt + 1));
+
+	for (;;) {
+		for (i = 0; i < pipe_cnt; ++i) {
+			while (!pipes[i].failed && pipes[i].queue_cnt > 0 && pipes[i].req_cnt < pext->pipe_depth)
+				oval_probe_pipe_send(pext, pipes + i);
+		}
+
+		for (i = 0, n = 0; i < pipe_cnt; ++i) {
+			if (pipes[i].req_cnt == 0)
+				continue;
+
+			sds[n] = pipes[i].pd->sd;
+			idx[n] = i;
+			n++;
+		}
+
+		if (n == 0)
+			break;
+
+		/*
+		 * Wait for a reply from any of the probes, the replies are
+		 * received in the order in which the probes finish.
+		 */
+		if (SEAP_select(ctx, sds, ready, n) < 0) {
+			protect_errno {
+				dW("Can't wait for the replies: %u, %s.", errno, strerror(errno));
+			}
+
+			for (k = 0; k < n; ++k)
+				oval_probe_pipe_close(ctx, pipes + idx[k]);
+			break;
+		}
+
+		for (k = 0; k < n; ++k) {
+			if (!ready[k])
+				continue;
+
+			if (oval_probe_pipe_recv(pext, pipes + idx[k]) != 0 && errno == ECONNABORTED) {
+				dI("Connection was aborted.");
+				ret = -2;
+				break;
+			}
+		}
+
+		if (ret != 0)
+			break;
+	}
+
+	oscap_free(sds);
+	oscap_free(idx);
+	oscap_free(ready);
+
+	for (i = 0; i < pipe_cnt; ++i)
+		oscap_free(pipes[i].req);
+	oscap_free(pipes);
+
+	if (ret == -2) {
+		oval_probe_ext_restart(pext);
+		errno = ECONNABORTED;
+	}
+
 	return (ret);
 }
 
+bool oval_probe_ext_pipe_done(oval_pext_t *pext, const char *id)
+{
+	return (pext->pipe_done != NULL && oval_string_map_get_value(pext->pipe_done, id) != NULL);
+}
+
 int oval_probe_ext_reset(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext)
 {
         SEAP_cmd_exec(ctx, pd->sd, SEAP_EXEC_RECV, PROBECMD_RESET, NULL, SEAP_CMDTYPE_SYNC, NULL, NULL);
@@ -61,10 +61,26 @@ struct oval_pext {
 
         void *sess_ptr;
         struct oval_syschar_model **model;
+
+        size_t        pipe_depth; /**< max. number of requests in flight per probe, 0 = no pipelining */
+        char         *fscache_dir; /**< directory listing cache shared by the probes, see fscache.h */
+        struct oval_string_map *set_objs; /**< IDs of the objects referenced by set objects */
+        struct oval_string_map *pipe_done; /**< IDs of the objects answered by the pipelined evaluation */
 };
 
 typedef struct oval_pext oval_pext_t;
 
+/*
+ * The depth of the object request pipeline can be changed using
+ * the environment variable below. Setting it to 0 disables the
+ * pipelined dispatch.
+ */
+#define OVAL_PROBE_PIPELINE_DEPTH_ENV "OSCAP_PROBE_PIPELINE_DEPTH"
+
+#ifndef OVAL_PROBE_PIPELINE_DEPTH
+# define OVAL_PROBE_PIPELINE_DEPTH 8
+#endif
+
 oval_pext_t *oval_pext_new(void);
 void oval_pext_free(oval_pext_t *pext);
 int oval_probe_ext_init(oval_pext_t *pext);
@@ -72,6 +88,22 @@ int oval_probe_ext_eval(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext, struc
 int oval_probe_ext_reset(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext);
 int oval_probe_ext_abort(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext);
 
+/**
+ * Send the objects of the `count' system characteristics in `syschar' to
+ * their probes without waiting for each reply. Objects which couldn't be
+ * collected this way are left with the SYSCHAR_FLAG_UNKNOWN flag so that
+ * the regular evaluation will query them again.
+ * @return 0 on success, -2 if the evaluation was aborted
+ */
+int oval_probe_ext_eval_pipelined(oval_pext_t *pext, struct oval_syschar *syschar[], size_t count);
+
+/**
+ * Check whether the object `id' was answered by the probe during the last
+ * pipelined evaluation. Such an object must not be queried again even if
+ * its flag is SYSCHAR_FLAG_UNKNOWN, the items would be added twice.
+ */
+bool oval_probe_ext_pipe_done(oval_pext_t *pext, const char *id);
+
 int oval_probe_ext_handler(oval_subtype_t type, void *ptr, int act, ...);
 int oval_probe_sys_handler(oval_subtype_t type, void *ptr, int act, ...);
 
@@ -57,6 +57,14 @@ OSCAP_HIDDEN_START;
 
 int oval_probe_query_test(oval_probe_session_t *sess, struct oval_test *test);
 
+/**
+ * Probe the objects of all definitions in the definition model of the
+ * session concurrently, before the definitions are evaluated one by one.
+ * Objects which depend on other objects are skipped.
+ * @return 0 on success, -1 on error, -2 if the evaluation was aborted
+ */
+int oval_probe_query_definitions(oval_probe_session_t *sess);
+
 OSCAP_HIDDEN_END;
 
 extern probe_ncache_t *OSCAP_GSYM(ncache);
@@ -975,30 +975,21 @@ static struct oval_sysitem *oval_sexp_to_sysitem(struct oval_syschar_model *mode
 	return sysitem;
 }
 
-int oval_sexp_to_sysch(const SEXP_t *cobj, struct oval_syschar *syschar)
+/**
+ * Convert the items of a collected object and add them to the syschar,
+ * or to `pending' if it's not NULL. Items already present in `itm_id_map'
+ * are skipped, which allows to call this function repeatedly for partial
+ * replies of a probe.
+ */
+int oval_sexp_to_sysch_items(const SEXP_t *cobj, struct oval_syschar *syschar, struct oval_string_map *itm_id_map,
+                             struct oval_collection *pending)
 {
-	oval_syschar_collection_flag_t flag;
-	SEXP_t *messages, *msg, *items, *item, *mask;
+	SEXP_t *items, *item, *mask;
 	struct oval_syschar_model *model;
-	struct oval_string_map *itm_id_map;
         struct oval_string_map *item_mask_map;
 
 	_A(cobj != NULL);
 
-	flag = probe_cobj_get_flag(cobj);
-	oval_syschar_set_flag(syschar, flag);
-
-	messages = probe_cobj_get_msgs(cobj);
-	SEXP_list_foreach(msg, messages) {
-		struct oval_message *omsg;
-
-		omsg = oval_sexp_to_msg(msg);
-		if (omsg != NULL)
-			oval_syschar_add_message(syschar, omsg);
-	}
-	SEXP_free(messages);
-
-	itm_id_map = oval_string_map_new();
 	model = oval_syschar_get_model(syschar);
 	items = probe_cobj_get_items(cobj);
 
@@ -1025,16 +1016,54 @@ int oval_sexp_to_sysch(const SEXP_t *cobj, struct oval_syschar *syschar)
 			itm_id = oval_sysitem_get_id(sysitem);
 			if (oval_string_map_get_value(itm_id_map, itm_id) == NULL) {
 				oval_string_map_put(itm_id_map, itm_id, itm_id);
-				oval_syschar_add_sysitem(syschar, sysitem);
+
+				if (pending != NULL)
+					oval_collection_add(pending, sysitem);
+				else
+					oval_syschar_add_sysitem(syschar, sysitem);
 			}
 		}
 	}
 	SEXP_free(items);
-	oval_string_map_free(itm_id_map, NULL);
         if (item_mask_map != NULL)
             oval_string_map_free_string(item_mask_map);
 
 	return 0;
 }
 
+int oval_sexp_to_sysch_r(const SEXP_t *cobj, struct oval_syschar *syschar, struct oval_string_map *itm_id_map)
+{
+	oval_syschar_collection_flag_t flag;
+	SEXP_t *messages, *msg;
+
+	_A(cobj != NULL);
+
+	flag = probe_cobj_get_flag(cobj);
+	oval_syschar_set_flag(syschar, flag);
+
+	messages = probe_cobj_get_msgs(cobj);
+	SEXP_list_foreach(msg, messages) {
+		struct oval_message *omsg;
+
+		omsg = oval_sexp_to_msg(msg);
+		if (omsg != NULL)
+			oval_syschar_add_message(syschar, omsg);
+	}
+	SEXP_free(messages);
+
+	return oval_sexp_to_sysch_items(cobj, syschar, itm_id_map, NULL);
+}
+
+int oval_sexp_to_sysch(const SEXP_t *cobj, struct oval_syschar *syschar)
+{
+	struct oval_string_map *itm_id_map;
+	int ret;
+
+	itm_id_map = oval_string_map_new();
+	ret = oval_sexp_to_sysch_r(cobj, syschar, itm_id_map);
+	oval_string_map_free(itm_id_map, NULL);
+
+	return ret;
+}
+
 /// @}
@@ -37,6 +37,8 @@
 #include <seap.h>
 #include "../common/util.h"
 #include "oval_definitions_impl.h"
+#include "adt/oval_string_map_impl.h"
+#include "adt/oval_collection_impl.h"
 
 OSCAP_HIDDEN_START;
 
@@ -52,6 +54,9 @@ int oval_state_to_sexp(void *sess, struct oval_state *state, SEXP_t **out_sexp);
  * S-exp -> OVAL
  */
 int oval_sexp_to_sysch(const SEXP_t *cobj, struct oval_syschar *syschar);
+int oval_sexp_to_sysch_r(const SEXP_t *cobj, struct oval_syschar *syschar, struct oval_string_map *itm_id_map);
+int oval_sexp_to_sysch_items(const SEXP_t *cobj, struct oval_syschar *syschar, struct oval_string_map *itm_id_map,
+                             struct oval_collection *pending);
 OSCAP_HIDDEN_END;
 
 #endif				/* OVAL_SEXP_H */
@@ -31,6 +31,7 @@
 #include <config.h>
 #endif
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -50,8 +51,23 @@ typedef struct oval_sysitem {
 	struct oval_collection *messages;
 	struct oval_collection *sysents;
 	oval_syschar_status_t status;
+
+	/*
+	 * Name index of the sysents. Entities are kept in the order
+	 * they were added, `ent_next' links entities of the same name
+	 * and `ent_slot' is an open addressing table of the first
+	 * entity of each name.
+	 */
+	struct oval_sysent **ent_v;
+	int    *ent_next;
+	size_t  ent_count;
+	size_t  ent_alloc;
+	int    *ent_slot;
+	size_t  ent_slots;
 } oval_sysitem_t;				///< Represents a single <*_item> element
 
+#define OVAL_SYSITEM_SLOTS_MIN 16
+
 struct oval_sysitem *oval_sysitem_new(struct oval_syschar_model *model, const char *id)
 {
 	__attribute__nonnull__(model);
@@ -67,6 +83,12 @@ struct oval_sysitem *oval_sysitem_new(struct oval_syschar_model *model, const ch
 	sysitem->messages = oval_collection_new();
 	sysitem->sysents = oval_collection_new();
 	sysitem->model = model;
+	sysitem->ent_v = NULL;
+	sysitem->ent_next = NULL;
+	sysitem->ent_count = 0;
+	sysitem->ent_alloc = 0;
+	sysitem->ent_slot = NULL;
+	sysitem->ent_slots = 0;
 
 	oval_syschar_model_add_sysitem(model, sysitem);
 
@@ -107,6 +129,9 @@ void oval_sysitem_free(struct oval_sysitem *sysitem)
 	oval_collection_free_items(sysitem->messages, (oscap_destruct_func) oval_message_free);
 	oval_collection_free_items(sysitem->sysents, (oscap_destruct_func) oval_sysent_free);
 	oscap_free(sysitem->id);
+	oscap_free(sysitem->ent_v);
+	oscap_free(sysitem->ent_next);
+	oscap_free(sysitem->ent_slot);
 
 	sysitem->id = NULL;
 	sysitem->sysents = NULL;
@@ -170,10 +195,119 @@ struct oval_sysent_iterator *oval_sysitem_get_sysents(struct oval_sysitem *sysit
 	return (struct oval_sysent_iterator *)oval_collection_iterator(sysitem->sysents);
 }
 
+static uint32_t _oval_sysitem_name_hash(const char *name)
+{
+	uint32_t h = 2166136261u;
+
+	while (*name != '\0')
+		h = (h ^ (uint8_t)*name++) * 16777619u;
+
+	return h;
+}
+
+/*
+ * Find the slot of the entity name `name'. The slot is either empty
+ * or holds the first entity of that name.
+ */
+static size_t _oval_sysitem_slot(struct oval_sysitem *sysitem, const char *name)
+{
+	size_t mask = sysitem->ent_slots - 1;
+	size_t i = _oval_sysitem_name_hash(name) & mask;
+
+	while (sysitem->ent_slot[i] != -1 &&
+	       strcmp(oval_sysent_get_name(sysitem->ent_v[sysitem->ent_slot[i]]), name) != 0)
+		i = (i + 1) & mask;
+
+	return i;
+}
+
+static void _oval_sysitem_rehash(struct oval_sysitem *sysitem, size_t slots)
+{
+	size_t i;
+
+	oscap_free(sysitem->ent_slot);
+	sysitem->ent_slot = oscap_alloc(slots * sizeof(int));
+	sysitem->ent_slots = slots;
+
+	for (i = 0; i < slots; ++i)
+		sysitem->ent_slot[i] = -1;
+
+	/* the first entity of each name is the one without a predecessor */
+	for (i = 0; i < sysitem->ent_count; ++i) {
+		size_t slot = _oval_sysitem_slot(sysitem, oval_sysent_get_name(sysitem->ent_v[i]));
+
+		if (sysitem->ent_slot[slot] == -1)
+			sysitem->ent_slot[slot] = (int)i;
+	}
+}
+
+static void _oval_sysitem_index_sysent(struct oval_sysitem *sysitem, struct oval_sysent *sysent)
+{
+	const char *name = oval_sysent_get_name(sysent);
+	int idx, prev;
+	size_t slot;
+
+	if (name == NULL)
+		return;
+
+	if (sysitem->ent_count == sysitem->ent_alloc) {
+		sysitem->ent_alloc = sysitem->ent_alloc ? sysitem->ent_alloc * 2 : 8;
+		sysitem->ent_v = oscap_realloc(sysitem->ent_v, sysitem->ent_alloc * sizeof(struct oval_sysent *));
+		sysitem->ent_next = oscap_realloc(sysitem->ent_next, sysitem->ent_alloc * sizeof(int));
+	}
+
+	idx = (int)sysitem->ent_count++;
+	sysitem->ent_v[idx] = sysent;
+	sysitem->ent_next[idx] = -1;
+
+	/* keep the load factor at most 1/2 */
+	if (sysitem->ent_count * 2 > sysitem->ent_slots)
+		_oval_sysitem_rehash(sysitem, sysitem->ent_slots ? sysitem->ent_slots * 2 : OVAL_SYSITEM_SLOTS_MIN);
+
+	slot = _oval_sysitem_slot(sysitem, name);
+	if (sysitem->ent_slot[slot] == -1) {
+		sysitem->ent_slot[slot] = idx;
+	} else if (sysitem->ent_slot[slot] != idx) {
+		prev = sysitem->ent_slot[slot];
+		while (sysitem->ent_next[prev] != -1)
+			prev = sysitem->ent_next[prev];
+		sysitem->ent_next[prev] = idx;
+	}
+}
+
 void oval_sysitem_add_sysent(struct oval_sysitem *sysitem, struct oval_sysent *sysent)
 {
 	__attribute__nonnull__(sysitem);
 	oval_collection_add(sysitem->sysents, sysent);
+	_oval_sysitem_index_sysent(sysitem, sysent);
+}
+
+int oval_sysitem_find_sysent(struct oval_sysitem *sysitem, const char *name)
+{
+	__attribute__nonnull__(sysitem);
+
+	if (sysitem->ent_count == 0)
+		return -1;
+
+	return sysitem->ent_slot[_oval_sysitem_slot(sysitem, name)];
+}
+
+int oval_sysitem_next_sysent(struct oval_sysitem *sysitem, int pos)
+{
+	__attribute__nonnull__(sysitem);
+	return sysitem->ent_next[pos];
+}
+
+struct oval_sysent *oval_sysitem_get_sysent_at(struct oval_sysitem *sysitem, int pos)
+{
+	__attribute__nonnull__(sysitem);
+	return sysitem->ent_v[pos];
+}
+
+size_t oval_sysitem_get_sysent_count(struct oval_sysitem *sysitem)
+{
+	__attribute__nonnull__(sysitem);
+	return sysitem->ent_count;
 }
 
 oval_syschar_status_t oval_sysitem_get_status(struct oval_sysitem *data)
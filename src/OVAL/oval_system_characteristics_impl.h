@@ -50,6 +50,16 @@ int oval_sysinfo_parse_tag(xmlTextReaderPtr reader, struct oval_parser_context *
 /* sysitem */
 void oval_sysitem_to_dom(struct oval_sysitem *, xmlDoc *, xmlNode *);
 int oval_sysitem_parse_tag(xmlTextReaderPtr, struct oval_parser_context *, void *usr);
+/*
+ * Name-indexed access to the item entities, e.g.
+ *
+ *   for (i = oval_sysitem_find_sysent(item, name); i != -1; i = oval_sysitem_next_sysent(item, i))
+ *           ent = oval_sysitem_get_sysent_at(item, i);
+ */
+int oval_sysitem_find_sysent(struct oval_sysitem *sysitem, const char *name);
+int oval_sysitem_next_sysent(struct oval_sysitem *sysitem, int pos);
+struct oval_sysent *oval_sysitem_get_sysent_at(struct oval_sysitem *sysitem, int pos);
+size_t oval_sysitem_get_sysent_count(struct oval_sysitem *sysitem);
 
 /* syschar */
 void oval_syschar_to_dom(struct oval_syschar *, xmlDoc *, xmlNode *);
@@ -45,6 +45,9 @@ struct SEAP_CTX {
 
         uint16_t recv_timeout;
         uint16_t send_timeout;
+
+        char   **peer_env; /* "name=value" entries added to the environment of spawned peers */
+        size_t   peer_envc;
 };
 
 OSCAP_HIDDEN_END;
@@ -1,6 +1,8 @@
 #ifndef _SEXP_ID_H
 #define _SEXP_ID_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include "public/sexp-ID.h"
 
 typedef struct {
@@ -8,4 +10,15 @@ typedef struct {
 	int       part;
 } __IDres_pair;
 
+/*
+ * Hash of the contents of a string value. Interned strings carry it
+ * with them.
+ */
+SEXP_ID_t SEXP_ID_string(const void *str, size_t len, int part);
+
+/* the cached SEXP_ID_string() results follow the string of an interned value */
+#define SEXP_ATOM_IDOFF(len)  (((len) + 7) & ~((size_t)7))
+#define SEXP_ATOM_IDP(mem, len, part) \
+	((uint8_t *)(mem) + SEXP_ATOM_IDOFF(len) + (part) * sizeof (SEXP_ID_t))
+
 #endif /* _SEXP_ID_H */
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+
+
+#pragma once
+#ifndef _SEXP_ARENA_H
+#define _SEXP_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "public/sexp-arena.h"
+#include "../../../common/util.h"
+
+OSCAP_HIDDEN_START;
+
+#ifndef SEXP_ARENA_CHUNK_SIZE
+#define SEXP_ARENA_CHUNK_SIZE (64 * 1024)
+#endif
+
+/* address space reserved for the chunks of all arenas */
+#ifndef SEXP_ARENA_REGION_SIZE
+#define SEXP_ARENA_REGION_SIZE (sizeof (void *) > 4 ? ((size_t)1 << 30) : ((size_t)1 << 26))
+#endif
+
+/* larger blocks are always allocated using the regular allocator */
+#define SEXP_ARENA_MAXALLOC (SEXP_ARENA_CHUNK_SIZE / 8)
+
+struct SEXP_arena_chunk {
+        volatile uint32_t        live; /* number of live blocks + 1 while owned by the arena */
+        uint32_t                 used;
+        struct SEXP_arena_chunk *next; /* next unused chunk */
+        uint8_t                  mem[] __attribute__ ((aligned (16)));
+};
+
+struct SEXP_arena {
+        struct SEXP_arena_chunk *chunk; /* current chunk */
+};
+
+/*
+ * Memory for values and list blocks. Blocks allocated while there is
+ * no current arena (or when the arena can't be used) are allocated
+ * using sm_memalign(). `align' must be a power of two not smaller than
+ * sizeof(void *).
+ */
+void *SEXP_valmem_alloc (size_t size, size_t align);
+void  SEXP_valmem_free  (void *mem, size_t align);
+
+OSCAP_HIDDEN_END;
+
+#endif /* _SEXP_ARENA_H */
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+
+#pragma once
+#ifndef _SEXP_BINARY_H
+#define _SEXP_BINARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "public/sexp-binary.h"
+#include "_sexp-types.h"
+#include "../../../common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/*
+ * Binary transport format
+ *
+ *  frame := MAGIC LENGTH sexp          LENGTH: 4 octets, big endian
+ *  sexp  := TAG [dtype] body           dtype present if TAG & SEXP_BIN_DTYPE
+ *  dtype := varint(length) octets
+ *  body  := varint(length) octets      (SEXP_BIN_STRING)
+ *         | varint(n)                  (SEXP_BIN_UINT)
+ *         | varint(-(n + 1))           (SEXP_BIN_NINT)
+ *         | 8 octets, IEEE 754, LE     (SEXP_BIN_DOUBLE)
+ *         | <empty>                    (SEXP_BIN_TRUE, SEXP_BIN_FALSE)
+ *         | varint(count) sexp*        (SEXP_BIN_LIST)
+ *
+ * Varints are unsigned LEB128. Integers are narrowed on input
+ * the same way the text parser does it, so a tree received in
+ * the binary format is identical to a tree received as text.
+ * Doubles are transferred without the loss of precision.
+ *
+ * The magic octet can't start a text S-exp, which allows the
+ * receiver to autodetect the format of each frame.
+ */
+#define SEXP_BIN_MAGIC   0xB1
+#define SEXP_BIN_HDRLEN  5
+
+#define SEXP_BIN_STRING  0x01
+#define SEXP_BIN_UINT    0x02
+#define SEXP_BIN_NINT    0x03
+#define SEXP_BIN_DOUBLE  0x04
+#define SEXP_BIN_TRUE    0x05
+#define SEXP_BIN_FALSE   0x06
+#define SEXP_BIN_LIST    0x07
+#define SEXP_BIN_TMASK   0x0f
+#define SEXP_BIN_DTYPE   0x80
+
+#define SEXP_BIN_MAXDEPTH 1024
+
+/*
+ * Frame reassembly buffer used by the SEAP receive loop
+ */
+typedef struct {
+        uint8_t *b_buf;
+        size_t   b_len;
+        size_t   b_cap;
+} SEXP_bstate_t;
+
+SEXP_bstate_t *SEXP_bstate_new (void);
+void           SEXP_bstate_free (SEXP_bstate_t *bstate);
+bool           SEXP_bstate_pendingp (const SEXP_bstate_t *bstate);
+int            SEXP_bstate_add (SEXP_bstate_t *bstate, const void *buf, size_t buflen);
+SEXP_t        *SEXP_bstate_parse (SEXP_bstate_t *bstate);
+
+OSCAP_HIDDEN_END;
+
+#endif /* _SEXP_BINARY_H */
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+
+#pragma once
+#ifndef _SEXP_SCAN_H
+#define _SEXP_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../../../common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/*
+ * Select the implementation of the scanners (scalar, sse2, avx2).
+ * By default the fastest one supported by the CPU is used.
+ */
+#define SEXP_SCAN_ENV "SEXP_SCAN"
+
+/*
+ * Scanners used by the parser to skip over the bytes of a token.
+ * Each of them returns the index of the first byte of `buf' which
+ * stops the scan or `len' if there's no such byte.
+ */
+typedef struct {
+        const char *name;
+        size_t (*nextexp) (const uint8_t *buf, size_t len); /* start or end of an expression */
+        size_t (*dquote)  (const uint8_t *buf, size_t len); /* '"' or '\\' */
+        size_t (*nonspace)(const uint8_t *buf, size_t len); /* not one of " \t\n\v\f\r" */
+        size_t (*nondigit)(const uint8_t *buf, size_t len); /* not one of "0123456789" */
+} SEXP_scan_t;
+
+const SEXP_scan_t *SEXP_scan_get (void);
+
+OSCAP_HIDDEN_END;
+
+#endif /* _SEXP_SCAN_H */
@@ -41,9 +41,24 @@ typedef uint8_t SEXP_valtype_t;
 
 typedef struct {
         uint32_t refs;
+        uint32_t flags __attribute__ ((aligned (4)));
         size_t   size;
 } __attribute__ ((packed)) SEXP_valhdr_t;
 
+/* the value is an interned string, see SEXP_string_atom() */
+#define SEXP_VALHDR_ATOM 0x00000001
+/* the list has a cached ID, cleared when the list is modified */
+#define SEXP_VALHDR_IDV  0x00000002
+
+/*
+ * Lists are shared by the threads, so the cached IDs are written using
+ * atomic stores and published by setting the IDV flag (release/acquire).
+ * The IDs aren't cached without native 64-bit atomics.
+ */
+#if defined(HAVE_ATOMIC_BUILTINS) && defined(__ATOMIC_ACQUIRE) && defined(__LP64__)
+# define SEXP_LIST_IDCACHE 1
+#endif
+
 typedef struct {
         uintptr_t      ptr;
         SEXP_valhdr_t *hdr;
@@ -58,6 +73,7 @@ typedef struct {
 
 int       SEXP_val_new (SEXP_val_t *dst, size_t vmemsize, SEXP_valtype_t type);
 void      SEXP_val_dsc (SEXP_val_t *dst, uintptr_t ptr);
+void      SEXP_val_free (SEXP_valhdr_t *hdr);
 uintptr_t SEXP_val_ptr (SEXP_val_t *dsc);
 
 uintptr_t SEXP_rawval_incref (uintptr_t valp);
@@ -84,11 +100,30 @@ SEXP_DEFNUM(u64, uint64_t);
  * List
  */
 
+/*
+ * The cached ID makes a list value (header included) take 48 bytes of
+ * aligned memory instead of 32 bytes. The members are stored in a separate
+ * list block of at least 32 bytes, so a list with members grows by a
+ * quarter at most, and in exchange an unmodified item isn't rehashed by
+ * SEXP_ID_v().
+ */
 struct SEXP_val_list {
+#if defined(SEXP_LIST_IDCACHE)
+        uint64_t id __attribute__ ((aligned (8))); /* cached SEXP_ID_v() result, see sexp-ID.c */
+        uint64_t id_stamp;
+#endif
         void    *b_addr;
         uint16_t offset;
 } __attribute__ ((packed));
 
+#if defined(SEXP_LIST_IDCACHE)
+# define SEXP_LIST_IDVALID(hdr) (__atomic_load_n (&(hdr)->flags, __ATOMIC_ACQUIRE) & SEXP_VALHDR_IDV)
+# define SEXP_LIST_IDRESET(dsc) ((void) __atomic_fetch_and (&(dsc)->hdr->flags, ~SEXP_VALHDR_IDV, __ATOMIC_RELEASE))
+#else
+# define SEXP_LIST_IDVALID(hdr) 0
+# define SEXP_LIST_IDRESET(dsc) ((void) (dsc))
+#endif
+
 #define SEXP_LCASTP(p) ((struct SEXP_val_list *)(p))
 
 struct SEXP_val_lblk {
@@ -102,6 +137,7 @@ size_t    SEXP_rawval_list_length (struct SEXP_val_list *list);
 uintptr_t SEXP_rawval_list_copy (uintptr_t s_valp);
 
 uintptr_t SEXP_rawval_lblk_copy (uintptr_t lblkp, uint16_t n_skip);
+uintptr_t SEXP_rawval_lblk_copyn (uintptr_t lblkp, uint16_t n_skip, size_t n_min);
 uintptr_t SEXP_rawval_lblk_new  (uint8_t sz);
 uintptr_t SEXP_rawval_lblk_incref (uintptr_t lblkp);
 int       SEXP_rawval_lblk_decref (uintptr_t lblkp);
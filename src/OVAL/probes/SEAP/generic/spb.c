@@ -321,6 +321,27 @@ uint8_t spb_octet (spb_t *spb, spb_size_t idx)
         return (uint8_t)(-1);
 }
 
+spb_size_t spb_scan (spb_t *spb, spb_size_t start, size_t (*scan)(const uint8_t *, size_t))
+{
+        uint32_t   b_idx;
+        spb_size_t b_start;
+        size_t     l_off, l, n;
+
+        b_idx = spb_bindex (spb, start);
+
+        for (; b_idx < spb->btotal; ++b_idx) {
+                b_start = (b_idx > 0 ? spb->buffer[b_idx - 1].gend + 1 : 0);
+                l_off   = (size_t)(start > b_start ? start - b_start : 0);
+                l       = (size_t)(spb->buffer[b_idx].gend - b_start + 1) - l_off;
+                n       = scan ((uint8_t *)(spb->buffer[b_idx].base) + l_off, l);
+
+                if (n < l)
+                        return (b_start + l_off + n);
+        }
+
+        return (spb_size (spb));
+}
+
 const uint8_t *spb_direct (spb_t *spb, spb_size_t start, spb_size_t size)
 {
         uint32_t b_idx;
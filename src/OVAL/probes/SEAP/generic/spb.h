@@ -168,4 +168,17 @@ spb_size_t spb_drop_head (spb_t *spb, spb_size_t size, spb_flags_t flags);
 uint8_t spb_octet (spb_t *spb, spb_size_t idx);
 const uint8_t *spb_direct (spb_t *spb, spb_size_t start, spb_size_t size);
 
+/**
+ * Scan the sparse buffer from index start using the `scan' function
+ * which is called for each of the underlying buffers. The function
+ * returns the index of the first byte where the scan should stop or
+ * the length of the buffer if there's none.
+ * @param spb sparse buffer
+ * @param start starting index
+ * @param scan scanning function
+ * @return index of the byte where the scan stopped or the size of
+ *         the sparse buffer if the end of the buffer was reached
+ */
+spb_size_t spb_scan (spb_t *spb, spb_size_t start, size_t (*scan)(const uint8_t *, size_t));
+
 #endif /* SPB_H */
@@ -33,6 +33,8 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <sexp.h>
 #include <seap-types.h>
 #include <seap-message.h>
@@ -51,6 +53,14 @@ SEAP_CTX_t *SEAP_CTX_new  (void);
 void        SEAP_CTX_init (SEAP_CTX_t *ctx);
 void        SEAP_CTX_free (SEAP_CTX_t *ctx);
 
+/**
+ * Add the variable `name' to the environment of the peers spawned
+ * by SEAP_connect(), overriding the value inherited from the caller.
+ * The environment of the calling process isn't changed.
+ * @return 0 on success, -1 on error
+ */
+int SEAP_CTX_setenv (SEAP_CTX_t *ctx, const char *name, const char *value);
+
 int     SEAP_connect (SEAP_CTX_t *ctx, const char *uri, uint32_t flags);
 int     SEAP_listen (SEAP_CTX_t *ctx, int sd, uint32_t maxcli);
 int     SEAP_accept (SEAP_CTX_t *ctx, int sd);
@@ -85,6 +95,14 @@ int SEAP_recverr_byid (SEAP_CTX_t *ctx, int sd, SEAP_err_t **err, SEAP_msgid_t i
 
 int SEAP_replyerr (SEAP_CTX_t *ctx, int sd, SEAP_msg_t *rep_msg, uint32_t e);
 
+/**
+ * Wait until something can be received from at least one of the `count'
+ * descriptors in `sd'. The corresponding items of `ready' are set to true
+ * for the descriptors which can be read without blocking.
+ * @return the number of ready descriptors, -1 on error
+ */
+int SEAP_select (SEAP_CTX_t *ctx, const int sd[], bool ready[], size_t count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+
+
+#pragma once
+#ifndef SEXP_ARENA_H
+#define SEXP_ARENA_H
+
+#include "sexp-types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * S-exp value arena. While an arena is set as the current arena of
+ * a thread, the values and list blocks created by that thread are
+ * carved out of large chunks owned by the arena instead of being
+ * allocated one by one. The values are still reference counted and
+ * may outlive the arena: a chunk is returned in one step as soon as
+ * the arena is freed and all the values allocated from the chunk
+ * are freed too.
+ */
+typedef struct SEXP_arena SEXP_arena_t;
+
+SEXP_arena_t *SEXP_arena_new (void);
+
+/**
+ * Set the current arena of the calling thread. NULL switches
+ * back to the regular allocator.
+ * @return the previous current arena
+ */
+SEXP_arena_t *SEXP_arena_switch (SEXP_arena_t *arena);
+
+/**
+ * Free the arena. The arena must not be the current arena of
+ * any thread.
+ */
+void SEXP_arena_free (SEXP_arena_t *arena);
+
+/**
+ * Get a value which doesn't pin any arena chunk. The parts of the value
+ * carved out of an arena are copied using the regular allocator, the
+ * rest is shared with `s_exp'.
+ * @return a new reference to the value or to its copy
+ */
+SEXP_t *SEXP_arena_detach (const SEXP_t *s_exp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEXP_ARENA_H */
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+
+#pragma once
+#ifndef SEXP_BINARY_H
+#define SEXP_BINARY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sexp-types.h>
+#include <strbuf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Append a binary transport frame containing `s_exp' to `sb'.
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int SEXP_sbprintf_b (const SEXP_t *s_exp, strbuf_t *sb);
+
+/**
+ * Check whether `buf' starts with a binary transport frame.
+ */
+bool SEXP_bin_framep (const void *buf, size_t buflen);
+
+/**
+ * Decode one binary transport frame from `buf'. The number of
+ * consumed bytes is stored at `*used' (if not NULL).
+ * @return the decoded S-exp or NULL on error. errno is set to
+ *         EAGAIN if the frame is not complete yet and to EILSEQ
+ *         if the frame is malformed.
+ */
+SEXP_t *SEXP_bin_parse (const void *buf, size_t buflen, size_t *used);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEXP_BINARY_H */
@@ -234,6 +234,17 @@ SEXP_t *SEXP_string_new  (const void *string, size_t strlen) __attribute__ ((non
  */
 SEXP_t *SEXP_string_newf (const char *format, ...) __attribute__ ((format (printf, 1, 2), nonnull (1)));
 
+/**
+ * Get the interned sexp object of a string. All the calls with equal
+ * strings share one value, so such objects are SEXP_eq() and their
+ * comparison is immediate. Meant for the strings that repeat a lot,
+ * like entity and attribute names or enumeration values. Long strings
+ * and strings over the limit of the intern table get a regular value.
+ * @param string the string to be stored
+ * @return NULL with errno set to EFAULT if `string' is NULL
+ */
+SEXP_t *SEXP_string_atom (const char *string);
+
 /**
  * Free the specified sexp object.
  * @param s_exp the object to be freed
@@ -381,6 +392,16 @@ SEXP_t *SEXP_list_nth (const SEXP_t *list, uint32_t n);
  */
 SEXP_t *SEXP_list_add (SEXP_t *list, const SEXP_t *s_exp);
 
+/**
+ * Make the list flat: store all its elements in a single block with
+ * room for at least `n' elements (up to 2^15), so that they are accessed
+ * by index in constant time and adding up to `n' elements doesn't
+ * allocate. Use it for lists whose final size is known in advance.
+ * @param list the modified sexp object
+ * @param n the expected number of elements
+ */
+SEXP_t *SEXP_list_reserve (SEXP_t *list, size_t n);
+
 /**
  * Create a new list containing the concatenated contents of two lists.
  * This function increments element's reference count.
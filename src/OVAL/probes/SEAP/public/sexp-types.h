@@ -71,6 +71,7 @@ typedef uint8_t SEXP_format_t;
 #define SEXP_FMT_CANONICAL  2
 #define SEXP_FMT_ADVANCED   3
 #define SEXP_FMT_AUTODETECT 4
+#define SEXP_FMT_BINARY     5
 
 #define SEXP_TYPE_EMPTY  0
 #define SEXP_TYPE_STRING 1
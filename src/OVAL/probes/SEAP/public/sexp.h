@@ -29,6 +29,8 @@
 #include <sexp-manip_r.h>
 #include <sexp-parser.h>
 #include <sexp-output.h>
+#include <sexp-binary.h>
+#include <sexp-arena.h>
 #include <sexp-ID.h>
 
 #endif /* SEXP_H */
@@ -100,3 +100,9 @@ int sch_cons_select (SEAP_desc_t *desc, int ev, uint16_t timeout, uint32_t flags
 {
         return (-1);
 }
+
+int sch_cons_fd (SEAP_desc_t *desc, int ev)
+{
+        errno = EOPNOTSUPP;
+        return (-1);
+}
@@ -75,3 +75,9 @@ int sch_dummy_select (SEAP_desc_t *desc, int ev, uint16_t timeout, uint32_t flag
 {
         return (-1);
 }
+
+int sch_dummy_fd (SEAP_desc_t *desc, int ev)
+{
+        errno = EOPNOTSUPP;
+        return (-1);
+}
@@ -80,6 +80,13 @@ int sch_generic_openfd2 (SEAP_desc_t *desc, int ifd, int ofd, uint32_t flags)
         data->ofd = ofd;
         desc->scheme_data = data;
 
+        {
+                const char *fmt = getenv (SEAP_WIRE_FORMAT_ENV);
+
+                if (fmt != NULL && strcmp (fmt, "binary") == 0)
+                        desc->fmt_out = SEXP_FMT_BINARY;
+        }
+
         return (0);
 }
 
@@ -101,7 +108,8 @@ ssize_t sch_generic_sendsexp (SEAP_desc_t *desc, SEXP_t *sexp, uint32_t flags)
         ret = 0;
         sb  = strbuf_new (SEAP_STRBUF_MAX);
 
-        if (SEXP_sbprintf_t (sexp, sb) != 0)
+        if ((desc->fmt_out == SEXP_FMT_BINARY ?
+             SEXP_sbprintf_b (sexp, sb) : SEXP_sbprintf_t (sexp, sb)) != 0)
                 ret = -1;
         else
                 ret = strbuf_write (sb, DATA(desc->scheme_data)->ofd);
@@ -177,3 +185,16 @@ int sch_generic_select (SEAP_desc_t *desc, int ev, uint16_t timeout, uint32_t fl
         /* NOTREACHED */
         return (-1);
 }
+
+int sch_generic_fd (SEAP_desc_t *desc, int ev)
+{
+        switch (ev) {
+        case SEAP_IO_EVREAD:
+                return (DATA(desc->scheme_data)->ifd);
+        case SEAP_IO_EVWRITE:
+                return (DATA(desc->scheme_data)->ofd);
+        default:
+                errno = EINVAL;
+                return (-1);
+        }
+}
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 #include <limits.h>
 #include <sys/stat.h>
@@ -184,11 +185,70 @@ static int check_child (pid_t pid, int waitf)
         return (1);
 }
 
+/* is `var' overridden by one of the "name=value" entries of `env'? */
+static bool probe_environ_set (char **env, const char *var)
+{
+        size_t namelen;
+
+        if (env == NULL)
+                return (false);
+
+        namelen = strcspn (var, "=");
+
+        for (; *env != NULL; ++env) {
+                if (strncmp (*env, var, namelen) == 0 && (*env)[namelen] == '=')
+                        return (true);
+        }
+
+        return (false);
+}
+
+/*
+ * Build the environment of the probe: the inherited one with the
+ * variables set in the SEAP context. Unless the user has chosen
+ * the output format of probes explicitly, ask for the binary one.
+ * This is done before fork() so that the child doesn't need to
+ * allocate memory.
+ */
+static char **probe_environ (char **peer_env)
+{
+        char  **envp;
+        size_t  envc, peerc, i, n;
+        bool    wire;
+
+        wire = getenv (SEAP_WIRE_FORMAT_ENV) == NULL
+                && !probe_environ_set (peer_env, SEAP_WIRE_FORMAT_ENV);
+
+        if (!wire && peer_env == NULL)
+                return (NULL);
+
+        for (envc  = 0; environ[envc] != NULL; ++envc);
+        for (peerc = 0; peer_env != NULL && peer_env[peerc] != NULL; ++peerc);
+
+        envp = sm_alloc (sizeof (char *) * (envc + peerc + 2));
+
+        for (i = 0, n = 0; i < envc; ++i) {
+                if (!probe_environ_set (peer_env, environ[i]))
+                        envp[n++] = environ[i];
+        }
+
+        for (i = 0; i < peerc; ++i)
+                envp[n++] = peer_env[i];
+
+        if (wire)
+                envp[n++] = SEAP_WIRE_FORMAT_ENV "=binary";
+
+        envp[n] = NULL;
+
+        return (envp);
+}
+
 int sch_pipe_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags)
 {
         sch_pipedata_t *data;
         pid_t pid;
         int   pfd[2] = { -1, -1 };
+        char **envp;
 
         assume_r (desc != NULL, -1, errno = EFAULT;);
         assume_r (uri  != NULL, -1, errno = EFAULT;);
@@ -212,8 +272,13 @@ int sch_pipe_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags)
         if (socketpair (AF_UNIX, SOCK_STREAM, 0, pfd) < 0)
                 goto fail1;
 
+        envp = probe_environ (desc->peer_env);
+
         switch (pid = fork ()) {
         case -1: /* error */
+                protect_errno {
+                        sm_free (envp);
+                }
                 goto fail1;
         case  0: /* child */
                 close (pfd[0]);
@@ -225,10 +290,12 @@ int sch_pipe_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags)
                         _exit (errno);
                 if (dup2 (pfd[1], STDOUT_FILENO) != STDOUT_FILENO)
                         _exit (errno);
-                execl (data->execpath, data->execpath, NULL);
+                execle (data->execpath, data->execpath, NULL,
+                        envp != NULL ? envp : environ);
                 _exit (errno);
         default: /* parent */
                 close (pfd[1]);
+                sm_free (envp);
 
                 data->pfd = pfd[0];
                 data->pid = pid;
@@ -324,7 +391,8 @@ ssize_t sch_pipe_sendsexp (SEAP_desc_t *desc, SEXP_t *sexp, uint32_t flags)
                 ret = 0;
                 sb  = strbuf_new (SEAP_STRBUF_MAX);
 
-                if (SEXP_sbprintf_t (sexp, sb) != 0)
+                if ((desc->fmt_out == SEXP_FMT_BINARY ?
+                     SEXP_sbprintf_b (sexp, sb) : SEXP_sbprintf_t (sexp, sb)) != 0)
                         ret = -1;
                 else
                         ret = strbuf_write (sb, data->pfd);
@@ -437,3 +505,17 @@ int sch_pipe_select (SEAP_desc_t *desc, int ev, uint16_t timeout, uint32_t flags
 
         return (-1);
 }
+
+int sch_pipe_fd (SEAP_desc_t *desc, int ev)
+{
+        sch_pipedata_t *data;
+
+        assume_d (desc != NULL, -1, errno = EFAULT;);
+
+        data = (sch_pipedata_t *)desc->scheme_data;
+
+        assume_r (data != NULL, -1, errno = EBADF;);
+
+        /* the same descriptor is used in both directions */
+        return (data->pfd);
+}
@@ -44,6 +44,7 @@ ssize_t sch_pipe_send (SEAP_desc_t *desc, void *buf, size_t len, uint32_t flags)
 ssize_t sch_pipe_sendsexp (SEAP_desc_t *desc, SEXP_t *sexp, uint32_t flags);
 int sch_pipe_close (SEAP_desc_t *desc, uint32_t flags);
 int sch_pipe_select (SEAP_desc_t *desc, int ev, uint16_t timeout, uint32_t flags);
+int sch_pipe_fd (SEAP_desc_t *desc, int ev);
 
 OSCAP_HIDDEN_END;
 
@@ -67,12 +67,15 @@ int SEAP_desc_add (SEAP_desctable_t *sd_table, SEXP_pstate_t *pstate,
                 sd_dsc->next_id = 0;
                 /* sd_dsc->sexpcnt = 0; */
                 sd_dsc->pstate  = pstate;
+                sd_dsc->bstate  = SEXP_bstate_new ();
+                sd_dsc->fmt_out = SEXP_FMT_CANONICAL;
                 sd_dsc->scheme  = scheme;
                 sd_dsc->scheme_data = scheme_data;
                 sd_dsc->ostate  = NULL;
                 sd_dsc->next_cid = 0;
                 sd_dsc->cmd_c_table = SEAP_cmdtbl_new ();
                 sd_dsc->cmd_w_table = SEAP_cmdtbl_new ();
+                sd_dsc->peer_env    = NULL;
 		sd_dsc->msg_queue = NULL;
 		sd_dsc->err_queue = rbt_i32_new();
 		sd_dsc->cmd_queue = NULL;
@@ -131,6 +134,7 @@ void SEAP_desc_free(SEAP_desc_t *dsc)
         SEAP_cmdtbl_free(dsc->cmd_c_table);
         SEAP_cmdtbl_free(dsc->cmd_w_table);
 	SEAP_packetq_free(&dsc->pck_queue);
+        SEXP_bstate_free(dsc->bstate);
         pthread_mutex_destroy(&(dsc->r_lock));
         pthread_mutex_destroy(&(dsc->w_lock));
 	rbt_i32_free_cb(dsc->err_queue, __SEAP_desc_errqueue_free_cb);
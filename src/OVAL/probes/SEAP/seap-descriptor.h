@@ -33,6 +33,7 @@
 #include "_seap-packetq.h"
 #include "_sexp-parser.h"
 #include "_sexp-output.h"
+#include "_sexp-binary.h"
 #include "_seap-command.h"
 #include "public/seap-scheme.h"
 #include "public/seap-message.h"
@@ -49,6 +50,8 @@ typedef struct {
         SEAP_msgid_t   next_id;
         SEXP_ostate_t *ostate; /* Output state */
         SEXP_pstate_t *pstate; /* Parser state */
+        SEXP_bstate_t *bstate; /* Binary frame reassembly state */
+        SEXP_format_t  fmt_out; /* Output format (text or binary) */
         SEAP_scheme_t  scheme; /* Protocol/Scheme used for this descriptor */
         void          *scheme_data; /* Protocol/Scheme related data */
 
@@ -64,12 +67,22 @@ typedef struct {
         SEAP_cmdid_t   next_cid;
         SEAP_cmdtbl_t *cmd_c_table; /* Local SEAP commands */
         SEAP_cmdtbl_t *cmd_w_table; /* Waiting SEAP commands */
+
+        char **peer_env; /* Environment of a spawned peer, only set while connecting */
 } SEAP_desc_t;
 
 #define SEAP_DESC_FDIN  0x00000001
 #define SEAP_DESC_FDOUT 0x00000002
 #define SEAP_DESC_SELF  -1
 
+/*
+ * Environment variable used to negotiate the output format of
+ * the probe side of a pipe. The library sets it to "binary" when
+ * spawning a probe unless it's already set, so "text" can be used
+ * to force the text format.
+ */
+#define SEAP_WIRE_FORMAT_ENV "SEAP_WIRE_FORMAT"
+
 typedef struct {
         rbt_t       *tree;
         bitmap_t    *bmap;
@@ -140,7 +140,8 @@ bool SEAP_msgattr_exists (SEAP_msg_t *msg, const char *name)
         /* FIXME: this is stupid */
         for (i = 0; i < msg->attrs_cnt; ++i) {
                 dD("%s ?= %s", name, msg->attrs[i].name);
-                if (strcmp (name, msg->attrs[i].name) == 0)
+                if (msg->attrs[i].name != NULL &&
+                    strcmp (name, msg->attrs[i].name) == 0)
                         return (true);
         }
 
@@ -156,8 +157,9 @@ SEXP_t *SEAP_msgattr_get (SEAP_msg_t *msg, const char *name)
 
         /* FIXME: this is stupid */
         for (i = 0; i < msg->attrs_cnt; ++i) {
-                if (strcmp (name, msg->attrs[i].name) == 0)
-                        return SEXP_ref (msg->attrs[i].value);
+                if (msg->attrs[i].name != NULL &&
+                    strcmp (name, msg->attrs[i].name) == 0)
+                        return (msg->attrs[i].value != NULL ? SEXP_ref (msg->attrs[i].value) : NULL);
         }
 
         return (NULL);
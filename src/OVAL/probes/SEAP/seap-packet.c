@@ -171,7 +171,8 @@ static int SEAP_packet_sexp2msg (SEXP_t *sexp_msg, SEAP_msg_t *seap_msg)
 
                                 SEXP_free (attr_val);
                         } else {
-                                seap_msg->attrs[attr_i].name  = SEXP_string_subcstr (attr_name, 1, 0);
+                                seap_msg->attrs[attr_i].name  = SEXP_string_subcstr (attr_name, 1,
+                                                                                   SEXP_string_length (attr_name) - 1);
                                 seap_msg->attrs[attr_i].value = SEXP_list_nth (sexp_msg, msg_n + 1);
 
                                 if (seap_msg->attrs[attr_i].value == NULL) {
@@ -701,7 +702,7 @@ eloop_exit:
                         sm_free (data_buffer);
                         SEXP_psetup_free (psetup);
 
-                        if (pstate != NULL) {
+                        if (pstate != NULL || SEXP_bstate_pendingp (dsc->bstate)) {
                                 dI("FAIL: incomplete S-exp received");
                                 errno = ENETRESET;
                                 return (-1);
@@ -718,34 +719,65 @@ eloop_exit:
 			data_buflen = data_length;
 		}
 
-                sexp_buffer = SEXP_parse (psetup, data_buffer, data_length, &pstate);
-
-                if (sexp_buffer != NULL) {
-                        _A(pstate == NULL);
+                if (pstate == NULL &&
+                    (SEXP_bstate_pendingp (dsc->bstate) ||
+                     SEXP_bin_framep (data_buffer, data_length)))
+                {
+                        /*
+                         * Binary frames are collected in the descriptor
+                         * until they're complete and decoded without
+                         * going through the text parser.
+                         */
+                        if (SEXP_bstate_add (dsc->bstate, data_buffer, data_length) != 0) {
+                                protect_errno {
+                                        sm_free (data_buffer);
+                                        SEXP_psetup_free (psetup);
+                                }
+                                return (-1);
+                        }
 
-                        DESC_RUNLOCK(dsc);
+                        sm_free (data_buffer);
+                        sexp_buffer = SEXP_bstate_parse (dsc->bstate);
 
-                        if (SEXP_list_length (sexp_buffer) > 0) {
+                        if (sexp_buffer != NULL) {
+                                DESC_RUNLOCK(dsc);
                                 break;
-                        } else {
-                                SEXP_list_free (sexp_buffer);
+                        } else if (errno != EAGAIN) {
+                                dI("FAIL: malformed binary frame received: dsc=%p", dsc);
                                 SEXP_psetup_free (psetup);
-                                dI("eloop_restart");
-                                goto eloop_start;
+                                errno = EILSEQ;
+                                return (-1);
                         }
                 } else {
-			if (pstate == NULL || SEXP_pstate_errorp(pstate)) {
-				dI("FAIL: S-exp parsing error, buffer: length: %ld, content:\n%.*s",
-				   data_length, data_length, data_buffer);
+                        sexp_buffer = SEXP_parse (psetup, data_buffer, data_length, &pstate);
 
-				SEXP_psetup_free(psetup);
-				SEXP_pstate_free(pstate);
+                        if (sexp_buffer != NULL) {
+                                _A(pstate == NULL);
 
-				errno = EILSEQ;
+                                DESC_RUNLOCK(dsc);
 
-				return (-1);
+                                if (SEXP_list_length (sexp_buffer) > 0) {
+                                        break;
+                                } else {
+                                        SEXP_list_free (sexp_buffer);
+                                        SEXP_psetup_free (psetup);
+                                        dI("eloop_restart");
+                                        goto eloop_start;
+                                }
+                        } else {
+				if (pstate == NULL || SEXP_pstate_errorp(pstate)) {
+					dI("FAIL: S-exp parsing error, buffer: length: %ld, content:\n%.*s",
+					   data_length, data_length, data_buffer);
+
+					SEXP_psetup_free(psetup);
+					SEXP_pstate_free(pstate);
+
+					errno = EILSEQ;
+
+					return (-1);
+				}
 			}
-		}
+                }
 
                 if (SCH_SELECT(dsc->scheme, dsc, SEAP_IO_EVREAD, ctx->recv_timeout, 0) != 0) {
                         switch (errno) {
@@ -25,11 +25,13 @@
 #endif
 
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <pthread.h>
 #include <errno.h>
+#include <poll.h>
 #include "common/assume.h"
 #include "public/seap.h"
 #include "public/sm_alloc.h"
@@ -61,6 +63,9 @@ static void SEAP_CTX_initdefault (SEAP_CTX_t *ctx)
         ctx->send_timeout = 5;
         ctx->cflags       = 0;
 
+        ctx->peer_env  = NULL;
+        ctx->peer_envc = 0;
+
         return;
 }
 
@@ -86,11 +91,44 @@ void SEAP_CTX_free (SEAP_CTX_t *ctx)
         _A(ctx != NULL);
         SEAP_desctable_free(ctx->sd_table);
         SEAP_cmdtbl_free (ctx->cmd_c_table);
+
+        while (ctx->peer_envc > 0)
+                sm_free (ctx->peer_env[--ctx->peer_envc]);
+        sm_free (ctx->peer_env);
         sm_free (ctx);
 
         return;
 }
 
+int SEAP_CTX_setenv (SEAP_CTX_t *ctx, const char *name, const char *value)
+{
+        size_t i, namelen;
+        char  *entry;
+
+        assume_r (ctx   != NULL, -1, errno = EFAULT;);
+        assume_r (name  != NULL, -1, errno = EFAULT;);
+        assume_r (value != NULL, -1, errno = EFAULT;);
+        assume_r (*name != '\0' && strchr (name, '=') == NULL, -1, errno = EINVAL;);
+
+        namelen = strlen (name);
+        entry   = sm_alloc (namelen + strlen (value) + 2);
+        sprintf (entry, "%s=%s", name, value);
+
+        for (i = 0; i < ctx->peer_envc; ++i) {
+                if (strncmp (ctx->peer_env[i], entry, namelen + 1) == 0) {
+                        sm_free (ctx->peer_env[i]);
+                        ctx->peer_env[i] = entry;
+                        return (0);
+                }
+        }
+
+        ctx->peer_env = sm_realloc (ctx->peer_env, sizeof (char *) * (ctx->peer_envc + 2));
+        ctx->peer_env[ctx->peer_envc++] = entry;
+        ctx->peer_env[ctx->peer_envc]   = NULL;
+
+        return (0);
+}
+
 int SEAP_connect (SEAP_CTX_t *ctx, const char *uri, uint32_t flags)
 {
         SEAP_desc_t  *dsc;
@@ -127,6 +165,8 @@ int SEAP_connect (SEAP_CTX_t *ctx, const char *uri, uint32_t flags)
                 return(-1);
         }
 
+        dsc->peer_env = ctx->peer_env;
+
         if (SCH_CONNECT(scheme, dsc, uri + schstr_len + 1, flags) != 0) {
                 dI("FAIL: errno=%u, %s.", errno, strerror (errno));
                 SEAP_desc_del(ctx->sd_table, sd);
@@ -134,6 +174,8 @@ int SEAP_connect (SEAP_CTX_t *ctx, const char *uri, uint32_t flags)
                 return (-1);
         }
 
+        dsc->peer_env = NULL;
+
         return (sd);
 }
 
@@ -575,6 +617,64 @@ int SEAP_recverr_byid (SEAP_CTX_t *ctx, int sd, SEAP_err_t **err, SEAP_msgid_t i
         return (0);
 }
 
+/*
+ * Packets which were already received and queued in the descriptor
+ * are checked first, poll() wouldn't report them.
+ */
+int SEAP_select (SEAP_CTX_t *ctx, const int sd[], bool ready[], size_t count)
+{
+        struct pollfd *pfd;
+        SEAP_desc_t   *dsc;
+        size_t i;
+        int    n;
+
+        _A(ctx != NULL);
+
+        pfd = sm_alloc (sizeof (struct pollfd) * count);
+
+        for (i = 0, n = 0; i < count; ++i) {
+                dsc = SEAP_desc_get (ctx->sd_table, sd[i]);
+
+                if (dsc == NULL) {
+                        sm_free (pfd);
+                        errno = EBADF;
+                        return (-1);
+                }
+
+                ready[i] = SEAP_packetq_count (&dsc->pck_queue) > 0;
+
+                if (ready[i])
+                        ++n;
+
+                pfd[i].fd      = SCH_FD(dsc->scheme, dsc, SEAP_IO_EVREAD);
+                pfd[i].events  = POLLIN;
+                pfd[i].revents = 0;
+
+                if (pfd[i].fd < 0) {
+                        protect_errno {
+                                sm_free (pfd);
+                        }
+                        return (-1);
+                }
+        }
+
+        if (n == 0) {
+                do {
+                        n = poll (pfd, (nfds_t)count, -1);
+                } while (n < 0 && errno == EINTR);
+
+                /* hangups and errors are reported by the receive functions */
+                for (i = 0; n > 0 && i < count; ++i)
+                        ready[i] = pfd[i].revents != 0;
+        }
+
+        protect_errno {
+                sm_free (pfd);
+        }
+
+        return (n);
+}
+
 SEXP_t *SEAP_read (SEAP_CTX_t *ctx, int sd)
 {
         errno = EOPNOTSUPP;
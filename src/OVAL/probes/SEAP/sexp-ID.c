@@ -61,37 +61,118 @@ static SEXP_ID_t SEXP_ID_hash(void *buf, size_t len, SEXP_ID_t seed, int part)
         return (resbuf[part]);
 }
 
-static int SEXP_ID_v_callback(const SEXP_t *sexp, __IDres_pair *pair)
+SEXP_ID_t SEXP_ID_string(const void *str, size_t len, int part)
+{
+        return SEXP_ID_hash((void *)str, len, 0, part);
+}
+
+/*
+ * Every value is hashed on its own and the hash of a list is chained from
+ * the hashes of its members, so the ID of a list doesn't depend on where
+ * the list is. The first half of the hash (SEXP_ID_v) of a list is cached
+ * in the list value together with a stamp taken when the hash was stored.
+ * Lists clear the cached hash when they are modified. The members of a list
+ * can be modified in place though (e.g. through SEXP_listref_*), that's
+ * why the cached hash of a list is valid only if the cached hashes of all
+ * the member lists are valid and older than the hash of the list.
+ *
+ * The lists may be shared by several threads computing their IDs at the
+ * same time. The hash and the stamp are stored atomically before the IDV
+ * flag is set with release semantics and they are read only after the flag
+ * was seen set with acquire semantics. Threads storing the hash of the same
+ * list at the same time store the same hash and any of the stamps is newer
+ * than the stamps of the member lists.
+ */
+static SEXP_ID_t SEXP_ID_value(uintptr_t valp, int part);
+
+#if defined(SEXP_LIST_IDCACHE)
+static uint64_t __ID_stamp = 0;
+
+static SEXP_ID_t SEXP_ID_list(SEXP_val_t *v_dsc, int part);
+
+static int SEXP_ID_list_check(SEXP_t *memb, void *arg)
 {
         SEXP_val_t v_dsc;
 
-        assume_d(sexp != NULL, -1);
-        assume_d(pair != NULL, -1);
+        if ((memb->s_valp & SEXP_VALT_MASK) != SEXP_VALTYPE_LIST)
+                return (0);
+
+        SEXP_val_dsc(&v_dsc, memb->s_valp);
+        SEXP_ID_list(&v_dsc, 0);
+
+        /* the member list was rehashed after the list */
+        return (__atomic_load_n(&SEXP_LCASTP(v_dsc.mem)->id_stamp, __ATOMIC_RELAXED) > *(uint64_t *)arg);
+}
+#endif
+
+static int SEXP_ID_list_memb(SEXP_t *memb, void *arg)
+{
+        __IDres_pair *pair = (__IDres_pair *)arg;
+        SEXP_ID_t     h;
+
+        h = SEXP_ID_value(memb->s_valp, pair->part);
+        pair->hash = SEXP_ID_hash(&h, sizeof h, pair->hash, pair->part);
+
+        return (0);
+}
+
+static SEXP_ID_t SEXP_ID_list(SEXP_val_t *v_dsc, int part)
+{
+        struct SEXP_val_list *list = SEXP_LCASTP(v_dsc->mem);
+        __IDres_pair pair;
+#if defined(SEXP_LIST_IDCACHE)
+        uint64_t     stamp;
+
+        if (part == 0 && SEXP_LIST_IDVALID(v_dsc->hdr)) {
+                stamp = __atomic_load_n(&list->id_stamp, __ATOMIC_RELAXED);
+
+                if (SEXP_rawval_lblk_cb((uintptr_t)list->b_addr, SEXP_ID_list_check,
+                                        (void *)&stamp, list->offset + 1) == 0)
+                        return (__atomic_load_n(&list->id, __ATOMIC_RELAXED));
+        }
+#endif
+        pair.hash = SEXP_VALTYPE_LIST;
+        pair.part = part;
+
+        SEXP_rawval_lblk_cb((uintptr_t)list->b_addr, SEXP_ID_list_memb, (void *)&pair, list->offset + 1);
+
+#if defined(SEXP_LIST_IDCACHE)
+        if (part == 0) {
+                /* the stamp is newer than the stamps of all the member lists */
+                __atomic_store_n(&list->id, pair.hash, __ATOMIC_RELAXED);
+                __atomic_store_n(&list->id_stamp,
+                                 __atomic_add_fetch(&__ID_stamp, 1, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+                __atomic_fetch_or(&v_dsc->hdr->flags, SEXP_VALHDR_IDV, __ATOMIC_RELEASE);
+        }
+#endif
+        return (pair.hash);
+}
+
+static SEXP_ID_t SEXP_ID_value(uintptr_t valp, int part)
+{
+        SEXP_val_t v_dsc;
+        SEXP_ID_t  h;
 
         /*
          * Fill v_dsc with metainformation
          */
-        SEXP_val_dsc(&v_dsc, sexp->s_valp);
+        SEXP_val_dsc(&v_dsc, valp);
 
         switch (v_dsc.type) {
         case SEXP_VALTYPE_NUMBER:
+                return SEXP_ID_hash(v_dsc.mem, v_dsc.hdr->size, SEXP_VALTYPE_NUMBER, part);
         case SEXP_VALTYPE_STRING:
-                pair->hash = SEXP_ID_hash(v_dsc.mem, v_dsc.hdr->size, pair->hash, pair->part);
-                break;
+                /* interned strings have the hash precomputed */
+                if (v_dsc.hdr->flags & SEXP_VALHDR_ATOM) {
+                        memcpy(&h, SEXP_ATOM_IDP(v_dsc.mem, v_dsc.hdr->size, part), sizeof h);
+                        return (h);
+                }
+
+                return SEXP_ID_string(v_dsc.mem, v_dsc.hdr->size, part);
         case SEXP_VALTYPE_LIST:
-        {
-                SEXP_rawval_lblk_cb ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr,
-                                     (int (*)(SEXP_t *, void *)) SEXP_ID_v_callback,
-                                     (void *) pair,
-                                     SEXP_LCASTP(v_dsc.mem)->offset + 1);
-
-                pair->hash = SEXP_ID_hash(&pair->hash, 1,
-					  pair->hash + SEXP_LCASTP(v_dsc.mem)->offset, pair->part);
-                break;
-        }
+                return SEXP_ID_list(&v_dsc, part);
         case SEXP_VALTYPE_EMPTY:
-                pair->hash = SEXP_ID_hash(&pair->hash, 1, pair->hash, pair->part);
-                break;
+                return SEXP_ID_hash((void *)"", 0, SEXP_VALTYPE_EMPTY, part);
         default:
                 /* Unknown S-exp value type */
                 abort ();
@@ -102,26 +183,20 @@ static int SEXP_ID_v_callback(const SEXP_t *sexp, __IDres_pair *pair)
 
 SEXP_ID_t SEXP_ID_v(const SEXP_t *s)
 {
-	__IDres_pair pair;
+        SEXP_ID_t h;
 
-        pair.hash = 0xAD30917100C0FFEE;
-	pair.part = 0;
+        h = SEXP_ID_value(s->s_valp, 0);
 
-        SEXP_ID_v_callback(s, &pair);
-
-        return (pair.hash);
+        return SEXP_ID_hash(&h, sizeof h, 0xAD30917100C0FFEE, 0);
 }
 
 SEXP_ID_t SEXP_ID_v2(const SEXP_t *s)
 {
-	__IDres_pair pair;
+        SEXP_ID_t h;
 
-        pair.hash = 0xAD309171FFC0FFEE;
-	pair.part = 1;
+        h = SEXP_ID_value(s->s_valp, 1);
 
-        SEXP_ID_v_callback(s, &pair);
-
-        return (pair.hash);
+        return SEXP_ID_hash(&h, sizeof h, 0xAD309171FFC0FFEE, 1);
 }
 
 /// @}
@@ -0,0 +1,313 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "_sexp-types.h"
+#include "_sexp-value.h"
+#include "_sexp-atomic.h"
+#include "_sexp-arena.h"
+#include "public/sm_alloc.h"
+#include "public/sexp-manip.h"
+
+#define SEXP_ARENA_MEMSIZE (SEXP_ARENA_CHUNK_SIZE - offsetof (struct SEXP_arena_chunk, mem))
+
+/*
+ * The chunks are carved out of one region of reserved address space.
+ * A block is known to be an arena block by its address, so the blocks
+ * don't need any header and the blocks allocated using the regular
+ * allocator have no overhead. Released chunks are given back to the
+ * system and reused.
+ */
+static uint8_t * volatile       __arena_region = NULL;
+static size_t                   __arena_region_used = 0;
+static struct SEXP_arena_chunk *__arena_unused = NULL;
+static pthread_mutex_t          __arena_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t           __arena_region_once = PTHREAD_ONCE_INIT;
+
+static pthread_key_t  __arena_key;
+static pthread_once_t __arena_key_once = PTHREAD_ONCE_INIT;
+
+static void SEXP_arena_key_init (void)
+{
+        if (pthread_key_create (&__arena_key, NULL) != 0)
+                abort ();
+}
+
+/*
+ * The region is reserved when the first chunk is needed, i.e. never
+ * in processes which don't use arenas. It's set before any block is
+ * carved out of it and never changes afterwards.
+ */
+static void SEXP_arena_region_init (void)
+{
+#if defined(MAP_ANONYMOUS) && defined(MAP_NORESERVE)
+        void *region;
+
+        region = mmap (NULL, SEXP_ARENA_REGION_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        /* without the region all the values are allocated using sm_* */
+        if (region != MAP_FAILED)
+                __arena_region = region;
+#endif
+}
+
+static SEXP_arena_t *SEXP_arena_current (void)
+{
+        (void) pthread_once (&__arena_key_once, &SEXP_arena_key_init);
+        return ((SEXP_arena_t *) pthread_getspecific (__arena_key));
+}
+
+static bool SEXP_arena_ownedp (const void *mem)
+{
+        const uint8_t *region = __arena_region;
+
+        return (region != NULL &&
+                (const uint8_t *)mem >= region &&
+                (const uint8_t *)mem <  region + SEXP_ARENA_REGION_SIZE);
+}
+
+static struct SEXP_arena_chunk *SEXP_arena_chunk_new (void)
+{
+        struct SEXP_arena_chunk *chunk;
+
+        (void) pthread_once (&__arena_region_once, &SEXP_arena_region_init);
+
+        if (__arena_region == NULL)
+                return (NULL);
+
+        if (pthread_mutex_lock (&__arena_lock) != 0)
+                return (NULL);
+
+        if (__arena_unused != NULL) {
+                chunk = __arena_unused;
+                __arena_unused = chunk->next;
+        } else if (__arena_region_used + SEXP_ARENA_CHUNK_SIZE <= SEXP_ARENA_REGION_SIZE) {
+                chunk = (struct SEXP_arena_chunk *)(void *)(__arena_region + __arena_region_used);
+                __arena_region_used += SEXP_ARENA_CHUNK_SIZE;
+        } else
+                chunk = NULL;
+
+        (void) pthread_mutex_unlock (&__arena_lock);
+
+        if (chunk == NULL)
+                return (NULL);
+
+        chunk->live = 1;
+        chunk->used = 0;
+        chunk->next = NULL;
+
+        return (chunk);
+}
+
+static void SEXP_arena_chunk_release (struct SEXP_arena_chunk *chunk)
+{
+        /*
+         * Blocks may be freed by other threads than the one
+         * which allocated them.
+         */
+        if (SEXP_atomic_dec_u32 (&chunk->live) != 0)
+                return;
+
+#if defined(MADV_DONTNEED)
+        (void) madvise (chunk, SEXP_ARENA_CHUNK_SIZE, MADV_DONTNEED);
+#endif
+        if (pthread_mutex_lock (&__arena_lock) != 0)
+                return; /* the chunk is leaked */
+
+        chunk->next = __arena_unused;
+        __arena_unused = chunk;
+
+        (void) pthread_mutex_unlock (&__arena_lock);
+}
+
+SEXP_arena_t *SEXP_arena_new (void)
+{
+        SEXP_arena_t *arena;
+
+        arena = sm_talloc (SEXP_arena_t);
+        arena->chunk = NULL;
+
+        return (arena);
+}
+
+SEXP_arena_t *SEXP_arena_switch (SEXP_arena_t *arena)
+{
+        SEXP_arena_t *prev;
+
+        prev = SEXP_arena_current ();
+        (void) pthread_setspecific (__arena_key, arena);
+
+        return (prev);
+}
+
+void SEXP_arena_free (SEXP_arena_t *arena)
+{
+        if (arena == NULL)
+                return;
+
+        if (arena->chunk != NULL)
+                SEXP_arena_chunk_release (arena->chunk);
+
+        sm_free (arena);
+}
+
+#define SEXP_ALIGN_UP(n, a) (((n) + (a) - 1) & ~((size_t)(a) - 1))
+
+void *SEXP_valmem_alloc (size_t size, size_t align)
+{
+        SEXP_arena_t *arena;
+        void         *mem;
+
+        arena = SEXP_arena_current ();
+
+        if (arena != NULL && size <= SEXP_ARENA_MAXALLOC && align <= 16) {
+                struct SEXP_arena_chunk *chunk;
+                size_t off;
+
+                chunk = arena->chunk;
+                off   = chunk != NULL ? SEXP_ALIGN_UP(chunk->used, align) : 0;
+
+                if (chunk == NULL || off + size > SEXP_ARENA_MEMSIZE) {
+                        chunk = SEXP_arena_chunk_new ();
+
+                        if (chunk == NULL)
+                                goto heap;
+                        if (arena->chunk != NULL)
+                                SEXP_arena_chunk_release (arena->chunk);
+
+                        arena->chunk = chunk;
+                        off = 0;
+                }
+
+                SEXP_atomic_inc_u32 (&chunk->live);
+                chunk->used = off + size;
+
+                return (chunk->mem + off);
+        }
+heap:
+        if (sm_memalign (&mem, align, size) != 0)
+                return (NULL);
+
+        return (mem);
+}
+
+void SEXP_valmem_free (void *mem, size_t align)
+{
+        size_t off;
+
+        if (mem == NULL)
+                return;
+
+        if (SEXP_arena_ownedp (mem)) {
+                /* chunks are aligned to their size within the region */
+                off = (size_t)((uint8_t *)mem - __arena_region);
+                off = off & ~((size_t)SEXP_ARENA_CHUNK_SIZE - 1);
+
+                SEXP_arena_chunk_release ((struct SEXP_arena_chunk *)(void *)(__arena_region + off));
+        } else
+                sm_free (mem);
+}
+
+/*
+ * A value is pinned if the value, one of its list blocks or one of its
+ * members (recursively) was carved out of an arena.
+ */
+static bool SEXP_arena_pinnedp (uintptr_t valp)
+{
+        SEXP_val_t v_dsc;
+        struct SEXP_val_lblk *lblk;
+        uint16_t i;
+
+        SEXP_val_dsc (&v_dsc, valp);
+
+        if (SEXP_arena_ownedp (v_dsc.hdr))
+                return (true);
+        if (v_dsc.type != SEXP_VALTYPE_LIST)
+                return (false);
+
+        lblk = SEXP_VALP_LBLK(SEXP_LCASTP(v_dsc.mem)->b_addr);
+        i    = SEXP_LCASTP(v_dsc.mem)->offset;
+
+        for (; lblk != NULL; lblk = SEXP_VALP_LBLK(lblk->nxsz), i = 0) {
+                if (SEXP_arena_ownedp (lblk))
+                        return (true);
+
+                for (; i < lblk->real; ++i)
+                        if (SEXP_arena_pinnedp (lblk->memb[i].s_valp))
+                                return (true);
+        }
+
+        return (false);
+}
+
+static SEXP_t *SEXP_arena_detach1 (const SEXP_t *s_exp)
+{
+        SEXP_t *copy, *memb, *r0;
+        SEXP_list_it *it;
+
+        if (!SEXP_arena_pinnedp (s_exp->s_valp))
+                return SEXP_ref (s_exp);
+
+        if (SEXP_listp (s_exp)) {
+                copy = SEXP_list_new (NULL);
+                it   = SEXP_list_it_new (s_exp);
+
+                while ((memb = SEXP_list_it_next (it)) != NULL) {
+                        SEXP_list_add (copy, r0 = SEXP_arena_detach1 (memb));
+                        SEXP_free (r0);
+                }
+
+                SEXP_list_it_free (it);
+        } else {
+                copy = SEXP_new ();
+                copy->s_valp = SEXP_rawval_copy (s_exp->s_valp);
+        }
+
+        copy->s_type = s_exp->s_type;
+
+        return (copy);
+}
+
+SEXP_t *SEXP_arena_detach (const SEXP_t *s_exp)
+{
+        SEXP_arena_t *prev;
+        SEXP_t *copy;
+
+        if (s_exp == NULL)
+                return (NULL);
+
+        prev = SEXP_arena_switch (NULL);
+        copy = SEXP_arena_detach1 (s_exp);
+        SEXP_arena_switch (prev);
+
+        return (copy);
+}
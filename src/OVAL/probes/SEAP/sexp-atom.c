@@ -0,0 +1,159 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "_sexp-types.h"
+#include "_sexp-value.h"
+#include "_sexp-arena.h"
+#include "_sexp-ID.h"
+#include "public/sexp-manip.h"
+#include "public/sexp-manip_r.h"
+
+/*
+ * Intern table of string values. The values are never freed: the table
+ * holds a reference to each of them. The table doesn't grow, once half
+ * of the slots are used new strings get regular values.
+ */
+#ifndef SEXP_ATOM_TABSIZE
+#define SEXP_ATOM_TABSIZE 8192 /* power of two */
+#endif
+#define SEXP_ATOM_MAXCNT (SEXP_ATOM_TABSIZE / 2)
+#define SEXP_ATOM_MAXLEN 255
+
+static uintptr_t        __atom_tab[SEXP_ATOM_TABSIZE];
+static size_t           __atom_cnt = 0;
+static pthread_rwlock_t __atom_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/*
+ * Find the slot of the string, or the empty slot where it belongs.
+ */
+static size_t SEXP_atom_slot (const char *string, size_t len, SEXP_ID_t h0)
+{
+        SEXP_val_t v_dsc;
+        SEXP_ID_t  h;
+        size_t     i;
+
+        for (i = (size_t)h0 & (SEXP_ATOM_TABSIZE - 1); __atom_tab[i] != 0; i = (i + 1) & (SEXP_ATOM_TABSIZE - 1)) {
+                SEXP_val_dsc (&v_dsc, __atom_tab[i]);
+
+                /* the hash is stored after the string, find it by the stored length */
+                if (v_dsc.hdr->size != len)
+                        continue;
+
+                memcpy (&h, SEXP_ATOM_IDP(v_dsc.mem, v_dsc.hdr->size, 0), sizeof h);
+
+                if (h == h0 && memcmp (v_dsc.mem, string, len) == 0)
+                        break;
+        }
+
+        return (i);
+}
+
+static uintptr_t SEXP_atom_new (const char *string, size_t len, SEXP_ID_t h0)
+{
+        SEXP_val_t    v_dsc;
+        SEXP_ID_t     h1;
+        SEXP_arena_t *arena;
+        int           ret;
+
+        /* atoms live forever, they must not pin an arena chunk */
+        arena = SEXP_arena_switch (NULL);
+        ret   = SEXP_val_new (&v_dsc, SEXP_ATOM_IDOFF(len) + 2 * sizeof (SEXP_ID_t), SEXP_VALTYPE_STRING);
+        SEXP_arena_switch (arena);
+
+        if (ret != 0)
+                return (0);
+
+        h1 = SEXP_ID_string (string, len, 1);
+
+        memcpy (v_dsc.mem, string, len);
+        memcpy (SEXP_ATOM_IDP(v_dsc.mem, len, 0), &h0, sizeof h0);
+        memcpy (SEXP_ATOM_IDP(v_dsc.mem, len, 1), &h1, sizeof h1);
+
+        v_dsc.hdr->size  = len;
+        v_dsc.hdr->flags = SEXP_VALHDR_ATOM;
+
+        return (v_dsc.ptr);
+}
+
+SEXP_t *SEXP_string_atom (const char *string)
+{
+        SEXP_t   *sexp;
+        SEXP_ID_t h0;
+        uintptr_t valp;
+        size_t    len, i;
+
+        if (string == NULL) {
+                errno = EFAULT;
+                return (NULL);
+        }
+
+        len = strlen (string);
+
+        if (len > SEXP_ATOM_MAXLEN)
+                return (SEXP_string_new (string, len));
+
+        h0 = SEXP_ID_string (string, len, 0);
+
+        if (pthread_rwlock_rdlock (&__atom_lock) != 0)
+                return (SEXP_string_new (string, len));
+
+        valp = __atom_tab[SEXP_atom_slot (string, len, h0)];
+        pthread_rwlock_unlock (&__atom_lock);
+
+        if (valp == 0) {
+                if (pthread_rwlock_wrlock (&__atom_lock) != 0)
+                        return (SEXP_string_new (string, len));
+
+                /* the string might have been added meanwhile */
+                i    = SEXP_atom_slot (string, len, h0);
+                valp = __atom_tab[i];
+
+                if (valp == 0 && __atom_cnt < SEXP_ATOM_MAXCNT) {
+                        valp = __atom_tab[i] = SEXP_atom_new (string, len, h0);
+
+                        if (valp != 0)
+                                ++__atom_cnt;
+                }
+
+                pthread_rwlock_unlock (&__atom_lock);
+
+                if (valp == 0)
+                        return (SEXP_string_new (string, len));
+        }
+
+        sexp = SEXP_new ();
+        SEXP_init (sexp);
+        sexp->s_type = NULL;
+        sexp->s_valp = SEXP_rawval_incref (valp);
+
+        return (sexp);
+}
@@ -0,0 +1,686 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "common/assume.h"
+#include "public/sm_alloc.h"
+#include "public/strbuf.h"
+#include "public/sexp-manip.h"
+#include "public/sexp-manip_r.h"
+#include "_sexp-types.h"
+#include "_sexp-value.h"
+#include "_sexp-datatype.h"
+#include "_sexp-rawptr.h"
+#include "_sexp-binary.h"
+
+
+/*
+ * Output
+ */
+
+struct SEXP_bout {
+        uint8_t *b_buf;
+        size_t   b_len;
+        size_t   b_cap;
+};
+
+static int SEXP_bout_reserve (struct SEXP_bout *out, size_t len)
+{
+        if (out->b_cap - out->b_len < len) {
+                size_t   cap = out->b_cap;
+                uint8_t *buf;
+
+                while (cap - out->b_len < len)
+                        cap = cap * 2;
+
+                buf = sm_realloc (out->b_buf, cap);
+
+                if (buf == NULL)
+                        return (-1);
+
+                out->b_buf = buf;
+                out->b_cap = cap;
+        }
+
+        return (0);
+}
+
+static int SEXP_bout_varint (struct SEXP_bout *out, uint64_t n)
+{
+        if (SEXP_bout_reserve (out, 10) != 0)
+                return (-1);
+
+        while (n >= 0x80) {
+                out->b_buf[out->b_len++] = (uint8_t)(n | 0x80);
+                n >>= 7;
+        }
+
+        out->b_buf[out->b_len++] = (uint8_t)n;
+
+        return (0);
+}
+
+static int SEXP_bout_add (struct SEXP_bout *out, const void *data, size_t len)
+{
+        if (SEXP_bout_reserve (out, len) != 0)
+                return (-1);
+
+        memcpy (out->b_buf + out->b_len, data, len);
+        out->b_len += len;
+
+        return (0);
+}
+
+static int SEXP_bin_put (SEXP_t *s_exp, struct SEXP_bout *out)
+{
+        SEXP_val_t v_dsc;
+        uint8_t    tag;
+        uint64_t   u = 0;
+
+        SEXP_val_dsc (&v_dsc, s_exp->s_valp);
+
+        switch (v_dsc.type) {
+        case SEXP_VALTYPE_STRING:
+                tag = SEXP_BIN_STRING;
+                u   = v_dsc.hdr->size;
+                break;
+        case SEXP_VALTYPE_LIST:
+                tag = SEXP_BIN_LIST;
+                u   = SEXP_rawval_list_length ((struct SEXP_val_list *)v_dsc.mem);
+                break;
+        case SEXP_VALTYPE_NUMBER:
+        {
+                int64_t i;
+
+                switch (SEXP_NTYPEP(v_dsc.hdr->size, v_dsc.mem)) {
+                case SEXP_NUM_BOOL:
+                        tag = SEXP_NCASTP(b,v_dsc.mem)->n ? SEXP_BIN_TRUE : SEXP_BIN_FALSE;
+                        break;
+                case SEXP_NUM_DOUBLE:
+                        tag = SEXP_BIN_DOUBLE;
+                        memcpy (&u, &SEXP_NCASTP(f,v_dsc.mem)->n, sizeof u);
+                        break;
+                case SEXP_NUM_UINT8:
+                        tag = SEXP_BIN_UINT; u = SEXP_NCASTP(u8 ,v_dsc.mem)->n;
+                        break;
+                case SEXP_NUM_UINT16:
+                        tag = SEXP_BIN_UINT; u = SEXP_NCASTP(u16,v_dsc.mem)->n;
+                        break;
+                case SEXP_NUM_UINT32:
+                        tag = SEXP_BIN_UINT; u = SEXP_NCASTP(u32,v_dsc.mem)->n;
+                        break;
+                case SEXP_NUM_UINT64:
+                        tag = SEXP_BIN_UINT; u = SEXP_NCASTP(u64,v_dsc.mem)->n;
+                        break;
+                case SEXP_NUM_INT8:
+                        i = SEXP_NCASTP(i8 ,v_dsc.mem)->n;
+                        goto signed_int;
+                case SEXP_NUM_INT16:
+                        i = SEXP_NCASTP(i16,v_dsc.mem)->n;
+                        goto signed_int;
+                case SEXP_NUM_INT32:
+                        i = SEXP_NCASTP(i32,v_dsc.mem)->n;
+                        goto signed_int;
+                case SEXP_NUM_INT64:
+                        i = SEXP_NCASTP(i64,v_dsc.mem)->n;
+                signed_int:
+                        if (i < 0) {
+                                tag = SEXP_BIN_NINT;
+                                u   = (uint64_t)(-(i + 1));
+                        } else {
+                                tag = SEXP_BIN_UINT;
+                                u   = (uint64_t)i;
+                        }
+                        break;
+                default:
+                        errno = EINVAL;
+                        return (-1);
+                }
+                break;
+        }
+        default:
+                errno = EINVAL;
+                return (-1);
+        }
+
+        if (SEXP_rawptr_mask(s_exp->s_type, SEXP_DATATYPEPTR_MASK) != NULL) {
+                const char *name = SEXP_datatype_name (s_exp->s_type);
+                size_t      nlen = strlen (name);
+
+                tag |= SEXP_BIN_DTYPE;
+
+                if (SEXP_bout_add (out, &tag, 1) != 0 ||
+                    SEXP_bout_varint (out, nlen) != 0 ||
+                    SEXP_bout_add (out, name, nlen) != 0)
+                        return (-1);
+        } else {
+                if (SEXP_bout_add (out, &tag, 1) != 0)
+                        return (-1);
+        }
+
+        switch (tag & SEXP_BIN_TMASK) {
+        case SEXP_BIN_STRING:
+                if (SEXP_bout_varint (out, u) != 0 ||
+                    SEXP_bout_add (out, v_dsc.mem, (size_t)u) != 0)
+                        return (-1);
+                break;
+        case SEXP_BIN_UINT:
+        case SEXP_BIN_NINT:
+                return SEXP_bout_varint (out, u);
+        case SEXP_BIN_DOUBLE:
+        {
+                uint8_t le[8];
+                int     k;
+
+                for (k = 0; k < 8; ++k)
+                        le[k] = (uint8_t)(u >> (8 * k));
+
+                return SEXP_bout_add (out, le, sizeof le);
+        }
+        case SEXP_BIN_LIST:
+                if (SEXP_bout_varint (out, u) != 0)
+                        return (-1);
+                if (u > 0)
+                        return SEXP_rawval_lblk_cb ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr,
+                                                    (int (*)(SEXP_t *, void *))SEXP_bin_put, (void *)out,
+                                                    SEXP_LCASTP(v_dsc.mem)->offset + 1);
+                break;
+        }
+
+        return (0);
+}
+
+int SEXP_sbprintf_b (const SEXP_t *s_exp, strbuf_t *sb)
+{
+        struct SEXP_bout out;
+        size_t len;
+        int    ret = -1;
+
+        if (s_exp == NULL || sb == NULL) {
+                errno = EFAULT;
+                return (-1);
+        }
+
+        SEXP_VALIDATE(s_exp);
+
+        out.b_cap = 1024;
+        out.b_len = SEXP_BIN_HDRLEN;
+        out.b_buf = sm_alloc (out.b_cap);
+
+        if (out.b_buf == NULL)
+                return (-1);
+
+        if (SEXP_bin_put ((SEXP_t *)s_exp, &out) != 0)
+                goto out;
+
+        len = out.b_len - SEXP_BIN_HDRLEN;
+
+        if (len > UINT32_MAX) {
+                errno = EMSGSIZE;
+                goto out;
+        }
+
+        out.b_buf[0] = SEXP_BIN_MAGIC;
+        out.b_buf[1] = (uint8_t)(len >> 24);
+        out.b_buf[2] = (uint8_t)(len >> 16);
+        out.b_buf[3] = (uint8_t)(len >> 8);
+        out.b_buf[4] = (uint8_t)(len);
+
+        ret = strbuf_add (sb, (const char *)out.b_buf, out.b_len);
+out:
+        sm_free (out.b_buf);
+        return (ret);
+}
+
+/*
+ * Input
+ */
+
+struct SEXP_bin {
+        const uint8_t *p;
+        const uint8_t *e;
+        /* last seen datatype; item entities repeat the same few names */
+        const uint8_t *dt_name;
+        size_t         dt_nlen;
+        SEXP_datatypePtr_t *dt_ptr;
+};
+
+static int SEXP_bin_varint (struct SEXP_bin *in, uint64_t *n)
+{
+        uint64_t v = 0;
+        unsigned s = 0;
+
+        while (in->p < in->e && s < 64) {
+                uint8_t b = *in->p++;
+
+                v |= (uint64_t)(b & 0x7f) << s;
+
+                if ((b & 0x80) == 0) {
+                        *n = v;
+                        return (0);
+                }
+
+                s += 7;
+        }
+
+        return (-1);
+}
+
+static int SEXP_bin_dtype (struct SEXP_bin *in, SEXP_t *dst)
+{
+        uint64_t nlen;
+        char    *name;
+
+        if (SEXP_bin_varint (in, &nlen) != 0 || nlen == 0 ||
+            nlen > (uint64_t)(in->e - in->p))
+                return (-1);
+
+        if (in->dt_ptr != NULL && in->dt_nlen == nlen &&
+            memcmp (in->dt_name, in->p, nlen) == 0)
+        {
+                dst->s_type = in->dt_ptr;
+                in->p += nlen;
+                return (0);
+        }
+
+        name = sm_alloc ((size_t)nlen + 1);
+        memcpy (name, in->p, nlen);
+        name[nlen] = '\0';
+
+        dst->s_type = SEXP_datatype_get (&g_datatypes, name);
+
+        if (dst->s_type == NULL) {
+                dst->s_type = SEXP_datatype_add (&g_datatypes, name, NULL, NULL);
+
+                if (dst->s_type == NULL) {
+                        sm_free (name);
+                        return (-1);
+                }
+        } else
+                sm_free (name);
+
+        /* only plain datatype pointers can be shared between S-exps */
+        if (((uintptr_t)dst->s_type & 1) == 0) {
+                in->dt_name = in->p;
+                in->dt_nlen = (size_t)nlen;
+                in->dt_ptr  = dst->s_type;
+        }
+
+        in->p += nlen;
+
+        return (0);
+}
+
+static int SEXP_bin_number (SEXP_t *dst, uint64_t u, bool neg)
+{
+        SEXP_val_t v_dsc;
+
+#define SEXP_BIN_NUMBER(s, T, NT)                                       \
+        do {                                                            \
+                if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (T), \
+                                  SEXP_VALTYPE_NUMBER) != 0)            \
+                        return (-1);                                    \
+                SEXP_NCASTP(s,v_dsc.mem)->t = NT;                       \
+                SEXP_NCASTP(s,v_dsc.mem)->n = (T)n;                     \
+        } while (0)
+
+        if (neg) {
+                int64_t n;
+
+                if (u > (uint64_t)INT64_MAX)
+                        return (-1);
+
+                n = -(int64_t)u - 1;
+
+                if (n < INT16_MIN) {
+                        if (n < INT32_MIN)
+                                SEXP_BIN_NUMBER(i64, int64_t, SEXP_NUM_INT64);
+                        else
+                                SEXP_BIN_NUMBER(i32, int32_t, SEXP_NUM_INT32);
+                } else {
+                        if (n < INT8_MIN)
+                                SEXP_BIN_NUMBER(i16, int16_t, SEXP_NUM_INT16);
+                        else
+                                SEXP_BIN_NUMBER(i8, int8_t, SEXP_NUM_INT8);
+                }
+        } else {
+                uint64_t n = u;
+
+                if (n > UINT16_MAX) {
+                        if (n > UINT32_MAX)
+                                SEXP_BIN_NUMBER(u64, uint64_t, SEXP_NUM_UINT64);
+                        else
+                                SEXP_BIN_NUMBER(u32, uint32_t, SEXP_NUM_UINT32);
+                } else {
+                        if (n > UINT8_MAX)
+                                SEXP_BIN_NUMBER(u16, uint16_t, SEXP_NUM_UINT16);
+                        else
+                                SEXP_BIN_NUMBER(u8, uint8_t, SEXP_NUM_UINT8);
+                }
+        }
+#undef SEXP_BIN_NUMBER
+
+        dst->s_valp = v_dsc.ptr;
+
+        return (0);
+}
+
+static int SEXP_bin_get (struct SEXP_bin *in, SEXP_t *dst, unsigned depth)
+{
+        SEXP_val_t v_dsc;
+        uint64_t   u;
+        uint8_t    tag;
+
+        SEXP_init (dst);
+
+        if (in->p >= in->e || depth > SEXP_BIN_MAXDEPTH)
+                return (-1);
+
+        tag = *in->p++;
+
+        if (tag & SEXP_BIN_DTYPE)
+                if (SEXP_bin_dtype (in, dst) != 0)
+                        return (-1);
+
+        switch (tag & ~SEXP_BIN_DTYPE) {
+        case SEXP_BIN_STRING:
+                if (SEXP_bin_varint (in, &u) != 0 || u > (uint64_t)(in->e - in->p))
+                        return (-1);
+                if (SEXP_val_new (&v_dsc, (size_t)u, SEXP_VALTYPE_STRING) != 0)
+                        return (-1);
+
+                memcpy (v_dsc.mem, in->p, (size_t)u);
+                in->p += u;
+                dst->s_valp = v_dsc.ptr;
+                break;
+        case SEXP_BIN_UINT:
+        case SEXP_BIN_NINT:
+                if (SEXP_bin_varint (in, &u) != 0)
+                        return (-1);
+                return SEXP_bin_number (dst, u, (tag & SEXP_BIN_TMASK) == SEXP_BIN_NINT);
+        case SEXP_BIN_DOUBLE:
+        {
+                int k;
+
+                if (in->e - in->p < 8)
+                        return (-1);
+
+                for (u = 0, k = 0; k < 8; ++k)
+                        u |= (uint64_t)in->p[k] << (8 * k);
+
+                in->p += 8;
+
+                if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (double),
+                                  SEXP_VALTYPE_NUMBER) != 0)
+                        return (-1);
+
+                SEXP_NCASTP(f,v_dsc.mem)->t = SEXP_NUM_DOUBLE;
+                memcpy (&SEXP_NCASTP(f,v_dsc.mem)->n, &u, sizeof (double));
+                dst->s_valp = v_dsc.ptr;
+                break;
+        }
+        case SEXP_BIN_TRUE:
+        case SEXP_BIN_FALSE:
+                if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (bool),
+                                  SEXP_VALTYPE_NUMBER) != 0)
+                        return (-1);
+
+                SEXP_NCASTP(b,v_dsc.mem)->t = SEXP_NUM_BOOL;
+                SEXP_NCASTP(b,v_dsc.mem)->n = (tag & SEXP_BIN_TMASK) == SEXP_BIN_TRUE;
+                dst->s_valp = v_dsc.ptr;
+                break;
+        case SEXP_BIN_LIST:
+        {
+                struct SEXP_val_lblk *lblk, *prev = NULL;
+                uint8_t b_exp;
+
+                /* each member takes at least one octet */
+                if (SEXP_bin_varint (in, &u) != 0 || u > (uint64_t)(in->e - in->p))
+                        return (-1);
+                if (SEXP_val_new (&v_dsc, sizeof (struct SEXP_val_list),
+                                  SEXP_VALTYPE_LIST) != 0)
+                        return (-1);
+
+                SEXP_LCASTP(v_dsc.mem)->offset = 0;
+                SEXP_LCASTP(v_dsc.mem)->b_addr = NULL;
+                dst->s_valp = v_dsc.ptr;
+
+                /*
+                 * The member count is known in advance, so the block
+                 * chain is built directly and the members are decoded
+                 * in place instead of being copied into the list one
+                 * by one.
+                 */
+                while (u > 0) {
+                        size_t n = u < (1 << 15) ? (size_t)u : (1 << 15);
+
+                        for (b_exp = 0; ((size_t)1 << b_exp) < n; ++b_exp);
+
+                        lblk = SEXP_VALP_LBLK(SEXP_rawval_lblk_new (b_exp));
+
+                        if (prev == NULL)
+                                SEXP_LCASTP(v_dsc.mem)->b_addr = (void *)lblk;
+                        else
+                                prev->nxsz = ((uintptr_t)lblk & SEXP_LBLKP_MASK) | (prev->nxsz & SEXP_LBLKS_MASK);
+
+                        while (n > 0) {
+                                if (SEXP_bin_get (in, lblk->memb + lblk->real, depth + 1) != 0) {
+                                        SEXP_free_r (lblk->memb + lblk->real);
+                                        return (-1);
+                                }
+
+                                ++lblk->real;
+                                --n;
+                                --u;
+                        }
+
+                        prev = lblk;
+                }
+                break;
+        }
+        default:
+                return (-1);
+        }
+
+        return (0);
+}
+
+bool SEXP_bin_framep (const void *buf, size_t buflen)
+{
+        return (buf != NULL && buflen > 0 && *(const uint8_t *)buf == SEXP_BIN_MAGIC);
+}
+
+static size_t SEXP_bin_framelen (const uint8_t *buf)
+{
+        return (((size_t)buf[1] << 24) | ((size_t)buf[2] << 16) |
+                ((size_t)buf[3] << 8)  |  (size_t)buf[4]);
+}
+
+SEXP_t *SEXP_bin_parse (const void *buf, size_t buflen, size_t *used)
+{
+        struct SEXP_bin in;
+        size_t  len;
+        SEXP_t *s_exp;
+
+        if (buf == NULL) {
+                errno = EFAULT;
+                return (NULL);
+        }
+
+        if (!SEXP_bin_framep (buf, buflen)) {
+                errno = buflen > 0 ? EILSEQ : EAGAIN;
+                return (NULL);
+        }
+
+        if (buflen < SEXP_BIN_HDRLEN) {
+                errno = EAGAIN;
+                return (NULL);
+        }
+
+        len = SEXP_bin_framelen (buf);
+
+        if (buflen - SEXP_BIN_HDRLEN < len) {
+                errno = EAGAIN;
+                return (NULL);
+        }
+
+        in.p = (const uint8_t *)buf + SEXP_BIN_HDRLEN;
+        in.e = in.p + len;
+        in.dt_name = NULL;
+        in.dt_nlen = 0;
+        in.dt_ptr  = NULL;
+
+        s_exp = SEXP_new ();
+
+        if (SEXP_bin_get (&in, s_exp, 0) != 0 || in.p != in.e) {
+                SEXP_free (s_exp);
+                errno = EILSEQ;
+                return (NULL);
+        }
+
+        if (used != NULL)
+                *used = SEXP_BIN_HDRLEN + len;
+
+        return (s_exp);
+}
+
+/*
+ * Frame reassembly
+ */
+
+SEXP_bstate_t *SEXP_bstate_new (void)
+{
+        SEXP_bstate_t *bstate;
+
+        bstate = sm_talloc (SEXP_bstate_t);
+        bstate->b_buf = NULL;
+        bstate->b_len = 0;
+        bstate->b_cap = 0;
+
+        return (bstate);
+}
+
+void SEXP_bstate_free (SEXP_bstate_t *bstate)
+{
+        if (bstate != NULL) {
+                sm_free (bstate->b_buf);
+                sm_free (bstate);
+        }
+}
+
+bool SEXP_bstate_pendingp (const SEXP_bstate_t *bstate)
+{
+        return (bstate != NULL && bstate->b_len > 0);
+}
+
+int SEXP_bstate_add (SEXP_bstate_t *bstate, const void *buf, size_t buflen)
+{
+        size_t need;
+
+        _A(bstate != NULL);
+
+        need = bstate->b_len + buflen;
+
+        /*
+         * Once the frame header is known, reserve space for the
+         * whole frame at once to avoid repeated reallocations of
+         * large frames.
+         */
+        if (bstate->b_len + buflen >= SEXP_BIN_HDRLEN) {
+                const uint8_t *hdr;
+                uint8_t tmp[SEXP_BIN_HDRLEN];
+
+                if (bstate->b_len >= SEXP_BIN_HDRLEN)
+                        hdr = bstate->b_buf;
+                else {
+                        memcpy (tmp, bstate->b_buf, bstate->b_len);
+                        memcpy (tmp + bstate->b_len, buf, SEXP_BIN_HDRLEN - bstate->b_len);
+                        hdr = tmp;
+                }
+
+                if (hdr[0] == SEXP_BIN_MAGIC && need < SEXP_BIN_HDRLEN + SEXP_bin_framelen (hdr))
+                        need = SEXP_BIN_HDRLEN + SEXP_bin_framelen (hdr);
+        }
+
+        if (need > bstate->b_cap) {
+                uint8_t *b_buf = sm_realloc (bstate->b_buf, need);
+
+                if (b_buf == NULL)
+                        return (-1);
+
+                bstate->b_buf = b_buf;
+                bstate->b_cap = need;
+        }
+
+        memcpy (bstate->b_buf + bstate->b_len, buf, buflen);
+        bstate->b_len += buflen;
+
+        return (0);
+}
+
+SEXP_t *SEXP_bstate_parse (SEXP_bstate_t *bstate)
+{
+        SEXP_t *list = NULL, *s_exp;
+        size_t  off = 0, used;
+
+        _A(bstate != NULL);
+
+        while (off < bstate->b_len) {
+                s_exp = SEXP_bin_parse (bstate->b_buf + off, bstate->b_len - off, &used);
+
+                if (s_exp == NULL) {
+                        if (errno == EAGAIN)
+                                break;
+
+                        protect_errno {
+                                SEXP_free (list);
+                                bstate->b_len = 0;
+                        }
+                        return (NULL);
+                }
+
+                if (list == NULL)
+                        list = SEXP_list_new (NULL);
+
+                SEXP_list_add (list, s_exp);
+                SEXP_free (s_exp);
+                off += used;
+        }
+
+        if (off > 0) {
+                memmove (bstate->b_buf, bstate->b_buf + off, bstate->b_len - off);
+                bstate->b_len -= off;
+        }
+
+        if (list == NULL)
+                errno = EAGAIN;
+
+        return (list);
+}
@@ -46,6 +46,7 @@
 #include "_sexp-value.h"
 #include "_sexp-manip.h"
 #include "_sexp-rawptr.h"
+#include "_sexp-ID.h"
 #include "public/sexp-manip.h"
 #include "public/sexp-manip_r.h"
 
@@ -846,7 +847,6 @@ char *SEXP_string_subcstr (const SEXP_t *s_exp, size_t beg, size_t len)
                 s_len = len;
 
         if (s_len > 0) {
-                s_len = v_dsc.hdr->size / sizeof (char);
                 s_str = sm_alloc (sizeof (char) * (s_len + 1));
 
                 memcpy (s_str, ((char *) v_dsc.mem) + beg, sizeof (char) * s_len);
@@ -884,6 +884,10 @@ int SEXP_string_cmp (const SEXP_t *str_a, const SEXP_t *str_b)
         SEXP_VALIDATE(str_a);
         SEXP_VALIDATE(str_b);
 
+        /* the same value, e.g. interned strings */
+        if (str_a->s_valp == str_b->s_valp)
+                return (0);
+
         a = SEXP_string_cstr (str_a);
         b = SEXP_string_cstr (str_b);
 
@@ -1105,6 +1109,7 @@ SEXP_t *SEXP_list_replace (SEXP_t *list, uint32_t n, const SEXP_t *n_val)
         }
 
         _A(n > 0);
+        SEXP_LIST_IDRESET(&v_dsc);
 
         SEXP_LCASTP(v_dsc.mem)->b_addr = (void *) SEXP_rawval_lblk_replace ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr,
                                                                             SEXP_LCASTP(v_dsc.mem)->offset + n,
@@ -1224,12 +1229,77 @@ SEXP_t *SEXP_list_add (SEXP_t *list, const SEXP_t *s_exp)
                  * be shared. This case is handled by the
                  * function SEXP_rawval_list_add.
                  */
+                SEXP_LIST_IDRESET(&v_dsc);
                 SEXP_LCASTP(v_dsc.mem)->b_addr = (void *)SEXP_rawval_lblk_add ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr, s_exp);
         }
 
         return (list);
 }
 
+SEXP_t *SEXP_list_reserve (SEXP_t *list, size_t n)
+{
+        SEXP_val_t v_dsc;
+        struct SEXP_val_lblk *lblk;
+        uintptr_t lb_old;
+        uint16_t  offset;
+
+        if (list == NULL) {
+                errno = EFAULT;
+                return (NULL);
+        }
+
+        SEXP_VALIDATE(list);
+
+        SEXP_val_dsc (&v_dsc, list->s_valp);
+
+        if (v_dsc.type != SEXP_VALTYPE_LIST) {
+                errno = EINVAL;
+                return (NULL);
+        }
+
+        lb_old = (uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr;
+        offset = SEXP_LCASTP(v_dsc.mem)->offset;
+        lblk   = SEXP_VALP_LBLK(lb_old);
+
+        /* empty lists get their first block when a member is added */
+        if (lblk == NULL)
+                return (list);
+
+        /* nothing to do if the list is already a single block with enough room */
+        if (v_dsc.hdr->refs < 2 && lblk->refs < 2 && offset == 0 &&
+            SEXP_VALP_LBLK(lblk->nxsz) == NULL && (size_t)(1 << (lblk->nxsz & SEXP_LBLKS_MASK)) >= n)
+                return (list);
+
+        if (v_dsc.hdr->refs > 1) {
+                /*
+                 * The value is shared: make a private flat copy of it
+                 * and leave the original to the other references.
+                 */
+                uintptr_t uptr;
+
+                if (SEXP_val_new (&v_dsc, sizeof (struct SEXP_val_list),
+                                  SEXP_VALTYPE_LIST) != 0)
+                        return (NULL);
+
+                SEXP_LCASTP(v_dsc.mem)->b_addr = (void *)SEXP_rawval_lblk_copyn (lb_old, offset, n);
+                SEXP_LCASTP(v_dsc.mem)->offset = 0;
+                uptr = SEXP_val_ptr (&v_dsc);
+
+                if (SEXP_rawval_decref (list->s_valp)) {
+                        /* TODO: handle this */
+                        abort ();
+                }
+
+                list->s_valp = uptr;
+        } else {
+                SEXP_LCASTP(v_dsc.mem)->b_addr = (void *)SEXP_rawval_lblk_copyn (lb_old, offset, n);
+                SEXP_LCASTP(v_dsc.mem)->offset = 0;
+                SEXP_rawval_lblk_free (lb_old, SEXP_free_lmemb);
+        }
+
+        return (list);
+}
+
 SEXP_t *SEXP_list_join (const SEXP_t *list_a, const SEXP_t *list_b)
 {
         SEXP_t *list_j, *memb;
@@ -1291,14 +1361,23 @@ SEXP_t *SEXP_list_pop (SEXP_t *list)
         }
 
         lblk = SEXP_VALP_LBLK(SEXP_LCASTP(v_dsc.mem)->b_addr);
+        SEXP_LIST_IDRESET(&v_dsc);
 
+        /*
+         * The popped members stay in the block until all of its members
+         * are popped, then the list moves to the next block.
+         */
         if (lblk != NULL) {
                 if (++SEXP_LCASTP(v_dsc.mem)->offset == lblk->real) {
                         SEXP_LCASTP(v_dsc.mem)->offset = 0;
                         SEXP_LCASTP(v_dsc.mem)->b_addr = SEXP_VALP_LBLK(lblk->nxsz);
-                }
 
-                SEXP_rawval_lblk_free1 ((uintptr_t)lblk, SEXP_free_lmemb);
+                        /* the block may be shared, the list needs its own reference to the next one */
+                        if (SEXP_LCASTP(v_dsc.mem)->b_addr != NULL)
+                                SEXP_LCASTP(v_dsc.mem)->b_addr = (void *)SEXP_rawval_lblk_incref ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr);
+
+                        SEXP_rawval_lblk_free ((uintptr_t)lblk, SEXP_free_lmemb);
+                }
         }
 
 #if !defined(NDEBUG)
@@ -1371,6 +1450,7 @@ SEXP_t *SEXP_list_sort(SEXP_t *list, int(*compare)(const SEXP_t *, const SEXP_t
 {
         SEXP_val_t v_dsc;
         SEXP_list_it *list_it;
+        struct SEXP_val_lblk *lblk;
         size_t list_it_count, list_it_alloc;
 
         if (list == NULL || compare == NULL) {
@@ -1389,6 +1469,21 @@ SEXP_t *SEXP_list_sort(SEXP_t *list, int(*compare)(const SEXP_t *, const SEXP_t
          * TODO: check reference counts and make copies of list
          * blocks if needed
          */
+        SEXP_LIST_IDRESET(&v_dsc);
+
+        /*
+         * A flat list (a single block) is sorted in place.
+         */
+        lblk = SEXP_VALP_LBLK(SEXP_LCASTP(v_dsc.mem)->b_addr);
+
+        if (lblk != NULL && SEXP_VALP_LBLK(lblk->nxsz) == NULL) {
+                uint16_t offset = SEXP_LCASTP(v_dsc.mem)->offset;
+
+                qsort(lblk->memb + offset, lblk->real - offset, sizeof(SEXP_t),
+                      (int(*)(const void *, const void *))compare);
+
+                return (list);
+        }
 
         /*
          * PASS #1: Sort each block and build the iterator array
@@ -1638,16 +1733,16 @@ SEXP_t *SEXP_unref (SEXP_t *s_exp_o)
 
                         switch (v_dsc.type) {
                         case SEXP_VALTYPE_STRING:
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (v_dsc.hdr);
                                 break;
                         case SEXP_VALTYPE_NUMBER:
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (v_dsc.hdr);
                                 break;
                         case SEXP_VALTYPE_LIST:
                                 if (SEXP_LCASTP(v_dsc.mem)->b_addr != NULL)
                                         SEXP_rawval_lblk_free ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr, SEXP_free_lmemb);
 
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (v_dsc.hdr);
                                 break;
                         default:
                                 abort ();
@@ -1749,6 +1844,8 @@ bool SEXP_deepcmp(const SEXP_t *a, const SEXP_t *b)
 
         if (a == NULL || b == NULL)
                 return (a == b);
+        if (a->s_valp == b->s_valp)
+                return (true);
         if ((type = SEXP_typeof(a)) != SEXP_typeof(b))
                 return (false);
         if (!SEXP_listp(a)) {
@@ -1795,6 +1892,12 @@ bool SEXP_deepcmp(const SEXP_t *a, const SEXP_t *b)
 		register SEXP_t *ia, *ib;
 		register bool ret = false;
 
+                /* lists which were hashed before can be told apart by their IDs */
+                if (SEXP_LIST_IDVALID(SEXP_VALP_HDR(a->s_valp)) &&
+                    SEXP_LIST_IDVALID(SEXP_VALP_HDR(b->s_valp)) &&
+                    SEXP_ID_v(a) != SEXP_ID_v(b))
+                        return (false);
+
                 it_a = SEXP_list_it_new(a);
                 it_b = SEXP_list_it_new(b);
 
@@ -1833,16 +1936,16 @@ static void SEXP_free_lmemb (SEXP_t *s_exp)
                 if (SEXP_rawval_decref (s_exp->s_valp)) {
                         switch (v_dsc.type) {
                         case SEXP_VALTYPE_STRING:
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (v_dsc.hdr);
                                 break;
                         case SEXP_VALTYPE_NUMBER:
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (v_dsc.hdr);
                                 break;
                         case SEXP_VALTYPE_LIST:
                                 if (SEXP_LCASTP(v_dsc.mem)->b_addr != NULL)
                                         SEXP_rawval_lblk_free ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr, SEXP_free_lmemb);
 
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (v_dsc.hdr);
                                 break;
                         default:
                                 abort ();
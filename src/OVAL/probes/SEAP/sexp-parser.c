@@ -39,6 +39,7 @@
 #include "_sexp-datatype.h"
 #include "_sexp-value.h"
 #include "_sexp-rawptr.h"
+#include "_sexp-scan.h"
 #include "generic/xbase64.h"
 #include "generic/strto.h"
 #include "public/strbuf.h"
@@ -119,7 +120,7 @@ void SEXP_pstate_free (SEXP_pstate_t *pstate)
                                 SEXP_val_t v_dsc;
 
                                 SEXP_val_dsc (&v_dsc, pstate->v_bool[i]);
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (v_dsc.hdr);
                         }
                 }
         }
@@ -395,9 +396,11 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
 #define SEXP_LABELNUM_B64E_FIXED  132
 
         SEXP_pstate_t *state;
-        spb_size_t     spb_len;
+        spb_size_t     spb_len, scan_i;
         SEXP_t        *ref_l;
 
+        const SEXP_scan_t *scan = SEXP_scan_get ();
+
         uint8_t cur_c = 128;
         int     ret_p = SEXP_PRET_EUNDEF;
 
@@ -528,10 +531,14 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
                 }
                 /* NOTREACHED */
         L_DQUOTE:
+                e_dsc.p_label = '"';
+
                 if ((ret_p = psetup->p_funcp[SEXP_PFUNC_UL_STRING_DQ](&e_dsc)) != SEXP_PRET_SUCCESS)
                         break;
                 goto L_SEXP_ADD;
         L_SQUOTE:
+                e_dsc.p_label = '\'';
+
                 if ((ret_p = psetup->p_funcp[SEXP_PFUNC_UL_STRING_SQ](&e_dsc)) != SEXP_PRET_SUCCESS)
                         break;
                 goto L_SEXP_ADD;
@@ -643,24 +650,25 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
                 L_NUMBER_final_flt:
                         e_dsc.p_numclass = SEXP_NUMCLASS_FLT;
 
-                        spb_iterate (e_dsc.p_buffer, e_dsc.p_bufoff + e_dsc.p_explen, cur_c,
-                                     if (!isdigit (cur_c)) {
-                                             if (isnextexp (cur_c))
-                                                     goto L_NUMBER_stage3;
-                                             else {
-                                                     switch (cur_c) {
-                                                     case 'e':
-                                                     case 'E':
-                                                             ++e_dsc.p_explen;
-                                                             goto L_NUMBER_final_exp;
-                                                     default:
-                                                             goto L_NUMBER_invalid;
-                                                     }
-                                             }
-                                     }
-
-                                     ++e_dsc.p_explen;
-                                );
+                        scan_i = spb_scan (e_dsc.p_buffer, e_dsc.p_bufoff + e_dsc.p_explen, scan->nondigit);
+                        e_dsc.p_explen = scan_i - e_dsc.p_bufoff;
+
+                        if (scan_i < spb_len) {
+                                cur_c = spb_octet (e_dsc.p_buffer, scan_i);
+
+                                if (isnextexp (cur_c))
+                                        goto L_NUMBER_stage3;
+                                else {
+                                        switch (cur_c) {
+                                        case 'e':
+                                        case 'E':
+                                                ++e_dsc.p_explen;
+                                                goto L_NUMBER_final_exp;
+                                        default:
+                                                goto L_NUMBER_invalid;
+                                        }
+                                }
+                        }
 
                         if (e_dsc.p_flags & SEXP_PFLAG_EOFOK)
                                 goto L_NUMBER_stage3;
@@ -677,12 +685,13 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
 
                                 ++e_dsc.p_explen;
                         L_NUMBER_cont_int:
-                                spb_iterate (e_dsc.p_buffer, e_dsc.p_bufoff + e_dsc.p_explen, cur_c,
-                                             if (!isdigit (cur_c))
-                                                     goto L_NUMBER_stage2;
+                                scan_i = spb_scan (e_dsc.p_buffer, e_dsc.p_bufoff + e_dsc.p_explen, scan->nondigit);
+                                e_dsc.p_explen = scan_i - e_dsc.p_bufoff;
 
-                                             ++e_dsc.p_explen;
-                                        );
+                                if (scan_i < spb_len) {
+                                        cur_c = spb_octet (e_dsc.p_buffer, scan_i);
+                                        goto L_NUMBER_stage2;
+                                }
 
                                 if (e_dsc.p_flags & SEXP_PFLAG_EOFOK)
                                         goto L_NUMBER_stage3;
@@ -719,27 +728,25 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
                                         ++e_dsc.p_explen;
                                 }
                         L_NUMBER_final_exp2:
-                                spb_iterate (e_dsc.p_buffer, e_dsc.p_bufoff + e_dsc.p_explen, cur_c,
-                                             if (!isdigit (cur_c)) {
-                                                     if (isdigit (spb_octet (e_dsc.p_buffer,
-                                                                             e_dsc.p_bufoff + e_dsc.p_explen - 1)))
-                                                     {
-                                                             /*
-                                                              * We've reached some non-digit character but the previous
-                                                              * one was a digit - we consider this to be the end of the
-                                                              * exponent
-                                                              */
-                                                             goto L_NUMBER_stage3;
-                                                     } else {
-                                                             /*
-                                                              * Only digits are allowed right after the sign of exponent
-                                                              * characters
-                                                              */
-                                                             goto L_NUMBER_invalid;
-                                                     }
-                                             }
-                                             ++e_dsc.p_explen;
-                                        );
+                                scan_i = spb_scan (e_dsc.p_buffer, e_dsc.p_bufoff + e_dsc.p_explen, scan->nondigit);
+                                e_dsc.p_explen = scan_i - e_dsc.p_bufoff;
+
+                                if (scan_i < spb_len) {
+                                        if (isdigit (spb_octet (e_dsc.p_buffer, scan_i - 1))) {
+                                                /*
+                                                 * We've reached some non-digit character but the previous
+                                                 * one was a digit - we consider this to be the end of the
+                                                 * exponent
+                                                 */
+                                                goto L_NUMBER_stage3;
+                                        } else {
+                                                /*
+                                                 * Only digits are allowed right after the sign of exponent
+                                                 * characters
+                                                 */
+                                                goto L_NUMBER_invalid;
+                                        }
+                                }
 
                                 if (e_dsc.p_flags & SEXP_PFLAG_EOFOK)
                                         goto L_NUMBER_stage3;
@@ -1082,11 +1089,12 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
 
                 break;
         L_WHITESPACE:
-                spb_iterate (e_dsc.p_buffer, e_dsc.p_bufoff, cur_c,
-                             if (!isspace (cur_c))
-                                     goto L_NO_CURC_UPDATE;
-                             ++e_dsc.p_bufoff;
-                        );
+                e_dsc.p_bufoff = spb_scan (e_dsc.p_buffer, e_dsc.p_bufoff, scan->nonspace);
+
+                if (e_dsc.p_bufoff < spb_len) {
+                        cur_c = spb_octet (e_dsc.p_buffer, e_dsc.p_bufoff);
+                        goto L_NO_CURC_UPDATE;
+                }
 
                 ret_p = SEXP_PRET_SUCCESS;
                 break;
@@ -1238,6 +1246,9 @@ SKIP_LOOP:
                          * Save the reference to the top-level list and free parser state.
                          */
                         s_list = SEXP_lstack_list (&state->l_stack);
+                        /* the saved subparser data may have been freed by the subparser */
+                        state->sp_data = e_dsc.sp_data;
+                        state->sp_free = e_dsc.sp_free;
                         SEXP_pstate_free (state);
                         *pstate = NULL;
 
@@ -1301,9 +1312,8 @@ SKIP_LOOP:
  */
 __PARSE_RT SEXP_parse_ul_string_si (__PARSE_PT(dsc))
 {
-        spb_size_t itb;
+        spb_size_t itb, end;
         register spb_size_t cnt;
-        register uint8_t    oct;
 
         assume_d (dsc != NULL, SEXP_PRET_EUNDEF);
         assume_d (dsc->p_buffer != NULL, SEXP_PRET_EUNDEF);
@@ -1321,11 +1331,11 @@ __PARSE_RT SEXP_parse_ul_string_si (__PARSE_PT(dsc))
                 cnt = 0;
         }
 
-        spb_iterate (dsc->p_buffer, itb, oct,
-                     if (isnextexp (oct))
-                             goto found;
-                     ++cnt;
-                );
+        end  = spb_scan (dsc->p_buffer, itb, SEXP_scan_get ()->nextexp);
+        cnt += end - itb;
+
+        if (end < spb_size (dsc->p_buffer))
+                goto found;
 
         /*
          * === Implementation note #1 ===
@@ -1406,8 +1416,9 @@ __PARSE_RT SEXP_parse_ul_string_dq (__PARSE_PT(dsc))
         spb_size_t itb;
         strbuf_t  *strbuf;
 
+        spb_size_t end, size;
+
         register spb_size_t noesc_s, noesc_l;
-        register bool       esc = false;
         register uint8_t    oct;
 
         assume_d (dsc != NULL, SEXP_PRET_EUNDEF);
@@ -1443,68 +1454,69 @@ __PARSE_RT SEXP_parse_ul_string_dq (__PARSE_PT(dsc))
 
         noesc_s = 0;
         noesc_l = 0;
+        size    = spb_size (dsc->p_buffer);
 
-        spb_iterate (dsc->p_buffer, itb, oct,
-                     /* Use branch prediction? */
-                     if (__predict(!esc, 1)) {
-                             switch (oct) {
-                             case '\\':
-                                     esc = true;
-                                     break;
-                             case '"':
-                                     goto found;
-                             default:
-                                     ++noesc_l;
-                             }
-                     } else {
-                             /* Copy noescape block into strbuf */
-                             if (noesc_l > 0) {
-                                     if (spb_pick_cb (dsc->p_buffer, itb + noesc_s, noesc_l,
-                                                      (void *(*)(void *, void *, size_t)) &strbuf_add, (void *)strbuf) != 0)
-                                     {
-                                             return (SEXP_PRET_EUNDEF);
-                                     }
-                             }
-
-                             /* Handle escape character */
-                             switch (oct) {
-                             case 'n': /* New line */
-                                     oct = '\n';
-                                     break;
-                             case 't': /* Horizontal tab */
-                                     oct = '\t';
-                                     break;
-                             case 'r': /* Cariage return */
-                                     oct = '\r';
-                                     break;
-                             case '0': /* Null byte */
-                                     oct = '\0';
-                                     break;
-                             case 'x': /* Hexadecimal - two more character needed */
-                                     abort ();
-                             case 'a': /* Alert (beep) */
-                                     oct = '\a';
-                                     break;
-                             case 'b': /* Backspace */
-                                     oct = '\b';
-                                     break;
-                             case 'v': /* Vertical tab */
-                                     oct = '\v';
-                                     break;
-                             case 'f': /* Form feed */
-                                     oct = '\f';
-                                     break;
-                             }
-
-                             if (strbuf_addc (strbuf, oct) != 0)
-                                     return (SEXP_PRET_EUNDEF);
-
-                             dsc->p_explen += noesc_l + 2 /* backslash + char */;
-                             noesc_s       += noesc_l + 2;
-                             noesc_l        = 0;
-                             esc            = false;
-                     }
-                );
+        for (;;) {
+                end     = spb_scan (dsc->p_buffer, itb + noesc_s, SEXP_scan_get ()->dquote);
+                noesc_l = end - (itb + noesc_s);
+
+                if (end >= size)
+                        break;
+                if (spb_octet (dsc->p_buffer, end) == '"')
+                        goto found;
+                /*
+                 * The escaped character isn't in the buffer yet, leave
+                 * the backslash for the next invocation.
+                 */
+                if (end + 1 >= size)
+                        break;
+
+                /* Copy noescape block into strbuf */
+                if (noesc_l > 0) {
+                        if (spb_pick_cb (dsc->p_buffer, itb + noesc_s, noesc_l,
+                                         (void *(*)(void *, void *, size_t)) &strbuf_add, (void *)strbuf) != 0)
+                        {
+                                return (SEXP_PRET_EUNDEF);
+                        }
+                }
+
+                /* Handle escape character */
+                switch (oct = spb_octet (dsc->p_buffer, end + 1)) {
+                case 'n': /* New line */
+                        oct = '\n';
+                        break;
+                case 't': /* Horizontal tab */
+                        oct = '\t';
+                        break;
+                case 'r': /* Cariage return */
+                        oct = '\r';
+                        break;
+                case '0': /* Null byte */
+                        oct = '\0';
+                        break;
+                case 'x': /* Hexadecimal - two more character needed */
+                        abort ();
+                case 'a': /* Alert (beep) */
+                        oct = '\a';
+                        break;
+                case 'b': /* Backspace */
+                        oct = '\b';
+                        break;
+                case 'v': /* Vertical tab */
+                        oct = '\v';
+                        break;
+                case 'f': /* Form feed */
+                        oct = '\f';
+                        break;
+                }
+
+                if (strbuf_addc (strbuf, oct) != 0)
+                        return (SEXP_PRET_EUNDEF);
+
+                dsc->p_explen += noesc_l + 2 /* backslash + char */;
+                noesc_s       += noesc_l + 2;
+                noesc_l        = 0;
+        }
 
         if (noesc_l > 0) {
                 if (spb_pick_cb (dsc->p_buffer, itb + noesc_s, noesc_l,
@@ -1537,7 +1549,7 @@ found:
 
                 sz = strbuf_size (strbuf);
 
-                assume_r (spb_size (dsc->p_buffer) >= itb + sz, SEXP_PRET_EUNDEF);
+                assume_r (spb_size (dsc->p_buffer) >= dsc->p_bufoff + dsc->p_explen, SEXP_PRET_EUNDEF);
 
                 if (SEXP_val_new (&v_dsc, sizeof (char) * sz,
                                   SEXP_VALTYPE_STRING) != 0)
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "_sexp-scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define SEXP_SCAN_X86 1
+# include <immintrin.h>
+#endif
+
+#define C_NEXTEXP 0x01
+#define C_DQUOTE  0x02
+#define C_SPACE   0x04
+#define C_DIGIT   0x08
+
+/* has to be kept in sync with isnextexp() in sexp-parser.c */
+static const uint8_t __scan_class[256] = {
+        ['\a'] = C_NEXTEXP,
+        ['\t'] = C_NEXTEXP | C_SPACE,
+        ['\n'] = C_NEXTEXP | C_SPACE,
+        ['\v'] = C_SPACE,
+        ['\f'] = C_SPACE,
+        ['\r'] = C_NEXTEXP | C_SPACE,
+        [' ' ] = C_NEXTEXP | C_SPACE,
+        ['"' ] = C_NEXTEXP | C_DQUOTE,
+        ['#' ] = C_NEXTEXP,
+        ['\''] = C_NEXTEXP,
+        ['(' ] = C_NEXTEXP,
+        [')' ] = C_NEXTEXP,
+        ['[' ] = C_NEXTEXP,
+        [']' ] = C_NEXTEXP,
+        ['{' ] = C_NEXTEXP,
+        ['|' ] = C_NEXTEXP,
+        ['}' ] = C_NEXTEXP,
+        ['\\'] = C_DQUOTE,
+        ['0' ] = C_DIGIT, ['1'] = C_DIGIT, ['2'] = C_DIGIT, ['3'] = C_DIGIT, ['4'] = C_DIGIT,
+        ['5' ] = C_DIGIT, ['6'] = C_DIGIT, ['7'] = C_DIGIT, ['8'] = C_DIGIT, ['9'] = C_DIGIT
+};
+
+#define SCAN_SCALAR(name, stop)                                         \
+        static size_t name (const uint8_t *buf, size_t len)             \
+        {                                                               \
+                size_t i;                                               \
+                                                                        \
+                for (i = 0; i < len; ++i)                               \
+                        if (stop)                                       \
+                                break;                                  \
+                return (i);                                             \
+        }
+
+SCAN_SCALAR(SEXP_scan_nextexp_scalar,    (__scan_class[buf[i]] & C_NEXTEXP))
+SCAN_SCALAR(SEXP_scan_dquote_scalar,     (__scan_class[buf[i]] & C_DQUOTE))
+SCAN_SCALAR(SEXP_scan_nonspace_scalar,  !(__scan_class[buf[i]] & C_SPACE))
+SCAN_SCALAR(SEXP_scan_nondigit_scalar,  !(__scan_class[buf[i]] & C_DIGIT))
+
+static const SEXP_scan_t __scan_scalar = {
+        "scalar",
+        &SEXP_scan_nextexp_scalar,
+        &SEXP_scan_dquote_scalar,
+        &SEXP_scan_nonspace_scalar,
+        &SEXP_scan_nondigit_scalar
+};
+
+#if defined(SEXP_SCAN_X86)
+/*
+ * The vector scanners compare a whole vector of bytes with the
+ * characters of the class and stop at the first set bit of the
+ * resulting mask. The rest of the buffer which doesn't fill
+ * a vector is scanned by the scalar code.
+ */
+#define SCAN_VECTOR(name, isa, vtype, vwidth, vload, vmask, vmatch, scalar) \
+        __attribute__ ((target (isa)))                                  \
+        static size_t name (const uint8_t *buf, size_t len)             \
+        {                                                               \
+                size_t   i;                                             \
+                uint32_t m;                                             \
+                                                                        \
+                for (i = 0; i + (vwidth) <= len; i += (vwidth)) {       \
+                        vtype x = vload ((const vtype *)(buf + i));     \
+                                                                        \
+                        m = (uint32_t) vmask (vmatch);                  \
+                        if (m != 0)                                     \
+                                return (i + (size_t) __builtin_ctz (m)); \
+                }                                                       \
+                return (i + scalar (buf + i, len - i));                 \
+        }
+
+#define V_SSE2(name, match, scalar) \
+        SCAN_VECTOR(name, "sse2", __m128i, 16, _mm_loadu_si128, _mm_movemask_epi8, match, scalar)
+#define V_AVX2(name, match, scalar) \
+        SCAN_VECTOR(name, "avx2", __m256i, 32, _mm256_loadu_si256, _mm256_movemask_epi8, match, scalar)
+
+/* x == c */
+#define EQ128(c) _mm_cmpeq_epi8 (x, _mm_set1_epi8 ((char)(c)))
+#define EQ256(c) _mm256_cmpeq_epi8 (x, _mm256_set1_epi8 ((char)(c)))
+/* lo <= x <= hi, unsigned */
+#define IN128(lo, hi) _mm_cmpeq_epi8 (_mm_min_epu8 (_mm_sub_epi8 (x, _mm_set1_epi8 ((char)(lo))), \
+                                                    _mm_set1_epi8 ((char)((hi) - (lo)))),       \
+                                      _mm_sub_epi8 (x, _mm_set1_epi8 ((char)(lo))))
+#define IN256(lo, hi) _mm256_cmpeq_epi8 (_mm256_min_epu8 (_mm256_sub_epi8 (x, _mm256_set1_epi8 ((char)(lo))), \
+                                                          _mm256_set1_epi8 ((char)((hi) - (lo)))),          \
+                                         _mm256_sub_epi8 (x, _mm256_set1_epi8 ((char)(lo))))
+
+#define NEXTEXP(OR, EQ, IN)                                             \
+        OR (OR (OR (OR (EQ ('\a'), IN ('\t', '\n')),                    \
+                    OR (EQ ('\r'), EQ (' '))),                          \
+                OR (OR (IN ('"', '#'), IN ('\'', ')')),                 \
+                    OR (EQ ('['), EQ (']')))),                          \
+            IN ('{', '}'))
+#define DQUOTE(OR, EQ, IN) OR (EQ ('"'), EQ ('\\'))
+#define SPACE(OR, EQ, IN)  OR (EQ (' '), IN ('\t', '\r'))
+#define DIGIT(OR, EQ, IN)  IN ('0', '9')
+
+V_SSE2(SEXP_scan_nextexp_sse2,  NEXTEXP(_mm_or_si128, EQ128, IN128), SEXP_scan_nextexp_scalar)
+V_SSE2(SEXP_scan_dquote_sse2,   DQUOTE(_mm_or_si128, EQ128, IN128),  SEXP_scan_dquote_scalar)
+V_SSE2(SEXP_scan_nonspace_sse2, _mm_xor_si128 (SPACE(_mm_or_si128, EQ128, IN128), _mm_set1_epi8 (-1)),
+       SEXP_scan_nonspace_scalar)
+V_SSE2(SEXP_scan_nondigit_sse2, _mm_xor_si128 (DIGIT(_mm_or_si128, EQ128, IN128), _mm_set1_epi8 (-1)),
+       SEXP_scan_nondigit_scalar)
+
+V_AVX2(SEXP_scan_nextexp_avx2,  NEXTEXP(_mm256_or_si256, EQ256, IN256), SEXP_scan_nextexp_scalar)
+V_AVX2(SEXP_scan_dquote_avx2,   DQUOTE(_mm256_or_si256, EQ256, IN256),  SEXP_scan_dquote_scalar)
+V_AVX2(SEXP_scan_nonspace_avx2, _mm256_xor_si256 (SPACE(_mm256_or_si256, EQ256, IN256), _mm256_set1_epi8 (-1)),
+       SEXP_scan_nonspace_scalar)
+V_AVX2(SEXP_scan_nondigit_avx2, _mm256_xor_si256 (DIGIT(_mm256_or_si256, EQ256, IN256), _mm256_set1_epi8 (-1)),
+       SEXP_scan_nondigit_scalar)
+
+static const SEXP_scan_t __scan_sse2 = {
+        "sse2",
+        &SEXP_scan_nextexp_sse2,
+        &SEXP_scan_dquote_sse2,
+        &SEXP_scan_nonspace_sse2,
+        &SEXP_scan_nondigit_sse2
+};
+
+static const SEXP_scan_t __scan_avx2 = {
+        "avx2",
+        &SEXP_scan_nextexp_avx2,
+        &SEXP_scan_dquote_avx2,
+        &SEXP_scan_nonspace_avx2,
+        &SEXP_scan_nondigit_avx2
+};
+#endif /* SEXP_SCAN_X86 */
+
+static const SEXP_scan_t *__scan = &__scan_scalar;
+static pthread_once_t     __scan_once = PTHREAD_ONCE_INIT;
+
+static void SEXP_scan_init (void)
+{
+        const SEXP_scan_t *avail[3];
+        const char *env;
+        size_t i, n = 0;
+
+        avail[n++] = &__scan_scalar;
+#if defined(SEXP_SCAN_X86)
+        __builtin_cpu_init ();
+
+        if (__builtin_cpu_supports ("sse2"))
+                avail[n++] = &__scan_sse2;
+        if (__builtin_cpu_supports ("avx2"))
+                avail[n++] = &__scan_avx2;
+#endif
+        __scan = avail[n - 1];
+        env    = getenv (SEXP_SCAN_ENV);
+
+        if (env != NULL) {
+                for (i = 0; i < n; ++i) {
+                        if (strcmp (env, avail[i]->name) == 0) {
+                                __scan = avail[i];
+                                break;
+                        }
+                }
+        }
+}
+
+const SEXP_scan_t *SEXP_scan_get (void)
+{
+        (void) pthread_once (&__scan_once, &SEXP_scan_init);
+        return (__scan);
+}
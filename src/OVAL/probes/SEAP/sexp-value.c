@@ -29,22 +29,23 @@
 
 #include "_sexp-atomic.h"
 #include "_sexp-value.h"
+#include "_sexp-arena.h"
 #include "public/sm_alloc.h"
 
 int SEXP_val_new (SEXP_val_t *dst, size_t vmemsize, SEXP_type_t type)
 {
         void *s_val;
 
-        if (sm_memalign (&s_val, SEXP_VALP_ALIGN,
-                         sizeof (SEXP_valhdr_t) + vmemsize) != 0)
-        {
+        s_val = SEXP_valmem_alloc (sizeof (SEXP_valhdr_t) + vmemsize, SEXP_VALP_ALIGN);
+
+        if (s_val == NULL)
                 return (-1);
-        }
 
         SEXP_val_dsc (dst, (uintptr_t) s_val);
 
-        dst->hdr->refs = 1;
-        dst->hdr->size = vmemsize;
+        dst->hdr->refs  = 1;
+        dst->hdr->flags = 0;
+        dst->hdr->size  = vmemsize;
         dst->type      = type;
         dst->ptr       = SEXP_val_ptr (dst);
 #if defined(SEAP_VERBOSE_DEBUG)
@@ -62,6 +63,11 @@ void SEXP_val_dsc (SEXP_val_t *dst, uintptr_t ptr)
         dst->type = ptr & SEXP_VALT_MASK;
 }
 
+void SEXP_val_free (SEXP_valhdr_t *hdr)
+{
+        SEXP_valmem_free (hdr, SEXP_VALP_ALIGN);
+}
+
 uintptr_t SEXP_val_ptr (SEXP_val_t *dsc)
 {
         return ((dsc->ptr & SEXP_VALP_MASK) | (dsc->type & SEXP_VALT_MASK));
@@ -114,8 +120,10 @@ uintptr_t SEXP_rawval_lblk_new (uint8_t sz)
 
         _A(sz < 16);
 
-        if (sm_memalign ((void **)(void *)&lblk, SEXP_LBLK_ALIGN,
-                         sizeof (uintptr_t) + (2 * sizeof (uint16_t)) + (sizeof (SEXP_t) * (1 << sz))) != 0) {
+        lblk = SEXP_valmem_alloc (sizeof (uintptr_t) + (2 * sizeof (uint16_t)) + (sizeof (SEXP_t) * (1 << sz)),
+                                  SEXP_LBLK_ALIGN);
+
+        if (lblk == NULL) {
                 /* TODO: handle this */
                 abort ();
                 return ((uintptr_t) NULL);
@@ -436,7 +444,7 @@ uintptr_t SEXP_rawval_list_copy (uintptr_t s_valp)
 {
         SEXP_val_t v_dsc_o, v_dsc_c;
 
-        if (SEXP_val_new (&v_dsc_c, sizeof (void *) + sizeof (uint16_t),
+        if (SEXP_val_new (&v_dsc_c, sizeof (struct SEXP_val_list),
                           SEXP_VALTYPE_LIST) != 0)
         {
                 /* TODO: handle this */
@@ -454,63 +462,81 @@ uintptr_t SEXP_rawval_list_copy (uintptr_t s_valp)
 
 uintptr_t SEXP_rawval_lblk_copy (uintptr_t lblkp, uint16_t n_skip)
 {
-        struct SEXP_val_lblk *lb_new, *lb_old;
-        uintptr_t lb_next;
+        return SEXP_rawval_lblk_copyn (lblkp, n_skip, 0);
+}
+
+/*
+ * Copy the members of a block chain, skipping the first `n_skip' ones,
+ * into as few blocks as possible: the whole copy is a single block
+ * unless it has more than 2^15 members. The first block has room for
+ * at least `n_min' members (up to 2^15). Empty chains aren't copied.
+ */
+uintptr_t SEXP_rawval_lblk_copyn (uintptr_t lblkp, uint16_t n_skip, size_t n_min)
+{
+        struct SEXP_val_lblk *lb_new, *lb_old, *lb_prev;
         uintptr_t lb_head;
-        uint16_t  off_n;  /* offset in the new block */
-        uint16_t  off_o;  /* offset in the old block */
-        uint8_t  cur_sz;  /* size of the new block */
+        size_t    left;     /* number of members left to copy */
+        uint16_t  off_o;    /* offset in the old block */
+        uint8_t   b_exp;
 
-        lb_head = 0;
-        off_n   = 0;
+        left   = 0;
+        lb_old = SEXP_VALP_LBLK(lblkp);
+
+        while (lb_old != NULL) {
+                left  += lb_old->real;
+                lb_old = SEXP_VALP_LBLK(lb_old->nxsz);
+        }
+
+        if (left <= n_skip)
+                return ((uintptr_t) NULL);
+
+        left   -= n_skip;
         off_o   = n_skip;
         lb_old  = SEXP_VALP_LBLK(lblkp);
+        lb_head = 0;
+        lb_prev = NULL;
 
-        if (lb_old == NULL)
-                return ((uintptr_t) NULL);
+        if (n_min > (1 << 15))
+                n_min = (1 << 15);
 
-        cur_sz  = 0;
-        lb_new  = (struct SEXP_val_lblk *)SEXP_rawval_lblk_new (cur_sz);
-        lb_head = (uintptr_t)lb_new;
+        while (left > 0) {
+                size_t n = left < (1 << 15) ? left : (1 << 15);
 
-        while (lb_old != NULL) {
-                if ((lb_old->real - off_o) == 0) {
-                        /*
-                         * move to the next old block
-                         */
-                        lb_old = SEXP_VALP_LBLK(lb_old->nxsz);
+                if (lb_prev == NULL && n < n_min)
+                        n = n_min;
 
-                        if (lb_old == NULL)
-                                break;
+                for (b_exp = 0; ((size_t)1 << b_exp) < n; ++b_exp);
 
-                        off_o  = 0;
-                }
+                lb_new = SEXP_VALP_LBLK(SEXP_rawval_lblk_new (b_exp));
 
-                /*
-                 * allocate new block
-                 */
-                if (lb_new->real >= (1 << (cur_sz))) {
-                        lb_next = SEXP_rawval_lblk_new (++cur_sz);
-                        lb_new->nxsz = (lb_next & SEXP_LBLKP_MASK) | (lb_new->nxsz & SEXP_LBLKS_MASK);
-                        lb_new  = SEXP_VALP_LBLK(lb_next);
-                        off_n   = 0;
-                }
+                if (lb_prev == NULL)
+                        lb_head = (uintptr_t)lb_new;
+                else
+                        lb_prev->nxsz = ((uintptr_t)lb_new & SEXP_LBLKP_MASK) | (lb_prev->nxsz & SEXP_LBLKS_MASK);
 
                 /*
                  * copy list items
                  */
-                while (off_n < (1 << cur_sz) && off_o < lb_old->real) {
-                        lb_new->memb[off_n].s_valp = SEXP_rawval_incref (lb_old->memb[off_o].s_valp);
-                        lb_new->memb[off_n].s_type = lb_old->memb[off_o].s_type;
+                while (lb_new->real < n && left > 0) {
+                        if (off_o == lb_old->real) {
+                                /* move to the next old block */
+                                lb_old = SEXP_VALP_LBLK(lb_old->nxsz);
+                                off_o  = 0;
+                                continue;
+                        }
+
+                        lb_new->memb[lb_new->real].s_valp = SEXP_rawval_incref (lb_old->memb[off_o].s_valp);
+                        lb_new->memb[lb_new->real].s_type = lb_old->memb[off_o].s_type;
 #if !defined(NDEBUG) || defined(VALIDATE_SEXP)
-                        lb_new->memb[off_n].__magic0 = lb_old->memb[off_o].__magic0;
-                        lb_new->memb[off_n].__magic1 = lb_old->memb[off_o].__magic1;
+                        lb_new->memb[lb_new->real].__magic0 = lb_old->memb[off_o].__magic0;
+                        lb_new->memb[lb_new->real].__magic1 = lb_old->memb[off_o].__magic1;
 #endif
-
-                        ++off_n;
-                        ++off_o;
                         ++lb_new->real;
+                        ++off_o;
+                        --left;
                 }
+
+                lb_prev = lb_new;
         }
 
         return (lb_head);
@@ -529,7 +555,7 @@ void SEXP_rawval_lblk_free (uintptr_t lblkp, void (*func) (SEXP_t *))
                         func (lblk->memb + lblk->real);
                 }
 
-                sm_free (lblk);
+                SEXP_valmem_free (lblk, SEXP_LBLK_ALIGN);
 
                 if (next != NULL)
                         SEXP_rawval_lblk_free ((uintptr_t)next, func);
@@ -550,7 +576,7 @@ void SEXP_rawval_lblk_free1 (uintptr_t lblkp, void (*func) (SEXP_t *))
                         func (lblk->memb + lblk->real);
                 }
 
-                sm_free (lblk);
+                SEXP_valmem_free (lblk, SEXP_LBLK_ALIGN);
         }
 
         return;
@@ -35,8 +35,18 @@ int crapi_init (void *unused)
 }
 #elif defined(HAVE_GCRYPT)
 #include <gcrypt.h>
+#if GCRYPT_VERSION_NUMBER < 0x010600
+#include <errno.h>
+#include <pthread.h>
+/* older versions need to be told that digests are computed concurrently */
+GCRY_THREAD_OPTION_PTHREAD_IMPL;
+#endif
+
 int crapi_init (void *unused)
 {
+#if GCRYPT_VERSION_NUMBER < 0x010600
+	gcry_control(GCRYCTL_SET_THREAD_CBS, &gcry_threads_pthread);
+#endif
 #ifdef HAVE_GCRYCTL_SET_ENFORCED_FIPS_FLAG
 	gcry_control(GCRYCTL_SET_ENFORCED_FIPS_FLAG, 0);
 #endif
@@ -27,7 +27,10 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <assume.h>
 #include <errno.h>
 
@@ -64,17 +67,96 @@ int crapi_digest_fd (int fd, crapi_alg_t alg, void *dst, size_t *size)
         return (-1);
 }
 
-int crapi_mdigest_fd (int fd, int num, ... /* crapi_alg_t alg, void *dst, size_t *size, ...*/)
+static int crapi_digest_ctbl_set (struct digest_ctbl_t *ctbl, crapi_alg_t alg)
+{
+        switch (alg) {
+        case CRAPI_DIGEST_MD5:
+                ctbl->init   = &crapi_md5_init;
+                ctbl->update = &crapi_md5_update;
+                ctbl->fini   = &crapi_md5_fini;
+                ctbl->free   = &crapi_md5_free;
+                break;
+        case CRAPI_DIGEST_SHA1:
+                ctbl->init   = &crapi_sha1_init;
+                ctbl->update = &crapi_sha1_update;
+                ctbl->fini   = &crapi_sha1_fini;
+                ctbl->free   = &crapi_sha1_free;
+                break;
+        case CRAPI_DIGEST_SHA224:
+                ctbl->init   = &crapi_sha224_init;
+                ctbl->update = &crapi_sha224_update;
+                ctbl->fini   = &crapi_sha224_fini;
+                ctbl->free   = &crapi_sha224_free;
+                break;
+        case CRAPI_DIGEST_SHA256:
+                ctbl->init   = &crapi_sha256_init;
+                ctbl->update = &crapi_sha256_update;
+                ctbl->fini   = &crapi_sha256_fini;
+                ctbl->free   = &crapi_sha256_free;
+                break;
+        case CRAPI_DIGEST_SHA384:
+                ctbl->init   = &crapi_sha384_init;
+                ctbl->update = &crapi_sha384_update;
+                ctbl->fini   = &crapi_sha384_fini;
+                ctbl->free   = &crapi_sha384_free;
+                break;
+        case CRAPI_DIGEST_SHA512:
+                ctbl->init   = &crapi_sha512_init;
+                ctbl->update = &crapi_sha512_update;
+                ctbl->fini   = &crapi_sha512_fini;
+                ctbl->free   = &crapi_sha512_free;
+                break;
+        case CRAPI_DIGEST_RMD160:
+                ctbl->init   = &crapi_rmd160_init;
+                ctbl->update = &crapi_rmd160_update;
+                ctbl->fini   = &crapi_rmd160_fini;
+                ctbl->free   = &crapi_rmd160_free;
+                break;
+        default:
+                errno = EINVAL;
+                return (-1);
+        }
+
+        return (0);
+}
+
+static int crapi_mdigest_update (struct digest_ctbl_t *ctbl, int num, void *buf, size_t len)
 {
         register int i;
-        va_list ap;
-        struct digest_ctbl_t ctbl[num];
 
-        crapi_alg_t alg;
-        void       *dst;
-        size_t     *size;
+        for (i = 0; i < num; ++i) {
+                if (ctbl[i].ctx == NULL)
+                        continue;
+                if (ctbl[i].update (ctbl[i].ctx, buf, len) != 0)
+                        return (-1);
+        }
+
+        return (0);
+}
+
+/*
+ * The files are read rather than mapped: a mapped file truncated by
+ * another process while it's being digested would raise SIGBUS.
+ * Large regular files are read in larger blocks.
+ */
+static size_t crapi_mdigest_bufsz (int fd)
+{
+        struct stat st;
+
+        if (fstat (fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < CRAPI_MDIGEST_LARGE_MINSZ)
+                return (CRAPI_MDIGEST_BUFSZ);
+#if defined(POSIX_FADV_SEQUENTIAL)
+        (void) posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        return (CRAPI_MDIGEST_LARGE_BUFSZ);
+}
 
-        uint8_t fd_buf[CRAPI_IO_BUFSZ];
+int crapi_mdigest_fdv (int fd, int num, const crapi_alg_t *alg, void **dst, size_t **size)
+{
+        register int i;
+        struct digest_ctbl_t ctbl[num];
+        uint8_t *fd_buf = NULL;
+        size_t  bufsz;
         ssize_t ret;
 
         assume_r (num > 0, -1, errno = EINVAL;);
@@ -83,95 +165,31 @@ int crapi_mdigest_fd (int fd, int num, ... /* crapi_alg_t alg, void *dst, size_t
         for (i = 0; i < num; ++i)
                 ctbl[i].ctx = NULL;
 
-        va_start (ap, num);
-
         for (i = 0; i < num; ++i) {
-                alg  = va_arg (ap, crapi_alg_t);
-                dst  = va_arg (ap, void *);
-                size = va_arg (ap, size_t *);
-
-                switch (alg) {
-                case CRAPI_DIGEST_MD5:
-                        ctbl[i].init   = &crapi_md5_init;
-                        ctbl[i].update = &crapi_md5_update;
-                        ctbl[i].fini   = &crapi_md5_fini;
-                        ctbl[i].free   = &crapi_md5_free;
-                        break;
-                case CRAPI_DIGEST_SHA1:
-                        ctbl[i].init   = &crapi_sha1_init;
-                        ctbl[i].update = &crapi_sha1_update;
-                        ctbl[i].fini   = &crapi_sha1_fini;
-                        ctbl[i].free   = &crapi_sha1_free;
-                        break;
-                case CRAPI_DIGEST_SHA224:
-                        ctbl[i].init   = &crapi_sha224_init;
-                        ctbl[i].update = &crapi_sha224_update;
-                        ctbl[i].fini   = &crapi_sha224_fini;
-                        ctbl[i].free   = &crapi_sha224_free;
-                        break;
-                case CRAPI_DIGEST_SHA256:
-                        ctbl[i].init   = &crapi_sha256_init;
-                        ctbl[i].update = &crapi_sha256_update;
-                        ctbl[i].fini   = &crapi_sha256_fini;
-                        ctbl[i].free   = &crapi_sha256_free;
-                        break;
-                case CRAPI_DIGEST_SHA384:
-                        ctbl[i].init   = &crapi_sha384_init;
-                        ctbl[i].update = &crapi_sha384_update;
-                        ctbl[i].fini   = &crapi_sha384_fini;
-                        ctbl[i].free   = &crapi_sha384_free;
-                        break;
-                case CRAPI_DIGEST_SHA512:
-                        ctbl[i].init   = &crapi_sha512_init;
-                        ctbl[i].update = &crapi_sha512_update;
-                        ctbl[i].fini   = &crapi_sha512_fini;
-                        ctbl[i].free   = &crapi_sha512_free;
-                        break;
-                case CRAPI_DIGEST_RMD160:
-                        ctbl[i].init   = &crapi_rmd160_init;
-                        ctbl[i].update = &crapi_rmd160_update;
-                        ctbl[i].fini   = &crapi_rmd160_fini;
-                        ctbl[i].free   = &crapi_rmd160_free;
-                        break;
-                default:
-                        va_end (ap);
+                if (crapi_digest_ctbl_set (&ctbl[i], alg[i]) != 0)
                         goto fail;
-                }
-
-                if ((ctbl[i].ctx = ctbl[i].init (dst, size)) == NULL)
-			*size = 0;
+                if ((ctbl[i].ctx = ctbl[i].init (dst[i], size[i])) == NULL)
+			*size[i] = 0;
         }
 
-        va_end (ap);
-
-        while ((ret = read (fd, fd_buf, sizeof fd_buf)) == sizeof fd_buf) {
-#pragma omp parallel for
-                for (i = 0; i < num; ++i) {
-			if (ctbl[i].ctx == NULL)
-				continue;
-                        if (ctbl[i].update (ctbl[i].ctx, fd_buf, sizeof fd_buf) != 0) {
-                                goto fail;
-                        }
-                }
-        }
+        bufsz = crapi_mdigest_bufsz (fd);
 
-        switch (ret) {
-        case 0:
-                break;
-        case -1:
+        if ((fd_buf = malloc (bufsz)) == NULL)
                 goto fail;
-        default:
-                assume_r (ret > 0, -1, goto fail;);
-
-                for (i = 0; i < num; ++i) {
-			if (ctbl[i].ctx == NULL)
-				continue;
-                        if (ctbl[i].update (ctbl[i].ctx, fd_buf, (size_t)ret) != 0) {
-                                goto fail;
-                        }
+
+        while ((ret = read (fd, fd_buf, bufsz)) != 0) {
+                if (ret < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        goto fail;
                 }
+                if (crapi_mdigest_update (ctbl, num, fd_buf, (size_t)ret) != 0)
+                        goto fail;
         }
 
+        free (fd_buf);
+        fd_buf = NULL;
+
         for (i = 0; i < num; ++i) {
 		if (ctbl[i].ctx == NULL)
 			continue;
@@ -180,9 +198,35 @@ int crapi_mdigest_fd (int fd, int num, ... /* crapi_alg_t alg, void *dst, size_t
 
         return (0);
 fail:
+        free (fd_buf);
+
         for (i = 0; i < num; ++i)
                 if (ctbl[i].ctx != NULL)
                         ctbl[i].free (ctbl[i].ctx);
 
         return (-1);
 }
+
+int crapi_mdigest_fd (int fd, int num, ... /* crapi_alg_t alg, void *dst, size_t *size, ...*/)
+{
+        register int i;
+        va_list ap;
+
+        assume_r (num > 0, -1, errno = EINVAL;);
+
+        crapi_alg_t alg[num];
+        void       *dst[num];
+        size_t     *size[num];
+
+        va_start (ap, num);
+
+        for (i = 0; i < num; ++i) {
+                alg[i]  = va_arg (ap, crapi_alg_t);
+                dst[i]  = va_arg (ap, void *);
+                size[i] = va_arg (ap, size_t *);
+        }
+
+        va_end (ap);
+
+        return crapi_mdigest_fdv (fd, num, alg, dst, size);
+}
@@ -53,6 +53,25 @@ struct digest_ctbl_t {
         void  (*free)  (void *);
 };
 
+#ifndef CRAPI_MDIGEST_BUFSZ
+#define CRAPI_MDIGEST_BUFSZ (128 * 1024) /**< read size */
+#endif
+
+#ifndef CRAPI_MDIGEST_LARGE_MINSZ
+#define CRAPI_MDIGEST_LARGE_MINSZ (1024 * 1024) /**< regular files at least this large are read in larger blocks */
+#endif
+
+#ifndef CRAPI_MDIGEST_LARGE_BUFSZ
+#define CRAPI_MDIGEST_LARGE_BUFSZ (1024 * 1024) /**< read size used for large files */
+#endif
+
 int crapi_mdigest_fd (int fd, int num, ... /*crapi_alg_t alg, void *dst, size_t *size, ...*/);
 
+/*
+ * Compute `num' digests of the file in a single pass. The i-th digest
+ * of type alg[i] is stored at dst[i], its size at *size[i]; the size
+ * is set to 0 if the digest type isn't available.
+ */
+int crapi_mdigest_fdv (int fd, int num, const crapi_alg_t *alg, void **dst, size_t **size);
+
 #endif /* CRAPI_DIGEST_H */
@@ -0,0 +1,475 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "alloc.h"
+#include "debug_priv.h"
+#include "fscache.h"
+
+/*
+ * Layout of a listing, both in the store and in memory:
+ *
+ *   struct fscache_hdr, key (root '\0' path '\0'), padding
+ *   struct fscache_rec, name '\0', padding
+ *   ...
+ *
+ * Everything is aligned to 8 bytes. The store is only shared by
+ * processes running on the same system, so the stat structures are
+ * stored as they are.
+ */
+#define FSCACHE_MAGIC   0x3253464f /* "OFS2" */
+#define FSCACHE_ALIGN(n) (((n) + 7) & ~((size_t)7))
+
+#define FSCACHE_REC_NOSTAT 0x01
+
+/* file of the store holding the number of bytes used by the listings */
+#define FSCACHE_USED_NAME "used"
+
+struct fscache_hdr {
+	uint32_t magic;
+	uint32_t count;
+	uint32_t keylen; /**< including the terminating null byte */
+	uint32_t size;   /**< size of the whole listing */
+	dev_t dev;       /**< identity and change times of the directory */
+	ino_t ino;
+	struct timespec mtim;
+	struct timespec ctim;
+};
+
+struct fscache_rec {
+	struct stat st;
+	uint32_t flags;
+	uint32_t namelen;
+	char name[];
+};
+
+struct fscache_dir {
+	uint8_t *data;
+	size_t size;
+	bool mapped;
+
+	size_t offset;
+	uint32_t index;
+	uint32_t count;
+	fscache_ent_t ent;
+};
+
+static int fscache_fd = -1;
+static const char *fscache_root = "";
+static volatile uint32_t fscache_tmpcnt = 0;
+static volatile uint64_t *fscache_used = NULL;
+
+char *fscache_store_new(void)
+{
+	const char *tmpdir;
+	char *path;
+
+	if (getenv(FSCACHE_DIR_ENV) != NULL)
+		return (NULL);
+
+	tmpdir = getenv("TMPDIR");
+	if (tmpdir == NULL || *tmpdir == '\0')
+		tmpdir = "/tmp";
+
+	path = oscap_alloc(strlen(tmpdir) + sizeof("/oscap-fscache.XXXXXX"));
+	sprintf(path, "%s/oscap-fscache.XXXXXX", tmpdir);
+
+	if (mkdtemp(path) == NULL) {
+		dW("Can't create the directory listing cache in \"%s\": %s",
+		   tmpdir, strerror(errno));
+		oscap_free(path);
+		return (NULL);
+	}
+
+	dI("Directory listing cache: %s", path);
+	return (path);
+}
+
+static void fscache_store_unlink(const char *path, bool all)
+{
+	DIR *dir;
+	struct dirent *dent;
+
+	dir = opendir(path);
+	if (dir == NULL)
+		return;
+
+	while ((dent = readdir(dir)) != NULL) {
+		if (dent->d_name[0] == '.')
+			continue;
+		if (!all && strcmp(dent->d_name, FSCACHE_USED_NAME) == 0)
+			continue;
+		unlinkat(dirfd(dir), dent->d_name, 0);
+	}
+
+	closedir(dir);
+}
+
+void fscache_store_clear(const char *path)
+{
+	int dfd, fd;
+	uint64_t used = 0;
+
+	if (path == NULL)
+		return;
+
+	fscache_store_unlink(path, false);
+
+	dfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd == -1)
+		return;
+
+	fd = openat(dfd, FSCACHE_USED_NAME, O_WRONLY | O_CLOEXEC);
+	if (fd != -1) {
+		if (pwrite(fd, &used, sizeof used, 0) != sizeof used)
+			dW("Can't reset the size of the directory listing cache \"%s\"", path);
+		close(fd);
+	}
+
+	close(dfd);
+}
+
+void fscache_store_free(char *path)
+{
+	if (path == NULL)
+		return;
+
+	fscache_store_unlink(path, true);
+
+	if (rmdir(path) != 0)
+		dW("Can't remove the directory listing cache \"%s\": %s", path, strerror(errno));
+
+	oscap_free(path);
+}
+
+int fscache_init(void)
+{
+	const char *path, *root;
+	void *used = MAP_FAILED;
+	struct stat st;
+	int fd;
+
+	path = getenv(FSCACHE_DIR_ENV);
+	if (path == NULL || *path == '\0')
+		return (-1);
+
+	fscache_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fscache_fd == -1) {
+		dW("Can't open the directory listing cache \"%s\": %s", path, strerror(errno));
+		return (-1);
+	}
+
+	/* shared by all the probes, so that the limit applies to the whole store */
+	fd = openat(fscache_fd, FSCACHE_USED_NAME, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd != -1) {
+		if (fstat(fd, &st) == 0 && (st.st_size >= (off_t)sizeof(uint64_t)
+		                            || ftruncate(fd, sizeof(uint64_t)) == 0))
+			used = mmap(NULL, sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+	}
+
+	/* without the size counter the store could grow without a limit */
+	if (fd == -1 || used == MAP_FAILED) {
+		dW("Can't open the size of the directory listing cache \"%s\"", path);
+		close(fscache_fd);
+		fscache_fd = -1;
+		return (-1);
+	}
+
+	fscache_used = used;
+
+	/* listings of different root directories must not be mixed */
+	root = getenv("OSCAP_PROBE_ROOT");
+	if (root != NULL)
+		fscache_root = strdup(root);
+
+	return (0);
+}
+
+/* FNV-1a of the key, used as the name of the listing in the store */
+static void fscache_keyname(const char *key, size_t keylen, char name[17])
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	for (i = 0; i < keylen; ++i) {
+		h ^= (uint8_t)key[i];
+		h *= 0x100000001b3ULL;
+	}
+
+	snprintf(name, 17, "%016llx", (unsigned long long)h);
+}
+
+static fscache_dir_t *fscache_dir_new(uint8_t *data, size_t size, bool mapped)
+{
+	fscache_dir_t *dir;
+	const struct fscache_hdr *hdr = (const struct fscache_hdr *)data;
+
+	dir = oscap_talloc(fscache_dir_t);
+	dir->data   = data;
+	dir->size   = size;
+	dir->mapped = mapped;
+	dir->offset = FSCACHE_ALIGN(sizeof(struct fscache_hdr) + hdr->keylen);
+	dir->index  = 0;
+	dir->count  = hdr->count;
+
+	return (dir);
+}
+
+static bool fscache_stamp_eq(const struct fscache_hdr *hdr, const struct stat *st)
+{
+	return (hdr->dev == st->st_dev && hdr->ino == st->st_ino
+	        && hdr->mtim.tv_sec == st->st_mtim.tv_sec && hdr->mtim.tv_nsec == st->st_mtim.tv_nsec
+	        && hdr->ctim.tv_sec == st->st_ctim.tv_sec && hdr->ctim.tv_nsec == st->st_ctim.tv_nsec);
+}
+
+static fscache_dir_t *fscache_load(const char *name, const char *key, size_t keylen, const struct stat *dst)
+{
+	int fd;
+	struct stat st;
+	void *data;
+	const struct fscache_hdr *hdr;
+
+	fd = openat(fscache_fd, name, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return (NULL);
+
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct fscache_hdr) + keylen) {
+		close(fd);
+		return (NULL);
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return (NULL);
+
+	hdr = (const struct fscache_hdr *)data;
+
+	/*
+	 * A hash collision, a listing of another root directory or one
+	 * taken before the directory was changed, e.g. by a fix.
+	 */
+	if (hdr->magic != FSCACHE_MAGIC || hdr->size != (size_t)st.st_size
+	    || hdr->keylen != keylen
+	    || memcmp((const uint8_t *)data + sizeof(struct fscache_hdr), key, keylen) != 0
+	    || !fscache_stamp_eq(hdr, dst)) {
+		munmap(data, st.st_size);
+		return (NULL);
+	}
+
+	return (fscache_dir_new(data, st.st_size, true));
+}
+
+static void fscache_save(const char *name, const uint8_t *data, size_t size)
+{
+	char tmpname[64];
+	int fd;
+
+	/* the listing becomes visible only when it's complete */
+	snprintf(tmpname, sizeof tmpname, "%s.%ld.%u", name, (long)getpid(),
+		 __sync_fetch_and_add(&fscache_tmpcnt, 1));
+
+	/* a listing that doesn't fit is read again the next time */
+	if (__sync_add_and_fetch(fscache_used, size) > FSCACHE_STORE_MAXSIZE) {
+		__sync_sub_and_fetch(fscache_used, size);
+		return;
+	}
+
+	fd = openat(fscache_fd, tmpname, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (fd == -1)
+		goto fail;
+
+	if (write(fd, data, size) != (ssize_t)size) {
+		close(fd);
+		unlinkat(fscache_fd, tmpname, 0);
+		goto fail;
+	}
+
+	close(fd);
+
+	if (renameat(fscache_fd, tmpname, fscache_fd, name) != 0) {
+		unlinkat(fscache_fd, tmpname, 0);
+		goto fail;
+	}
+
+	return;
+fail:
+	__sync_sub_and_fetch(fscache_used, size);
+}
+
+static fscache_dir_t *fscache_read(const char *path, const char *key, size_t keylen, const char *name)
+{
+	DIR *dir;
+	struct dirent *dent;
+	struct fscache_hdr *hdr;
+	struct fscache_rec *rec;
+	struct stat dst;
+	uint8_t *data;
+	size_t size, alloc, namelen, reclen;
+	time_t now;
+	bool save;
+
+	now = time(NULL);
+	dir = opendir(path);
+	if (dir == NULL)
+		return (NULL);
+
+	/*
+	 * A change made within the granularity of the timestamps wouldn't
+	 * be noticed, so recently changed directories aren't stored.
+	 */
+	save = fscache_fd != -1 && fstat(dirfd(dir), &dst) == 0
+		&& dst.st_mtim.tv_sec < now - 1 && dst.st_ctim.tv_sec < now - 1;
+
+	size  = FSCACHE_ALIGN(sizeof(struct fscache_hdr) + keylen);
+	alloc = size + 4096;
+	data  = oscap_alloc(alloc);
+
+	memset(data, 0, size);
+	hdr = (struct fscache_hdr *)data;
+	hdr->magic  = FSCACHE_MAGIC;
+	hdr->keylen = keylen;
+
+	if (save) {
+		hdr->dev  = dst.st_dev;
+		hdr->ino  = dst.st_ino;
+		hdr->mtim = dst.st_mtim;
+		hdr->ctim = dst.st_ctim;
+	}
+	memcpy(data + sizeof(struct fscache_hdr), key, keylen);
+
+	while ((dent = readdir(dir)) != NULL) {
+		if (dent->d_name[0] == '.'
+		    && (dent->d_name[1] == '\0' || (dent->d_name[1] == '.' && dent->d_name[2] == '\0')))
+			continue;
+
+		namelen = strlen(dent->d_name);
+		reclen  = FSCACHE_ALIGN(sizeof(struct fscache_rec) + namelen + 1);
+
+		if (size + reclen > alloc) {
+			alloc = (size + reclen) * 2;
+			data  = oscap_realloc(data, alloc);
+			hdr   = (struct fscache_hdr *)data;
+		}
+
+		rec = (struct fscache_rec *)(data + size);
+		memset(rec, 0, reclen);
+
+		if (fstatat(dirfd(dir), dent->d_name, &rec->st, AT_SYMLINK_NOFOLLOW) != 0)
+			rec->flags |= FSCACHE_REC_NOSTAT;
+
+		rec->namelen = namelen;
+		memcpy(rec->name, dent->d_name, namelen + 1);
+
+		size += reclen;
+		hdr->count++;
+	}
+
+	closedir(dir);
+	hdr->size = size;
+
+	if (save)
+		fscache_save(name, data, size);
+
+	return (fscache_dir_new(data, size, false));
+}
+
+fscache_dir_t *fscache_opendir(const char *path)
+{
+	fscache_dir_t *dir;
+	char *key, name[17];
+	size_t rootlen, keylen;
+	struct stat dst;
+
+	rootlen = strlen(fscache_root);
+	keylen  = rootlen + 1 + strlen(path) + 1;
+	key     = oscap_alloc(keylen);
+
+	memcpy(key, fscache_root, rootlen + 1);
+	memcpy(key + rootlen + 1, path, keylen - rootlen - 1);
+
+	fscache_keyname(key, keylen, name);
+
+	if (fscache_fd != -1 && stat(path, &dst) == 0
+	    && (dir = fscache_load(name, key, keylen, &dst)) != NULL) {
+		oscap_free(key);
+		return (dir);
+	}
+
+	dir = fscache_read(path, key, keylen, name);
+	oscap_free(key);
+
+	return (dir);
+}
+
+const fscache_ent_t *fscache_readdir(fscache_dir_t *dir)
+{
+	const struct fscache_rec *rec;
+
+	if (dir->index == dir->count
+	    || dir->offset + sizeof(struct fscache_rec) > dir->size)
+		return (NULL);
+
+	rec = (const struct fscache_rec *)(dir->data + dir->offset);
+
+	dir->ent.name    = rec->name;
+	dir->ent.namelen = rec->namelen;
+	dir->ent.st      = (rec->flags & FSCACHE_REC_NOSTAT) ? NULL : &rec->st;
+
+	dir->offset += FSCACHE_ALIGN(sizeof(struct fscache_rec) + rec->namelen + 1);
+	dir->index++;
+
+	return (&dir->ent);
+}
+
+void fscache_closedir(fscache_dir_t *dir)
+{
+	if (dir == NULL)
+		return;
+
+	if (dir->mapped)
+		munmap(dir->data, dir->size);
+	else
+		oscap_free(dir->data);
+
+	oscap_free(dir);
+}
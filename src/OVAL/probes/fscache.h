@@ -0,0 +1,92 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+#ifndef FSCACHE_H
+#define FSCACHE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/*
+ * Directory listing cache shared by the probes of one scan. Each
+ * directory read by oval_fts is stored, together with the lstat()
+ * data of its entries, in a file of the store directory named by the
+ * environment variable below. The store is created by the library
+ * when the probes are started, passed to them in their environment,
+ * emptied when the probe session is reset and removed when it's freed.
+ * A listing is used only while the change times of its directory are
+ * the same as when it was read. Setting the variable to an empty
+ * string disables the cache.
+ */
+#define FSCACHE_DIR_ENV "OSCAP_PROBE_FSCACHE_DIR"
+
+/* listings are read uncached once the store reaches this size */
+#define FSCACHE_STORE_MAXSIZE (64 * 1024 * 1024)
+
+typedef struct fscache_dir fscache_dir_t;
+
+typedef struct {
+	const char *name;
+	size_t namelen;
+	const struct stat *st; /**< lstat() data, NULL if lstat() failed */
+} fscache_ent_t;
+
+/**
+ * Create a new store, unless FSCACHE_DIR_ENV is already set.
+ * @return the path of the store or NULL if no store was created
+ */
+char *fscache_store_new(void);
+
+/**
+ * Remove all the listings from the store created by fscache_store_new().
+ */
+void fscache_store_clear(const char *path);
+
+/**
+ * Remove the store created by fscache_store_new().
+ */
+void fscache_store_free(char *path);
+
+/**
+ * Open the store named by FSCACHE_DIR_ENV. It has to be called before
+ * the probe changes its root directory.
+ * @return 0 on success, -1 if the directories will be read uncached
+ */
+int fscache_init(void);
+
+/**
+ * Get the listing of the directory `path', either from the store or
+ * by reading the directory, in which case the listing is stored.
+ * @return NULL and errno set if the directory can't be read
+ */
+fscache_dir_t *fscache_opendir(const char *path);
+
+/**
+ * Get the next entry of the listing. The entry is valid until the
+ * listing is closed.
+ * @return NULL at the end of the listing
+ */
+const fscache_ent_t *fscache_readdir(fscache_dir_t *dir);
+
+void fscache_closedir(fscache_dir_t *dir);
+
+#endif /* FSCACHE_H */
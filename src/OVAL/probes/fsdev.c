@@ -153,7 +153,8 @@ static fsdev_t *__fsdev_init(fsdev_t * lfs, const char **fs, size_t fs_cnt)
 	FILE *fp;
 	size_t i;
 
-	struct mntent *ment;
+	struct mntent *ment, ment_mem;
+	char ment_buf[4096];
 	struct stat st;
 
 	fp = setmntent(_PATH_MOUNTED, "r");
@@ -176,7 +177,8 @@ static fsdev_t *__fsdev_init(fsdev_t * lfs, const char **fs, size_t fs_cnt)
 	lfs->cnt = DEVID_ARRAY_SIZE;
 	i = 0;
 
-	while ((ment = getmntent(fp)) != NULL) {
+	/* getmntent() uses a static buffer; file objects are collected concurrently */
+	while ((ment = getmntent_r(fp, &ment_mem, ment_buf, sizeof ment_buf)) != NULL) {
 		if (fs == NULL) {
 			if (!is_local_fs(ment))
 				continue;
@@ -56,131 +56,93 @@
 #include "probe/entcmp.h"
 #include "alloc.h"
 #include "common/debug_priv.h"
-
-#define BUFFER_SIZE 256
+#include "proctab.h"
 
 extern char **environ;
 
-static int read_environment(SEXP_t *pid_ent, SEXP_t *name_ent, probe_ctx *ctx)
+static void collect_environment(proctab_t *tab, proctab_ent_t *proc, SEXP_t *name_ent, probe_ctx *ctx, int *err)
 {
-	int err = 1, pid, fd;
-	bool empty;
-	size_t env_name_size;
-	SEXP_t *env_name, *env_value, *item, *pid_sexp;
-	DIR *d;
-	struct dirent *d_entry;
-	char *buffer, env_file[256], *null_char;
-	ssize_t buffer_used;
-	size_t buffer_size;
-
-	d = opendir("/proc");
-	if (d == NULL) {
-		dE("Can't read /proc: errno=%d, %s.", errno, strerror (errno));
-		return PROBE_EACCESS;
+	SEXP_t *env_name, *env_value, *item;
+	const char *env, *env_end, *eq_char;
+	size_t env_len;
+
+	env = proctab_environ(tab, proc, &env_len);
+	if (env == NULL) {
+		dE("Can't open \"/proc/%d/environ\": errno=%d, %s.", (int)proc->pid, errno, strerror (errno));
+		item = probe_item_create(
+				OVAL_INDEPENDENT_ENVIRONMENT_VARIABLE58, NULL,
+				"pid", OVAL_DATATYPE_INTEGER, (int64_t)proc->pid,
+				NULL
+		);
+
+		probe_item_setstatus(item, SYSCHAR_STATUS_ERROR);
+		probe_item_add_msg(item, OVAL_MESSAGE_LEVEL_ERROR,
+				   "Can't open \"/proc/%d/environ\": errno=%d, %s.", (int)proc->pid, errno, strerror (errno));
+		probe_item_collect(ctx, item);
+		return;
 	}
 
-	if ((buffer = oscap_realloc(NULL, BUFFER_SIZE)) == NULL) {
-		dE("Can't allocate memory");
-		closedir(d);
-		return PROBE_EFAULT;
-	}
-	buffer_size = BUFFER_SIZE;
-
-	while ((d_entry = readdir(d))) {
-		if (strspn(d_entry->d_name, "0123456789") != strlen(d_entry->d_name))
-			continue;
-
-		pid = atoi(d_entry->d_name);
-		pid_sexp = SEXP_number_newi_32(pid);
-
-		if (probe_entobj_cmp(pid_ent, pid_sexp) != OVAL_RESULT_TRUE) {
-			SEXP_free(pid_sexp);
+	for (env_end = env + env_len; env < env_end; env += strlen(env) + 1) {
+		eq_char = strchr(env, '=');
+		if (eq_char == NULL) {
+			/* strange but possible:
+			 * $ strings /proc/1218/environ
+			/dev/input/event0 /dev/input/event1 /dev/input/event4 /dev/input/event3
+			*/
 			continue;
 		}
-		SEXP_free(pid_sexp);
 
-		sprintf(env_file, "/proc/%d/environ", pid);
-
-		if ((fd = open(env_file, O_RDONLY)) == -1) {
-			dE("Can't open \"%s\": errno=%d, %s.", env_file, errno, strerror (errno));
+		env_name = SEXP_string_new(env, eq_char - env);
+		if (probe_entobj_cmp(name_ent, env_name) == OVAL_RESULT_TRUE) {
+			env_value = SEXP_string_newf("%s", eq_char + 1);
 			item = probe_item_create(
-					OVAL_INDEPENDENT_ENVIRONMENT_VARIABLE58, NULL,
-					"pid", OVAL_DATATYPE_INTEGER, (int64_t)pid,
-					NULL
-			);
-
-			probe_item_setstatus(item, SYSCHAR_STATUS_ERROR);
-			probe_item_add_msg(item, OVAL_MESSAGE_LEVEL_ERROR,
-					   "Can't open \"%s\": errno=%d, %s.", env_file, errno, strerror (errno));
+				OVAL_INDEPENDENT_ENVIRONMENT_VARIABLE58, NULL,
+				"pid", OVAL_DATATYPE_INTEGER, (int64_t)proc->pid,
+				"name",  OVAL_DATATYPE_SEXP, env_name,
+				"value", OVAL_DATATYPE_SEXP, env_value,
+			      NULL);
 			probe_item_collect(ctx, item);
-			continue;
+			SEXP_free(env_value);
+			*err = 0;
 		}
+		SEXP_free(env_name);
+	}
+}
 
-		empty = true;
+static int read_environment(SEXP_t *pid_ent, SEXP_t *name_ent, probe_ctx *ctx)
+{
+	int err = 1;
+	size_t i;
+	proctab_t *tab;
+	proctab_ent_t *proc;
+	SEXP_t *pid_sexp;
+
+	tab = proctab_get(PROCTAB_STAT);
+	if (tab == NULL)
+		return PROBE_EACCESS;
 
-		if ((buffer_used = read(fd, buffer, buffer_size - 1)) > 0) {
-			empty = false;
-		}
+	if (probe_ent_getoperation(pid_ent, OVAL_OPERATION_EQUALS) == OVAL_OPERATION_EQUALS
+	    && !probe_ent_attrexists(pid_ent, "var_ref")) {
+		/* look up the process instead of comparing every pid */
+		int pid;
 
-		while (! empty) {
-			while (! (null_char = memchr(buffer, 0, buffer_used))) {
-				ssize_t s;
-				if ((size_t)buffer_used >= buffer_size) {
-					buffer_size += BUFFER_SIZE;
-					buffer = oscap_realloc(buffer, buffer_size);
-					if (buffer == NULL) {
-						dE("Can't allocate memory");
-						exit(ENOMEM);
-					}
-
-				}
-				s = read(fd, buffer + buffer_used, buffer_size - buffer_used);
-				if (s <= 0) {
-					empty = true;
-					buffer[buffer_used++] = 0;
-				}
-				else {
-					buffer_used += s;
-				}
-			}
-
-			do {
-				char *eq_char = strchr(buffer, '=');
-				if (eq_char == NULL) {
-					/* strange but possible:
-					 * $ strings /proc/1218/environ
- 					/dev/input/event0 /dev/input/event1 /dev/input/event4 /dev/input/event3
-					*/
-					buffer_used -= null_char + 1 - buffer;
-					memmove(buffer, null_char + 1, buffer_used);
-					continue;
-				}
-
-				env_name_size =  eq_char - buffer;
-				env_name = SEXP_string_new(buffer, env_name_size);
-				env_value = SEXP_string_newf("%s", buffer + env_name_size + 1);
-				if (probe_entobj_cmp(name_ent, env_name) == OVAL_RESULT_TRUE) {
-					item = probe_item_create(
-						OVAL_INDEPENDENT_ENVIRONMENT_VARIABLE58, NULL,
-						"pid", OVAL_DATATYPE_INTEGER, (int64_t)pid,
-						"name",  OVAL_DATATYPE_SEXP, env_name,
-						"value", OVAL_DATATYPE_SEXP, env_value,
-					      NULL);
-					probe_item_collect(ctx, item);
-					err = 0;
-				}
-				SEXP_free(env_name);
-				SEXP_free(env_value);
-
-				buffer_used -= null_char + 1 - buffer;
-				memmove(buffer, null_char + 1, buffer_used);
-			} while ((null_char = memchr(buffer, 0, buffer_used)));
-		}
+		PROBE_ENT_I32VAL(pid_ent, pid, pid = -1;, pid = -1;);
+		proc = proctab_pid(tab, pid);
+		if (proc != NULL)
+			collect_environment(tab, proc, name_ent, ctx, &err);
+	} else {
+		for (i = 0; (proc = proctab_ent(tab, i)) != NULL; ++i) {
+			pid_sexp = SEXP_number_newi_32(proc->pid);
 
-		close(fd);
+			if (probe_entobj_cmp(pid_ent, pid_sexp) == OVAL_RESULT_TRUE)
+				collect_environment(tab, proc, name_ent, ctx, &err);
+
+			SEXP_free(pid_sexp);
+		}
 	}
-	closedir(d);
-	oscap_free(buffer);
+
+	proctab_put(tab);
+
 	if (err) {
 		SEXP_t *msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
 				"Can't find process with requested PID.");
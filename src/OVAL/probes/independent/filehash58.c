@@ -43,7 +43,6 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <limits.h>
-#include <pthread.h>
 #include <errno.h>
 #include <crapi/crapi.h>
 #include <probe/probe.h>
@@ -56,7 +55,8 @@
 
 #define FILE_SEPARATOR '/'
 
-static pthread_mutex_t __filehash58_probe_mutex;
+/* passed from probe_init to probe_main once the crypto API is ready */
+static int __filehash58_probe_ready;
 
 #define CRAPI_INVALID -1
 
@@ -103,14 +103,14 @@ static int mem2hex (uint8_t *mem, size_t mlen, char *str, size_t slen)
 	return (0);
 }
 
-static int filehash58_cb (const char *p, const char *f, const char *h, probe_ctx *ctx)
+static int filehash58_cb (const char *p, const char *f, int hcnt, const crapi_alg_t *halg, const char **hname, probe_ctx *ctx)
 {
 	SEXP_t *itm;
 
 	char   pbuf[PATH_MAX+1];
 	size_t plen, flen;
 
-	int fd;
+	int fd, i;
 
 	if (f == NULL)
 		return (0);
@@ -140,61 +140,68 @@ static int filehash58_cb (const char *p, const char *f, const char *h, probe_ctx
 	fd = open (pbuf, O_RDONLY);
 
 	if (fd < 0) {
-		strerror_r (errno, pbuf, PATH_MAX);
-		pbuf[PATH_MAX] = '\0';
-
-		itm = probe_item_create (OVAL_INDEPENDENT_FILE_HASH58, NULL,
-					"filepath", OVAL_DATATYPE_STRING, pbuf,
-					"path",     OVAL_DATATYPE_STRING, p,
-					"filename", OVAL_DATATYPE_STRING, f,
-					"hash_type",OVAL_DATATYPE_STRING, h,
-					NULL);
-		probe_item_add_msg(itm, OVAL_MESSAGE_LEVEL_ERROR,
-			"Can't open \"%s\": errno=%d, %s.", pbuf, errno, strerror (errno));
-		probe_item_setstatus(itm, SYSCHAR_STATUS_ERROR);
+		int err = errno;
+
+		for (i = 0; i < hcnt; ++i) {
+			itm = probe_item_create (OVAL_INDEPENDENT_FILE_HASH58, NULL,
+						"filepath", OVAL_DATATYPE_STRING, pbuf,
+						"path",     OVAL_DATATYPE_STRING, p,
+						"filename", OVAL_DATATYPE_STRING, f,
+						"hash_type",OVAL_DATATYPE_STRING, hname[i],
+						NULL);
+			probe_item_add_msg(itm, OVAL_MESSAGE_LEVEL_ERROR,
+				"Can't open \"%s\": errno=%d, %s.", pbuf, err, strerror (err));
+			probe_item_setstatus(itm, SYSCHAR_STATUS_ERROR);
+			probe_item_collect(ctx, itm);
+		}
 	} else {
-		uint8_t hash_dst[1025];
-		size_t  hash_dstlen = sizeof hash_dst;
-		char    hash_str[2051];
-
-		crapi_alg_t hash_type;
-
-		hash_type = oscap_string_to_enum(CRAPI_ALG_MAP, h);
-		hash_dstlen = oscap_string_to_enum(CRAPI_ALG_MAP_SIZE, h);
+		uint8_t hash_dst[hcnt][64];
+		size_t  hash_dstlen[hcnt];
+		void   *hash_dstp[hcnt];
+		size_t *hash_dstlenp[hcnt];
+		char    hash_str[129];
+
+		for (i = 0; i < hcnt; ++i) {
+			hash_dstlen[i]  = oscap_string_to_enum(CRAPI_ALG_MAP_SIZE, hname[i]);
+			hash_dstp[i]    = hash_dst[i];
+			hash_dstlenp[i] = &hash_dstlen[i];
+		}
 
 		/*
-		 * Compute hash value
+		 * Compute all the hash values in a single pass
 		 */
-		if (crapi_mdigest_fd (fd, 1, hash_type, hash_dst, &hash_dstlen) != 0) {
+		if (crapi_mdigest_fdv (fd, hcnt, halg, hash_dstp, hash_dstlenp) != 0) {
 			close (fd);
 			return (-1);
 		}
 
 		close (fd);
 
-		hash_str[0] = '\0';
-		mem2hex (hash_dst, hash_dstlen, hash_str, sizeof hash_str);
+		for (i = 0; i < hcnt; ++i) {
+			hash_str[0] = '\0';
+			mem2hex (hash_dst[i], hash_dstlen[i], hash_str, sizeof hash_str);
+
+			/*
+			 * Create and add the item
+			 */
+			itm = probe_item_create(OVAL_INDEPENDENT_FILE_HASH58, NULL,
+						"filepath", OVAL_DATATYPE_STRING, pbuf,
+						"path",     OVAL_DATATYPE_STRING, p,
+						"filename", OVAL_DATATYPE_STRING, f,
+						"hash_type",OVAL_DATATYPE_STRING, hname[i],
+						"hash",     OVAL_DATATYPE_STRING, hash_str,
+						NULL);
+
+			if (hash_dstlen[i] == 0) {
+				probe_item_add_msg(itm, OVAL_MESSAGE_LEVEL_ERROR,
+						   "Unable to compute %s hash value of \"%s\".", hname[i], pbuf);
+				probe_item_setstatus(itm, SYSCHAR_STATUS_ERROR);
+			}
 
-		/*
-		 * Create and add the item
-		 */
-		itm = probe_item_create(OVAL_INDEPENDENT_FILE_HASH58, NULL,
-					"filepath", OVAL_DATATYPE_STRING, pbuf,
-					"path",     OVAL_DATATYPE_STRING, p,
-					"filename", OVAL_DATATYPE_STRING, f,
-					"hash_type",OVAL_DATATYPE_STRING, h,
-					"hash",     OVAL_DATATYPE_STRING, hash_str,
-					NULL);
-
-		if (hash_dstlen == 0) {
-			probe_item_add_msg(itm, OVAL_MESSAGE_LEVEL_ERROR,
-					   "Unable to compute %s hash value of \"%s\".", h, pbuf);
-			probe_item_setstatus(itm, SYSCHAR_STATUS_ERROR);
+			probe_item_collect(ctx, itm);
 		}
 	}
 
-	probe_item_collect(ctx, itm);
-
 	return (0);
 }
 
@@ -208,46 +215,30 @@ void *probe_init (void)
 	if (crapi_init (NULL) != 0)
 		return (NULL);
 
-	/*
-	 * Initialize mutex.
-	 */
-	switch (pthread_mutex_init (&__filehash58_probe_mutex, NULL)) {
-	case 0:
-		return ((void *)&__filehash58_probe_mutex);
-	default:
-		dI("Can't initialize mutex: errno=%u, %s.", errno, strerror (errno));
-	}
-
-	return (NULL);
+	return ((void *)&__filehash58_probe_ready);
 }
 
-void probe_fini (void *arg)
-{
-	_A((void *)arg == (void *)&__filehash58_probe_mutex);
-
-	/*
-	 * Destroy mutex.
-	 */
-	(void) pthread_mutex_destroy (&__filehash58_probe_mutex);
-
-	return;
-}
-
-int probe_main(probe_ctx *ctx, void *mutex)
+int probe_main(probe_ctx *ctx, void *arg)
 {
 	SEXP_t *probe_in;
 	SEXP_t *path, *filename, *behaviors, *filepath, *hash_type;
 	char hash_type_str[128];
+	probe_entmatch_t *hash_match;
 	int err = 0;
 
+	const struct oscap_string_map *p;
+	crapi_alg_t halg[CRAPI_DIGEST_CNT];
+	const char *hname[CRAPI_DIGEST_CNT];
+	int hcnt = 0;
+
 	OVAL_FTS    *ofts;
 	OVAL_FTSENT *ofts_ent;
 
-	if (mutex == NULL) {
+	if (arg == NULL) {
 		return (PROBE_EINIT);
 	}
 
-	_A(mutex == &__filehash58_probe_mutex);
+	_A(arg == &__filehash58_probe_ready);
 
 	probe_in  = probe_ctx_getobject(ctx);
 
@@ -271,29 +262,22 @@ int probe_main(probe_ctx *ctx, void *mutex)
 
 	probe_filebehaviors_canonicalize(&behaviors);
 
-	switch (pthread_mutex_lock (&__filehash58_probe_mutex)) {
-	case 0:
-		break;
-	default:
-		dI("Can't lock mutex(%p): %u, %s.", &__filehash58_probe_mutex, errno, strerror (errno));
+	/* find hash types to compare with entity, think "not satisfy" */
+	hash_match = probe_entmatch_new(hash_type);
 
-		err = PROBE_EFATAL;
-		goto cleanup;
+	for (p = CRAPI_ALG_MAP; p->value != CRAPI_INVALID; ++p) {
+		if (probe_entmatch_cstr(hash_match, p->string) == OVAL_RESULT_TRUE) {
+			halg[hcnt]  = p->value;
+			hname[hcnt] = p->string;
+			++hcnt;
+		}
 	}
 
-	if ((ofts = oval_fts_open(path, filename, filepath, behaviors, probe_ctx_getresult(ctx))) != NULL) {
+	probe_entmatch_free(hash_match);
+
+	if (hcnt > 0 && (ofts = oval_fts_open(path, filename, filepath, behaviors, probe_ctx_getresult(ctx))) != NULL) {
 		while ((ofts_ent = oval_fts_read(ofts)) != NULL) {
-			/* find hash types to compare with entity, think "not satisfy" */
-			const struct oscap_string_map *p = CRAPI_ALG_MAP;
-			while (p->value != CRAPI_INVALID) {
-				SEXP_t *crapi_hash_type_sexp = SEXP_string_new(p->string, strlen(p->string));
-				if (probe_entobj_cmp(hash_type, crapi_hash_type_sexp) == OVAL_RESULT_TRUE) {
-					filehash58_cb(ofts_ent->path, ofts_ent->file, p->string, ctx);
-				}
-
-				SEXP_free(crapi_hash_type_sexp);
-				p++;
-			}
+			filehash58_cb(ofts_ent->path, ofts_ent->file, hcnt, halg, hname, ctx);
 			oval_ftsent_free(ofts_ent);
 		}
 
@@ -307,14 +291,5 @@ cleanup:
 	SEXP_free (filepath);
         SEXP_free (hash_type);
 
-	switch (pthread_mutex_unlock (&__filehash58_probe_mutex)) {
-	case 0:
-		break;
-	default:
-		dI("Can't unlock mutex(%p): %u, %s.", &__filehash58_probe_mutex, errno, strerror (errno));
-
-		err = PROBE_EFATAL;
-	}
-
 	return err;
 }
@@ -52,7 +52,8 @@
 
 #define FILE_SEPARATOR '/'
 
-static pthread_mutex_t __filemd5_probe_mutex;
+/* passed from probe_init to probe_main once the crypto API is ready */
+static int __filemd5_probe_ready;
 
 static int mem2hex (uint8_t *mem, size_t mlen, char *str, size_t slen)
 {
@@ -164,34 +165,12 @@ void *probe_init (void)
         if (crapi_init (NULL) != 0)
                 return (NULL);
 
-        /*
-         * Initialize mutex.
-         */
-        switch (pthread_mutex_init (&__filemd5_probe_mutex, NULL)) {
-        case 0:
-                return ((void *)&__filemd5_probe_mutex);
-        default:
-                dI("Can't initialize mutex: errno=%u, %s.", errno, strerror (errno));
-        }
-
         probe_setoption(PROBEOPT_OFFLINE_MODE_SUPPORTED, PROBE_OFFLINE_CHROOT);
 
-        return (NULL);
-}
-
-void probe_fini (void *arg)
-{
-        _A((void *)arg == (void *)&__filemd5_probe_mutex);
-
-        /*
-         * Destroy mutex.
-         */
-        (void) pthread_mutex_destroy (&__filemd5_probe_mutex);
-
-        return;
+        return ((void *)&__filemd5_probe_ready);
 }
 
-int probe_main (SEXP_t *probe_in, SEXP_t *probe_out, void *mutex, SEXP_t *filters)
+int probe_main (SEXP_t *probe_in, SEXP_t *probe_out, void *arg, SEXP_t *filters)
 {
         SEXP_t *path, *filename, *behaviors, *filepath;
 	OVAL_FTS    *ofts;
@@ -203,11 +182,11 @@ int probe_main (SEXP_t *probe_in, SEXP_t *probe_out, void *mutex, SEXP_t *filter
 		return (PROBE_EINVAL);
 	}
 
-        if (mutex == NULL) {
+        if (arg == NULL) {
 		return (PROBE_EINIT);
         }
 
-        _A(mutex == &__filemd5_probe_mutex);
+        _A(arg == &__filemd5_probe_ready);
 
         path      = probe_obj_getent (probe_in, "path",      1);
         filename  = probe_obj_getent (probe_in, "filename",  1);
@@ -226,20 +205,6 @@ int probe_main (SEXP_t *probe_in, SEXP_t *probe_out, void *mutex, SEXP_t *filter
 
 	probe_filebehaviors_canonicalize(&behaviors);
 
-        switch (pthread_mutex_lock (&__filemd5_probe_mutex)) {
-        case 0:
-                break;
-        default:
-                dI("Can't lock mutex(%p): %u, %s.", &__filemd5_probe_mutex, errno, strerror (errno));
-
-		SEXP_free (behaviors);
-		SEXP_free (path);
-		SEXP_free (filename);
-		SEXP_free (filepath);
-
-		return (PROBE_EFATAL);
-        }
-
 	if ((ofts = oval_fts_open(path, filename, filepath, behaviors, probe_ctx_getresult(ctx))) != NULL) {
 		while ((ofts_ent = oval_fts_read(ofts)) != NULL) {
 			filehash_cb(ofts_ent->path, ofts_ent->file, probe_out, filters);
@@ -254,14 +219,5 @@ int probe_main (SEXP_t *probe_in, SEXP_t *probe_out, void *mutex, SEXP_t *filter
         SEXP_free (filename);
         SEXP_free (filepath);
 
-        switch (pthread_mutex_unlock (&__filemd5_probe_mutex)) {
-        case 0:
-                break;
-        default:
-                dI("Can't unlock mutex(%p): %u, %s.", &__filemd5_probe_mutex, errno, strerror (errno));
-
-		return (PROBE_EFATAL);
-        }
-
         return 0;
 }
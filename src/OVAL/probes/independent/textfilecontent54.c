@@ -36,6 +36,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
 #include <string.h>
 #include <errno.h>
 #include <sys/stat.h>
@@ -63,8 +65,25 @@
 
 oval_schema_version_t over;
 
+/*
+ * Files are read whole with as few read() calls as possible rather
+ * than mapped, a file truncated while mapped would raise SIGBUS. The
+ * kernel is told to read ahead aggressively for files at least
+ * TFC54_SEQUENTIAL_MINSZ large.
+ */
+#ifndef TFC54_SEQUENTIAL_MINSZ
+#define TFC54_SEQUENTIAL_MINSZ (1024 * 1024)
+#endif
+
 #if defined USE_REGEX_PCRE
-static int get_substrings(char *str, int *ofs, pcre *re, int want_substrs, char ***substrings) {
+#if defined(PCRE_STUDY_JIT_COMPILE)
+# define TFC54_STUDY_OPTIONS PCRE_STUDY_JIT_COMPILE
+#else
+# define TFC54_STUDY_OPTIONS 0
+#endif
+
+static int get_substrings(const char *str, int str_len, int *ofs, pcre *re, pcre_extra *extra, int options,
+			  int want_substrs, char ***substrings) {
 	int i, ret, rc;
 	int ovector[60], ovector_len = sizeof (ovector) / sizeof (ovector[0]);
 	char **substrs;
@@ -75,13 +94,12 @@ static int get_substrings(char *str, int *ofs, pcre *re, int want_substrs, char
 		ovector[i] = -1;
 
 #if defined(__SVR4) && defined(__sun)
-	rc = pcre_exec(re, NULL, str, strlen(str), *ofs, PCRE_NO_UTF8_CHECK, ovector, ovector_len);
-#else
-	rc = pcre_exec(re, NULL, str, strlen(str), *ofs, 0, ovector, ovector_len);
+	options |= PCRE_NO_UTF8_CHECK;
 #endif
+	rc = pcre_exec(re, extra, str, str_len, *ofs, options, ovector, ovector_len);
 
 	if (rc < -1) {
-		dE("Function pcre_exec() failed to match a regular expression with return code %d on string '%s'.", rc, str);
+		dE("Function pcre_exec() failed to match a regular expression with return code %d on string '%.*s'.", rc, str_len, str);
 		return rc;
 	} else if (rc == -1) {
 		/* no match */
@@ -122,7 +140,7 @@ static int get_substrings(char *str, int *ofs, pcre *re, int want_substrs, char
 	return ret;
 }
 #elif defined USE_REGEX_POSIX
-static int get_substrings(char *str, int *ofs, regex_t *re, int want_substrs, char ***substrings) {
+static int get_substrings(const char *str, int str_len, int *ofs, regex_t *re, int want_substrs, char ***substrings) {
 	int i, ret, rc;
 	regmatch_t pmatch[40];
 	int pmatch_len = sizeof (pmatch) / sizeof (pmatch[0]);
@@ -211,21 +229,40 @@ static SEXP_t *create_item(const char *path, const char *filename, char *pattern
 struct pfdata {
 	char *pattern;
 	int re_opts;
-	SEXP_t *instance_ent;
+	probe_entmatch_t *instance_match;
         probe_ctx *ctx;
 #if defined USE_REGEX_PCRE
 	pcre *compiled_regex;
+	pcre_extra *study;
 #elif defined USE_REGEX_POSIX
 	regex_t *compiled_regex;
 #endif
 };
 
+/* report an error of the file `path' in the collected object */
+static void tfc54_error(struct pfdata *pfd, const char *fmt, ...)
+{
+	SEXP_t *msg;
+	va_list ap;
+	char buf[PATH_MAX + 128];
+
+	va_start(ap, fmt);
+	vsnprintf(buf, sizeof buf, fmt, ap);
+	va_end(ap);
+
+	msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR, "%s", buf);
+	probe_cobj_add_msg(probe_ctx_getresult(pfd->ctx), msg);
+	SEXP_free(msg);
+	probe_cobj_set_flag(probe_ctx_getresult(pfd->ctx), SYSCHAR_FLAG_ERROR);
+}
+
 static int process_file(const char *path, const char *file, void *arg)
 {
 	struct pfdata *pfd = (struct pfdata *) arg;
 	int ret = 0, path_len, file_len, cur_inst = 0, fd = -1, substr_cnt,
-		buf_size = 0, buf_used = 0, ofs = 0, buf_inc = 4096;
-	char *whole_path = NULL, *buf = NULL;
+		ofs = 0, str_len, re_opts = 0;
+	char *whole_path = NULL, *buf = NULL, *nul;
+	size_t buf_len = 0, buf_size;
 	SEXP_t *next_inst = NULL;
 	struct stat st;
 
@@ -261,59 +298,86 @@ static int process_file(const char *path, const char *file, void *arg)
 
 	fd = open(whole_path, O_RDONLY);
 	if (fd == -1) {
-		SEXP_t *msg;
-
-		msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR, "open(): '%s' %s.", whole_path, strerror(errno));
-		probe_cobj_add_msg(probe_ctx_getresult(pfd->ctx), msg);
-		SEXP_free(msg);
-		probe_cobj_set_flag(probe_ctx_getresult(pfd->ctx), SYSCHAR_FLAG_ERROR);
+		tfc54_error(pfd, "open(): '%s' %s.", whole_path, strerror(errno));
 		ret = -1;
 		goto cleanup;
 	}
 
-	do {
-		buf_size += buf_inc;
-		buf = oscap_realloc(buf, buf_size);
-		ret = read(fd, buf + buf_used, buf_inc);
-		if (ret == -1) {
-			SEXP_t *msg;
-
-			msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR, "read(): '%s' %s.", whole_path, strerror(errno));
-			probe_cobj_add_msg(probe_ctx_getresult(pfd->ctx), msg);
-			SEXP_free(msg);
-			probe_cobj_set_flag(probe_ctx_getresult(pfd->ctx), SYSCHAR_FLAG_ERROR);
+#if defined(POSIX_FADV_SEQUENTIAL)
+	if (st.st_size >= TFC54_SEQUENTIAL_MINSZ)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+	/*
+	 * The size is only a hint, e.g. files in /proc report 0 and a file
+	 * may change while it's read, so read until the end of the file.
+	 */
+	buf_size = st.st_size > 0 && (uintmax_t)st.st_size < SIZE_MAX ? (size_t)st.st_size + 1 : 4096;
+	buf = oscap_alloc(buf_size);
+
+	for (;;) {
+		ssize_t rlen;
+
+		if (buf_len + 1 == buf_size) {
+			buf_size *= 2;
+			buf = oscap_realloc(buf, buf_size);
+		}
+
+		rlen = read(fd, buf + buf_len, buf_size - buf_len - 1);
+		if (rlen == -1) {
+			if (errno == EINTR)
+				continue;
+			tfc54_error(pfd, "read(): '%s' %s.", whole_path, strerror(errno));
 			ret = -2;
 			goto cleanup;
 		}
-		buf_used += ret;
-	} while (ret == buf_inc);
+		if (rlen == 0)
+			break;
+		buf_len += rlen;
+	}
+
+	buf[buf_len] = '\0';
+
+	/* as before, the content is searched up to the first null byte */
+	nul = memchr(buf, '\0', buf_len);
+	if (nul != NULL)
+		buf_len = nul - buf;
 
-	if (buf_used == buf_size)
-		buf = realloc(buf, ++buf_size);
-	buf[buf_used++] = '\0';
+	if (buf_len > INT_MAX) {
+		tfc54_error(pfd, "File '%s' is too large to be searched.", whole_path);
+		ret = -2;
+		goto cleanup;
+	}
+	str_len = (int)buf_len;
 
 	do {
-		char **substrs;
+		char **substrs = NULL;
 		int want_instance;
 
 		next_inst = SEXP_number_newi_32(cur_inst + 1);
 
-		if (probe_entobj_cmp(pfd->instance_ent, next_inst) == OVAL_RESULT_TRUE)
+		if (probe_entmatch_sexp(pfd->instance_match, next_inst) == OVAL_RESULT_TRUE)
 			want_instance = 1;
 		else
 			want_instance = 0;
 
 		SEXP_free(next_inst);
-		substr_cnt = get_substrings(buf, &ofs, pfd->compiled_regex, want_instance, &substrs);
+#if defined USE_REGEX_PCRE
+		substr_cnt = get_substrings(buf, str_len, &ofs, pfd->compiled_regex, pfd->study,
+					    re_opts, want_instance, &substrs);
+		if (pfd->re_opts & PCRE_UTF8) {
+			/* the subject has been checked by the first call */
+			re_opts |= PCRE_NO_UTF8_CHECK;
+			/* so the next search must not start inside of a character */
+			while (ofs < str_len && (buf[ofs] & 0xc0) == 0x80)
+				++ofs;
+		}
+#elif defined USE_REGEX_POSIX
+		substr_cnt = get_substrings(buf, str_len, &ofs, pfd->compiled_regex, want_instance, &substrs);
+#endif
 
 		if (substr_cnt < 0) {
-			SEXP_t *msg;
-			msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
-				"Regular expression pattern match failed in file %s with error %d.",
-				whole_path, substr_cnt);
-			probe_cobj_add_msg(probe_ctx_getresult(pfd->ctx), msg);
-			SEXP_free(msg);
-			probe_cobj_set_flag(probe_ctx_getresult(pfd->ctx), SYSCHAR_FLAG_ERROR);
+			tfc54_error(pfd, "Regular expression pattern match failed in file %s with error %d.",
+				    whole_path, substr_cnt);
 			ret = -3;
 			goto cleanup;
 		}
@@ -335,7 +399,7 @@ static int process_file(const char *path, const char *file, void *arg)
 				oscap_free(substrs);
 			}
 		}
-	} while (substr_cnt > 0 && ofs < buf_used);
+	} while (substr_cnt > 0 && ofs <= str_len);
 
  cleanup:
 	if (fd != -1)
@@ -350,6 +414,7 @@ static int process_file(const char *path, const char *file, void *arg)
 void *probe_init(void)
 {
   probe_setoption(PROBEOPT_OFFLINE_MODE_SUPPORTED, PROBE_OFFLINE_CHROOT);
+  probe_setoption(PROBEOPT_PERSISTENT_CACHE, NULL);
   return NULL;
 }
 
@@ -426,8 +491,8 @@ int probe_main(probe_ctx *ctx, void *arg)
 
 	probe_tfc54behaviors_canonicalize(&bh_ent);
 
-	pfd.instance_ent = inst_ent;
-        pfd.ctx          = ctx;
+	pfd.instance_match = probe_entmatch_new(inst_ent);
+        pfd.ctx            = ctx;
 #if defined USE_REGEX_PCRE
 	pfd.re_opts = PCRE_UTF8;
 	r0 = probe_ent_getattrval(bh_ent, "ignore_case");
@@ -463,6 +528,8 @@ int probe_main(probe_ctx *ctx, void *arg)
 		probe_cobj_set_flag(probe_ctx_getresult(pfd.ctx), SYSCHAR_FLAG_ERROR);
 		goto cleanup;
 	}
+	/* the pattern is used for every matching file */
+	pfd.study = pcre_study(pfd.compiled_regex, TFC54_STUDY_OPTIONS, &error);
 #elif defined USE_REGEX_POSIX
 	pfd.re_opts = REG_EXTENDED | REG_NEWLINE;
 	r0 = probe_ent_getattrval(bh_ent, "ignore_case");
@@ -504,7 +571,14 @@ int probe_main(probe_ctx *ctx, void *arg)
         SEXP_free(filepath_ent);
 	if (pfd.pattern != NULL)
 		oscap_free(pfd.pattern);
+	probe_entmatch_free(pfd.instance_match);
 #if defined USE_REGEX_PCRE
+	if (pfd.study != NULL)
+#if defined(PCRE_STUDY_JIT_COMPILE)
+		pcre_free_study(pfd.study);
+#else
+		pcre_free(pfd.study);
+#endif
 	if (pfd.compiled_regex != NULL)
 		pcre_free(pfd.compiled_regex);
 #elif defined USE_REGEX_POSIX
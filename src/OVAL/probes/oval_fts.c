@@ -32,6 +32,9 @@
 #include <sys/stat.h>
 #include <limits.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <assume.h>
 #include <pcre.h>
 #include <libgen.h>
@@ -42,6 +45,7 @@
 #include "alloc.h"
 #include "debug_priv.h"
 #include "oval_fts.h"
+#include "fscache.h"
 #if defined(__SVR4) && defined(__sun)
 #include "fts_sun.h"
 #include <sys/mntent.h>
@@ -67,8 +71,12 @@ static OVAL_FTS *OVAL_FTS_new()
 	return (ofts);
 }
 
+static void oval_fts_walk_free(struct oval_fts_walk *walk);
+
 static void OVAL_FTS_free(OVAL_FTS *ofts)
 {
+	if (ofts->ofts_walk != NULL)
+		oval_fts_walk_free(ofts->ofts_walk);
 	if (ofts->ofts_match_path_fts != NULL)
 		fts_close(ofts->ofts_match_path_fts);
 	if (ofts->ofts_recurse_path_fts != NULL)
@@ -93,24 +101,25 @@ static int pathlen_from_ftse(int fts_pathlen, int fts_namelen)
 	return pathlen;
 }
 
-static OVAL_FTSENT *OVAL_FTSENT_new(OVAL_FTS *ofts, FTSENT *fts_ent)
+static OVAL_FTSENT *OVAL_FTSENT_new_path(OVAL_FTS *ofts, const char *path, size_t pathlen,
+					 const char *name, size_t namelen, unsigned int info)
 {
 	OVAL_FTSENT *ofts_ent;
 
 	ofts_ent = oscap_talloc(OVAL_FTSENT);
 
-	ofts_ent->fts_info = fts_ent->fts_info;
+	ofts_ent->fts_info = info;
 	if (ofts->ofts_sfilename || ofts->ofts_sfilepath) {
-		ofts_ent->path_len = pathlen_from_ftse(fts_ent->fts_pathlen, fts_ent->fts_namelen);
+		ofts_ent->path_len = pathlen_from_ftse(pathlen, namelen);
 		ofts_ent->path = oscap_alloc(ofts_ent->path_len + 1);
-		strncpy(ofts_ent->path, fts_ent->fts_path, ofts_ent->path_len);
+		strncpy(ofts_ent->path, path, ofts_ent->path_len);
 		ofts_ent->path[ofts_ent->path_len] = '\0';
 
-		ofts_ent->file_len = fts_ent->fts_namelen;
-		ofts_ent->file = strdup(fts_ent->fts_name);
+		ofts_ent->file_len = namelen;
+		ofts_ent->file = strdup(name);
 	} else {
-		ofts_ent->path_len = fts_ent->fts_pathlen;
-		ofts_ent->path = strdup(fts_ent->fts_path);
+		ofts_ent->path_len = pathlen;
+		ofts_ent->path = strdup(path);
 
 		ofts_ent->file_len = -1;
 		ofts_ent->file = NULL;
@@ -122,6 +131,12 @@ static OVAL_FTSENT *OVAL_FTSENT_new(OVAL_FTS *ofts, FTSENT *fts_ent)
 	return (ofts_ent);
 }
 
+static OVAL_FTSENT *OVAL_FTSENT_new(OVAL_FTS *ofts, FTSENT *fts_ent)
+{
+	return OVAL_FTSENT_new_path(ofts, fts_ent->fts_path, fts_ent->fts_pathlen,
+				    fts_ent->fts_name, fts_ent->fts_namelen, fts_ent->fts_info);
+}
+
 static void OVAL_FTSENT_free(OVAL_FTSENT *ofts_ent)
 {
 	oscap_free(ofts_ent->path);
@@ -143,6 +158,8 @@ typedef struct zone_path {
 	char zpath[MAXPATHLEN];
 } zone_path_t;
 static avl_tree_t avl_tree_list;
+/* the zone list is shared by all the walkers and loaded only once */
+static pthread_once_t zones_path_list_once = PTHREAD_ONCE_INIT;
 
 
 static bool valid_remote_fs(char *fstype)
@@ -233,6 +250,14 @@ static void free_zones_path_list()
 	avl_destroy(&avl_tree_list);
 }
 
+static void init_zones_path_list(void)
+{
+	if (load_zones_path_list() != 0) {
+		dE("Failed to load zones path info. Recursing non-global zones.");
+		free_zones_path_list();
+	}
+}
+
 static bool valid_local_zone(char *path)
 {
 	zone_path_t temp;
@@ -872,20 +897,21 @@ OVAL_FTS *oval_fts_open(SEXP_t *path, SEXP_t *filename, SEXP_t *filepath, SEXP_t
 
 	if (path) { /* filepath == NULL */
 		ofts->ofts_spath = SEXP_ref(path); /* path entity */
-		if (!nilfilename)
+		ofts->ofts_mpath = probe_entmatch_new(path);
+		if (!nilfilename) {
 			ofts->ofts_sfilename = SEXP_ref(filename); /* filename entity */
+			ofts->ofts_mfilename = probe_entmatch_new(filename);
+		}
 
 		ofts->max_depth = max_depth;
 		ofts->direction = direction;
 	} else { /* filepath != NULL */
 		ofts->ofts_sfilepath = SEXP_ref(filepath);
+		ofts->ofts_mfilepath = probe_entmatch_new(filepath);
 	}
 
 #if defined(__SVR4) && defined(__sun)
-	if (load_zones_path_list() != 0) {
-		dE("Failed to load zones path info. Recursing non-global zones.");
-		free_zones_path_list();
-	}
+	pthread_once(&zones_path_list_once, init_zones_path_list);
 #endif
 
 	ofts->result = result;
@@ -893,29 +919,30 @@ OVAL_FTS *oval_fts_open(SEXP_t *path, SEXP_t *filename, SEXP_t *filepath, SEXP_t
 	return (ofts);
 }
 
-static inline int _oval_fts_is_local(OVAL_FTS *ofts, FTSENT *fts_ent) {
+static inline int _oval_fts_is_local_st(OVAL_FTS *ofts, unsigned int info, const char *path, const struct stat *st) {
 # if defined (__SVR4) && defined(__sun)
 	/* pseudo filesystems will be skipped */
 	/* don't recurse into remote fs if local is specified */
-	return ((fts_ent->fts_info == FTS_D || fts_ent->fts_info == FTS_SL)
-	    && (!OVAL_FTS_localp(ofts, fts_ent->fts_path,
-	    (fts_ent->fts_statp != NULL) ?
-	    &fts_ent->fts_statp->st_fstype : NULL)));
+	return ((info == FTS_D || info == FTS_SL)
+	    && (!OVAL_FTS_localp(ofts, path,
+	    (st != NULL) ? (void *)&st->st_fstype : NULL)));
 #else
 	/* don't recurse into non-local filesystems */
 	return (ofts->filesystem == OVAL_RECURSE_FS_LOCAL
-	    && (fts_ent->fts_info == FTS_D || fts_ent->fts_info == FTS_SL)
-	    && (!OVAL_FTS_localp(ofts, fts_ent->fts_path,
-				 (fts_ent->fts_statp != NULL) ?
-				 &fts_ent->fts_statp->st_dev : NULL)));
+	    && (info == FTS_D || info == FTS_SL)
+	    && (!OVAL_FTS_localp(ofts, path,
+				 (st != NULL) ? (void *)&st->st_dev : NULL)));
 #endif
 }
 
+static inline int _oval_fts_is_local(OVAL_FTS *ofts, FTSENT *fts_ent) {
+	return _oval_fts_is_local_st(ofts, fts_ent->fts_info, fts_ent->fts_path, fts_ent->fts_statp);
+}
+
 /* find the first matching path or filepath */
 static FTSENT *oval_fts_read_match_path(OVAL_FTS *ofts)
 {
 	FTSENT *fts_ent = NULL;
-	SEXP_t *stmp;
 	oval_result_t ores;
 
 	/* iterate until a match is found or all elements have been traversed */
@@ -986,14 +1013,12 @@ static FTSENT *oval_fts_read_match_path(OVAL_FTS *ofts)
 		    || (!ofts->ofts_sfilepath && fts_ent->fts_info != FTS_D))
 			continue;
 
-		stmp = SEXP_string_newf("%s", fts_ent->fts_path);
 		if (ofts->ofts_sfilepath)
 			/* try to match filepath */
-			ores = probe_entobj_cmp(ofts->ofts_sfilepath, stmp);
+			ores = probe_entmatch_cstr(ofts->ofts_mfilepath, fts_ent->fts_path);
 		else
 			/* try to match path */
-			ores = probe_entobj_cmp(ofts->ofts_spath, stmp);
-		SEXP_free(stmp);
+			ores = probe_entmatch_cstr(ofts->ofts_mpath, fts_ent->fts_path);
 
 		if (ores == OVAL_RESULT_TRUE)
 			break;
@@ -1024,142 +1049,13 @@ static FTSENT *oval_fts_read_recurse_path(OVAL_FTS *ofts)
 
 	switch (ofts->direction) {
 
-	case OVAL_RECURSE_DIRECTION_DOWN:
 	case OVAL_RECURSE_DIRECTION_NONE:
-		if (ofts->direction == OVAL_RECURSE_DIRECTION_NONE
-		    && collect_dirs) {
+		/* filenames are matched by the walker, see oval_fts_read() */
+		if (collect_dirs) {
 			/* the target is the directory itself */
 			out_fts_ent = ofts->ofts_match_path_fts_ent;
 			ofts->ofts_match_path_fts_ent = NULL;
-			break;
-		}
-
-		/* initialize separate fts for recursion */
-		if (ofts->ofts_recurse_path_fts == NULL) {
-			char * const paths[2] = { ofts->ofts_match_path_fts_ent->fts_path, NULL };
-
-#if defined(OSCAP_FTS_DEBUG)
-			dI("fts_open args: path: \"%s\", options: %d.",
-				paths[0], ofts->ofts_recurse_path_fts_opts);
-#endif
-			/* reset errno as fts_open() doesn't do it itself. */
-			errno = 0;
-			ofts->ofts_recurse_path_fts = fts_open(paths,
-				ofts->ofts_recurse_path_fts_opts, NULL);
-			/* fts_open() doesn't return NULL for all errors
-			   (e.g. nonexistent paths), so check errno to detect it.
-			   Far from being perfect. */
-			if (ofts->ofts_recurse_path_fts == NULL || errno != 0) {
-				dE("fts_open() failed, errno: %d \"%s\".",
-					errno, strerror(errno));
-#if !defined(OSCAP_FTS_DEBUG)
-				dE("fts_open args: path: \"%s\", options: %d.",
-					paths[0], ofts->ofts_recurse_path_fts_opts);
-#endif
-				if (ofts->ofts_recurse_path_fts != NULL) {
-					fts_close(ofts->ofts_recurse_path_fts);
-					ofts->ofts_recurse_path_fts = NULL;
-				}
-				return (NULL);
-			}
 		}
-
-		/* iterate until a match is found or all elements have been traversed */
-		while (out_fts_ent == NULL) {
-			FTSENT *fts_ent;
-
-			fts_ent = fts_read(ofts->ofts_recurse_path_fts);
-			if (fts_ent == NULL) {
-				fts_close(ofts->ofts_recurse_path_fts);
-				ofts->ofts_recurse_path_fts = NULL;
-
-				return NULL;
-			}
-
-			switch (fts_ent->fts_info) {
-			case FTS_DP:
-				continue;
-			case FTS_DC:
-				dW("Filesystem tree cycle detected at '%s'.", fts_ent->fts_path);
-				fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_SKIP);
-				continue;
-			}
-
-#if defined(OSCAP_FTS_DEBUG)
-			dI("fts_path: '%s' (l=%d)."
-			   "fts_name: '%s' (l=%d).\n"
-			   "fts_info: %u.\n", fts_ent->fts_path, fts_ent->fts_pathlen,
-			   fts_ent->fts_name, fts_ent->fts_namelen, fts_ent->fts_info);
-#endif
-
-			/* collect matching target */
-			if (collect_dirs) {
-				if (fts_ent->fts_info == FTS_D
-				    && (ofts->max_depth == -1 || fts_ent->fts_level <= ofts->max_depth))
-					out_fts_ent = fts_ent;
-			} else {
-				if (fts_ent->fts_info != FTS_D) {
-					SEXP_t *stmp;
-
-					stmp = SEXP_string_newf("%s", fts_ent->fts_name);
-					oval_result_t result = probe_entobj_cmp(ofts->ofts_sfilename, stmp);
-					switch (result){
-						case OVAL_RESULT_TRUE:
-							out_fts_ent = fts_ent;
-							break;
-
-						case OVAL_RESULT_ERROR:
-							probe_cobj_set_flag(ofts->result, SYSCHAR_FLAG_ERROR);
-							break;
-
-						default:
-							break;
-					}
-
-					SEXP_free(stmp);
-				}
-			}
-
-			if (fts_ent->fts_level > 0) { /* don't skip fts root */
-				/* limit recursion depth */
-				if (ofts->direction == OVAL_RECURSE_DIRECTION_NONE
-				    || (ofts->max_depth != -1 && fts_ent->fts_level > ofts->max_depth)) {
-					fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_SKIP);
-					continue;
-				}
-
-				/* limit recursion only to selected file types */
-				switch (fts_ent->fts_info) {
-				case FTS_D:
-					if (!(ofts->recurse & OVAL_RECURSE_DIRS)) {
-						fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_SKIP);
-						continue;
-					}
-					break;
-				case FTS_SL:
-					if (!(ofts->recurse & OVAL_RECURSE_SYMLINKS)) {
-						fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_SKIP);
-						continue;
-					}
-					fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_FOLLOW);
-					break;
-				default:
-					continue;
-				}
-			}
-			if (_oval_fts_is_local(ofts, fts_ent)) {
-				fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_SKIP);
-				continue;
-			}
-			/* don't recurse beyond the initial filesystem */
-			if (ofts->filesystem == OVAL_RECURSE_FS_DEFINED
-			    && (fts_ent->fts_info == FTS_D || fts_ent->fts_info == FTS_SL)
-			    && ofts->ofts_recurse_path_devid != fts_ent->fts_statp->st_dev) {
-				fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_SKIP);
-				continue;
-			}
-		}
-
 		break;
 	case OVAL_RECURSE_DIRECTION_UP:
 		if (ofts->ofts_recurse_path_pthcpy == NULL) {
@@ -1242,12 +1138,8 @@ static FTSENT *oval_fts_read_recurse_path(OVAL_FTS *ofts)
 					}
 				} else {
 					if (fts_ent->fts_info != FTS_D) {
-						SEXP_t *stmp;
-
-						stmp = SEXP_string_newf("%s", fts_ent->fts_name);
-						if (probe_entobj_cmp(ofts->ofts_sfilename, stmp) == OVAL_RESULT_TRUE)
+						if (probe_entmatch_cstr(ofts->ofts_mfilename, fts_ent->fts_name) == OVAL_RESULT_TRUE)
 							out_fts_ent = fts_ent;
-						SEXP_free(stmp);
 					}
 				}
 
@@ -1282,6 +1174,624 @@ static FTSENT *oval_fts_read_recurse_path(OVAL_FTS *ofts)
 	return out_fts_ent;
 }
 
+/*
+ * Walker used for recurse_direction="down" and for matching filenames
+ * with recurse_direction="none"
+ *
+ * Directories are listed through the directory listing cache shared
+ * by the probes of a scan (see fscache.h). Subdirectories which are
+ * to be descended into are pushed to the work queue of the worker
+ * which found them; idle workers steal work from the other end of the
+ * queues. Matching entries are passed to oval_fts_read() through a
+ * bounded queue, hence the order in which they are returned differs
+ * from the order of fts. Without worker threads, the directories are
+ * read by oval_fts_read() itself.
+ */
+#ifndef OVAL_FTS_WORKERS_MAX
+#define OVAL_FTS_WORKERS_MAX 4
+#endif
+#ifndef OVAL_FTS_QUEUE_SIZE
+#define OVAL_FTS_QUEUE_SIZE 1024
+#endif
+/* number of walker threads; 0 or 1 reads the directories in the calling thread */
+#define OVAL_FTS_WORKERS_ENV "OSCAP_FTS_WORKERS"
+
+/* a directory and its ancestors, used to detect cycles across workers */
+struct oval_fts_dirid {
+	dev_t dev;
+	ino_t ino;
+	struct oval_fts_dirid *parent;
+	uint32_t refs;
+};
+
+struct oval_fts_work {
+	char *path;
+	int level; /* depth of the directory relative to the matched path */
+	struct oval_fts_dirid *dirid;
+};
+
+/* an entry of a directory, in terms of fts */
+struct oval_fts_went {
+	const char *path;
+	size_t pathlen;
+	const char *name;
+	size_t namelen;
+	const struct stat *st;
+	unsigned int info;
+	int level;
+};
+
+struct oval_fts_deque {
+	pthread_mutex_t lock;
+	struct oval_fts_work *work;
+	size_t head; /* stolen from here */
+	size_t tail; /* pushed and popped here */
+	size_t alloc;
+};
+
+struct oval_fts_worker {
+	struct oval_fts_walk *walk;
+	unsigned int id;
+	pthread_t thread;
+	struct oval_fts_deque deque;
+};
+
+struct oval_fts_walk {
+	OVAL_FTS *ofts;
+
+	struct oval_fts_worker *worker;
+	unsigned int nworkers;
+	unsigned int nthreads;
+
+	pthread_mutex_t lock; /* idle workers wait here */
+	pthread_cond_t work_cond;
+	volatile uint32_t pending; /* directories queued or being read */
+	volatile uint32_t queued;
+
+	pthread_mutex_t qlock;
+	pthread_cond_t q_nonempty;
+	pthread_cond_t q_nonfull;
+	OVAL_FTSENT **q;
+	size_t q_alloc; /* grows only if there are no worker threads */
+	size_t q_head;
+	size_t q_count;
+	bool done;
+
+	volatile bool cancel;
+	volatile bool error;
+};
+
+static struct oval_fts_dirid *oval_fts_dirid_new(const struct stat *st, struct oval_fts_dirid *parent)
+{
+	struct oval_fts_dirid *dirid;
+
+	dirid = oscap_talloc(struct oval_fts_dirid);
+	dirid->dev = st->st_dev;
+	dirid->ino = st->st_ino;
+	dirid->parent = parent;
+	dirid->refs = 1;
+
+	if (parent != NULL)
+		__sync_fetch_and_add(&parent->refs, 1);
+
+	return (dirid);
+}
+
+static void oval_fts_dirid_free(struct oval_fts_dirid *dirid)
+{
+	struct oval_fts_dirid *parent;
+
+	while (dirid != NULL && __sync_sub_and_fetch(&dirid->refs, 1) == 0) {
+		parent = dirid->parent;
+		oscap_free(dirid);
+		dirid = parent;
+	}
+}
+
+static bool oval_fts_dirid_cycle(const struct oval_fts_dirid *dirid, const struct stat *st)
+{
+	for (; dirid != NULL; dirid = dirid->parent) {
+		if (dirid->ino == st->st_ino && dirid->dev == st->st_dev)
+			return (true);
+	}
+
+	return (false);
+}
+
+static void oval_fts_deque_push(struct oval_fts_deque *dq, struct oval_fts_work *work)
+{
+	pthread_mutex_lock(&dq->lock);
+
+	if (dq->tail == dq->alloc) {
+		if (dq->head > 0) {
+			memmove(dq->work, dq->work + dq->head,
+				sizeof(struct oval_fts_work) * (dq->tail - dq->head));
+			dq->tail -= dq->head;
+			dq->head  = 0;
+		} else {
+			dq->alloc = dq->alloc > 0 ? dq->alloc * 2 : 16;
+			dq->work  = oscap_realloc(dq->work, sizeof(struct oval_fts_work) * dq->alloc);
+		}
+	}
+
+	dq->work[dq->tail++] = *work;
+	pthread_mutex_unlock(&dq->lock);
+}
+
+static bool oval_fts_deque_get(struct oval_fts_deque *dq, struct oval_fts_work *work, bool steal)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&dq->lock);
+
+	if (dq->head < dq->tail) {
+		/* the owner goes depth-first, thieves take the largest subtrees */
+		*work = steal ? dq->work[dq->head++] : dq->work[--dq->tail];
+		found = true;
+
+		if (dq->head == dq->tail)
+			dq->head = dq->tail = 0;
+	}
+
+	pthread_mutex_unlock(&dq->lock);
+	return (found);
+}
+
+static void oval_fts_walk_push(struct oval_fts_worker *w, struct oval_fts_work *work)
+{
+	struct oval_fts_walk *walk = w->walk;
+
+	__sync_fetch_and_add(&walk->pending, 1);
+	oval_fts_deque_push(&w->deque, work);
+	__sync_fetch_and_add(&walk->queued, 1);
+
+	pthread_mutex_lock(&walk->lock);
+	pthread_cond_signal(&walk->work_cond);
+	pthread_mutex_unlock(&walk->lock);
+}
+
+static bool oval_fts_walk_get(struct oval_fts_worker *w, struct oval_fts_work *work)
+{
+	struct oval_fts_walk *walk = w->walk;
+	unsigned int i;
+	bool done;
+
+	for (;;) {
+		if (walk->cancel)
+			return (false);
+
+		if (oval_fts_deque_get(&w->deque, work, false))
+			goto found;
+
+		for (i = 1; i < walk->nworkers; ++i) {
+			if (oval_fts_deque_get(&walk->worker[(w->id + i) % walk->nworkers].deque, work, true))
+				goto found;
+		}
+
+		pthread_mutex_lock(&walk->lock);
+		while (walk->queued == 0 && walk->pending > 0 && !walk->cancel)
+			pthread_cond_wait(&walk->work_cond, &walk->lock);
+		done = (walk->pending == 0);
+		pthread_mutex_unlock(&walk->lock);
+
+		if (done)
+			return (false);
+	}
+found:
+	__sync_fetch_and_sub(&walk->queued, 1);
+	return (true);
+}
+
+static void oval_fts_walk_put(struct oval_fts_walk *walk, OVAL_FTSENT *ofts_ent)
+{
+	pthread_mutex_lock(&walk->qlock);
+
+	while (walk->q_count == walk->q_alloc && !walk->cancel) {
+		if (walk->nthreads > 0) {
+			pthread_cond_wait(&walk->q_nonfull, &walk->qlock);
+		} else {
+			OVAL_FTSENT **q;
+			size_t i;
+
+			q = oscap_alloc(sizeof(OVAL_FTSENT *) * walk->q_alloc * 2);
+			for (i = 0; i < walk->q_count; ++i)
+				q[i] = walk->q[(walk->q_head + i) % walk->q_alloc];
+
+			oscap_free(walk->q);
+			walk->q = q;
+			walk->q_head = 0;
+			walk->q_alloc *= 2;
+		}
+	}
+
+	if (walk->cancel) {
+		pthread_mutex_unlock(&walk->qlock);
+		OVAL_FTSENT_free(ofts_ent);
+		return;
+	}
+
+	walk->q[(walk->q_head + walk->q_count) % walk->q_alloc] = ofts_ent;
+	walk->q_count++;
+
+	pthread_cond_signal(&walk->q_nonempty);
+	pthread_mutex_unlock(&walk->qlock);
+}
+
+static void oval_fts_walk_done(struct oval_fts_walk *walk)
+{
+	pthread_mutex_lock(&walk->lock);
+	pthread_cond_broadcast(&walk->work_cond);
+	pthread_mutex_unlock(&walk->lock);
+
+	pthread_mutex_lock(&walk->qlock);
+	walk->done = true;
+	pthread_cond_broadcast(&walk->q_nonempty);
+	pthread_mutex_unlock(&walk->qlock);
+}
+
+static unsigned int oval_fts_walk_info(const struct stat *st)
+{
+	if (st == NULL)
+		return (FTS_NS);
+	if (S_ISDIR(st->st_mode))
+		return (FTS_D);
+	if (S_ISLNK(st->st_mode))
+		return (FTS_SL);
+	if (S_ISREG(st->st_mode))
+		return (FTS_F);
+
+	return (FTS_DEFAULT);
+}
+
+/*
+ * Process one entry of the directory `parent'. The checks are the same
+ * as those done by fts_read() and oval_fts_read_recurse_path() with the
+ * options set in oval_fts_open().
+ */
+static void oval_fts_walk_ent(struct oval_fts_worker *w, struct oval_fts_dirid *parent, struct oval_fts_went *ent)
+{
+	struct oval_fts_walk *walk = w->walk;
+	OVAL_FTS *ofts = walk->ofts;
+	struct stat st;
+
+	if (ent->info == FTS_D && ent->level > 0 && oval_fts_dirid_cycle(parent, ent->st)) {
+		dW("Filesystem tree cycle detected at '%s'.", ent->path);
+		return;
+	}
+
+	/* collect matching target */
+	if (ofts->ofts_sfilename == NULL) {
+		if (ent->info == FTS_D
+		    && (ofts->max_depth == -1 || ent->level <= ofts->max_depth))
+			oval_fts_walk_put(walk, OVAL_FTSENT_new_path(ofts, ent->path, ent->pathlen,
+								    ent->name, ent->namelen, ent->info));
+	} else if (ent->info != FTS_D) {
+		/* the name is the null terminated tail of the path */
+		switch (probe_entmatch_cstr(ofts->ofts_mfilename, ent->name)) {
+		case OVAL_RESULT_TRUE:
+			oval_fts_walk_put(walk, OVAL_FTSENT_new_path(ofts, ent->path, ent->pathlen,
+								    ent->name, ent->namelen, ent->info));
+			break;
+		case OVAL_RESULT_ERROR:
+			walk->error = true;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (ent->level > 0) { /* don't skip the matched path */
+		/* limit recursion depth */
+		if (ofts->direction == OVAL_RECURSE_DIRECTION_NONE
+		    || (ofts->max_depth != -1 && ent->level > ofts->max_depth))
+			return;
+
+		/* limit recursion only to selected file types */
+		switch (ent->info) {
+		case FTS_D:
+			if (!(ofts->recurse & OVAL_RECURSE_DIRS))
+				return;
+			break;
+		case FTS_SL:
+			if (!(ofts->recurse & OVAL_RECURSE_SYMLINKS))
+				return;
+			break;
+		default:
+			return;
+		}
+	}
+	if (_oval_fts_is_local_st(ofts, ent->info, ent->path, ent->st))
+		return;
+	/* don't recurse beyond the initial filesystem */
+	if (ofts->filesystem == OVAL_RECURSE_FS_DEFINED
+	    && (ent->info == FTS_D || ent->info == FTS_SL)
+	    && ofts->ofts_recurse_path_devid != ent->st->st_dev)
+		return;
+
+	if (ent->info == FTS_SL) {
+		/* like fts_read() with FTS_FOLLOW, check the target as well */
+		if (stat(ent->path, &st) == 0) {
+			ent->st = &st;
+			ent->info = oval_fts_walk_info(&st);
+		} else {
+			ent->info = FTS_SLNONE;
+		}
+
+		oval_fts_walk_ent(w, parent, ent);
+	} else if (ent->info == FTS_D) {
+		struct oval_fts_work sub;
+
+		sub.path  = strndup(ent->path, ent->pathlen);
+		sub.level = ent->level;
+		sub.dirid = oval_fts_dirid_new(ent->st, parent);
+
+		oval_fts_walk_push(w, &sub);
+	}
+}
+
+static void oval_fts_walk_dir(struct oval_fts_worker *w, struct oval_fts_work *work)
+{
+	struct oval_fts_walk *walk = w->walk;
+	struct oval_fts_went ent;
+	const fscache_ent_t *dent;
+	fscache_dir_t *dir;
+	char *path;
+	size_t pathlen, prefixlen, alloc;
+
+	pathlen = strlen(work->path);
+	dir = fscache_opendir(work->path);
+
+	if (dir == NULL) {
+		/* fts_read() returns unreadable directories again as FTS_DNR */
+		dW("Can't read directory '%s': %s.", work->path, strerror(errno));
+
+		ent.path    = work->path;
+		ent.pathlen = pathlen;
+		ent.name    = work->level > 0 ? strrchr(work->path, '/') + 1 : work->path;
+		ent.namelen = pathlen - (ent.name - work->path);
+		ent.st      = NULL;
+		ent.info    = FTS_DNR;
+		ent.level   = work->level;
+
+		oval_fts_walk_ent(w, work->dirid, &ent);
+		return;
+	}
+
+	/* no slash is added after the root directory */
+	prefixlen = pathlen;
+	if (pathlen == 0 || work->path[pathlen - 1] != '/')
+		prefixlen++;
+
+	alloc = prefixlen + NAME_MAX + 1;
+	path  = oscap_alloc(alloc);
+	memcpy(path, work->path, pathlen);
+	path[prefixlen - 1] = '/';
+
+	while (!walk->cancel && (dent = fscache_readdir(dir)) != NULL) {
+		if (prefixlen + dent->namelen + 1 > alloc) {
+			alloc = prefixlen + dent->namelen + 1;
+			path  = oscap_realloc(path, alloc);
+		}
+
+		memcpy(path + prefixlen, dent->name, dent->namelen + 1);
+
+		ent.path    = path;
+		ent.pathlen = prefixlen + dent->namelen;
+		ent.name    = path + prefixlen;
+		ent.namelen = dent->namelen;
+		ent.st      = dent->st;
+		ent.info    = oval_fts_walk_info(dent->st);
+		ent.level   = work->level + 1;
+
+		oval_fts_walk_ent(w, work->dirid, &ent);
+	}
+
+	oscap_free(path);
+	fscache_closedir(dir);
+}
+
+static void oval_fts_walk_run(struct oval_fts_worker *w, struct oval_fts_work *work)
+{
+	struct oval_fts_walk *walk = w->walk;
+
+	oval_fts_walk_dir(w, work);
+
+	oscap_free(work->path);
+	oval_fts_dirid_free(work->dirid);
+
+	if (__sync_sub_and_fetch(&walk->pending, 1) == 0)
+		oval_fts_walk_done(walk);
+}
+
+static void *oval_fts_walk_worker(void *arg)
+{
+	struct oval_fts_worker *w = arg;
+	struct oval_fts_work work;
+
+	while (oval_fts_walk_get(w, &work))
+		oval_fts_walk_run(w, &work);
+
+	return (NULL);
+}
+
+static unsigned int oval_fts_walk_nworkers(void)
+{
+	const char *env;
+	long n;
+
+	env = getenv(OVAL_FTS_WORKERS_ENV);
+	if (env != NULL)
+		return ((unsigned int)strtoul(env, NULL, 10));
+
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < 1)
+		return (1);
+
+	return (n > OVAL_FTS_WORKERS_MAX ? OVAL_FTS_WORKERS_MAX : (unsigned int)n);
+}
+
+/*
+ * Start walking `path'. Without recursion, or if the walker threads
+ * can't be started, the directories are read by oval_fts_walk_read().
+ */
+static struct oval_fts_walk *oval_fts_walk_new(OVAL_FTS *ofts, const char *path)
+{
+	struct oval_fts_walk *walk;
+	struct oval_fts_went ent;
+	struct stat st;
+	unsigned int i, nworkers;
+
+	nworkers = 1;
+	if (ofts->direction == OVAL_RECURSE_DIRECTION_DOWN)
+		nworkers = oval_fts_walk_nworkers();
+	if (nworkers < 1)
+		nworkers = 1;
+
+	walk = oscap_talloc(struct oval_fts_walk);
+	memset(walk, 0, sizeof(*walk));
+
+	walk->ofts = ofts;
+	walk->nworkers = nworkers;
+	walk->worker = oscap_alloc(sizeof(struct oval_fts_worker) * nworkers);
+	walk->q_alloc = OVAL_FTS_QUEUE_SIZE;
+	walk->q = oscap_alloc(sizeof(OVAL_FTSENT *) * walk->q_alloc);
+
+	pthread_mutex_init(&walk->lock, NULL);
+	pthread_cond_init(&walk->work_cond, NULL);
+	pthread_mutex_init(&walk->qlock, NULL);
+	pthread_cond_init(&walk->q_nonempty, NULL);
+	pthread_cond_init(&walk->q_nonfull, NULL);
+
+	for (i = 0; i < nworkers; ++i) {
+		memset(&walk->worker[i], 0, sizeof(struct oval_fts_worker));
+		walk->worker[i].walk = walk;
+		walk->worker[i].id = i;
+		pthread_mutex_init(&walk->worker[i].deque.lock, NULL);
+	}
+
+	/* the matched path is followed if it's a symlink (FTS_COMFOLLOW) */
+	ent.path    = path;
+	ent.pathlen = strlen(path);
+	ent.name    = path;
+	ent.namelen = ent.pathlen;
+	ent.level   = 0;
+
+	if (stat(path, &st) == 0) {
+		ent.st   = &st;
+		ent.info = oval_fts_walk_info(&st);
+	} else if (lstat(path, &st) == 0) {
+		ent.st   = &st;
+		ent.info = FTS_SLNONE;
+	} else {
+		ent.st   = NULL;
+		ent.info = FTS_NS;
+	}
+
+	oval_fts_walk_ent(&walk->worker[0], NULL, &ent);
+
+	if (walk->pending == 0) {
+		walk->done = true;
+		return (walk);
+	}
+
+	if (nworkers < 2)
+		return (walk);
+
+	for (i = 0; i < nworkers; ++i) {
+		if (pthread_create(&walk->worker[i].thread, NULL,
+				   oval_fts_walk_worker, &walk->worker[i]) != 0) {
+			dW("Can't start walker thread: %u, errno: %d \"%s\".", i, errno, strerror(errno));
+			break;
+		}
+		walk->nthreads++;
+	}
+
+	return (walk);
+}
+
+static void oval_fts_walk_free(struct oval_fts_walk *walk)
+{
+	struct oval_fts_work work;
+	unsigned int i;
+
+	pthread_mutex_lock(&walk->qlock);
+	walk->cancel = true;
+	pthread_cond_broadcast(&walk->q_nonfull);
+	pthread_mutex_unlock(&walk->qlock);
+
+	pthread_mutex_lock(&walk->lock);
+	pthread_cond_broadcast(&walk->work_cond);
+	pthread_mutex_unlock(&walk->lock);
+
+	for (i = 0; i < walk->nthreads; ++i)
+		pthread_join(walk->worker[i].thread, NULL);
+
+	for (i = 0; i < walk->nworkers; ++i) {
+		struct oval_fts_deque *dq = &walk->worker[i].deque;
+
+		while (oval_fts_deque_get(dq, &work, false)) {
+			oscap_free(work.path);
+			oval_fts_dirid_free(work.dirid);
+		}
+
+		oscap_free(dq->work);
+		pthread_mutex_destroy(&dq->lock);
+	}
+
+	for (; walk->q_count > 0; walk->q_count--) {
+		OVAL_FTSENT_free(walk->q[walk->q_head]);
+		walk->q_head = (walk->q_head + 1) % walk->q_alloc;
+	}
+
+	pthread_mutex_destroy(&walk->lock);
+	pthread_cond_destroy(&walk->work_cond);
+	pthread_mutex_destroy(&walk->qlock);
+	pthread_cond_destroy(&walk->q_nonempty);
+	pthread_cond_destroy(&walk->q_nonfull);
+
+	oscap_free(walk->q);
+	oscap_free(walk->worker);
+	oscap_free(walk);
+}
+
+/* get the next matching entry found by the walker, NULL at the end of the walk */
+static OVAL_FTSENT *oval_fts_walk_read(OVAL_FTS *ofts)
+{
+	struct oval_fts_walk *walk = ofts->ofts_walk;
+	OVAL_FTSENT *ofts_ent = NULL;
+
+	if (walk->nthreads == 0) {
+		struct oval_fts_work work;
+
+		while (walk->q_count == 0 && oval_fts_walk_get(&walk->worker[0], &work))
+			oval_fts_walk_run(&walk->worker[0], &work);
+
+		if (walk->q_count == 0)
+			walk->done = true;
+	}
+
+	pthread_mutex_lock(&walk->qlock);
+
+	while (walk->q_count == 0 && !walk->done)
+		pthread_cond_wait(&walk->q_nonempty, &walk->qlock);
+
+	if (walk->q_count > 0) {
+		ofts_ent = walk->q[walk->q_head];
+		walk->q_head = (walk->q_head + 1) % walk->q_alloc;
+		walk->q_count--;
+		pthread_cond_signal(&walk->q_nonfull);
+	}
+
+	pthread_mutex_unlock(&walk->qlock);
+
+	if (walk->error) {
+		walk->error = false;
+		probe_cobj_set_flag(ofts->result, SYSCHAR_FLAG_ERROR);
+	}
+
+	return (ofts_ent);
+}
+
 OVAL_FTSENT *oval_fts_read(OVAL_FTS *ofts)
 {
 	FTSENT *fts_ent;
@@ -1305,9 +1815,26 @@ OVAL_FTSENT *oval_fts_read(OVAL_FTS *ofts)
 			ofts->ofts_match_path_fts_ent = NULL;
 			break;
 		} else {
-			fts_ent = oval_fts_read_recurse_path(ofts);
-			if (fts_ent != NULL)
-				break;
+			/* recursion and matching of filenames is done by the walker */
+			if (ofts->ofts_walk == NULL
+			    && (ofts->direction == OVAL_RECURSE_DIRECTION_DOWN
+				|| (ofts->direction == OVAL_RECURSE_DIRECTION_NONE && ofts->ofts_sfilename != NULL)))
+				ofts->ofts_walk = oval_fts_walk_new(ofts, ofts->ofts_match_path_fts_ent->fts_path);
+
+			if (ofts->ofts_walk != NULL) {
+				OVAL_FTSENT *ofts_ent;
+
+				ofts_ent = oval_fts_walk_read(ofts);
+				if (ofts_ent != NULL)
+					return (ofts_ent);
+
+				oval_fts_walk_free(ofts->ofts_walk);
+				ofts->ofts_walk = NULL;
+			} else {
+				fts_ent = oval_fts_read_recurse_path(ofts);
+				if (fts_ent != NULL)
+					break;
+			}
 
 			ofts->ofts_match_path_fts_ent = NULL;
 
@@ -1342,13 +1869,13 @@ int oval_fts_close(OVAL_FTS *ofts)
 		SEXP_free(ofts->ofts_sfilename);
 	if (ofts->ofts_sfilepath != NULL)
 		SEXP_free(ofts->ofts_sfilepath);
+	probe_entmatch_free(ofts->ofts_mpath);
+	probe_entmatch_free(ofts->ofts_mfilename);
+	probe_entmatch_free(ofts->ofts_mfilepath);
 
 	fsdev_free(ofts->localdevs);
 
 	OVAL_FTS_free(ofts);
-#if defined(__SVR4) && defined(__sun)
-	free_zones_path_list();
-#endif
 
 	return (0);
 }
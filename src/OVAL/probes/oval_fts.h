@@ -30,6 +30,7 @@
 #endif
 #include <pcre.h>
 #include "fsdev.h"
+#include "probe-api.h"
 
 #define ENT_GET_AREF(ent, dst, attr_name, mandatory)			\
 	do {								\
@@ -75,6 +76,8 @@ typedef struct {
 	char *ofts_recurse_path_pthcpy;
 	char *ofts_recurse_path_curpth;
 	dev_t ofts_recurse_path_devid;
+	/* walker used for recursion and matching of filenames, see oval_fts.c */
+	struct oval_fts_walk *ofts_walk;
 
 	pcre       *ofts_path_regex;
 	pcre_extra *ofts_path_regex_extra;
@@ -83,6 +86,9 @@ typedef struct {
 	SEXP_t *ofts_spath;
 	SEXP_t *ofts_sfilename;
 	SEXP_t *ofts_sfilepath;
+	probe_entmatch_t *ofts_mpath;
+	probe_entmatch_t *ofts_mfilename;
+	probe_entmatch_t *ofts_mfilepath;
 	SEXP_t *result;
 
 	int max_depth;
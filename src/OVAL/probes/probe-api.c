@@ -100,6 +100,22 @@ SEXP_t *probe_item_creat(const char *name, SEXP_t * attrs, ...)
 	return (itm);
 }
 
+/*
+ * Attribute names repeat in every item, they are interned.
+ * Names of attributes with a value are prefixed by a colon.
+ */
+static SEXP_t *probe_attr_name(const char *name, bool hasval)
+{
+	char buf[128];
+
+	if (!hasval)
+		return SEXP_string_atom(name);
+	if (snprintf(buf, sizeof buf, ":%s", name) >= (int)sizeof buf)
+		return SEXP_string_newf(":%s", name);
+
+	return SEXP_string_atom(buf);
+}
+
 SEXP_t *probe_item_new(const char *name, SEXP_t * attrs)
 {
 	SEXP_t *itm, *sid, *attr;
@@ -136,10 +152,7 @@ SEXP_t *probe_item_attr_add(SEXP_t * item, const char *name, SEXP_t * val)
 		 * There are already some attributes.
 		 * Just add the new to the list.
 		 */
-		if (val == NULL)
-			ns = SEXP_string_new(name, strlen(name));
-		else
-			ns = SEXP_string_newf(":%s", name);
+		ns = probe_attr_name(name, val != NULL);
 
 		SEXP_list_add(n_ref, ns);
 		SEXP_free(ns);
@@ -155,10 +168,7 @@ SEXP_t *probe_item_attr_add(SEXP_t * item, const char *name, SEXP_t * val)
 		 */
 		SEXP_t *nl;
 
-		if (val == NULL)
-			ns = SEXP_string_new(name, strlen(name));
-		else
-			ns = SEXP_string_newf(":%s", name);
+		ns = probe_attr_name(name, val != NULL);
 
 		nl = SEXP_list_new(n_ref, ns, val, NULL);
 
@@ -310,12 +320,12 @@ SEXP_t *probe_attr_creat(const char *name, const SEXP_t * val, ...)
 	list = SEXP_list_new(NULL);
 
 	while (name != NULL) {
+		ns = probe_attr_name(name, val != NULL);
+
 		if (val == NULL) {
-			ns = SEXP_string_new(name, strlen(name));
 			SEXP_list_add(list, ns);
 			SEXP_free(ns);
 		} else {
-			ns = SEXP_string_newf(":%s", name);
 			SEXP_list_add(list, ns);
 			SEXP_list_add(list, val);
 			SEXP_free(ns);
@@ -1324,22 +1334,22 @@ void probe_filebehaviors_canonicalize(SEXP_t **behaviors)
 	}
 
 	if (!probe_ent_attrexists(bhs, "max_depth")) {
-		r0 = SEXP_string_newf("-1");
+		r0 = SEXP_string_atom("-1");
 		probe_ent_attr_add(bhs, "max_depth", r0);
 		SEXP_free(r0);
 	}
 	if (!probe_ent_attrexists(bhs, "recurse")) {
-		r0 = SEXP_string_newf("symlinks and directories");
+		r0 = SEXP_string_atom("symlinks and directories");
 		probe_ent_attr_add(bhs, "recurse", r0);
 		SEXP_free(r0);
 	}
 	if (!probe_ent_attrexists(bhs, "recurse_direction")) {
-		r0 = SEXP_string_newf("none");
+		r0 = SEXP_string_atom("none");
 		probe_ent_attr_add(bhs, "recurse_direction", r0);
 		SEXP_free(r0);
 	}
 	if (!probe_ent_attrexists(bhs, "recurse_file_system")) {
-		r0 = SEXP_string_newf("all");
+		r0 = SEXP_string_atom("all");
 		probe_ent_attr_add(bhs, "recurse_file_system", r0);
 		SEXP_free(r0);
 	}
@@ -1362,17 +1372,17 @@ void probe_tfc54behaviors_canonicalize(SEXP_t **behaviors)
 	probe_filebehaviors_canonicalize(&bhs);
 
 	if (!probe_ent_attrexists(bhs, "ignore_case")) {
-		r0 = SEXP_string_newf("0");
+		r0 = SEXP_string_atom("0");
 		probe_ent_attr_add(bhs, "ignore_case", r0);
 		SEXP_free(r0);
 	}
 	if (!probe_ent_attrexists(bhs, "multiline")) {
-		r0 = SEXP_string_newf("1");
+		r0 = SEXP_string_atom("1");
 		probe_ent_attr_add(bhs, "multiline", r0);
 		SEXP_free(r0);
 	}
 	if (!probe_ent_attrexists(bhs, "singleline")) {
-		r0 = SEXP_string_newf("0");
+		r0 = SEXP_string_atom("0");
 		probe_ent_attr_add(bhs, "singleline", r0);
 		SEXP_free(r0);
 	}
@@ -1387,10 +1397,64 @@ static SEXP_t *probe_item_optimize(const SEXP_t *item)
 	return SEXP_ref(item);
 }
 
+/*
+ * Count the entities probe_item_create() will add to the item, so that
+ * the item list can be allocated flat, with its final size.
+ */
+static size_t probe_item_create_count(va_list ap)
+{
+        const char *value_name;
+        char **value_stra;
+        size_t count = 0;
+
+        while ((value_name = va_arg(ap, const char *)) != NULL) {
+                switch (va_arg(ap, oval_datatype_t)) {
+                case OVAL_DATATYPE_STRING_M:
+                        value_stra = va_arg(ap, char **);
+
+                        while (value_stra != NULL && *value_stra != NULL) {
+                                ++value_stra;
+                                ++count;
+                        }
+                        continue;
+                case OVAL_DATATYPE_BOOLEAN:
+                        (void)va_arg(ap, int);
+                        break;
+                case OVAL_DATATYPE_INTEGER:
+                        (void)va_arg(ap, int64_t);
+                        break;
+                case OVAL_DATATYPE_FLOAT:
+                        (void)va_arg(ap, double);
+                        break;
+                case OVAL_DATATYPE_SEXP:
+                case OVAL_DATATYPE_RECORD:
+                        (void)va_arg(ap, SEXP_t *);
+                        break;
+                case OVAL_DATATYPE_STRING:
+                case OVAL_DATATYPE_EVR_STRING:
+                case OVAL_DATATYPE_DEBIAN_EVR_STRING:
+                case OVAL_DATATYPE_FILESET_REVISION:
+                case OVAL_DATATYPE_IOS_VERSION:
+                case OVAL_DATATYPE_IPV4ADDR:
+                case OVAL_DATATYPE_IPV6ADDR:
+                case OVAL_DATATYPE_VERSION:
+                        (void)va_arg(ap, char *);
+                        break;
+                default:
+                        /* probe_item_create() fails on these */
+                        return (count);
+                }
+
+                ++count;
+        }
+
+        return (count);
+}
+
 SEXP_t *probe_item_create(oval_subtype_t item_subtype, probe_elmatr_t *item_attributes[],
                           /* const char *value_name, oval_datatype_t value_type, void *value, */ ...)
 {
-        va_list ap;
+        va_list ap, ap_count;
 	SEXP_t *item, *name_sexp, *value_sexp = NULL, *entity;
         SEXP_t value_sexp_mem, entity_mem;
 	const char *value_name, *subtype_name;
@@ -1423,7 +1487,13 @@ SEXP_t *probe_item_create(oval_subtype_t item_subtype, probe_elmatr_t *item_attr
 
 	va_start(ap, item_attributes);
 
-	item       = probe_item_new(item_name, NULL);
+	item = probe_item_new(item_name, NULL);
+
+	/* room for the item name and all the entities */
+	va_copy(ap_count, ap);
+	SEXP_list_reserve(item, 1 + probe_item_create_count(ap_count));
+	va_end(ap_count);
+
 	value_name = va_arg(ap, const char *);
 
         while (value_name != NULL) {
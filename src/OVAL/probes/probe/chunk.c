@@ -0,0 +1,188 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      Daniel Kopecek <dkopecek@redhat.com>
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <seap.h>
+
+#include "probe-api.h"
+#include "common/debug_priv.h"
+#include "common/alloc.h"
+#include "common/assume.h"
+
+#include "probe.h"
+#include "icache.h"
+#include "chunk.h"
+
+bool probe_chunk_requested(SEAP_msg_t *msg_in)
+{
+	return (SEAP_msgattr_exists(msg_in, PROBE_MSGATTR_CHUNKED) &&
+	        !SEAP_msgattr_exists(msg_in, "no-reply"));
+}
+
+probe_chunk_t *probe_chunk_new(probe_t *probe, SEAP_msg_t *msg_in)
+{
+	probe_chunk_t *chunk;
+
+	chunk = oscap_talloc(probe_chunk_t);
+	chunk->SEAP_ctx = probe->SEAP_ctx;
+	chunk->sd       = probe->sd;
+	chunk->msg_in   = msg_in;
+	chunk->nsent    = 0;
+	chunk->pending  = 0;
+	chunk->error_cnt  = 0;
+	chunk->exists_cnt = 0;
+	chunk->not_collected_cnt = 0;
+
+	return (chunk);
+}
+
+void probe_chunk_free(probe_chunk_t *chunk)
+{
+	if (chunk == NULL)
+		return;
+
+	oscap_free(chunk);
+}
+
+/*
+ * Add the statuses of `items' to the counters. Unknown statuses
+ * are counted as errors, like in probe_cobj_compute_flag().
+ */
+static void probe_chunk_count(probe_chunk_t *chunk, SEXP_t *items)
+{
+	SEXP_t *item;
+
+	SEXP_list_foreach(item, items) {
+		switch (probe_ent_getstatus(item)) {
+		case SYSCHAR_STATUS_EXISTS:
+			++chunk->exists_cnt;
+			break;
+		case SYSCHAR_STATUS_DOES_NOT_EXIST:
+			break;
+		case SYSCHAR_STATUS_NOT_COLLECTED:
+			++chunk->not_collected_cnt;
+			break;
+		default:
+			++chunk->error_cnt;
+		}
+	}
+}
+
+/**
+ * Send the items collected so far in a partial reply and
+ * remove them from the collected object.
+ * Returns 0 on success, -1 on error.
+ */
+int probe_chunk_flush(probe_chunk_t *chunk, struct probe_ctx *ctx)
+{
+	SEXP_t *items, *mask, *part, *empty, *r0;
+	SEAP_msg_t *reply;
+	int ret;
+
+	assume_d(chunk != NULL, -1);
+	assume_d(ctx != NULL, -1);
+
+	chunk->pending = 0;
+
+	/*
+	 * Sync with the icache thread before taking the items
+	 * out of the collected object.
+	 */
+	if (probe_icache_nop(ctx->icache) != 0)
+		return (-1);
+
+	items = probe_cobj_get_items(ctx->probe_out);
+
+	if (SEXP_list_length(items) == 0) {
+		SEXP_free(items);
+		return (0);
+	}
+
+	empty = SEXP_list_new(NULL);
+	r0 = SEXP_list_replace(ctx->probe_out, 3, empty);
+	SEXP_vfree(r0, empty, NULL);
+
+	mask = probe_cobj_get_mask(ctx->probe_out);
+	part = probe_cobj_new(SYSCHAR_FLAG_UNKNOWN, NULL, items, mask);
+
+	reply = SEAP_msg_new();
+	SEAP_msg_set(reply, part);
+	SEAP_msgattr_set(reply, PROBE_MSGATTR_CHUNK, NULL);
+
+	dD("Sending %zu items in a partial reply", SEXP_list_length(items));
+
+	ret = SEAP_reply(chunk->SEAP_ctx, chunk->sd, reply, chunk->msg_in);
+
+	if (ret == 0) {
+		probe_chunk_count(chunk, items);
+		chunk->nsent += SEXP_list_length(items);
+	} else {
+		protect_errno {
+			dE("Can't send a partial reply: %u, %s", errno, strerror(errno));
+		}
+	}
+
+	SEAP_msg_free(reply);
+	SEXP_vfree(part, mask, items, NULL);
+
+	return (ret);
+}
+
+/**
+ * Compute the flag of the collected object like probe_cobj_compute_flag()
+ * does, taking into account the items which were already sent.
+ */
+oval_syschar_collection_flag_t probe_chunk_compute_flag(probe_chunk_t *chunk, SEXP_t *cobj)
+{
+	probe_chunk_t all;
+	oval_syschar_collection_flag_t flag;
+	SEXP_t *items;
+
+	assume_d(chunk != NULL, SYSCHAR_FLAG_ERROR);
+	assume_d(cobj != NULL, SYSCHAR_FLAG_ERROR);
+
+	if (chunk->nsent == 0)
+		return probe_cobj_compute_flag(cobj);
+
+	all = *chunk;
+	items = probe_cobj_get_items(cobj);
+	probe_chunk_count(&all, items);
+	SEXP_free(items);
+
+	if (all.error_cnt > 0)
+		flag = SYSCHAR_FLAG_ERROR;
+	else if (all.not_collected_cnt > 0)
+		flag = SYSCHAR_FLAG_INCOMPLETE;
+	else if (all.exists_cnt > 0)
+		flag = SYSCHAR_FLAG_COMPLETE;
+	else
+		flag = SYSCHAR_FLAG_DOES_NOT_EXIST;
+
+	if (probe_cobj_get_flag(cobj) == SYSCHAR_FLAG_UNKNOWN)
+		probe_cobj_set_flag(cobj, flag);
+
+	return (flag);
+}
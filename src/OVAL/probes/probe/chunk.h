@@ -0,0 +1,41 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      Daniel Kopecek <dkopecek@redhat.com>
+ */
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <stdbool.h>
+#include <seap.h>
+#include <sexp.h>
+#include "probe.h"
+
+#ifndef PROBE_CHUNK_ITEMS
+#define PROBE_CHUNK_ITEMS 512 /**< number of items sent in one partial reply */
+#endif
+
+bool probe_chunk_requested(SEAP_msg_t *msg_in);
+probe_chunk_t *probe_chunk_new(probe_t *probe, SEAP_msg_t *msg_in);
+void probe_chunk_free(probe_chunk_t *chunk);
+
+int probe_chunk_flush(probe_chunk_t *chunk, struct probe_ctx *ctx);
+oval_syschar_collection_flag_t probe_chunk_compute_flag(probe_chunk_t *chunk, SEXP_t *cobj);
+
+#endif /* CHUNK_H */
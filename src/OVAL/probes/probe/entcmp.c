@@ -49,6 +49,9 @@
 #include "../../results/oval_cmp_basic_impl.h"
 #include "../../results/oval_cmp_evr_string_impl.h"
 #include "../../results/oval_cmp_ip_address_impl.h"
+#if defined USE_REGEX_PCRE
+#include "../../results/oval_pcre_cache_impl.h"
+#endif
 
 oval_result_t probe_ent_cmp_binary(SEXP_t * val1, SEXP_t * val2, oval_operation_t op)
 {
@@ -454,87 +457,84 @@ struct _oresults {
 	int true_cnt, false_cnt, unknown_cnt, error_cnt, noteval_cnt, notappl_cnt;
 };
 
+static int results_add(struct _oresults *ores, oval_result_t r)
+{
+	switch (r) {
+	case OVAL_RESULT_TRUE:
+		++(ores->true_cnt);
+		break;
+	case OVAL_RESULT_FALSE:
+		++(ores->false_cnt);
+		break;
+	case OVAL_RESULT_UNKNOWN:
+		++(ores->unknown_cnt);
+		break;
+	case OVAL_RESULT_ERROR:
+		++(ores->error_cnt);
+		break;
+	case OVAL_RESULT_NOT_EVALUATED:
+		++(ores->noteval_cnt);
+		break;
+	case OVAL_RESULT_NOT_APPLICABLE:
+		++(ores->notappl_cnt);
+		break;
+	default:
+		return -1;
+	}
+
+	return 0;
+}
+
 static int results_parser(SEXP_t * res_lst, struct _oresults *ores)
 {
-	oval_result_t r;
 	SEXP_t *res;
 
 	memset(ores, 0, sizeof(struct _oresults));
 
 	SEXP_list_foreach(res, res_lst) {
-		r = SEXP_number_geti_32(res);
-		switch (r) {
-		case OVAL_RESULT_TRUE:
-			++(ores->true_cnt);
-			break;
-		case OVAL_RESULT_FALSE:
-			++(ores->false_cnt);
-			break;
-		case OVAL_RESULT_UNKNOWN:
-			++(ores->unknown_cnt);
-			break;
-		case OVAL_RESULT_ERROR:
-			++(ores->error_cnt);
-			break;
-		case OVAL_RESULT_NOT_EVALUATED:
-			++(ores->noteval_cnt);
-			break;
-		case OVAL_RESULT_NOT_APPLICABLE:
-			++(ores->notappl_cnt);
-			break;
-		default:
+		if (results_add(ores, SEXP_number_geti_32(res)) != 0)
 			return -1;
-		}
 	}
 
 	return 0;
 }
 
-// todo: already implemented elsewhere; consolidate
-oval_result_t probe_ent_result_bychk(SEXP_t * res_lst, oval_check_t check)
+static oval_result_t results_bychk(const struct _oresults *ores, oval_check_t check)
 {
 	oval_result_t result = OVAL_RESULT_UNKNOWN;
-	struct _oresults ores;
-
-	if (SEXP_list_length(res_lst) == 0)
-		return OVAL_RESULT_UNKNOWN;
 
-	if (results_parser(res_lst, &ores) != 0) {
-		return OVAL_RESULT_ERROR;
-	}
-
-	if (ores.notappl_cnt > 0 &&
-	    ores.noteval_cnt == 0 &&
-	    ores.false_cnt == 0 && ores.error_cnt == 0 && ores.unknown_cnt == 0 && ores.true_cnt == 0)
+	if (ores->notappl_cnt > 0 &&
+	    ores->noteval_cnt == 0 &&
+	    ores->false_cnt == 0 && ores->error_cnt == 0 && ores->unknown_cnt == 0 && ores->true_cnt == 0)
 		return OVAL_RESULT_NOT_APPLICABLE;
 
 	switch (check) {
 	case OVAL_CHECK_ALL:
-		if (ores.true_cnt > 0 &&
-		    ores.false_cnt == 0 && ores.error_cnt == 0 && ores.unknown_cnt == 0 && ores.noteval_cnt == 0) {
+		if (ores->true_cnt > 0 &&
+		    ores->false_cnt == 0 && ores->error_cnt == 0 && ores->unknown_cnt == 0 && ores->noteval_cnt == 0) {
 			result = OVAL_RESULT_TRUE;
-		} else if (ores.false_cnt > 0) {
+		} else if (ores->false_cnt > 0) {
 			result = OVAL_RESULT_FALSE;
-		} else if (ores.false_cnt == 0 && ores.error_cnt > 0) {
+		} else if (ores->false_cnt == 0 && ores->error_cnt > 0) {
 			result = OVAL_RESULT_ERROR;
-		} else if (ores.false_cnt == 0 && ores.error_cnt == 0 && ores.unknown_cnt > 0) {
+		} else if (ores->false_cnt == 0 && ores->error_cnt == 0 && ores->unknown_cnt > 0) {
 			result = OVAL_RESULT_UNKNOWN;
-		} else if (ores.false_cnt == 0 && ores.error_cnt == 0 && ores.unknown_cnt == 0 && ores.noteval_cnt > 0) {
+		} else if (ores->false_cnt == 0 && ores->error_cnt == 0 && ores->unknown_cnt == 0 && ores->noteval_cnt > 0) {
 			result = OVAL_RESULT_NOT_EVALUATED;
 		}
 		break;
 	case OVAL_CHECK_AT_LEAST_ONE:
-		if (ores.true_cnt > 0) {
+		if (ores->true_cnt > 0) {
 			result = OVAL_RESULT_TRUE;
-		} else if (ores.false_cnt > 0 &&
-			   ores.true_cnt == 0 &&
-			   ores.unknown_cnt == 0 && ores.error_cnt == 0 && ores.noteval_cnt == 0) {
+		} else if (ores->false_cnt > 0 &&
+			   ores->true_cnt == 0 &&
+			   ores->unknown_cnt == 0 && ores->error_cnt == 0 && ores->noteval_cnt == 0) {
 			result = OVAL_RESULT_FALSE;
-		} else if (ores.true_cnt == 0 && ores.error_cnt > 0) {
+		} else if (ores->true_cnt == 0 && ores->error_cnt > 0) {
 			result = OVAL_RESULT_ERROR;
-		} else if (ores.false_cnt == 0 && ores.error_cnt == 0 && ores.unknown_cnt > 0) {
+		} else if (ores->false_cnt == 0 && ores->error_cnt == 0 && ores->unknown_cnt > 0) {
 			result = OVAL_RESULT_UNKNOWN;
-		} else if (ores.false_cnt == 0 && ores.error_cnt == 0 && ores.unknown_cnt == 0 && ores.noteval_cnt > 0) {
+		} else if (ores->false_cnt == 0 && ores->error_cnt == 0 && ores->unknown_cnt == 0 && ores->noteval_cnt > 0) {
 			result = OVAL_RESULT_NOT_EVALUATED;
 		}
 		break;
@@ -543,32 +543,32 @@ oval_result_t probe_ent_result_bychk(SEXP_t * res_lst, oval_check_t check)
 		   "Converted to check='none satisfy'.");
 		/* FALLTHROUGH */
 	case OVAL_CHECK_NONE_SATISFY:
-		if (ores.true_cnt > 0) {
+		if (ores->true_cnt > 0) {
 			result = OVAL_RESULT_FALSE;
-		} else if (ores.true_cnt == 0 && ores.error_cnt > 0) {
+		} else if (ores->true_cnt == 0 && ores->error_cnt > 0) {
 			result = OVAL_RESULT_ERROR;
-		} else if (ores.true_cnt == 0 && ores.error_cnt == 0 && ores.unknown_cnt > 0) {
+		} else if (ores->true_cnt == 0 && ores->error_cnt == 0 && ores->unknown_cnt > 0) {
 			result = OVAL_RESULT_UNKNOWN;
-		} else if (ores.true_cnt == 0 && ores.error_cnt == 0 && ores.unknown_cnt == 0 && ores.noteval_cnt > 0) {
+		} else if (ores->true_cnt == 0 && ores->error_cnt == 0 && ores->unknown_cnt == 0 && ores->noteval_cnt > 0) {
 			result = OVAL_RESULT_NOT_EVALUATED;
-		} else if (ores.false_cnt > 0 &&
-			   ores.error_cnt == 0 &&
-			   ores.unknown_cnt == 0 && ores.noteval_cnt == 0 && ores.true_cnt == 0) {
+		} else if (ores->false_cnt > 0 &&
+			   ores->error_cnt == 0 &&
+			   ores->unknown_cnt == 0 && ores->noteval_cnt == 0 && ores->true_cnt == 0) {
 			result = OVAL_RESULT_TRUE;
 		}
 		break;
 	case OVAL_CHECK_ONLY_ONE:
-		if (ores.true_cnt == 1 && ores.error_cnt == 0 && ores.unknown_cnt == 0 && ores.noteval_cnt == 0) {
+		if (ores->true_cnt == 1 && ores->error_cnt == 0 && ores->unknown_cnt == 0 && ores->noteval_cnt == 0) {
 			result = OVAL_RESULT_TRUE;
-		} else if (ores.true_cnt > 1) {
+		} else if (ores->true_cnt > 1) {
 			result = OVAL_RESULT_FALSE;
-		} else if (ores.true_cnt < 2 && ores.error_cnt > 0) {
+		} else if (ores->true_cnt < 2 && ores->error_cnt > 0) {
 			result = OVAL_RESULT_ERROR;
-		} else if (ores.true_cnt < 2 && ores.error_cnt == 0 && ores.unknown_cnt > 0) {
+		} else if (ores->true_cnt < 2 && ores->error_cnt == 0 && ores->unknown_cnt > 0) {
 			result = OVAL_RESULT_UNKNOWN;
-		} else if (ores.true_cnt < 2 && ores.error_cnt == 0 && ores.unknown_cnt == 0 && ores.noteval_cnt > 0) {
+		} else if (ores->true_cnt < 2 && ores->error_cnt == 0 && ores->unknown_cnt == 0 && ores->noteval_cnt > 0) {
 			result = OVAL_RESULT_NOT_EVALUATED;
-		} else if (ores.true_cnt != 1 && ores.false_cnt > 0) {
+		} else if (ores->true_cnt != 1 && ores->false_cnt > 0) {
 			result = OVAL_RESULT_FALSE;
 		}
 		break;
@@ -579,6 +579,21 @@ oval_result_t probe_ent_result_bychk(SEXP_t * res_lst, oval_check_t check)
 	return result;
 }
 
+// todo: already implemented elsewhere; consolidate
+oval_result_t probe_ent_result_bychk(SEXP_t * res_lst, oval_check_t check)
+{
+	struct _oresults ores;
+
+	if (SEXP_list_length(res_lst) == 0)
+		return OVAL_RESULT_UNKNOWN;
+
+	if (results_parser(res_lst, &ores) != 0) {
+		return OVAL_RESULT_ERROR;
+	}
+
+	return results_bychk(&ores, check);
+}
+
 // todo: already implemented elsewhere; consolidate
 oval_result_t probe_ent_result_byopr(SEXP_t * res_lst, oval_operator_t operator)
 {
@@ -680,4 +695,265 @@ oval_result_t probe_ent_result_byopr(SEXP_t * res_lst, oval_operator_t operator)
 	return result;
 }
 
+struct probe_entmatch_val {
+	SEXP_t *sexp;
+	char   *cstr; /* NULL if the value isn't a string */
+#if defined USE_REGEX_PCRE
+	const oval_pcre_t *re;
+#elif defined USE_REGEX_POSIX
+	regex_t re;
+	bool    re_ok;
+#endif
+};
+
+struct probe_entmatch {
+	oval_operation_t op;
+	oval_datatype_t  dtype;
+	oval_check_t     check;
+	bool             is_var;
+	bool             is_str; /* the values are compared as C strings */
+	int              count;
+	struct probe_entmatch_val *vals;
+};
+
+probe_entmatch_t *probe_entmatch_new(SEXP_t *ent_obj)
+{
+	probe_entmatch_t *m;
+	SEXP_t *vals, *val, *stmp;
+	int i;
+
+	m = oscap_talloc(probe_entmatch_t);
+	m->is_var = probe_ent_attrexists(ent_obj, "var_ref");
+	m->dtype  = probe_ent_getdatatype(ent_obj);
+
+	stmp = probe_ent_getattrval(ent_obj, "operation");
+	m->op = stmp == NULL ? OVAL_OPERATION_EQUALS : SEXP_number_geti_32(stmp);
+	SEXP_free(stmp);
+
+	stmp = probe_ent_getattrval(ent_obj, "var_check");
+	m->check = stmp == NULL ? OVAL_CHECK_ALL : SEXP_number_geti_32(stmp);
+	SEXP_free(stmp);
+
+	switch (m->dtype) {
+	case OVAL_DATATYPE_BINARY:
+	case OVAL_DATATYPE_EVR_STRING:
+	case OVAL_DATATYPE_DEBIAN_EVR_STRING:
+	case OVAL_DATATYPE_VERSION:
+	case OVAL_DATATYPE_STRING:
+	case OVAL_DATATYPE_IPV4ADDR:
+	case OVAL_DATATYPE_IPV6ADDR:
+		m->is_str = true;
+		break;
+	default:
+		m->is_str = false;
+	}
+
+	vals = NULL;
+	m->count = probe_ent_getvals(ent_obj, &vals);
+	m->vals  = NULL;
+	i = 0;
+
+	if (m->count > 0)
+		m->vals = oscap_calloc(m->count, sizeof(struct probe_entmatch_val));
+
+	SEXP_list_foreach(val, vals) {
+		struct probe_entmatch_val *v = &m->vals[i++];
+
+		v->sexp = SEXP_ref(val);
+
+		if (!SEXP_stringp(val))
+			continue;
+
+		v->cstr = SEXP_string_cstr(val);
+
+		if (m->dtype != OVAL_DATATYPE_STRING || m->op != OVAL_OPERATION_PATTERN_MATCH)
+			continue;
+		/*
+		 * Patterns which fail to compile are left to oval_string_cmp()
+		 * so that the error is reported the same way as before.
+		 */
+#if defined USE_REGEX_PCRE
+		{
+			const char *err;
+			int errofs;
+
+			v->re = oval_pcre_get(v->cstr, PCRE_UTF8, &err, &errofs);
+		}
+#elif defined USE_REGEX_POSIX
+		v->re_ok = regcomp(&v->re, v->cstr, REG_EXTENDED) == 0;
+#endif
+	}
+
+	SEXP_free(vals);
+
+	return m;
+}
+
+void probe_entmatch_free(probe_entmatch_t *m)
+{
+	int i;
+
+	if (m == NULL)
+		return;
+
+	for (i = 0; i < m->count; ++i) {
+		SEXP_free(m->vals[i].sexp);
+		oscap_free(m->vals[i].cstr);
+#if defined USE_REGEX_PCRE
+		oval_pcre_release(m->vals[i].re);
+#elif defined USE_REGEX_POSIX
+		if (m->vals[i].re_ok)
+			regfree(&m->vals[i].re);
+#endif
+	}
+
+	oscap_free(m->vals);
+	oscap_free(m);
+}
+
+static oval_result_t probe_entmatch_single(const probe_entmatch_t *m, const struct probe_entmatch_val *v, const char *str)
+{
+	switch (m->dtype) {
+	case OVAL_DATATYPE_STRING:
+#if defined USE_REGEX_PCRE
+		if (v->re != NULL) {
+			int ret = oval_pcre_exec(v->re, str, strlen(str), NULL, 0);
+
+			if (ret > -1)
+				return OVAL_RESULT_TRUE;
+			else if (ret == -1)
+				return OVAL_RESULT_FALSE;
+
+			dE("Unable to match regex pattern, "
+			   "pcre_exec() returned error: %d.\n", ret);
+			return OVAL_RESULT_ERROR;
+		}
+#elif defined USE_REGEX_POSIX
+		if (v->re_ok) {
+			int ret = regexec(&v->re, str, 0, NULL, 0);
+
+			if (ret == 0)
+				return OVAL_RESULT_TRUE;
+			else if (ret == REG_NOMATCH)
+				return OVAL_RESULT_FALSE;
+
+			dE("Unable to match regex pattern: %d.", ret);
+			return OVAL_RESULT_ERROR;
+		}
+#endif
+		return oval_string_cmp(v->cstr, str, m->op);
+	case OVAL_DATATYPE_BINARY:
+		return oval_binary_cmp(v->cstr, str, m->op);
+	case OVAL_DATATYPE_DEBIAN_EVR_STRING:
+		dW("Using RPM algorithm to compare epoch, version and release.");
+		/* FALLTHROUGH */
+	case OVAL_DATATYPE_EVR_STRING:
+		return oval_evr_string_cmp(v->cstr, str, m->op);
+	case OVAL_DATATYPE_VERSION:
+		return oval_versiontype_cmp(v->cstr, str, m->op);
+	case OVAL_DATATYPE_IPV4ADDR:
+		return oval_ipaddr_cmp(AF_INET, v->cstr, str, m->op);
+	case OVAL_DATATYPE_IPV6ADDR:
+		return oval_ipaddr_cmp(AF_INET6, v->cstr, str, m->op);
+	default:
+		break;
+	}
+
+	return OVAL_RESULT_ERROR;
+}
+
+/*
+ * Combine the results of the values like probe_entobj_cmp() does.
+ */
+static oval_result_t probe_entmatch_result(const probe_entmatch_t *m, const struct _oresults *ores, oval_result_t last)
+{
+	oval_result_t result;
+
+	result = m->is_var ? results_bychk(ores, m->check) : last;
+
+	if (result == OVAL_RESULT_NOT_EVALUATED)
+		return OVAL_RESULT_FALSE;
+	return result;
+}
+
+oval_result_t probe_entmatch_cstr(const probe_entmatch_t *m, const char *str)
+{
+	struct _oresults ores;
+	oval_result_t r = OVAL_RESULT_ERROR;
+	int i;
+
+	if (m->count == 0)
+		return OVAL_RESULT_FALSE;
+	if (!m->is_var && m->count != 1)
+		return OVAL_RESULT_ERROR;
+
+	if (!m->is_str) {
+		SEXP_t *sval = SEXP_string_newf("%s", str);
+
+		r = probe_entmatch_sexp(m, sval);
+		SEXP_free(sval);
+
+		return r;
+	}
+
+	memset(&ores, 0, sizeof ores);
+
+	for (i = 0; i < m->count; ++i) {
+		if (m->vals[i].cstr == NULL) {
+			dI("Types of values to compare don't match: val1: %d, val2: %d",
+			   SEXP_typeof(m->vals[i].sexp), SEXP_TYPE_STRING);
+			return OVAL_RESULT_ERROR;
+		}
+
+		r = probe_entmatch_single(m, &m->vals[i], str);
+		results_add(&ores, r);
+	}
+
+	return probe_entmatch_result(m, &ores, r);
+}
+
+oval_result_t probe_entmatch_sexp(const probe_entmatch_t *m, SEXP_t *val)
+{
+	struct _oresults ores;
+	oval_result_t r = OVAL_RESULT_ERROR;
+	int i;
+
+	if (m->count == 0)
+		return OVAL_RESULT_FALSE;
+
+	if (m->is_str && SEXP_stringp(val)) {
+		char buf[1024], *str;
+
+		/* the string is compared up to the first null byte, as before */
+		if (SEXP_string_length(val) < sizeof buf) {
+			SEXP_string_cstr_r(val, buf, sizeof buf);
+			return probe_entmatch_cstr(m, buf);
+		}
+
+		str = SEXP_string_cstr(val);
+		r = probe_entmatch_cstr(m, str);
+		oscap_free(str);
+
+		return r;
+	}
+
+	if (!m->is_var && m->count != 1)
+		return OVAL_RESULT_ERROR;
+
+	memset(&ores, 0, sizeof ores);
+
+	for (i = 0; i < m->count; ++i) {
+		if (SEXP_typeof(m->vals[i].sexp) != SEXP_typeof(val)) {
+			dI("Types of values to compare don't match: val1: %d, val2: %d",
+			   SEXP_typeof(m->vals[i].sexp), SEXP_typeof(val));
+			return OVAL_RESULT_ERROR;
+		}
+
+		r = probe_ent_cmp_single(m->vals[i].sexp, m->dtype, val, m->op);
+		results_add(&ores, r);
+	}
+
+	return probe_entmatch_result(m, &ores, r);
+}
+
 /// @}
@@ -30,6 +30,8 @@
 #include <string.h>
 #include <inttypes.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
 
 #include "../SEAP/generic/rbt/rbt.h"
 #include "probe-api.h"
@@ -40,6 +42,8 @@
 
 #include "probe.h"
 #include "icache.h"
+#include "chunk.h"
+#include "worker.h"
 
 static volatile uint32_t next_ID = 0;
 
@@ -85,99 +89,354 @@ static void probe_icache_item_setID(SEXP_t *item, SEXP_ID_t item_ID)
         return;
 }
 
-static int icache_lookup(rbt_t *tree, int64_t item_id, probe_iqpair_t *pair) {
+static probe_ishard_t *icache_shard(probe_icache_t *cache, SEXP_ID_t item_ID)
+{
+        return (&cache->shard[item_ID & (PROBE_ICACHE_SHARDS - 1)]);
+}
 
-	probe_citem_t *cached = NULL;
+/*
+ * Find the slot for `item_ID'. Returns the index of the slot holding
+ * the key or of the empty slot where the key should be inserted.
+ */
+static uint32_t icache_shard_slot(probe_ishard_t *shard, SEXP_ID_t item_ID)
+{
+        uint32_t mask = shard->size - 1;
+        /* the low bits were used to select the shard */
+        uint32_t i = (uint32_t)(item_ID >> 6 ^ item_ID >> 32) & mask;
 
-	if (rbt_i64_get(tree, item_id, (void**)&cached) != 0) {
-		return -1;
-	}
+        while (shard->val[i] != NULL && shard->key[i] != item_ID)
+                i = (i + 1) & mask;
 
-	/*
-	* Maybe a cache HIT
-	*/
-	dI("cache HIT #1");
+        return (i);
+}
 
-	register uint16_t i;
-	for (i = 0; i < cached->count; ++i) {
-		SEXP_t rest1;
-		SEXP_t* rest_r1 = SEXP_list_rest_r(&rest1, pair->p.item);
+static int icache_shard_init(probe_ishard_t *shard)
+{
+        if (pthread_mutex_init(&shard->lock, NULL) != 0) {
+                dE("Can't initialize icache shard mutex: %u, %s", errno, strerror(errno));
+                return (-1);
+        }
 
-		SEXP_t rest2;
-		SEXP_t* rest_r2 = SEXP_list_rest_r(&rest2, cached->item[i]);
+        shard->size   = PROBE_ICACHE_SHARD_INITSIZE;
+        shard->used   = 0;
+        shard->key    = oscap_alloc(sizeof(SEXP_ID_t) * shard->size);
+        shard->val    = oscap_calloc(shard->size, sizeof(probe_citem_t *));
+        shard->hits   = 0;
+        shard->misses = 0;
 
-		if (SEXP_deepcmp(rest_r1, rest_r2)) {
-			SEXP_free_r(&rest1);
-			SEXP_free_r(&rest2);
-			break;
-		}
+        return (0);
+}
 
-		SEXP_free_r(&rest1);
-		SEXP_free_r(&rest2);
-	}
+static void icache_shard_grow(probe_ishard_t *shard)
+{
+        SEXP_ID_t      *old_key  = shard->key;
+        probe_citem_t **old_val  = shard->val;
+        uint32_t        old_size = shard->size, i, j;
 
-	if (i == cached->count) {
-		/*
-		* Cache MISS
-		*/
-		dI("cache MISS");
+        shard->size *= 2;
+        shard->key   = oscap_alloc(sizeof(SEXP_ID_t) * shard->size);
+        shard->val   = oscap_calloc(shard->size, sizeof(probe_citem_t *));
 
-		cached->item = oscap_realloc(cached->item, sizeof(SEXP_t *) * ++cached->count);
-		cached->item[cached->count - 1] = pair->p.item;
+        for (i = 0; i < old_size; ++i) {
+                if (old_val[i] == NULL)
+                        continue;
 
-		/* Assign an unique item ID */
-		probe_icache_item_setID(pair->p.item, item_id);
-	} else {
-		/*
-		* Cache HIT
-		*/
-		dI("cache HIT #2 -> real HIT");
-		SEXP_free(pair->p.item);
-		pair->p.item = cached->item[i];
-	}
-	return 0;
+                j = icache_shard_slot(shard, old_key[i]);
+                shard->key[j] = old_key[i];
+                shard->val[j] = old_val[i];
+        }
+
+        oscap_free(old_key);
+        oscap_free(old_val);
 }
 
-static void icache_add_to_tree(rbt_t *tree, int64_t item_id, probe_iqpair_t *pair) {
+/*
+ * The cached items outlive the request, so they must not pin the arena
+ * chunks of the request. Only the parts carved out of the arena are copied.
+ */
+static SEXP_t *icache_detach(SEXP_t *item)
+{
+        SEXP_t *copy;
+
+        copy = SEXP_arena_detach(item);
+        SEXP_free(item);
+
+        return (copy);
+}
+
+/*
+ * Return the cached copy of `item' if there is one. Otherwise the
+ * item is added to the cache and an unique item ID is assigned to it.
+ * The item is freed in case of a cache hit.
+ */
+static SEXP_t *icache_dedup(probe_icache_t *cache, SEXP_t *item)
+{
+        SEXP_ID_t       item_ID;
+        probe_ishard_t *shard;
+        probe_citem_t  *cached;
+        uint32_t        slot;
+        uint16_t        i;
+
+        /*
+         * Compute item ID
+         */
+        item_ID = SEXP_ID_v(item);
+        dD("item ID=%"PRIu64"", item_ID);
 
-	probe_citem_t *cached = oscap_talloc(probe_citem_t);
-	cached->item = oscap_talloc(SEXP_t *);
-	cached->item[0] = pair->p.item;
-	cached->count = 1;
+        shard = icache_shard(cache, item_ID);
 
-	/* Assign an unique item ID */
-	probe_icache_item_setID(pair->p.item, item_id);
+        if (pthread_mutex_lock(&shard->lock) != 0) {
+                dE("Can't lock the icache shard mutex: %u, %s", errno, strerror(errno));
+                abort();
+        }
 
-	if (rbt_i64_add(tree, (int64_t)item_id, (void **)cached, NULL) != 0) {
-		dE("Can't add item (k=%"PRIi64" to the cache (%p)", item_id, tree);
+        slot   = icache_shard_slot(shard, item_ID);
+        cached = shard->val[slot];
 
-		oscap_free(cached->item);
-		oscap_free(cached);
+        if (cached != NULL) {
+                /*
+                 * Maybe a cache HIT
+                 */
+                dI("cache HIT #1");
 
-		/* now what? */
-		abort();
-	}
+                for (i = 0; i < cached->count; ++i) {
+                        SEXP_t rest1;
+                        SEXP_t* rest_r1 = SEXP_list_rest_r(&rest1, item);
+
+                        SEXP_t rest2;
+                        SEXP_t* rest_r2 = SEXP_list_rest_r(&rest2, cached->item[i]);
+
+                        if (SEXP_deepcmp(rest_r1, rest_r2)) {
+                                SEXP_free_r(&rest1);
+                                SEXP_free_r(&rest2);
+                                break;
+                        }
+
+                        SEXP_free_r(&rest1);
+                        SEXP_free_r(&rest2);
+                }
+
+                if (i < cached->count) {
+                        /*
+                         * Cache HIT
+                         */
+                        dI("cache HIT #2 -> real HIT");
+                        ++shard->hits;
+                        SEXP_free(item);
+                        item = cached->item[i];
+                        goto unlock;
+                }
+
+                item = icache_detach(item);
+                cached->item = oscap_realloc(cached->item, sizeof(SEXP_t *) * ++cached->count);
+                cached->item[cached->count - 1] = item;
+        } else {
+                item = icache_detach(item);
+
+                if ((shard->used + 1) * 4 > shard->size * 3) {
+                        icache_shard_grow(shard);
+                        slot = icache_shard_slot(shard, item_ID);
+                }
+
+                cached = oscap_talloc(probe_citem_t);
+                cached->item = oscap_talloc(SEXP_t *);
+                cached->item[0] = item;
+                cached->count = 1;
+
+                shard->key[slot] = item_ID;
+                shard->val[slot] = cached;
+                ++shard->used;
+        }
+
+        /*
+         * Cache MISS
+         */
+        dI("cache MISS");
+        ++shard->misses;
+
+        /* Assign an unique item ID */
+        probe_icache_item_setID(item, item_ID);
+unlock:
+        if (pthread_mutex_unlock(&shard->lock) != 0) {
+                dE("Can't unlock the icache shard mutex: %u, %s", errno, strerror(errno));
+                abort();
+        }
+
+        return (item);
 }
 
-static void *probe_icache_worker(void *arg)
+static void icache_shard_free(probe_ishard_t *shard)
 {
-        probe_icache_t *cache = (probe_icache_t *)(arg);
-        probe_iqpair_t *pair, pair_mem;
-        SEXP_ID_t       item_ID;
+        probe_citem_t *ci;
+        uint32_t i;
 
-        assume_d(cache != NULL, NULL);
+        for (i = 0; i < shard->size; ++i) {
+                if ((ci = shard->val[i]) == NULL)
+                        continue;
 
-#if defined(HAVE_PTHREAD_SETNAME_NP)
-	pthread_setname_np(pthread_self(), "icache_worker");
+                for ( ; ci->count > 0 ; --ci->count ) {
+                        SEXP_free(ci->item[ci->count - 1]);
+                }
+
+                oscap_free(ci->item);
+                oscap_free(ci);
+        }
+
+        oscap_free(shard->key);
+        oscap_free(shard->val);
+        pthread_mutex_destroy(&shard->lock);
+}
+
+/*
+ * Push an entry onto the queue.
+ * Returns true if the queue was empty before.
+ */
+static bool icache_queue_push(probe_icache_t *cache, probe_iqpair_t *pair)
+{
+#if defined(HAVE_ATOMIC_BUILTINS)
+        probe_iqpair_t *head;
+
+        do {
+                head = cache->queue_head;
+                pair->next = head;
+        } while (!__sync_bool_compare_and_swap(&cache->queue_head, head, pair));
+
+        return (head == NULL);
+#else
+        bool empty;
+
+        if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
+                dE("An error ocured while locking the queue mutex: %u, %s",
+                   errno, strerror(errno));
+                abort();
+        }
+
+        empty = cache->queue_head == NULL;
+        pair->next = cache->queue_head;
+        cache->queue_head = pair;
+
+        if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
+                dE("An error ocured while unlocking the queue mutex: %u, %s",
+                   errno, strerror(errno));
+                abort();
+        }
+
+        return (empty);
+#endif
+}
+
+/*
+ * Take all queued entries. The entries are returned in
+ * the order they were pushed.
+ */
+static probe_iqpair_t *icache_queue_take(probe_icache_t *cache, uint32_t *count)
+{
+        probe_iqpair_t *head, *next, *prev;
+#if defined(HAVE_ATOMIC_BUILTINS)
+        head = __sync_lock_test_and_set(&cache->queue_head, NULL);
+        __sync_synchronize();
+#else
+        if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
+                dE("An error ocured while locking the queue mutex: %u, %s",
+                   errno, strerror(errno));
+                abort();
+        }
+
+        head = cache->queue_head;
+        cache->queue_head = NULL;
+
+        if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
+                dE("An error ocured while unlocking the queue mutex: %u, %s",
+                   errno, strerror(errno));
+                abort();
+        }
 #endif
+        *count = 0;
+
+        for (prev = NULL; head != NULL; head = next) {
+                next = head->next;
+                head->next = prev;
+                prev = head;
+                ++(*count);
+        }
+
+        return (prev);
+}
+
+/*
+ * Wake up the worker thread after pushing an entry onto an empty queue.
+ */
+static int icache_queue_notify(probe_icache_t *cache)
+{
+        if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
+                dE("An error ocured while locking the queue mutex: %u, %s",
+                   errno, strerror(errno));
+                return (-1);
+        }
+
+        if (pthread_cond_signal(&cache->queue_notempty) != 0) {
+                dE("An error ocured while signaling the `notempty' condition: %u, %s",
+                   errno, strerror(errno));
+                pthread_mutex_unlock(&cache->queue_mutex);
+                return (-1);
+        }
+
+        if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
+                dE("An error ocured while unlocking the queue mutex: %u, %s",
+                   errno, strerror(errno));
+                abort();
+        }
+
+        return (0);
+}
+
+static void icache_handle_nop(probe_icache_t *cache, probe_iqpair_t *pair)
+{
+        assume_d(pair->p.cond != NULL, /* void */);
+
+        dD("Handling NOP");
 
         if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
                 dE("An error ocured while locking the queue mutex: %u, %s",
                    errno, strerror(errno));
-                return (NULL);
+                abort();
         }
 
-	pair = &pair_mem;
+        pair->done = 1;
+
+        if (pthread_cond_signal(pair->p.cond) != 0) {
+                dE("An error ocured while signaling NOP condition: %u, %s",
+                   errno, strerror(errno));
+                abort();
+        }
+
+        if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
+                dE("An error ocured while unlocking the queue mutex: %u, %s",
+                   errno, strerror(errno));
+                abort();
+        }
+}
+
+static void icache_handle_item(probe_icache_t *cache, probe_iqpair_t *pair)
+{
+        dD("Handling cache request");
+
+        if (probe_cobj_add_item(pair->cobj, pair->p.item) != 0) {
+                dW("An error ocured while adding the item to the collected object");
+        }
+}
+
+static void *probe_icache_worker(void *arg)
+{
+        probe_icache_t *cache = (probe_icache_t *)(arg);
+        probe_iqpair_t *pair, *next;
+        uint32_t        count;
+
+        assume_d(cache != NULL, NULL);
+
+#if defined(HAVE_PTHREAD_SETNAME_NP)
+	pthread_setname_np(pthread_self(), "icache_worker");
+#endif
         dD("icache worker ready");
 
         switch (errno = pthread_barrier_wait(&OSCAP_GSYM(th_barrier)))
@@ -188,93 +447,58 @@ static void *probe_icache_worker(void *arg)
         default:
 	        dE("pthread_barrier_wait: %d, %s.",
 	           errno, strerror(errno));
-	        pthread_mutex_unlock(&cache->queue_mutex);
 	        return (NULL);
         }
 
-        while(pthread_cond_wait(&cache->queue_notempty, &cache->queue_mutex) == 0) {
-                assume_d(cache->queue_cnt > 0, NULL);
-        do {
-                dI("Extracting item from the cache queue: cnt=%"PRIu16", beg=%"PRIu16"", cache->queue_cnt, cache->queue_beg);
+        for (;;) {
                 /*
-                 * Extract an item from the queue and update queue beg, end & cnt
+                 * Drain everything that was queued since the last batch
                  */
-                pair_mem = cache->queue[cache->queue_beg];
-#ifndef NDEBUG
-		memset(cache->queue + cache->queue_beg, 0, sizeof(probe_iqpair_t));
-#endif
-                --cache->queue_cnt;
-		++cache->queue_beg;
-
-		if (cache->queue_beg == cache->queue_max)
-			cache->queue_beg = 0;
+                pair = icache_queue_take(cache, &count);
 
-		assume_d(cache->queue_cnt == 0 ?
-			 cache->queue_end == cache->queue_beg :
-			 cache->queue_end != cache->queue_beg, NULL);
+                if (pair == NULL) {
+                        if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
+                                dE("An error ocured while locking the queue mutex: %u, %s",
+                                   errno, strerror(errno));
+                                return (NULL);
+                        }
 
+                        pthread_cleanup_push(probe_mutex_unlock, (void *)&cache->queue_mutex);
 
-                dD("Signaling `notfull'");
+                        while (cache->queue_head == NULL) {
+                                if (pthread_cond_wait(&cache->queue_notempty, &cache->queue_mutex) != 0) {
+                                        dE("An error ocured while waiting for the `notempty' queue condition: %u, %s",
+                                           errno, strerror(errno));
+                                        abort();
+                                }
+                        }
 
-                if (pthread_cond_signal(&cache->queue_notfull) != 0) {
-                        dE("An error ocured while signaling the `notfull' condition: %u, %s",
-                           errno, strerror(errno));
-                        abort();
+                        pthread_cleanup_pop(1);
+                        continue;
                 }
-                /*
-                 * Release the mutex
-                 */
-                if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
-                        dE("An error ocured while unlocking the queue mutex: %u, %s",
-                           errno, strerror(errno));
-                        abort();
-                }
-
-                if (pair->cobj == NULL) {
-                        /*
-                         * Handle NOP case (synchronization)
-                         */
-                        assume_d(pair->p.cond != NULL, NULL);
 
-                        dD("Handling NOP");
+                dI("Extracted a batch of %"PRIu32" entries from the cache queue", count);
 
-                        if (pthread_cond_signal(pair->p.cond) != 0) {
-                                dE("An error ocured while signaling NOP condition: %u, %s",
-                                   errno, strerror(errno));
-                                abort();
-                        }
-                } else {
+                cache->stats.enqueued += count;
+                cache->stats.batches++;
 
-                        dD("Handling cache request");
+                if (count > cache->stats.depth_max)
+                        cache->stats.depth_max = count;
 
-                        /*
-                         * Compute item ID
-                         */
-			dD("pair address: %"PRIu64, (uint64_t) pair);
-			dD("item address: %"PRIu64, (uint64_t) pair->p.item);
-                        item_ID = SEXP_ID_v(pair->p.item);
-                        dD("item ID=%"PRIu64"", item_ID);
+                for (; pair != NULL; pair = next) {
+                        next = pair->next;
 
-                        if (icache_lookup(cache->tree, item_ID, pair) != 0) {
+                        if (pair->cobj == NULL) {
                                 /*
-                                 * Cache MISS
+                                 * Handle NOP case (synchronization). The entry
+                                 * is owned by the waiting thread.
                                  */
-                                dI("cache MISS");
-                                icache_add_to_tree(cache->tree, item_ID, pair);
-                        }
-
-                        if (probe_cobj_add_item(pair->cobj, pair->p.item) != 0) {
-                            dW("An error ocured while adding the item to the collected object");
+                                icache_handle_nop(cache, pair);
+                        } else {
+                                icache_handle_item(cache, pair);
+                                oscap_free(pair);
                         }
                 }
-
-                if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
-                        dE("An error ocured while re-locking the queue mutex: %u, %s",
-                           errno, strerror(errno));
-                        abort();
-                }
-
-                } while (cache->queue_cnt > 0);
         }
 
         return (NULL);
@@ -284,31 +508,33 @@ probe_icache_t *probe_icache_new(void)
 {
         probe_icache_t *cache;
 
+        size_t i;
+
         cache = oscap_talloc(probe_icache_t);
-        cache->tree = rbt_i64_new();
+        cache->queue_head = NULL;
+        memset(&cache->stats, 0, sizeof cache->stats);
+
+        for (i = 0; i < PROBE_ICACHE_SHARDS; ++i) {
+                if (icache_shard_init(&cache->shard[i]) != 0) {
+                        while (i > 0)
+                                icache_shard_free(&cache->shard[--i]);
+
+                        oscap_free(cache);
+                        return (NULL);
+                }
+        }
 
         if (pthread_mutex_init(&cache->queue_mutex, NULL) != 0) {
                 dE("Can't initialize icache mutex: %u, %s", errno, strerror(errno));
                 goto fail;
         }
 
-        cache->queue_beg = 0;
-        cache->queue_end = 0;
-        cache->queue_cnt = 0;
-        cache->queue_max = PROBE_IQUEUE_CAPACITY;
-
         if (pthread_cond_init(&cache->queue_notempty, NULL) != 0) {
                 dE("Can't initialize icache queue condition variable (notempty): %u, %s",
                    errno, strerror(errno));
                 goto fail;
         }
 
-        if (pthread_cond_init(&cache->queue_notfull, NULL) != 0) {
-                dE("Can't initialize icache queue condition variable (notfull): %u, %s",
-                   errno, strerror(errno));
-                goto fail;
-        }
-
         if (pthread_create(&cache->thid, NULL,
                            probe_icache_worker, (void *)cache) != 0)
         {
@@ -318,8 +544,8 @@ probe_icache_t *probe_icache_new(void)
 
         return (cache);
 fail:
-        if (cache->tree != NULL)
-                rbt_i64_free(cache->tree);
+        for (i = 0; i < PROBE_ICACHE_SHARDS; ++i)
+                icache_shard_free(&cache->shard[i]);
 
         pthread_mutex_destroy(&cache->queue_mutex);
         pthread_cond_destroy(&cache->queue_notempty);
@@ -328,120 +554,85 @@ fail:
         return (NULL);
 }
 
-static int __probe_icache_add_nolock(probe_icache_t *cache, SEXP_t *cobj, SEXP_t *item, pthread_cond_t *cond)
+int probe_icache_add(probe_icache_t *cache, SEXP_t *cobj, SEXP_t *item)
 {
-        assume_d((cond == NULL) ^ (item == NULL), -1);
-retry:
-        if (cache->queue_cnt < cache->queue_max) {
-                cache->queue[cache->queue_end].cobj = cobj;
-
-                if (item != NULL) {
-			assume_d(cobj != NULL, -1);
-                        cache->queue[cache->queue_end].p.item = item;
-                } else {
-			assume_d(item == NULL && cobj == NULL, -1);
-                        cache->queue[cache->queue_end].p.cond = cond;
-		}
+        probe_iqpair_t *pair;
 
-                ++cache->queue_cnt;
-		++cache->queue_end;
+        if (cache == NULL || cobj == NULL || item == NULL)
+                return (-1); /* XXX: EFAULT */
 
-                if (cache->queue_end == cache->queue_max)
-                        cache->queue_end = 0;
-        } else {
-                /*
-                 * The queue is full, we have to wait
-                 */
-                if (pthread_cond_wait(&cache->queue_notfull, &cache->queue_mutex) == 0)
-                        goto retry;
-                else {
-                        dE("An error ocured while waiting for the `notfull' queue condition: %u, %s",
-                           errno, strerror(errno));
+        /*
+         * Deduplicate the item in the calling thread, only adding it
+         * to the collected object is left to the icache worker.
+         */
+        pair = oscap_talloc(probe_iqpair_t);
+        pair->cobj   = cobj;
+        pair->p.item = icache_dedup(cache, item);
+        pair->done   = 0;
+
+        if (icache_queue_push(cache, pair)) {
+                if (icache_queue_notify(cache) != 0)
                         return (-1);
-                }
         }
 
         return (0);
 }
 
-int probe_icache_add(probe_icache_t *cache, SEXP_t *cobj, SEXP_t *item)
+static uint64_t icache_time_ns(void)
 {
-        int ret;
-
-        if (cache == NULL || cobj == NULL || item == NULL)
-                return (-1); /* XXX: EFAULT */
+        struct timespec ts;
 
-        if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
-                dE("An error ocured while locking the queue mutex: %u, %s",
-                   errno, strerror(errno));
-                return (-1);
-        }
-
-        ret = __probe_icache_add_nolock(cache, cobj, item, NULL);
-
-        if (pthread_cond_signal(&cache->queue_notempty) != 0) {
-                dE("An error ocured while signaling the `notempty' condition: %u, %s",
-                   errno, strerror(errno));
-                return (-1);
-        }
-
-        if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
-                dE("An error ocured while unlocking the queue mutex: %u, %s",
-                   errno, strerror(errno));
-                abort();
-        }
+        if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+                return (0);
 
-        if (ret != 0)
-                return (-1);
-
-        return (0);
+        return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
 }
 
 int probe_icache_nop(probe_icache_t *cache)
 {
         pthread_cond_t cond;
+        probe_iqpair_t pair;
+        uint64_t       wait_beg;
 
         dD("NOP");
 
-        if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
-                dE("An error ocured while locking the queue mutex: %u, %s",
-                   errno, strerror(errno));
-                return (-1);
-        }
-
         if (pthread_cond_init(&cond, NULL) != 0) {
                 dE("Can't initialize icache queue condition variable (NOP): %u, %s",
                    errno, strerror(errno));
                 return (-1);
         }
 
-        if (__probe_icache_add_nolock(cache, NULL, NULL, &cond) != 0) {
-                if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
-                        dE("An error ocured while unlocking the queue mutex: %u, %s",
-                           errno, strerror(errno));
+        pair.cobj   = NULL;
+        pair.p.cond = &cond;
+        pair.done   = 0;
+        wait_beg    = icache_time_ns();
+
+        if (icache_queue_push(cache, &pair)) {
+                dD("Signaling `notempty'");
+
+                if (icache_queue_notify(cache) != 0) {
+                        /*
+                         * The entry is already queued and may be accessed
+                         * by the worker thread, we can't return from here.
+                         */
                         abort();
                 }
-
-                pthread_cond_destroy(&cond);
-                return (-1);
         }
 
-        dD("Signaling `notempty'");
+        dD("Waiting for icache worker to handle the NOP");
 
-        if (pthread_cond_signal(&cache->queue_notempty) != 0) {
-                dE("An error ocured while signaling the `notempty' condition: %u, %s",
+        if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
+                dE("An error ocured while locking the queue mutex: %u, %s",
                    errno, strerror(errno));
-
-                pthread_cond_destroy(&cond);
-                return (-1);
+                abort();
         }
 
-        dD("Waiting for icache worker to handle the NOP");
-
-        if (pthread_cond_wait(&cond, &cache->queue_mutex) != 0) {
-                dE("An error ocured while waiting for the `NOP' queue condition: %u, %s",
-                   errno, strerror(errno));
-                return (-1);
+        while (!pair.done) {
+                if (pthread_cond_wait(&cond, &cache->queue_mutex) != 0) {
+                        dE("An error ocured while waiting for the `NOP' queue condition: %u, %s",
+                           errno, strerror(errno));
+                        abort();
+                }
         }
 
         dD("Sync");
@@ -453,7 +644,9 @@ int probe_icache_nop(probe_icache_t *cache)
         }
 
         pthread_cond_destroy(&cond);
-
+#if defined(HAVE_ATOMIC_BUILTINS)
+        __sync_fetch_and_add(&cache->stats.wait_ns, icache_time_ns() - wait_beg);
+#endif
         return (0);
 }
 
@@ -526,6 +719,9 @@ int probe_item_collect(struct probe_ctx *ctx, SEXP_t *item)
 	cobj_itemcnt = SEXP_list_length(cobj_content);
 	SEXP_free(cobj_content);
 
+	if (ctx->chunk != NULL)
+		cobj_itemcnt += ctx->chunk->nsent;
+
 	if (probe_cobj_memcheck(cobj_itemcnt) != 0) {
 
 		/*
@@ -564,33 +760,51 @@ int probe_item_collect(struct probe_ctx *ctx, SEXP_t *item)
                 return (-1);
         }
 
-        return (0);
-}
-
-static void probe_icache_free_node(struct rbt_i64_node *n)
-{
-        probe_citem_t *ci = (probe_citem_t *)n->data;
-
-	for ( ; ci->count > 0 ; --ci->count ) {
-		SEXP_free(ci->item[ci->count - 1]);
-	}
+        if (ctx->chunk != NULL && ++ctx->chunk->pending >= PROBE_CHUNK_ITEMS) {
+                if (probe_chunk_flush(ctx->chunk, ctx) != 0)
+                        return (-1);
+        }
 
-        oscap_free(ci->item);
-        oscap_free(ci);
-        return;
+        return (0);
 }
 
 void probe_icache_free(probe_icache_t *cache)
 {
         void *ret = NULL;
 
+        probe_iqpair_t *pair, *next;
+        uint32_t count;
+        uint64_t hits = 0, misses = 0;
+        size_t   i;
+
         pthread_cancel(cache->thid);
         pthread_join(cache->thid, &ret);
+
+        dI("icache stats: enqueued=%"PRIu64", batches=%"PRIu64", depth_max=%"PRIu32", nop_wait=%"PRIu64"ns",
+           cache->stats.enqueued, cache->stats.batches, cache->stats.depth_max, cache->stats.wait_ns);
+
+        /* items which were queued but not handled */
+        for (pair = icache_queue_take(cache, &count); pair != NULL; pair = next) {
+                next = pair->next;
+
+                if (pair->cobj != NULL) {
+                        SEXP_free(pair->p.item);
+                        oscap_free(pair);
+                }
+        }
+
         pthread_mutex_destroy(&cache->queue_mutex);
         pthread_cond_destroy(&cache->queue_notempty);
-        pthread_cond_destroy(&cache->queue_notfull);
 
-        rbt_i64_free_cb(cache->tree, &probe_icache_free_node);
+        for (i = 0; i < PROBE_ICACHE_SHARDS; ++i) {
+                hits   += cache->shard[i].hits;
+                misses += cache->shard[i].misses;
+                icache_shard_free(&cache->shard[i]);
+        }
+
+        dI("icache dedup: hits=%"PRIu64", misses=%"PRIu64", hit rate=%.2f%%",
+           hits, misses, hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0);
+
         oscap_free(cache);
         return;
 }
@@ -23,41 +23,80 @@
 #define ICACHE_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <sexp.h>
 #include "../SEAP/generic/rbt/rbt.h"
 
-#ifndef PROBE_IQUEUE_CAPACITY
-#define PROBE_IQUEUE_CAPACITY 1024
-#endif
-
-typedef struct {
+/*
+ * Item cache queue entry. Entries with cobj == NULL are NOP requests
+ * used for synchronization with the icache worker thread. Items are
+ * deduplicated before they are queued, the worker thread only adds
+ * them to the collected object.
+ */
+typedef struct probe_iqpair {
+        struct probe_iqpair *next;
         SEXP_t *cobj;
         union {
                 SEXP_t         *item;
                 pthread_cond_t *cond;
         } p;
+        volatile int done; /**< NOP handled */
 } probe_iqpair_t;
 
 typedef struct {
-        rbt_t    *tree; /* XXX: rewrite to extensible or linear hashing */
-        pthread_t thid;
+        uint64_t enqueued;  /**< number of queued entries */
+        uint64_t batches;   /**< number of batches drained by the worker */
+        uint32_t depth_max; /**< maximal number of entries in a batch */
+        uint64_t wait_ns;   /**< time spent waiting for NOPs to be handled */
+} probe_icache_stats_t;
 
-        pthread_mutex_t queue_mutex;
-        pthread_cond_t  queue_notempty;
-        pthread_cond_t  queue_notfull;
+#ifndef PROBE_ICACHE_SHARDS
+#define PROBE_ICACHE_SHARDS 64 /**< number of item table shards, power of 2 */
+#endif
 
-        probe_iqpair_t  queue[PROBE_IQUEUE_CAPACITY];
-        uint16_t        queue_beg;
-        uint16_t        queue_end;
-        uint16_t        queue_cnt;
-        uint16_t        queue_max;
-} probe_icache_t;
+#ifndef PROBE_ICACHE_SHARD_INITSIZE
+#define PROBE_ICACHE_SHARD_INITSIZE 64 /**< initial number of slots per shard, power of 2 */
+#endif
 
 typedef struct {
         SEXP_t  **item;
         uint16_t  count;
 } probe_citem_t;
 
+/*
+ * One shard of the item table: an open addressing (linear probing)
+ * hash table keyed by the item hash. Items with the same hash are
+ * stored in the same slot and compared with SEXP_deepcmp.
+ */
+typedef struct {
+        pthread_mutex_t lock;
+        SEXP_ID_t      *key;
+        probe_citem_t **val;  /**< NULL marks an empty slot */
+        uint32_t        size; /**< number of slots, power of 2 */
+        uint32_t        used; /**< number of occupied slots */
+        uint64_t        hits;
+        uint64_t        misses;
+} probe_ishard_t;
+
+typedef struct {
+        probe_ishard_t shard[PROBE_ICACHE_SHARDS];
+        pthread_t thid;
+
+        /*
+         * Multi-producer, single-consumer queue. Producers push entries
+         * onto a lock-free LIFO list, the worker takes the whole list at
+         * once and handles the entries in the order they were pushed. The
+         * mutex & condition are used only when the worker goes to sleep
+         * and for waiting on NOPs.
+         */
+        probe_iqpair_t *volatile queue_head;
+        pthread_mutex_t queue_mutex;
+        pthread_cond_t  queue_notempty;
+
+        probe_icache_stats_t stats;
+} probe_icache_t;
+
 probe_icache_t *probe_icache_new(void);
 int probe_icache_add(probe_icache_t *cache, SEXP_t *cobj, SEXP_t *item);
 int probe_icache_nop(probe_icache_t *cache);
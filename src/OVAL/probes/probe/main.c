@@ -43,6 +43,8 @@
 #include "input_handler.h"
 #include "probe-api.h"
 #include "option.h"
+#include "../fscache.h"
+#include "../proctab.h"
 #include <oscap_debug.h>
 #include "debug_priv.h"
 static int fail(int err, const char *who, int line)
@@ -63,6 +65,13 @@ pthread_barrier_t OSCAP_GSYM(th_barrier);
 
 extern probe_ncache_t *OSCAP_GSYM(ncache);
 
+static uint32_t probe_worker_threads = 0;
+
+static bool    pcache_enabled  = false;
+static bool    pcache_itemdeps = false;
+static char  **pcache_depends  = NULL;
+static size_t  pcache_depcnt   = 0;
+
 static int probe_optecmp(char **a, char **b)
 {
 	return strcmp(*a, *b);
@@ -80,6 +89,9 @@ static SEXP_t *probe_reset(SEXP_t *arg0, void *arg1)
         probe->rcache = probe_rcache_new();
         probe->ncache = probe_ncache_new();
 
+	/* the next scan takes a new snapshot of the process table */
+	proctab_reset();
+
         return(NULL);
 }
 
@@ -161,6 +173,55 @@ static int probe_opthandler_offlinemode(int option, int op, va_list args)
 	return 0;
 }
 
+/*
+ * Number of worker threads evaluating the requests. Zero means
+ * the default, i.e. the number of online CPUs.
+ */
+static int probe_opthandler_workers(int option, int op, va_list args)
+{
+	if (op == PROBE_OPTION_SET) {
+		int o_threads = va_arg(args, int);
+
+		if (o_threads < 0 || o_threads > PROBE_WORKER_DEFAULT_MAX_THREADS)
+			return (-1);
+
+		probe_worker_threads = (uint32_t)o_threads;
+	} else if (op == PROBE_OPTION_GET) {
+		int *o_threads = va_arg(args, int *);
+
+		if (o_threads != NULL)
+			*o_threads = probe_worker_threads;
+	}
+	return (0);
+}
+
+/*
+ * Opt in to the persistent result cache. The argument is a file
+ * all collected objects depend on (e.g. the package database) or
+ * NULL if the objects depend on the files their items refer to.
+ * The option may be set several times.
+ */
+static int probe_opthandler_pcache(int option, int op, va_list args)
+{
+	if (op == PROBE_OPTION_SET) {
+		const char *o_depend = va_arg(args, const char *);
+
+		if (o_depend != NULL) {
+			pcache_depends = oscap_realloc(pcache_depends, sizeof(char *) * ++pcache_depcnt);
+			pcache_depends[pcache_depcnt - 1] = strdup(o_depend);
+		} else
+			pcache_itemdeps = true;
+
+		pcache_enabled = true;
+	} else if (op == PROBE_OPTION_GET) {
+		bool *o_enabled = va_arg(args, bool *);
+
+		if (o_enabled != NULL)
+			*o_enabled = pcache_enabled;
+	}
+	return (0);
+}
+
 // Dummy pthread routine
 static void * dummy_routine(void *dummy_param)
 {
@@ -215,6 +276,8 @@ int main(int argc, char *argv[])
 		fail(errno, "pthread_sigmask", __LINE__ - 1);
 
 	probe.flags = 0;
+	probe.pool  = NULL;
+	probe.pcache = NULL;
 	probe.pid   = getpid();
 	probe.name  = basename(argv[0]);
         probe.probe_exitcode = 0;
@@ -243,7 +306,7 @@ int main(int argc, char *argv[])
 	/*
 	 * Initialize probe option handlers
 	 */
-#define PROBE_OPTION_INITCOUNT 3
+#define PROBE_OPTION_INITCOUNT 5
 
 	probe.option = oscap_alloc(sizeof(probe_option_t) * PROBE_OPTION_INITCOUNT);
 	probe.optcnt = PROBE_OPTION_INITCOUNT;
@@ -254,6 +317,10 @@ int main(int argc, char *argv[])
 	probe.option[1].handler = &probe_opthandler_rcache;
 	probe.option[2].option  = PROBEOPT_OFFLINE_MODE_SUPPORTED;
 	probe.option[2].handler = &probe_opthandler_offlinemode;
+	probe.option[3].option  = PROBEOPT_WORKER_THREADS;
+	probe.option[3].handler = &probe_opthandler_workers;
+	probe.option[4].option  = PROBEOPT_PERSISTENT_CACHE;
+	probe.option[4].handler = &probe_opthandler_pcache;
 
 	OSCAP_GSYM(probe_optdef) = probe.option;
 	OSCAP_GSYM(probe_optdef_count) = probe.optcnt;
@@ -273,6 +340,12 @@ int main(int argc, char *argv[])
 
 	probe_offline_mode();
 
+	/*
+	 * The directory listing cache shared with the other probes
+	 * has to be opened before changing the root directory.
+	 */
+	fscache_init();
+
 	/*
 	 * Setup offline mode(s)
 	 */
@@ -317,6 +390,24 @@ int main(int argc, char *argv[])
         probe.workers   = rbt_i32_new();
         probe.probe_arg = probe_init();
 
+	/*
+	 * Open the persistent result cache if requested and supported
+	 * by the probe. Not used in offline mode.
+	 */
+	if (pcache_enabled && OSCAP_GSYM(offline_mode) == PROBE_OFFLINE_NONE)
+		probe.pcache = probe_pcache_open(getenv(PROBE_PCACHE_DIR_ENV), probe.name,
+		                                 pcache_depends, pcache_depcnt, pcache_itemdeps);
+
+	/*
+	 * Start the worker threads. The probe may change their number
+	 * in probe_init() using the PROBEOPT_WORKER_THREADS option.
+	 */
+	probe.max_threads = probe_worker_threads != 0 ? probe_worker_threads : probe_workpool_defsize();
+	probe.pool        = probe_workpool_new(probe.max_threads);
+
+	if (probe.pool == NULL)
+		fail(errno, "probe_workpool_new", __LINE__ - 3);
+
 	pthread_attr_init(&th_attr);
 
 	if (pthread_create(&probe.th_input, &th_attr, &probe_input_handler, &probe))
@@ -357,7 +448,13 @@ int main(int argc, char *argv[])
 	probe_ncache_free(probe.ncache);
 	probe_rcache_free(probe.rcache);
         probe_icache_free(probe.icache);
+        probe_pcache_close(probe.pcache);
+
+	while (pcache_depcnt > 0)
+		free(pcache_depends[--pcache_depcnt]);
+	oscap_free(pcache_depends);
 
+        probe_workpool_free(probe.pool);
         rbt_i32_free(probe.workers);
 
         if (probe.sd != -1)
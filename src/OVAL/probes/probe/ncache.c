@@ -129,7 +129,7 @@ SEXP_t *probe_ncache_add (probe_ncache_t *cache, const char *name)
         assume_d (cache != NULL, NULL);
         assume_d (name  != NULL, NULL);
 
-        ref = SEXP_string_new (name, strlen (name));
+        ref = SEXP_string_atom (name);
 
         if (ref == NULL)
                 return (NULL);
@@ -184,7 +184,7 @@ SEXP_t *probe_ncache_ref (probe_ncache_t *cache, const char *name)
         assume_d (name  != NULL, NULL);
 
         if (cache == NULL)
-                return SEXP_string_new (name, strlen (name));
+                return SEXP_string_atom (name);
 
         ref = probe_ncache_get (cache, name);
 
@@ -4,6 +4,8 @@
 #define PROBEOPT_VARREF_HANDLING 0
 #define PROBEOPT_RESULT_CACHING  1
 #define PROBEOPT_OFFLINE_MODE_SUPPORTED 2
+#define PROBEOPT_WORKER_THREADS  3
+#define PROBEOPT_PERSISTENT_CACHE 4
 
 #define PROBE_OPTION_SET 0
 #define PROBE_OPTION_GET 1
@@ -0,0 +1,769 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <libgen.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <sexp.h>
+#include "probe-api.h"
+#include "common/debug_priv.h"
+#include "common/alloc.h"
+#include "common/assume.h"
+#include "entcmp.h"
+#include "pcache.h"
+
+/*
+ * Store layout (host byte order, the store is local to the host):
+ *
+ *  "OSCAPPC1"
+ *  record: struct pcache_rec
+ *          depcnt * (struct pcache_dep, path, NUL, padding to 8 bytes)
+ *          binary frame of the input object
+ *          binary frame of the collected object
+ *  record: ...
+ *
+ * Records are only appended. A record for an already stored object
+ * replaces the older one. The record keys are SEXP_ID_v() values, the
+ * magic changes when they do and a store with another magic is reset.
+ */
+#define PCACHE_MAGIC    "OSCAPPC5"
+#define PCACHE_MAGICLEN 8
+
+struct pcache_rec {
+	uint32_t reclen; /* number of bytes following the header */
+	uint32_t depcnt;
+	uint64_t key;
+};
+
+struct pcache_dep {
+	uint64_t dev;
+	uint64_t ino;
+	int64_t  size; /* -1 if the file doesn't exist */
+	int64_t  mtime;
+	int64_t  mtime_ns;
+	int64_t  ctime;
+	int64_t  ctime_ns;
+	int64_t  atime;
+	int64_t  atime_ns;
+	uint32_t pathlen; /* including the terminating NUL */
+	uint32_t flags;
+};
+
+#define PCACHE_DEP_ATIME 0x0001 /* the access time is a part of the result */
+
+#define PCACHE_ALIGN(n) (((n) + 7) & ~((size_t)7))
+
+static void pcache_dep_stat(struct pcache_dep *dep, const char *path)
+{
+	struct stat st;
+
+	memset(dep, 0, sizeof(struct pcache_dep));
+
+	if (lstat(path, &st) != 0) {
+		dep->size = -1;
+		return;
+	}
+
+	dep->dev   = (uint64_t)st.st_dev;
+	dep->ino   = (uint64_t)st.st_ino;
+	dep->size  = (int64_t)st.st_size;
+	dep->mtime = (int64_t)st.st_mtime;
+	dep->ctime = (int64_t)st.st_ctime;
+	dep->atime = (int64_t)st.st_atime;
+#if defined(__linux__)
+	dep->mtime_ns = (int64_t)st.st_mtim.tv_nsec;
+	dep->ctime_ns = (int64_t)st.st_ctim.tv_nsec;
+	dep->atime_ns = (int64_t)st.st_atim.tv_nsec;
+#endif
+}
+
+typedef struct {
+	char  **path;
+	size_t  count;
+} pcache_paths_t;
+
+static void pcache_paths_add(pcache_paths_t *paths, const char *path)
+{
+	paths->path = oscap_realloc(paths->path, sizeof(char *) * ++paths->count);
+	paths->path[paths->count - 1] = strdup(path);
+}
+
+static void pcache_paths_add_parent(pcache_paths_t *paths, const char *path)
+{
+	char *copy = strdup(path);
+
+	pcache_paths_add(paths, dirname(copy));
+	free(copy);
+}
+
+static int pcache_paths_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char **)a, *(char **)b);
+}
+
+static void pcache_paths_free(pcache_paths_t *paths)
+{
+	while (paths->count > 0)
+		free(paths->path[--paths->count]);
+
+	oscap_free(paths->path);
+	paths->path = NULL;
+}
+
+/*
+ * Add the files in `dir' whose name matches the filename entity `ent'.
+ * Their content is checked by the probe even if no item is collected
+ * (e.g. textfilecontent54 with no matching line).
+ */
+static void pcache_dir_matches(const char *dir, SEXP_t *ent, pcache_paths_t *paths)
+{
+	DIR    *d;
+	struct dirent *de;
+	SEXP_t *name;
+	char   *file;
+
+	if ((d = opendir(dir)) == NULL)
+		return;
+
+	while ((de = readdir(d)) != NULL) {
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		name = SEXP_string_newf("%s", de->d_name);
+
+		if (probe_entobj_cmp(ent, name) == OVAL_RESULT_TRUE) {
+			file = oscap_alloc(strlen(dir) + strlen(de->d_name) + 2);
+			sprintf(file, "%s/%s", dir, de->d_name);
+			pcache_paths_add(paths, file);
+			oscap_free(file);
+		}
+
+		SEXP_free(name);
+	}
+
+	closedir(d);
+}
+
+/*
+ * Objects whose result depends on something else than the object
+ * itself and the files: filters refer to states fetched from the
+ * library and sets to results of other objects.
+ */
+static bool pcache_obj_cacheable(const SEXP_t *obj)
+{
+	SEXP_t *ent;
+
+	if ((ent = probe_obj_getent(obj, "filter", 1)) != NULL ||
+	    (ent = probe_obj_getent(obj, "set", 1)) != NULL)
+	{
+		SEXP_free(ent);
+		return (false);
+	}
+
+	return (true);
+}
+
+/*
+ * Add the files a collected object depends on to `paths'.
+ * Returns -1 if the object can't be reliably invalidated.
+ */
+static int pcache_obj_paths(const SEXP_t *obj, pcache_paths_t *paths)
+{
+	const char *names[] = { "filepath", "path" };
+	SEXP_t *ent, *vals, *val, *attr, *dirs = NULL;
+	char   *str;
+	size_t  i;
+
+	/*
+	 * Files found by recursing into subdirectories can't
+	 * be tracked.
+	 */
+	ent = probe_obj_getent(obj, "behaviors", 1);
+
+	if (ent != NULL) {
+		attr = probe_ent_getattrval(ent, "recurse_direction");
+		SEXP_free(ent);
+
+		if (attr != NULL) {
+			str = SEXP_string_cstr(attr);
+			SEXP_free(attr);
+
+			if (str == NULL || strcmp(str, "none") != 0) {
+				oscap_free(str);
+				return (-1);
+			}
+
+			oscap_free(str);
+		}
+	}
+
+	for (i = 0; i < sizeof names / sizeof names[0]; ++i) {
+		ent = probe_obj_getent(obj, names[i], 1);
+
+		if (ent == NULL)
+			continue;
+
+		if (probe_ent_getoperation(ent, OVAL_OPERATION_EQUALS) != OVAL_OPERATION_EQUALS) {
+			SEXP_free(ent);
+			return (-1);
+		}
+
+		vals = NULL;
+		probe_ent_getvals(ent, &vals);
+		SEXP_free(ent);
+
+		if (vals == NULL)
+			continue;
+
+		SEXP_list_foreach(val, vals) {
+			if (!SEXP_stringp(val))
+				continue;
+
+			str = SEXP_string_cstr(val);
+			pcache_paths_add(paths, str);
+			pcache_paths_add_parent(paths, str);
+			oscap_free(str);
+		}
+
+		if (strcmp(names[i], "path") == 0)
+			dirs = SEXP_ref(vals);
+
+		SEXP_free(vals);
+	}
+
+	if (dirs == NULL)
+		return (0);
+
+	ent = probe_obj_getent(obj, "filename", 1);
+
+	if (ent != NULL) {
+		vals = NULL;
+		probe_ent_getvals(ent, &vals);
+
+		if (vals != NULL && SEXP_list_length(vals) > 0) {
+			SEXP_list_foreach(val, dirs) {
+				if (!SEXP_stringp(val))
+					continue;
+
+				str = SEXP_string_cstr(val);
+				pcache_dir_matches(str, ent, paths);
+				oscap_free(str);
+			}
+		}
+
+		SEXP_free(vals);
+		SEXP_free(ent);
+	}
+
+	SEXP_free(dirs);
+
+	return (0);
+}
+
+static void pcache_item_paths(const SEXP_t *item, pcache_paths_t *paths)
+{
+	SEXP_t *ent, *val;
+	char   *path, *name;
+
+	path = name = NULL;
+
+	if ((ent = probe_item_getent(item, "filepath", 1)) != NULL) {
+		val = probe_ent_getval(ent);
+		path = val != NULL && SEXP_stringp(val) ? SEXP_string_cstr(val) : NULL;
+		SEXP_vfree(ent, val, NULL);
+	} else if ((ent = probe_item_getent(item, "path", 1)) != NULL) {
+		val = probe_ent_getval(ent);
+		path = val != NULL && SEXP_stringp(val) ? SEXP_string_cstr(val) : NULL;
+		SEXP_vfree(ent, val, NULL);
+
+		if (path != NULL && (ent = probe_item_getent(item, "filename", 1)) != NULL) {
+			val = probe_ent_getval(ent);
+			name = val != NULL && SEXP_stringp(val) ? SEXP_string_cstr(val) : NULL;
+			SEXP_vfree(ent, val, NULL);
+		}
+	}
+
+	if (path == NULL)
+		return;
+
+	if (name != NULL && name[0] != '\0') {
+		char *file = oscap_alloc(strlen(path) + strlen(name) + 2);
+
+		sprintf(file, "%s/%s", path, name);
+		pcache_paths_add(paths, file);
+		oscap_free(file);
+	}
+
+	pcache_paths_add(paths, path);
+	pcache_paths_add_parent(paths, path);
+
+	oscap_free(path);
+	oscap_free(name);
+}
+
+static bool pcache_item_atimep(const SEXP_t *item)
+{
+	SEXP_t *ent;
+
+	if ((ent = probe_item_getent(item, "a_time", 1)) == NULL)
+		return (false);
+
+	SEXP_free(ent);
+	return (true);
+}
+
+static char *pcache_frame(const SEXP_t *s_exp, size_t *len)
+{
+	strbuf_t *sb;
+	char     *buf;
+
+	sb = strbuf_new(SEAP_STRBUF_MAX);
+
+	if (SEXP_sbprintf_b(s_exp, sb) != 0) {
+		strbuf_free(sb);
+		return (NULL);
+	}
+
+	*len = strbuf_length(sb);
+	buf  = oscap_alloc(*len);
+	strbuf_copy(sb, buf, *len);
+	strbuf_free(sb);
+
+	return (buf);
+}
+
+/*
+ * Check the record at `off' and return the offset of the next one,
+ * or 0 if the record is not complete.
+ */
+static size_t pcache_rec_next(const uint8_t *map, size_t size, size_t off)
+{
+	struct pcache_rec rec;
+
+	if (size - off < sizeof rec)
+		return (0);
+
+	memcpy(&rec, map + off, sizeof rec);
+
+	if (rec.reclen > size - off - sizeof rec)
+		return (0);
+
+	return (off + sizeof rec + rec.reclen);
+}
+
+static int pcache_reset(const char *path)
+{
+	char tmp[PATH_MAX];
+	int  fd;
+
+	/*
+	 * The store is replaced rather than truncated so that other
+	 * processes which have it mapped are not affected.
+	 */
+	if (snprintf(tmp, sizeof tmp, "%s.%u", path, (unsigned int)getpid()) >= (int)sizeof tmp)
+		return (-1);
+
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+	if (fd < 0)
+		return (-1);
+
+	if (write(fd, PCACHE_MAGIC, PCACHE_MAGICLEN) != PCACHE_MAGICLEN || rename(tmp, path) != 0) {
+		close(fd);
+		unlink(tmp);
+		return (-1);
+	}
+
+	close(fd);
+	return (0);
+}
+
+probe_pcache_t *probe_pcache_open(const char *dir, const char *name,
+                                  char **depends, size_t depcnt, bool itemdeps)
+{
+	probe_pcache_t *cache;
+	char   path[PATH_MAX];
+	struct stat st;
+	char   magic[PCACHE_MAGICLEN];
+	size_t off, next;
+	int    fd;
+
+	if (dir == NULL || name == NULL)
+		return (NULL);
+
+	if (snprintf(path, sizeof path, "%s/%s.cache", dir, name) >= (int)sizeof path) {
+		dE("Persistent cache path too long");
+		return (NULL);
+	}
+
+	if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+		dE("Can't create the persistent cache directory %s: %d, %s", dir, errno, strerror(errno));
+		return (NULL);
+	}
+
+	fd = open(path, O_RDWR | O_APPEND);
+
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < PCACHE_MAGICLEN || st.st_size > PROBE_PCACHE_MAXSIZE ||
+	    pread(fd, magic, PCACHE_MAGICLEN, 0) != PCACHE_MAGICLEN || memcmp(magic, PCACHE_MAGIC, PCACHE_MAGICLEN) != 0)
+	{
+		if (fd >= 0)
+			close(fd);
+
+		dI("Creating a new persistent cache store: %s", path);
+
+		if (pcache_reset(path) != 0 ||
+		    (fd = open(path, O_RDWR | O_APPEND)) < 0 || fstat(fd, &st) != 0)
+		{
+			dE("Can't open the persistent cache store %s: %d, %s", path, errno, strerror(errno));
+
+			if (fd >= 0)
+				close(fd);
+
+			return (NULL);
+		}
+	}
+
+	cache = oscap_talloc(probe_pcache_t);
+	cache->fd       = fd;
+	cache->map_size = (size_t)st.st_size;
+	cache->map      = mmap(NULL, cache->map_size, PROT_READ, MAP_SHARED, fd, 0);
+	cache->index    = rbt_i64_new();
+	cache->depends  = depends;
+	cache->depcnt   = depcnt;
+	cache->itemdeps = itemdeps;
+
+	if (cache->map == MAP_FAILED || memcmp(cache->map, PCACHE_MAGIC, PCACHE_MAGICLEN) != 0) {
+		dE("Invalid persistent cache store: %s", path);
+
+		if (cache->map != MAP_FAILED)
+			munmap(cache->map, cache->map_size);
+
+		rbt_i64_free(cache->index);
+		close(fd);
+		oscap_free(cache);
+
+		return (NULL);
+	}
+
+	pthread_mutex_init(&cache->lock, NULL);
+
+	/*
+	 * Index the records. An incomplete record at the end (being
+	 * written by another process) is ignored.
+	 */
+	for (off = PCACHE_MAGICLEN; (next = pcache_rec_next(cache->map, cache->map_size, off)) != 0; off = next) {
+		struct pcache_rec rec;
+		size_t *offp;
+
+		memcpy(&rec, cache->map + off, sizeof rec);
+
+		if (rbt_i64_get(cache->index, (int64_t)rec.key, (void **)&offp) == 0) {
+			*offp = off;
+		} else {
+			offp  = oscap_talloc(size_t);
+			*offp = off;
+
+			if (rbt_i64_add(cache->index, (int64_t)rec.key, offp, NULL) != 0)
+				oscap_free(offp);
+		}
+	}
+
+	dI("Persistent cache %s: %zu objects", path, rbt_i64_size(cache->index));
+
+	return (cache);
+}
+
+/*
+ * Check that none of the dependencies of the record changed and
+ * return the offset of the first frame, or 0.
+ */
+static size_t pcache_rec_valid(probe_pcache_t *cache, size_t off)
+{
+	struct pcache_rec rec;
+	struct pcache_dep dep, cur;
+	size_t end;
+	const char *path;
+
+	memcpy(&rec, cache->map + off, sizeof rec);
+	end  = off + sizeof rec + rec.reclen;
+	off += sizeof rec;
+
+	for (; rec.depcnt > 0; --rec.depcnt) {
+		if (end - off < sizeof dep)
+			return (0);
+
+		memcpy(&dep, cache->map + off, sizeof dep);
+		off += sizeof dep;
+
+		if (dep.pathlen == 0 || dep.pathlen > end - off)
+			return (0);
+
+		path = (const char *)cache->map + off;
+
+		if (path[dep.pathlen - 1] != '\0')
+			return (0);
+
+		off += PCACHE_ALIGN(dep.pathlen);
+
+		pcache_dep_stat(&cur, path);
+
+		if (cur.size != dep.size || cur.ino != dep.ino || cur.dev != dep.dev ||
+		    cur.mtime != dep.mtime || cur.mtime_ns != dep.mtime_ns ||
+		    cur.ctime != dep.ctime || cur.ctime_ns != dep.ctime_ns ||
+		    ((dep.flags & PCACHE_DEP_ATIME) &&
+		     (cur.atime != dep.atime || cur.atime_ns != dep.atime_ns)))
+		{
+			dD("Persistent cache: %s changed", path);
+			return (0);
+		}
+
+		if (off > end)
+			return (0);
+	}
+
+	return (off);
+}
+
+SEXP_t *probe_pcache_get(probe_pcache_t *cache, probe_icache_t *icache, const SEXP_t *obj)
+{
+	SEXP_t *s_obj, *s_cobj, *cobj, *msgs, *mask, *items, *item;
+	size_t *offp, off, end, used;
+	struct pcache_rec rec;
+
+	if (cache == NULL || !pcache_obj_cacheable(obj))
+		return (NULL);
+
+	if (rbt_i64_get(cache->index, (int64_t)SEXP_ID_v(obj), (void **)&offp) != 0)
+		return (NULL);
+
+	memcpy(&rec, cache->map + *offp, sizeof rec);
+	end = *offp + sizeof rec + rec.reclen;
+
+	if ((off = pcache_rec_valid(cache, *offp)) == 0)
+		return (NULL);
+
+	s_obj = SEXP_bin_parse(cache->map + off, end - off, &used);
+
+	if (s_obj == NULL)
+		return (NULL);
+
+	/* hash collision */
+	if (!SEXP_deepcmp(s_obj, obj)) {
+		SEXP_free(s_obj);
+		return (NULL);
+	}
+
+	SEXP_free(s_obj);
+	off += used;
+
+	s_cobj = SEXP_bin_parse(cache->map + off, end - off, &used);
+
+	if (s_cobj == NULL)
+		return (NULL);
+
+	/*
+	 * The stored items have IDs assigned by a different process.
+	 * Pass them through the item cache to get new unique IDs.
+	 */
+	msgs  = probe_cobj_get_msgs(s_cobj);
+	mask  = probe_cobj_get_mask(s_cobj);
+	items = probe_cobj_get_items(s_cobj);
+	cobj  = probe_cobj_new(probe_cobj_get_flag(s_cobj), msgs, NULL, mask);
+
+	SEXP_list_foreach(item, items) {
+		if (probe_icache_add(icache, cobj, SEXP_ref(item)) != 0) {
+			SEXP_free(item);
+			SEXP_vfree(msgs, mask, items, s_cobj, cobj, NULL);
+			return (NULL);
+		}
+	}
+
+	SEXP_vfree(msgs, mask, items, s_cobj, NULL);
+
+	if (probe_icache_nop(icache) != 0) {
+		SEXP_free(cobj);
+		return (NULL);
+	}
+
+	dD("Persistent cache HIT");
+
+	return (cobj);
+}
+
+int probe_pcache_add(probe_pcache_t *cache, const SEXP_t *obj, const SEXP_t *cobj)
+{
+	pcache_paths_t paths = { NULL, 0 };
+	struct pcache_rec  rec;
+	struct pcache_dep *dep;
+	SEXP_t *items, *item;
+	char   *f_obj, *f_cobj;
+	size_t  l_obj, l_cobj, i, n, deplen;
+	uint32_t flags = 0;
+	uint8_t *buf, *p;
+	int     ret = -1;
+
+	if (cache == NULL)
+		return (-1);
+
+	if (!pcache_obj_cacheable(obj))
+		return (0);
+
+	switch (probe_cobj_get_flag(cobj)) {
+	case SYSCHAR_FLAG_COMPLETE:
+	case SYSCHAR_FLAG_DOES_NOT_EXIST:
+		break;
+	default:
+		return (0);
+	}
+
+	for (i = 0; i < cache->depcnt; ++i)
+		pcache_paths_add(&paths, cache->depends[i]);
+
+	if (cache->itemdeps) {
+		if (pcache_obj_paths(obj, &paths) != 0) {
+			pcache_paths_free(&paths);
+			return (0);
+		}
+
+		items = probe_cobj_get_items(cobj);
+
+		SEXP_list_foreach(item, items) {
+			pcache_item_paths(item, &paths);
+
+			/*
+			 * Reading a file changes only its access time, the
+			 * objects which don't report it needn't check it.
+			 */
+			if (!(flags & PCACHE_DEP_ATIME) && pcache_item_atimep(item))
+				flags |= PCACHE_DEP_ATIME;
+		}
+
+		SEXP_free(items);
+	}
+
+	/* remove duplicates */
+	if (paths.count > 1) {
+		qsort(paths.path, paths.count, sizeof(char *), pcache_paths_cmp);
+
+		for (i = 1, n = 1; i < paths.count; ++i) {
+			if (strcmp(paths.path[i], paths.path[n - 1]) == 0)
+				free(paths.path[i]);
+			else
+				paths.path[n++] = paths.path[i];
+		}
+
+		paths.count = n;
+	}
+
+	f_obj  = pcache_frame(obj, &l_obj);
+	f_cobj = pcache_frame(cobj, &l_cobj);
+
+	if (f_obj == NULL || f_cobj == NULL)
+		goto cleanup;
+
+	for (i = 0, deplen = 0; i < paths.count; ++i)
+		deplen += sizeof(struct pcache_dep) + PCACHE_ALIGN(strlen(paths.path[i]) + 1);
+
+	if (deplen + l_obj + l_cobj > UINT32_MAX)
+		goto cleanup;
+
+	rec.reclen = (uint32_t)(deplen + l_obj + l_cobj);
+	rec.depcnt = (uint32_t)paths.count;
+	rec.key    = SEXP_ID_v(obj);
+
+	buf = oscap_calloc(1, sizeof rec + rec.reclen);
+	p   = buf;
+
+	memcpy(p, &rec, sizeof rec);
+	p += sizeof rec;
+
+	for (i = 0; i < paths.count; ++i) {
+		dep = (struct pcache_dep *)p;
+		pcache_dep_stat(dep, paths.path[i]);
+		dep->flags   = flags;
+		dep->pathlen = (uint32_t)strlen(paths.path[i]) + 1;
+		p += sizeof(struct pcache_dep);
+		memcpy(p, paths.path[i], dep->pathlen);
+		p += PCACHE_ALIGN(dep->pathlen);
+	}
+
+	memcpy(p, f_obj, l_obj);
+	p += l_obj;
+	memcpy(p, f_cobj, l_cobj);
+
+	/*
+	 * One write per record, other processes may append to the
+	 * store at the same time.
+	 */
+	pthread_mutex_lock(&cache->lock);
+
+	if (flock(cache->fd, LOCK_EX) == 0) {
+		if (write(cache->fd, buf, sizeof rec + rec.reclen) == (ssize_t)(sizeof rec + rec.reclen))
+			ret = 0;
+		else
+			dW("Can't write to the persistent cache: %d, %s", errno, strerror(errno));
+
+		flock(cache->fd, LOCK_UN);
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+	oscap_free(buf);
+cleanup:
+	oscap_free(f_obj);
+	oscap_free(f_cobj);
+	pcache_paths_free(&paths);
+
+	return (ret);
+}
+
+static void pcache_free_node(struct rbt_i64_node *n)
+{
+	oscap_free(n->data);
+}
+
+void probe_pcache_close(probe_pcache_t *cache)
+{
+	if (cache == NULL)
+		return;
+
+	munmap(cache->map, cache->map_size);
+	rbt_i64_free_cb(cache->index, &pcache_free_node);
+	pthread_mutex_destroy(&cache->lock);
+	close(cache->fd);
+	oscap_free(cache);
+}
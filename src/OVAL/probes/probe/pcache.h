@@ -0,0 +1,81 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+#ifndef PCACHE_H
+#define PCACHE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sexp.h>
+#include "../SEAP/generic/rbt/rbt.h"
+#include "icache.h"
+
+/*
+ * Persistent result cache. Collected objects are stored in a file
+ * named after the probe in the directory given by the environment
+ * variable below and reused by later probe processes as long as the
+ * files the objects depend on did not change.
+ */
+#define PROBE_PCACHE_DIR_ENV "OSCAP_PROBE_CACHE_DIR"
+
+#ifndef PROBE_PCACHE_MAXSIZE
+#define PROBE_PCACHE_MAXSIZE (64 * 1024 * 1024) /**< the store is discarded when it gets larger */
+#endif
+
+typedef struct {
+	pthread_mutex_t lock;
+	int      fd;
+	uint8_t *map;      /**< the store as it was when it was opened */
+	size_t   map_size;
+	rbt_t   *index;    /**< object hash -> record offset */
+
+	char   **depends;  /**< files all the stored objects depend on */
+	size_t   depcnt;
+	bool     itemdeps; /**< objects depend on the files their items refer to */
+} probe_pcache_t;
+
+/**
+ * Open the persistent result cache of the probe `name' in `dir'.
+ * Objects will be invalidated when one of the `depcnt' files in
+ * `depends' changes and, if `itemdeps' is true, when one of the
+ * files referred to by the items changes.
+ * @return NULL if the cache can't be used
+ */
+probe_pcache_t *probe_pcache_open(const char *dir, const char *name,
+                                  char **depends, size_t depcnt, bool itemdeps);
+
+/**
+ * Get a collected object for the input object `obj'. The items are
+ * passed through the item cache so that they get new unique IDs.
+ * @return NULL if there is no valid collected object for `obj'
+ */
+SEXP_t *probe_pcache_get(probe_pcache_t *cache, probe_icache_t *icache, const SEXP_t *obj);
+
+/**
+ * Store the collected object `cobj' for the input object `obj'.
+ * Objects which can't be reliably invalidated are not stored.
+ */
+int probe_pcache_add(probe_pcache_t *cache, const SEXP_t *obj, const SEXP_t *cobj);
+
+void probe_pcache_close(probe_pcache_t *cache);
+
+#endif /* PCACHE_H */
@@ -32,10 +32,13 @@
 #include "ncache.h"
 #include "rcache.h"
 #include "icache.h"
+#include "pcache.h"
 #include "probe-common.h"
 #include "option.h"
 #include "common/util.h"
 
+typedef struct probe_workpool probe_workpool_t;
+
 typedef struct {
 	pthread_rwlock_t rwlock;
 	uint32_t         flags;
@@ -53,22 +56,44 @@ typedef struct {
 	pthread_t th_signal;
 
         rbt_t    *workers;
+        probe_workpool_t *pool; /**< worker threads */
         uint32_t  max_threads;
         uint32_t  max_chdepth;
 
 	probe_rcache_t *rcache; /**< probe result cache */
 	probe_ncache_t *ncache; /**< probe name cache */
         probe_icache_t *icache; /**< probe item cache */
+        probe_pcache_t *pcache; /**< persistent result cache (NULL if disabled) */
 
 	probe_option_t *option; /**< probe option handlers */
 	size_t          optcnt; /**< number of defined options */
 } probe_t;
 
+/*
+ * Chunked reply state. Items are sent to the library in partial
+ * replies while the probe is still collecting them and they're
+ * dropped once they're sent. Only the statuses of the sent items
+ * are counted, so that the flag of the collected object can be
+ * computed.
+ */
+typedef struct {
+        SEAP_CTX_t *SEAP_ctx;
+        int         sd;
+        SEAP_msg_t *msg_in;  /**< request being answered */
+        uint32_t    nsent;   /**< number of items already sent to the library */
+        uint32_t    pending; /**< items collected since the last flush */
+        uint32_t    error_cnt;         /**< sent items with the error status */
+        uint32_t    exists_cnt;        /**< sent items with the exists status */
+        uint32_t    not_collected_cnt; /**< sent items with the not collected status */
+} probe_chunk_t;
+
 struct probe_ctx {
         SEXP_t         *probe_in;  /**< S-exp representation of the input object */
         SEXP_t         *probe_out; /**< collected object */
         SEXP_t         *filters;   /**< object filters (OVAL 5.8 and higher) */
         probe_icache_t *icache;    /**< item cache */
+        probe_chunk_t  *chunk;     /**< chunked reply state (NULL if disabled) */
+        SEXP_arena_t   *arena;     /**< allocator of the S-exp values created by the request */
 };
 
 typedef enum {
@@ -50,8 +50,6 @@ static int __abort_cb(void *n, void *u)
 	struct rbt_i32_node *node = (struct rbt_i32_node *)n;
 	probe_worker_t      *thr  = (probe_worker_t *)(node->data);
 
-        pthread_cancel(thr->tid);
-
 	coll->thr = oscap_realloc(coll->thr, sizeof(SEAP_msg_t *) * ++coll->cnt);
 	coll->thr[coll->cnt - 1] = thr;
 
@@ -121,40 +119,19 @@ void *probe_signal_handler(void *arg)
 
                         pthread_cancel(probe->th_input);
 
-			/* collect IDs and cancel threads */
-			rbt_walk_inorder2(probe->workers, __abort_cb, &coll, 0);
+			/* cancel the worker threads */
+			probe_workpool_cancel(probe->pool);
 
 			/*
-			 * Wait till all threads are canceled (they may temporarily disable
-			 * cancelability), but at most 60 seconds per thread.
+			 * Collect the requests being evaluated or still queued. If some
+			 * of the threads didn't exit in time, the memory is leaked rather
+			 * than freed under their hands. We are in the process of shutting
+			 * down the whole probe anyway.
 			 */
+			if (probe->pool == NULL || probe->pool->count == 0)
+				rbt_walk_inorder2(probe->workers, __abort_cb, &coll, 0);
+
 			for (; coll.cnt > 0; --coll.cnt) {
-				probe_worker_t *thr = coll.thr[coll.cnt - 1];
-#if defined(HAVE_PTHREAD_TIMEDJOIN_NP) && defined(HAVE_CLOCK_GETTIME)
-				struct timespec j_tm;
-
-				if (clock_gettime(CLOCK_REALTIME, &j_tm) == -1) {
-					dE("clock_gettime(CLOCK_REALTIME): %d, %s.", errno, strerror(errno));
-					continue;
-				}
-
-				j_tm.tv_sec += 60;
-
-				if ((errno = pthread_timedjoin_np(thr->tid, NULL, &j_tm)) != 0) {
-					dE("[%llu] pthread_timedjoin_np: %d, %s.", (uint64_t)thr->sid, errno, strerror(errno));
-					/*
-					 * Memory will be leaked here by continuing to the next thread. However, we are in the
-					 * process of shutting down the whole probe. We're just nice and gave the probe_main()
-					 * thread a chance to finish it's critical section which shouldn't take that long...
-					 */
-					continue;
-				}
-#else
-				if ((errno = pthread_join(thr->tid, NULL)) != 0) {
-					dE("pthread_join: %d, %s.", errno, strerror(errno));
-					continue;
-				}
-#endif
 				SEAP_msg_free(coll.thr[coll.cnt - 1]->msg);
                                 oscap_free(coll.thr[coll.cnt - 1]);
 			}
@@ -29,6 +29,8 @@
 #include <string.h>
 #include <pthread.h>
 #include <errno.h>
+#include <unistd.h>
+#include <time.h>
 
 #include "probe-api.h"
 #include "common/debug_priv.h"
@@ -36,6 +38,7 @@
 #include "entcmp.h"
 
 #include "worker.h"
+#include "chunk.h"
 
 extern bool  OSCAP_GSYM(varref_handling);
 extern void *OSCAP_GSYM(probe_arg);
@@ -44,16 +47,19 @@ void *probe_worker_runfn(void *arg)
 {
 	probe_pwpair_t *pair = (probe_pwpair_t *)arg;
 
-	SEXP_t *probe_res, *obj, *oid;
+	SEXP_t *probe_res, *probe_rep, *obj, *oid;
 	int     probe_ret;
+	probe_chunk_t *chunk;
 
-#if defined(HAVE_PTHREAD_SETNAME_NP)
-	pthread_setname_np(pthread_self(), "probe_worker");
-#endif
 	dD("handling SEAP message ID %u", pair->pth->sid);
 	//
 	probe_ret = -1;
-	probe_res = pair->pth->msg_handler(pair->probe, pair->pth->msg, &probe_ret);
+	chunk = NULL;
+
+	if (probe_chunk_requested(pair->pth->msg))
+		chunk = probe_chunk_new(pair->probe, pair->pth->msg);
+
+	probe_res = pair->pth->msg_handler(pair->probe, pair->pth->msg, chunk, &probe_ret);
 	//
 	dD("handler result = %p, return code = %d", probe_res, probe_ret);
 
@@ -68,6 +74,7 @@ void *probe_worker_runfn(void *arg)
 
                 SEAP_msg_free(pair->pth->msg);
                 SEXP_free(probe_res);
+                probe_chunk_free(chunk);
                 oscap_free(pair);
 
                 return (NULL);
@@ -78,6 +85,8 @@ void *probe_worker_runfn(void *arg)
 
 		obj = SEAP_msg_get(pair->pth->msg);
 		oid = probe_obj_getattrval(obj, "id");
+
+                probe_rep = SEXP_ref(probe_res);
                 items = probe_cobj_get_items(probe_res);
 
                 if (items != NULL) {
@@ -85,10 +94,20 @@ void *probe_worker_runfn(void *arg)
                         SEXP_free(items);
                 }
 
-		if (probe_rcache_sexp_add(pair->probe->rcache, oid, probe_res) != 0) {
-			/* TODO */
-			abort();
-		}
+                /*
+                 * The items sent in partial replies are gone, so the
+                 * result isn't complete and can't be cached. A repeated
+                 * request evaluates the object again.
+                 */
+                if (chunk == NULL || chunk->nsent == 0) {
+                        if (probe_rcache_sexp_add(pair->probe->rcache, oid, probe_res) != 0) {
+                                /* TODO */
+                                abort();
+                        }
+
+                        if (probe_ret == 0 && pair->probe->pcache != NULL)
+                                probe_pcache_add(pair->probe->pcache, obj, probe_res);
+                }
 
 		SEXP_vfree(obj, oid, NULL);
 	}
@@ -102,37 +121,37 @@ void *probe_worker_runfn(void *arg)
 			int ret = errno;
 
 			dE("An error ocured while sending error status. errno=%u, %s.", errno, strerror(errno));
-			SEXP_free(probe_res);
+			SEXP_vfree(probe_res, probe_rep, NULL);
 
 			/* FIXME */
 			exit(ret);
 		}
-		SEXP_free(probe_res);
+		SEXP_vfree(probe_res, probe_rep, NULL);
 	} else {
 		SEAP_msg_t *seap_reply;
 		/*
 		 * OK, the probe actually returned something, let's send it to the library.
 		 */
 		seap_reply = SEAP_msg_new();
-		SEAP_msg_set(seap_reply, probe_res);
+		SEAP_msg_set(seap_reply, probe_rep);
 
 		if (SEAP_reply(pair->probe->SEAP_ctx, pair->probe->sd, seap_reply, pair->pth->msg) == -1) {
 			int ret = errno;
 
 			SEAP_msg_free(seap_reply);
-			SEXP_free(probe_res);
+			SEXP_vfree(probe_res, probe_rep, NULL);
 
 			exit(ret);
 		}
 
 		SEAP_msg_free(seap_reply);
-                SEXP_free(probe_res);
+                SEXP_vfree(probe_res, probe_rep, NULL);
 	}
 
+        probe_chunk_free(chunk);
         SEAP_msg_free(pair->pth->msg);
         oscap_free(pair->pth);
 	oscap_free(pair);
-	pthread_detach(pthread_self());
 
 	return (NULL);
 }
@@ -149,6 +168,269 @@ probe_worker_t *probe_worker_new(void)
 	return (pth);
 }
 
+void probe_mutex_unlock(void *arg)
+{
+	pthread_mutex_unlock((pthread_mutex_t *)arg);
+}
+
+static void *probe_workpool_runfn(void *arg)
+{
+	probe_workpool_t *pool = (probe_workpool_t *)arg;
+	probe_pwpair_t   *pair;
+
+#if defined(HAVE_PTHREAD_SETNAME_NP)
+	pthread_setname_np(pthread_self(), "probe_worker");
+#endif
+	for (;;) {
+		if (pthread_mutex_lock(&pool->mutex) != 0) {
+			dE("Can't lock the work queue mutex");
+			return (NULL);
+		}
+
+		/*
+		 * Waiting for a request is the only place where an idle
+		 * worker thread can be canceled.
+		 */
+		pthread_cleanup_push(probe_mutex_unlock, (void *)&pool->mutex);
+
+		++pool->idle;
+
+		while (pool->head == NULL)
+			pthread_cond_wait(&pool->notempty, &pool->mutex);
+
+		--pool->idle;
+
+		pair = pool->head;
+		pool->head = pair->next;
+
+		if (pool->head == NULL)
+			pool->tail = NULL;
+
+		pthread_cleanup_pop(1);
+
+		pair->next = NULL;
+		pair->pth->tid = pthread_self();
+
+		probe_worker_runfn(pair);
+	}
+
+	return (NULL);
+}
+
+uint32_t probe_workpool_defsize(void)
+{
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (ncpu < 1)
+		return (1);
+	if (ncpu > PROBE_WORKER_DEFAULT_MAX_THREADS)
+		return (PROBE_WORKER_DEFAULT_MAX_THREADS);
+
+	return ((uint32_t)ncpu);
+}
+
+probe_workpool_t *probe_workpool_new(uint32_t count)
+{
+	probe_workpool_t *pool;
+
+	if (count == 0)
+		count = probe_workpool_defsize();
+
+	pool = oscap_talloc(probe_workpool_t);
+	pool->head   = NULL;
+	pool->tail   = NULL;
+	pool->thread = oscap_alloc(sizeof(pthread_t) * count);
+	pool->count  = 0;
+	pool->size   = count;
+	pool->idle   = 0;
+	pool->canceled = false;
+
+	if (pthread_mutex_init(&pool->mutex, NULL) != 0) {
+		dE("Can't initialize the work queue mutex: %d, %s", errno, strerror(errno));
+		goto fail_mutex;
+	}
+
+	if (pthread_cond_init(&pool->notempty, NULL) != 0) {
+		dE("Can't initialize the work queue condition variable: %d, %s", errno, strerror(errno));
+		goto fail_cond;
+	}
+
+	for (; pool->count < count; ++pool->count) {
+		if ((errno = pthread_create(&pool->thread[pool->count], NULL,
+		                            &probe_workpool_runfn, pool)) != 0)
+		{
+			dE("Cannot start a new worker thread: %d, %s.", errno, strerror(errno));
+
+			if (pool->count > 0)
+				break;
+
+			pthread_cond_destroy(&pool->notempty);
+			goto fail_cond;
+		}
+	}
+
+	dD("Started %u worker threads", pool->count);
+
+	return (pool);
+fail_cond:
+	pthread_mutex_destroy(&pool->mutex);
+fail_mutex:
+	oscap_free(pool->thread);
+	oscap_free(pool);
+
+	return (NULL);
+}
+
+int probe_workpool_add(probe_workpool_t *pool, probe_pwpair_t *pair)
+{
+	if (pthread_mutex_lock(&pool->mutex) != 0) {
+		dE("Can't lock the work queue mutex");
+		return (-1);
+	}
+
+	pair->next = NULL;
+
+	if (pool->tail != NULL)
+		pool->tail->next = pair;
+	else
+		pool->head = pair;
+
+	pool->tail = pair;
+
+	if (pthread_cond_signal(&pool->notempty) != 0) {
+		dE("Can't signal the work queue condition variable");
+	}
+
+	if (pthread_mutex_unlock(&pool->mutex) != 0) {
+		dE("Can't unlock the work queue mutex");
+		abort();
+	}
+
+	return (0);
+}
+
+void probe_workpool_block(probe_workpool_t *pool)
+{
+	if (pool == NULL)
+		return;
+
+	if (pthread_mutex_lock(&pool->mutex) != 0) {
+		dE("Can't lock the work queue mutex");
+		return;
+	}
+
+	if (pool->idle == 0 && !pool->canceled) {
+		if (pool->count == pool->size) {
+			pool->size  *= 2;
+			pool->thread = oscap_realloc(pool->thread, sizeof(pthread_t) * pool->size);
+		}
+
+		if ((errno = pthread_create(&pool->thread[pool->count], NULL,
+		                            &probe_workpool_runfn, pool)) != 0)
+		{
+			dE("Cannot start a new worker thread: %d, %s.", errno, strerror(errno));
+		} else {
+			++pool->count;
+			dD("Started an extra worker thread, %u threads", pool->count);
+		}
+	}
+
+	if (pthread_mutex_unlock(&pool->mutex) != 0) {
+		dE("Can't unlock the work queue mutex");
+		abort();
+	}
+}
+
+void probe_workpool_cancel(probe_workpool_t *pool)
+{
+	uint32_t i, alive;
+
+	if (pool == NULL)
+		return;
+
+	/*
+	 * No more threads are started by probe_workpool_block() from now
+	 * on, so the `thread' array can be walked without the lock below.
+	 */
+	if (pthread_mutex_lock(&pool->mutex) != 0) {
+		dE("Can't lock the work queue mutex");
+		return;
+	}
+
+	pool->canceled = true;
+
+	for (i = 0; i < pool->count; ++i)
+		pthread_cancel(pool->thread[i]);
+
+	if (pthread_mutex_unlock(&pool->mutex) != 0) {
+		dE("Can't unlock the work queue mutex");
+		abort();
+	}
+
+	/*
+	 * Wait till all threads are canceled (they may temporarily disable
+	 * cancelability), but at most 60 seconds per thread.
+	 */
+	for (i = 0, alive = 0; i < pool->count; ++i) {
+#if defined(HAVE_PTHREAD_TIMEDJOIN_NP) && defined(HAVE_CLOCK_GETTIME)
+		struct timespec j_tm;
+
+		if (clock_gettime(CLOCK_REALTIME, &j_tm) == -1) {
+			dE("clock_gettime(CLOCK_REALTIME): %d, %s.", errno, strerror(errno));
+			continue;
+		}
+
+		j_tm.tv_sec += 60;
+
+		if ((errno = pthread_timedjoin_np(pool->thread[i], NULL, &j_tm)) != 0) {
+			dE("pthread_timedjoin_np: %d, %s.", errno, strerror(errno));
+			pool->thread[alive++] = pool->thread[i];
+			continue;
+		}
+#else
+		if ((errno = pthread_join(pool->thread[i], NULL)) != 0) {
+			dE("pthread_join: %d, %s.", errno, strerror(errno));
+			pool->thread[alive++] = pool->thread[i];
+			continue;
+		}
+#endif
+	}
+
+	pool->count = alive;
+}
+
+void probe_workpool_free(probe_workpool_t *pool)
+{
+	probe_pwpair_t *pair;
+
+	if (pool == NULL)
+		return;
+
+	if (pool->count > 0) {
+		/*
+		 * Some threads didn't exit in time. The pool is leaked, but we
+		 * are in the process of shutting down the whole probe anyway.
+		 */
+		dW("%u worker threads are still running", pool->count);
+		return;
+	}
+
+	/*
+	 * The queued requests are owned by the `workers' tree
+	 * of the probe, only the queue entries are freed here.
+	 */
+	while (pool->head != NULL) {
+		pair = pool->head;
+		pool->head = pair->next;
+		oscap_free(pair);
+	}
+
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_cond_destroy(&pool->notempty);
+	oscap_free(pool->thread);
+	oscap_free(pool);
+}
+
 struct probe_varref_ctx {
 	SEXP_t *pi2;
 	unsigned int ent_cnt;
@@ -370,6 +652,11 @@ static SEXP_t *probe_obj_eval(probe_t *probe, SEXP_t *id)
 {
 	SEXP_t *res, *rid;
 
+	/*
+	 * The library sends the object back to this probe and it's queued
+	 * in the pool while this thread waits for it.
+	 */
+	probe_workpool_block(probe->pool);
 	res = SEAP_cmd_exec(probe->SEAP_ctx, probe->sd, 0, PROBECMD_OBJ_EVAL, id, SEAP_CMDTYPE_SYNC, NULL, NULL);
 
 	rid = SEXP_list_first(res);
@@ -893,7 +1180,7 @@ static SEXP_t *probe_set_eval(probe_t *probe, SEXP_t *set, size_t depth)
  * @param msg_in SEAP message with the request which contains the object to be evaluated
  * @param ret pointer to the return code storage
  */
-SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
+SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, probe_chunk_t *chunk, int *ret)
 {
 	SEXP_t *probe_in, *probe_out, *set;
 
@@ -921,9 +1208,13 @@ SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
 	} else {
                 struct probe_ctx pctx;
 		SEXP_t *varrefs, *mask;
+		SEXP_arena_t *prev_arena;
 
 		/* simple object */
                 pctx.icache  = probe->icache;
+                pctx.chunk   = NULL;
+                pctx.arena   = SEXP_arena_new();
+
 		pctx.filters = probe_prepare_filters(probe, probe_in);
                 mask = probe_obj_getmask(probe_in);
 
@@ -941,6 +1232,7 @@ SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
 			
                         pctx.probe_in  = probe_in;
                         pctx.probe_out = probe_out;
+                        pctx.chunk     = chunk;
 
                         /*
                          * Run the main function of the probe implementation. Set thread
@@ -949,7 +1241,14 @@ SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
                          */
 			int __unused_oldstate;
 			pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &__unused_oldstate);
+			/*
+			 * Values created by the probe implementation are carved out
+			 * of the request's arena. The items and the collected object
+			 * are copied off the arena when they're cached.
+			 */
+			prev_arena = SEXP_arena_switch(pctx.arena);
 			*ret = probe_main(&pctx, probe->probe_arg);
+			SEXP_arena_switch(prev_arena);
 			pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, &__unused_oldstate);
 
                         /*
@@ -957,7 +1256,10 @@ SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
                          */
                         probe_icache_nop(probe->icache);
 
-			probe_cobj_compute_flag(probe_out);
+                        if (chunk != NULL)
+                                probe_chunk_compute_flag(chunk, probe_out);
+                        else
+                                probe_cobj_compute_flag(probe_out);
 		} else {
 			/*
 			 * there are variable references in the object.
@@ -969,6 +1271,7 @@ SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
 
 			if (probe_varref_create_ctx(probe_in, varrefs, &ctx) != 0) {
 				SEXP_vfree(varrefs, pctx.filters, probe_in, mask, NULL);
+				SEXP_arena_free(pctx.arena);
 				*ret = PROBE_EUNKNOWN;
 				return (NULL);
 			}
@@ -987,7 +1290,9 @@ SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
                                 /*
                                  * Run the main function of the probe implementation
                                  */
+				prev_arena = SEXP_arena_switch(pctx.arena);
 				*ret = probe_main(&pctx, probe->probe_arg);
+				SEXP_arena_switch(prev_arena);
 
                                 /*
                                  * Synchronize
@@ -1006,6 +1311,7 @@ SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
 		}
 
                 SEXP_free(pctx.filters);
+                SEXP_arena_free(pctx.arena);
 	}
 
 	SEXP_free(probe_in);
@@ -25,6 +25,7 @@
 #include <seap.h>
 #include <sexp.h>
 #include <pthread.h>
+#include <stdbool.h>
 #include "probe.h"
 
 #ifndef PROBE_WORKER_DEFAULT_MAX_THREADS
@@ -38,17 +39,76 @@
 typedef struct {
 	SEAP_msgid_t sid; /**< SEAP message handled by this thread */
 	pthread_t    tid; /**< thread ID */
-	SEXP_t * (*msg_handler)(probe_t *, SEAP_msg_t *, int *); /**< input message (object) handler */
+	SEXP_t * (*msg_handler)(probe_t *, SEAP_msg_t *, probe_chunk_t *, int *); /**< input message (object) handler */
 	SEAP_msg_t  *msg; /**< the message being handled */
 } probe_worker_t;
 
-typedef struct {
+typedef struct probe_pwpair {
 	probe_t        *probe;
 	probe_worker_t *pth;
+	struct probe_pwpair *next; /**< next request in the work queue */
 } probe_pwpair_t;
 
+/*
+ * Worker thread pool. Requests which weren't answered from the result
+ * cache are queued and evaluated by a fixed number of worker threads.
+ */
+struct probe_workpool {
+	pthread_mutex_t  mutex;
+	pthread_cond_t   notempty;
+	probe_pwpair_t  *head;    /**< first queued request */
+	probe_pwpair_t  *tail;    /**< last queued request */
+	pthread_t       *thread;  /**< worker thread IDs */
+	uint32_t         count;   /**< number of worker threads */
+	uint32_t         size;    /**< allocated size of the `thread' array */
+	uint32_t         idle;    /**< number of threads waiting for a request */
+	bool             canceled;
+};
+
 probe_worker_t *probe_worker_new(void);
+
+/**
+ * Unlock the mutex pointed to by `arg'. To be used as a cleanup handler
+ * of the threads which can be canceled while waiting on a condition.
+ */
+void probe_mutex_unlock(void *arg);
 void *probe_worker_runfn(void *arg);
-SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret);
+
+/**
+ * Start a pool of `count' worker threads.
+ */
+probe_workpool_t *probe_workpool_new(uint32_t count);
+
+/**
+ * Queue a request for evaluation by the worker threads.
+ * @return 0 on success, -1 on error
+ */
+int probe_workpool_add(probe_workpool_t *pool, probe_pwpair_t *pair);
+
+/**
+ * Called by a worker thread before it blocks waiting for the result
+ * of a request which is evaluated by the pool too (a sub-object of a
+ * set). If there's no idle thread, an extra one is started so that
+ * the nested request can't get stuck behind the blocked workers.
+ */
+void probe_workpool_block(probe_workpool_t *pool);
+
+/**
+ * Cancel the worker threads and wait until they exit, at most
+ * 60 seconds per thread. The queued requests are not freed.
+ */
+void probe_workpool_cancel(probe_workpool_t *pool);
+
+/**
+ * Free the pool. The worker threads have to be canceled before.
+ */
+void probe_workpool_free(probe_workpool_t *pool);
+
+/**
+ * Default number of worker threads: the number of online CPUs,
+ * at most PROBE_WORKER_DEFAULT_MAX_THREADS.
+ */
+uint32_t probe_workpool_defsize(void);
+SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, probe_chunk_t *chunk, int *ret);
 
 #endif /* WORKER_H */
@@ -0,0 +1,635 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "alloc.h"
+#include "debug_priv.h"
+#include "proctab.h"
+
+#ifndef PROCTAB_WORKERS_MAX
+#define PROCTAB_WORKERS_MAX 4
+#endif
+
+/* smaller process tables are read without starting any threads */
+#ifndef PROCTAB_WORKERS_MINPROCS
+#define PROCTAB_WORKERS_MINPROCS 256
+#endif
+
+#define PROCTAB_ENV_UNREAD 0
+#define PROCTAB_ENV_READ   1
+
+typedef struct {
+	unsigned long inode;
+	proctab_ent_t *ent;
+} proctab_sock_t;
+
+struct proctab {
+	unsigned int refs;
+	unsigned int fields;
+	pthread_mutex_t lock; /**< protects reading of the environments */
+
+	proctab_ent_t *ents;
+	size_t count;
+
+	proctab_ent_t **commands; /**< sorted by the command */
+	proctab_sock_t *sockets;  /**< sorted by the inode */
+	size_t sockcnt;
+
+	size_t next;              /**< next process to be read */
+};
+
+static pthread_mutex_t proctab_lock = PTHREAD_MUTEX_INITIALIZER;
+static proctab_t *proctab_cur = NULL;
+
+/*
+ * Read the whole file `name' of the process directory `dirfd' into
+ * `buf', which is resized as needed.
+ * @return the length of the data or -1 if the file can't be opened
+ */
+static ssize_t proctab_readfile(int dirfd, const char *name, char **buf, size_t *size)
+{
+	ssize_t len = 0, ret;
+	int fd;
+
+	fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return (-1);
+
+	for (;;) {
+		if ((size_t)len + 1 >= *size) {
+			*size = *size * 2;
+			*buf  = oscap_realloc(*buf, *size);
+		}
+
+		ret = read(fd, *buf + len, *size - len - 1);
+		if (ret == -1 && errno == EINTR)
+			continue;
+		/* a read error is handled as the end of the file */
+		if (ret <= 0)
+			break;
+		len += ret;
+	}
+
+	close(fd);
+	(*buf)[len] = '\0';
+
+	return (len);
+}
+
+static int proctab_read_stat(int dirfd, proctab_ent_t *ent)
+{
+	char buf[512], *tmp;
+	int fd, pid, pgrp, tpgid;
+	unsigned int flags;
+	unsigned long minflt, cminflt, majflt, cmajflt;
+	long cutime, cstime, cnice, nthreads, itrealvalue;
+	ssize_t len;
+
+	fd = openat(dirfd, "stat", O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return (-1);
+	len = read(fd, buf, sizeof buf - 1);
+	close(fd);
+
+	if (len < 40)
+		return (-1);
+
+	buf[len] = '\0';
+	tmp = strrchr(buf, ')');
+	if (tmp == NULL)
+		return (-1);
+	*tmp = '\0';
+
+	memset(ent->comm, 0, sizeof ent->comm);
+	sscanf(buf, "%d (%15c", &pid, ent->comm);
+	sscanf(tmp + 2, "%c %d %d %d %d %d "
+	       "%u %lu %lu %lu %lu "
+	       "%lu %lu %ld %ld %ld "
+	       "%ld %ld %ld %llu",
+	       &ent->state, &ent->ppid, &pgrp, &ent->session, &ent->tty_nr, &tpgid,
+	       &flags, &minflt, &cminflt, &majflt, &cmajflt,
+	       &ent->utime, &ent->stime, &cutime, &cstime, &ent->priority,
+	       &cnice, &nthreads, &itrealvalue, &ent->start);
+
+	return (0);
+}
+
+/* the command line with the arguments separated by spaces, as shown by ps */
+static void proctab_read_cmdline(int dirfd, proctab_ent_t *ent, char **buf, size_t *size)
+{
+	static const char defunct[] = "] <defunct>";
+	ssize_t len, i;
+	char *cmd;
+
+	if (ent->state != 'Z') {
+		len = proctab_readfile(dirfd, "cmdline", buf, size);
+
+		if (len > 0) {
+			cmd = *buf;
+
+			/* skip multiple trailing zeros */
+			i = len - 1;
+			while (i > 0 && cmd[i] == '\0')
+				--i;
+
+			for (; i >= 0; --i) {
+				if (cmd[i] == '\0' || cmd[i] == '\n')
+					cmd[i] = ' ';
+				else if (!isprint((unsigned char)cmd[i]))
+					cmd[i] = '.';
+			}
+
+			ent->command = strdup(cmd);
+			return;
+		}
+
+		ent->command = strdup(ent->comm);
+		return;
+	}
+
+	ent->command = oscap_alloc(1 + strlen(ent->comm) + sizeof defunct);
+	sprintf(ent->command, "[%s%s", ent->comm, defunct);
+}
+
+static void proctab_read_status(int dirfd, proctab_ent_t *ent, char **buf, size_t *size)
+{
+	const char *uid;
+
+	ent->ruid = -1;
+	ent->euid = -1;
+	ent->loginuid = -1;
+
+	if (proctab_readfile(dirfd, "status", buf, size) > 0) {
+		uid = strstr(*buf, "\nUid:");
+		if (uid != NULL)
+			sscanf(uid + 1, "Uid: %d %d", &ent->ruid, &ent->euid);
+	}
+
+	if (proctab_readfile(dirfd, "loginuid", buf, size) > 0)
+		sscanf(*buf, "%u", &ent->loginuid);
+}
+
+static void proctab_read_sockets(int dirfd, proctab_ent_t *ent)
+{
+	DIR *dir;
+	struct dirent *dent;
+	char line[256], *s, *e;
+	unsigned long inode;
+	size_t alloc = 0;
+	int fd, lnlen;
+
+	fd = openat(dirfd, "fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1)
+		return;
+
+	dir = fdopendir(fd);
+	if (dir == NULL) {
+		close(fd);
+		return;
+	}
+
+	while ((dent = readdir(dir)) != NULL) {
+		if (dent->d_name[0] == '.')
+			continue;
+		if ((lnlen = readlinkat(fd, dent->d_name, line, sizeof line - 1)) < 0)
+			continue;
+		line[lnlen] = '\0';
+
+		if (memcmp(line, "socket:", 7) == 0) {
+			s = strchr(line + 7, '[');
+			if (s == NULL)
+				continue;
+			s++;
+			e = strchr(s, ']');
+			if (e == NULL)
+				continue;
+			*e = '\0';
+		} else if (memcmp(line, "[0000]:", 7) == 0) {
+			s = line + 8;
+		} else
+			continue;
+
+		errno = 0;
+		inode = strtoul(s, NULL, 10);
+		if (errno)
+			continue;
+
+		if (ent->sockcnt == alloc) {
+			alloc = alloc ? alloc * 2 : 8;
+			ent->sockets = oscap_realloc(ent->sockets, alloc * sizeof(unsigned long));
+		}
+		ent->sockets[ent->sockcnt++] = inode;
+	}
+
+	closedir(dir);
+}
+
+static void proctab_read_process(proctab_t *tab, proctab_ent_t *ent, char **buf, size_t *size)
+{
+	char path[32];
+	int dirfd;
+
+	snprintf(path, sizeof path, "/proc/%d", (int)ent->pid);
+	dirfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd == -1)
+		return;
+
+	if (proctab_read_stat(dirfd, ent) == 0) {
+		ent->fields |= PROCTAB_STAT;
+
+		if (tab->fields & PROCTAB_CMDLINE) {
+			proctab_read_cmdline(dirfd, ent, buf, size);
+			ent->fields |= PROCTAB_CMDLINE;
+		}
+		if (tab->fields & PROCTAB_STATUS) {
+			proctab_read_status(dirfd, ent, buf, size);
+			ent->fields |= PROCTAB_STATUS;
+		}
+		if (tab->fields & PROCTAB_SOCKETS) {
+			proctab_read_sockets(dirfd, ent);
+			ent->fields |= PROCTAB_SOCKETS;
+		}
+	}
+
+	close(dirfd);
+}
+
+static void *proctab_worker(void *arg)
+{
+	proctab_t *tab = (proctab_t *)arg;
+	size_t i, size = 1024;
+	char *buf = oscap_alloc(size);
+
+	while ((i = __sync_fetch_and_add(&tab->next, 1)) < tab->count)
+		proctab_read_process(tab, tab->ents + i, &buf, &size);
+
+	oscap_free(buf);
+	return (NULL);
+}
+
+static unsigned int proctab_nworkers(size_t count)
+{
+	long n;
+
+	if (count < PROCTAB_WORKERS_MINPROCS)
+		return (1);
+
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < 1)
+		return (1);
+
+	return (n > PROCTAB_WORKERS_MAX ? PROCTAB_WORKERS_MAX : (unsigned int)n);
+}
+
+static int proctab_pidcmp(const void *a, const void *b)
+{
+	pid_t pa = ((const proctab_ent_t *)a)->pid;
+	pid_t pb = ((const proctab_ent_t *)b)->pid;
+
+	return (pa < pb ? -1 : pa > pb);
+}
+
+static int proctab_cmdcmp(const void *a, const void *b)
+{
+	const proctab_ent_t *ea = *(proctab_ent_t * const *)a;
+	const proctab_ent_t *eb = *(proctab_ent_t * const *)b;
+	int cmp;
+
+	cmp = strcmp(ea->command, eb->command);
+	if (cmp != 0)
+		return (cmp);
+
+	return (ea->pid < eb->pid ? -1 : ea->pid > eb->pid);
+}
+
+static int proctab_sockcmp(const void *a, const void *b)
+{
+	const proctab_sock_t *sa = (const proctab_sock_t *)a;
+	const proctab_sock_t *sb = (const proctab_sock_t *)b;
+
+	if (sa->inode != sb->inode)
+		return (sa->inode < sb->inode ? -1 : 1);
+
+	return (sa->ent->pid < sb->ent->pid ? -1 : sa->ent->pid > sb->ent->pid);
+}
+
+static void proctab_index(proctab_t *tab)
+{
+	size_t i, j, n;
+
+	if (tab->fields & PROCTAB_CMDLINE) {
+		tab->commands = oscap_alloc((tab->count + 1) * sizeof(proctab_ent_t *));
+
+		for (i = 0, n = 0; i < tab->count; ++i) {
+			if (tab->ents[i].command != NULL)
+				tab->commands[n++] = tab->ents + i;
+		}
+		tab->commands[n] = NULL;
+
+		qsort(tab->commands, n, sizeof(proctab_ent_t *), proctab_cmdcmp);
+	}
+
+	if (tab->fields & PROCTAB_SOCKETS) {
+		for (i = 0, n = 0; i < tab->count; ++i)
+			n += tab->ents[i].sockcnt;
+
+		tab->sockets = oscap_alloc((n + 1) * sizeof(proctab_sock_t));
+		tab->sockcnt = n;
+
+		for (i = 0, n = 0; i < tab->count; ++i) {
+			for (j = 0; j < tab->ents[i].sockcnt; ++j) {
+				tab->sockets[n].inode = tab->ents[i].sockets[j];
+				tab->sockets[n].ent   = tab->ents + i;
+				++n;
+			}
+		}
+
+		qsort(tab->sockets, n, sizeof(proctab_sock_t), proctab_sockcmp);
+	}
+}
+
+static proctab_t *proctab_new(unsigned int fields)
+{
+	proctab_t *tab;
+	DIR *dir;
+	struct dirent *dent;
+	size_t alloc = 256;
+	unsigned int i, nworkers;
+	pthread_t *workers;
+	long pid;
+	char *end;
+
+	dir = opendir("/proc");
+	if (dir == NULL) {
+		dE("Can't read /proc: errno=%d, %s.", errno, strerror(errno));
+		return (NULL);
+	}
+
+	tab = oscap_talloc(proctab_t);
+	memset(tab, 0, sizeof(proctab_t));
+	tab->refs   = 1;
+	tab->fields = fields | PROCTAB_STAT;
+	tab->ents   = oscap_alloc(alloc * sizeof(proctab_ent_t));
+	pthread_mutex_init(&tab->lock, NULL);
+
+	while ((dent = readdir(dir)) != NULL) {
+		if (dent->d_name[0] < '0' || dent->d_name[0] > '9')
+			continue;
+
+		errno = 0;
+		pid = strtol(dent->d_name, &end, 10);
+		if (errno || *end != '\0')
+			continue;
+
+		if (tab->count == alloc) {
+			alloc *= 2;
+			tab->ents = oscap_realloc(tab->ents, alloc * sizeof(proctab_ent_t));
+		}
+
+		memset(tab->ents + tab->count, 0, sizeof(proctab_ent_t));
+		tab->ents[tab->count].pid = (pid_t)pid;
+		tab->count++;
+	}
+
+	closedir(dir);
+	qsort(tab->ents, tab->count, sizeof(proctab_ent_t), proctab_pidcmp);
+
+	nworkers = proctab_nworkers(tab->count);
+	workers  = oscap_alloc(nworkers * sizeof(pthread_t));
+
+	/* the calling thread is one of the workers */
+	for (i = 1; i < nworkers; ++i) {
+		int err = pthread_create(workers + i, NULL, proctab_worker, tab);
+
+		if (err != 0) {
+			dW("Can't start a process table reader: %s", strerror(err));
+			break;
+		}
+	}
+
+	nworkers = i;
+	proctab_worker(tab);
+
+	for (i = 1; i < nworkers; ++i)
+		pthread_join(workers[i], NULL);
+
+	oscap_free(workers);
+	proctab_index(tab);
+
+	dI("Process table: %zu processes", tab->count);
+	return (tab);
+}
+
+static void proctab_free(proctab_t *tab)
+{
+	size_t i;
+
+	for (i = 0; i < tab->count; ++i) {
+		oscap_free(tab->ents[i].command);
+		oscap_free(tab->ents[i].sockets);
+		oscap_free(tab->ents[i].environ);
+	}
+
+	oscap_free(tab->ents);
+	oscap_free(tab->commands);
+	oscap_free(tab->sockets);
+	pthread_mutex_destroy(&tab->lock);
+	oscap_free(tab);
+}
+
+proctab_t *proctab_get(unsigned int fields)
+{
+	proctab_t *tab;
+
+	pthread_mutex_lock(&proctab_lock);
+
+	if (proctab_cur == NULL || (proctab_cur->fields & fields) != fields) {
+		tab = proctab_new(fields | (proctab_cur != NULL ? proctab_cur->fields : 0));
+		if (tab == NULL) {
+			pthread_mutex_unlock(&proctab_lock);
+			return (NULL);
+		}
+
+		if (proctab_cur != NULL)
+			proctab_put(proctab_cur);
+		proctab_cur = tab;
+	}
+
+	tab = proctab_cur;
+	__sync_fetch_and_add(&tab->refs, 1);
+
+	pthread_mutex_unlock(&proctab_lock);
+
+	return (tab);
+}
+
+void proctab_put(proctab_t *tab)
+{
+	if (tab == NULL)
+		return;
+
+	if (__sync_sub_and_fetch(&tab->refs, 1) == 0)
+		proctab_free(tab);
+}
+
+void proctab_reset(void)
+{
+	pthread_mutex_lock(&proctab_lock);
+
+	if (proctab_cur != NULL) {
+		proctab_put(proctab_cur);
+		proctab_cur = NULL;
+	}
+
+	pthread_mutex_unlock(&proctab_lock);
+}
+
+size_t proctab_count(const proctab_t *tab)
+{
+	return (tab->count);
+}
+
+proctab_ent_t *proctab_ent(proctab_t *tab, size_t i)
+{
+	return (i < tab->count ? tab->ents + i : NULL);
+}
+
+proctab_ent_t *proctab_pid(proctab_t *tab, pid_t pid)
+{
+	proctab_ent_t key;
+
+	key.pid = pid;
+
+	return (bsearch(&key, tab->ents, tab->count, sizeof(proctab_ent_t), proctab_pidcmp));
+}
+
+size_t proctab_command(proctab_t *tab, const char *command, proctab_ent_t ***ents)
+{
+	size_t lo = 0, hi, n;
+
+	if (tab->commands == NULL)
+		return (0);
+
+	for (n = 0; tab->commands[n] != NULL; ++n)
+		;
+
+	/* the first process running the command */
+	hi = n;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (strcmp(tab->commands[mid]->command, command) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (n = lo; tab->commands[n] != NULL && strcmp(tab->commands[n]->command, command) == 0; ++n)
+		;
+
+	*ents = tab->commands + lo;
+	return (n - lo);
+}
+
+proctab_ent_t *proctab_socket(proctab_t *tab, unsigned long inode)
+{
+	size_t lo = 0, hi = tab->sockcnt;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (tab->sockets[mid].inode < inode)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < tab->sockcnt && tab->sockets[lo].inode == inode)
+		return (tab->sockets[lo].ent);
+
+	return (NULL);
+}
+
+const char *proctab_environ(proctab_t *tab, proctab_ent_t *ent, size_t *len)
+{
+	char path[32];
+	int dirfd;
+	ssize_t ret;
+	size_t size;
+
+	pthread_mutex_lock(&tab->lock);
+
+	if (ent->envstate == PROCTAB_ENV_UNREAD) {
+		snprintf(path, sizeof path, "/proc/%d", (int)ent->pid);
+		dirfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+		if (dirfd != -1) {
+			size = 4096;
+			ent->environ = oscap_alloc(size);
+			ret = proctab_readfile(dirfd, "environ", &ent->environ, &size);
+			if (ret == -1)
+				ent->enverrno = errno;
+			close(dirfd);
+		} else {
+			ret = -1;
+			ent->enverrno = errno;
+		}
+
+		if (ret == -1) {
+			oscap_free(ent->environ);
+			ent->environ = NULL;
+		} else {
+			/* the last string doesn't have to be terminated */
+			if (ret > 0 && ent->environ[ret - 1] != '\0')
+				++ret;
+			ent->envlen = ret;
+		}
+
+		ent->envstate = PROCTAB_ENV_READ;
+	}
+
+	pthread_mutex_unlock(&tab->lock);
+
+	if (ent->environ == NULL) {
+		errno = ent->enverrno;
+		return (NULL);
+	}
+
+	*len = ent->envlen;
+	return (ent->environ);
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:
+ *      "Daniel Kopecek" <dkopecek@redhat.com>
+ */
+#ifndef PROCTAB_H
+#define PROCTAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * Snapshot of the process table read from /proc. The snapshot is taken
+ * once, when a probe first asks for it, and it's shared by all the
+ * objects evaluated by the probe until the probe session is reset.
+ * Only the data requested by the PROCTAB_* flags is read; the
+ * environment of a process is read when it's first asked for.
+ */
+#define PROCTAB_STAT    0x01 /**< /proc/<pid>/stat, always read */
+#define PROCTAB_CMDLINE 0x02 /**< the command as shown by ps */
+#define PROCTAB_STATUS  0x04 /**< user IDs from /proc/<pid>/status and loginuid */
+#define PROCTAB_SOCKETS 0x08 /**< inodes of the sockets in /proc/<pid>/fd */
+
+typedef struct proctab proctab_t;
+
+typedef struct {
+	pid_t pid;
+	unsigned int fields; /**< PROCTAB_* data read for the process */
+
+	/* PROCTAB_STAT */
+	char state;
+	pid_t ppid;
+	int session;
+	int tty_nr;
+	unsigned long utime;
+	unsigned long stime;
+	long priority;
+	unsigned long long start;
+	char comm[16];
+
+	/* PROCTAB_CMDLINE */
+	char *command;
+
+	/* PROCTAB_STATUS, -1 if not known */
+	int ruid;
+	int euid;
+	unsigned int loginuid;
+
+	/* PROCTAB_SOCKETS */
+	unsigned long *sockets;
+	size_t sockcnt;
+
+	/* read by proctab_environ() */
+	int envstate;
+	int enverrno;
+	char *environ;
+	size_t envlen;
+} proctab_ent_t;
+
+/**
+ * Get the current snapshot, taking it if there's none or if it lacks
+ * some of the `fields'. The returned reference has to be released by
+ * proctab_put().
+ * @return NULL and errno set if /proc can't be read
+ */
+proctab_t *proctab_get(unsigned int fields);
+
+void proctab_put(proctab_t *tab);
+
+/**
+ * Drop the current snapshot, the next proctab_get() takes a new one.
+ */
+void proctab_reset(void);
+
+/**
+ * Number of processes in the snapshot. The processes are ordered by
+ * their pid.
+ */
+size_t proctab_count(const proctab_t *tab);
+
+proctab_ent_t *proctab_ent(proctab_t *tab, size_t i);
+
+/**
+ * @return the process `pid' or NULL if it isn't in the snapshot
+ */
+proctab_ent_t *proctab_pid(proctab_t *tab, pid_t pid);
+
+/**
+ * Find the processes running `command'. Requires PROCTAB_CMDLINE.
+ * @return the number of processes stored in `ents', in pid order
+ */
+size_t proctab_command(proctab_t *tab, const char *command, proctab_ent_t ***ents);
+
+/**
+ * Find the process with the lowest pid having the socket `inode' open.
+ * Requires PROCTAB_SOCKETS.
+ */
+proctab_ent_t *proctab_socket(proctab_t *tab, unsigned long inode);
+
+/**
+ * Get the environment of the process, a sequence of null terminated
+ * strings `len' bytes long.
+ * @return NULL and errno set if it can't be read
+ */
+const char *proctab_environ(proctab_t *tab, proctab_ent_t *ent, size_t *len);
+
+#endif /* PROCTAB_H */
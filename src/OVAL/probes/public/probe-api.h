@@ -429,6 +429,38 @@ size_t probe_ent_getname_r(const SEXP_t * ent, char *buffer, size_t buflen);
  */
 void probe_free(SEXP_t * obj);
 
+/**
+ * Object entity compiled for matching many values.
+ * The values (including var_ref values), the operation, the datatype
+ * and the var_check attribute of the entity are read once and the
+ * pattern match values are compiled. A matcher can be used by more
+ * threads at once.
+ */
+typedef struct probe_entmatch probe_entmatch_t;
+
+/**
+ * Compile an object entity into a matcher.
+ * @param ent_obj object entity
+ */
+probe_entmatch_t *probe_entmatch_new(SEXP_t *ent_obj);
+
+void probe_entmatch_free(probe_entmatch_t *m);
+
+/**
+ * Match a value, the result is the same as the one of probe_entobj_cmp()
+ * called with the entity the matcher was compiled from.
+ * @param m matcher
+ * @param val raw value
+ */
+oval_result_t probe_entmatch_sexp(const probe_entmatch_t *m, SEXP_t *val);
+
+/**
+ * Match a string value without creating an S-exp for it.
+ * @param m matcher
+ * @param str null terminated string
+ */
+oval_result_t probe_entmatch_cstr(const probe_entmatch_t *m, const char *str);
+
 /**
  * Set all of the missing attributes of the 'behaviors' entity
  * to default values. If the referenced pointer contains NULL,
@@ -468,6 +500,9 @@ void probe_tfc54behaviors_canonicalize(SEXP_t **behaviors);
 #define PROBECMD_OBJ_EVAL  2 /**< Object eval command code */
 #define PROBECMD_RESET     3 /**< Reset command code */
 
+#define PROBE_MSGATTR_CHUNKED "chunked" /**< request attribute: the library accepts chunked replies */
+#define PROBE_MSGATTR_CHUNK   "chunk"   /**< reply attribute: partial reply, more items will follow */
+
 
 void probe_offline_mode(void);
 void probe_preload(void);
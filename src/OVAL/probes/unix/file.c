@@ -39,7 +39,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
-#include <pthread.h>
 #include <errno.h>
 #include <limits.h>
 
@@ -84,12 +83,9 @@
 # error "Sorry, your OS isn't supported."
 #endif
 
-oval_schema_version_t over;
-
 static SEXP_t *gr_true   = NULL, *gr_false  = NULL, *gr_t_reg  = NULL;
 static SEXP_t *gr_t_dir  = NULL, *gr_t_lnk  = NULL, *gr_t_blk  = NULL;
 static SEXP_t *gr_t_fifo = NULL, *gr_t_sock = NULL, *gr_t_char = NULL;
-static SEXP_t  gr_lastpath;
 #if defined(OS_SOLARIS)
 static SEXP_t *gr_t_door = NULL, *gr_t_port = NULL;
 #endif
@@ -115,32 +111,45 @@ static SEXP_t *se_filetype (mode_t mode)
         return (NULL);
 }
 
+/*
+ * Objects are collected concurrently by the probe worker threads,
+ * so everything specific to one object lives here.
+ */
 struct cbargs {
         probe_ctx *ctx;
 	int     error;
+	oval_schema_version_t over;
+	SEXP_t  lastpath;
 };
 
-static rbt_t   *g_ID_cache     = NULL;
+/*
+ * IDs are represented as strings before OVAL 5.8 and as numbers
+ * since then. Each representation has its own cache, the trees
+ * are locked internally.
+ */
+static rbt_t   *g_ID_cache[2]  = { NULL, NULL };
 static uint32_t g_ID_cache_max = 0; /* 0 = unlimited */
 
-static SEXP_t *ID_cache_get(int32_t id)
+static SEXP_t *ID_cache_get(int32_t id, oval_schema_version_t over)
 {
 	SEXP_t *s_id = NULL, *s_id2 = NULL;
+	bool    numeric = oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.8)) >= 0;
+	rbt_t  *cache = g_ID_cache[numeric];
 
-	if (rbt_i32_get(g_ID_cache, id, (void *)&s_id) == 0)
+	if (rbt_i32_get(cache, id, (void *)&s_id) == 0)
 		return SEXP_ref(s_id); /* cache hit (first attempt) */
 
-	if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.8)) < 0) {
+	if (!numeric) {
 		s_id = SEXP_string_newf("%u", id);
 	} else {
 		s_id = SEXP_number_newu_32(id);
 	}
 
-	if (g_ID_cache_max == 0 || rbt_i32_size(g_ID_cache) < g_ID_cache_max) {
-		if (rbt_i32_add(g_ID_cache, id, (void *)s_id, NULL) == 0)
+	if (g_ID_cache_max == 0 || rbt_i32_size(cache) < g_ID_cache_max) {
+		if (rbt_i32_add(cache, id, (void *)s_id, NULL) == 0)
 			return SEXP_ref(s_id); /* insert succeeded */
 
-		if (rbt_i32_get(g_ID_cache, id, (void *)&s_id2) == 0) {
+		if (rbt_i32_get(cache, id, (void *)&s_id2) == 0) {
 			SEXP_free (s_id); /* cache hit (second attempt) */
 			return SEXP_ref(s_id2);
 		}
@@ -153,7 +162,8 @@ static SEXP_t *ID_cache_get(int32_t id)
 static void ID_cache_init(uint32_t max)
 {
 	g_ID_cache_max = max;
-	g_ID_cache     = rbt_i32_new();
+	g_ID_cache[0]  = rbt_i32_new();
+	g_ID_cache[1]  = rbt_i32_new();
 }
 
 static void ID_cache_free_cb(rbt_i32_node_t *n)
@@ -163,12 +173,14 @@ static void ID_cache_free_cb(rbt_i32_node_t *n)
 
 static void ID_cache_free(void)
 {
-	rbt_i32_free_cb(g_ID_cache, ID_cache_free_cb);
-	g_ID_cache     = NULL;
+	rbt_i32_free_cb(g_ID_cache[0], ID_cache_free_cb);
+	rbt_i32_free_cb(g_ID_cache[1], ID_cache_free_cb);
+	g_ID_cache[0]  = NULL;
+	g_ID_cache[1]  = NULL;
 	g_ID_cache_max = 0;
 }
 
-static SEXP_t *get_atime(struct stat *st, SEXP_t *sexp)
+static SEXP_t *get_atime(struct stat *st, SEXP_t *sexp, oval_schema_version_t over)
 {
 	uint64_t t = (
 #if defined(OS_FREEBSD)
@@ -189,7 +201,7 @@ static SEXP_t *get_atime(struct stat *st, SEXP_t *sexp)
 	}
 }
 
-static SEXP_t *get_ctime(struct stat *st, SEXP_t *sexp)
+static SEXP_t *get_ctime(struct stat *st, SEXP_t *sexp, oval_schema_version_t over)
 {
 	uint64_t t = (
 #if defined(OS_FREEBSD)
@@ -210,7 +222,7 @@ static SEXP_t *get_ctime(struct stat *st, SEXP_t *sexp)
 	}
 }
 
-static SEXP_t *get_mtime(struct stat *st, SEXP_t *sexp)
+static SEXP_t *get_mtime(struct stat *st, SEXP_t *sexp, oval_schema_version_t over)
 {
 	uint64_t t = (
 #if defined(OS_FREEBSD)
@@ -290,25 +302,25 @@ static int file_cb (const char *p, const char *f, void *ptr)
                 SEXP_t  se_atime_mem, se_ctime_mem, se_mtime_mem, se_size_mem;
 		SEXP_t *se_filepath, *se_acl;
 
-		if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.6)) < 0
+		if (oval_schema_version_cmp(args->over, OVAL_SCHEMA_VERSION(5.6)) < 0
 		    || f == NULL) {
 			se_filepath = NULL;
 		} else {
 			se_filepath = SEXP_string_newf("%s", st_path);
 		}
 
-		se_usr_id = ID_cache_get(st.st_uid);
-		se_grp_id = st.st_gid != st.st_uid ? ID_cache_get(st.st_gid) : SEXP_ref(se_usr_id);
+		se_usr_id = ID_cache_get(st.st_uid, args->over);
+		se_grp_id = st.st_gid != st.st_uid ? ID_cache_get(st.st_gid, args->over) : SEXP_ref(se_usr_id);
 
-		if (!SEXP_emptyp(&gr_lastpath)) {
-			if (SEXP_strcmp(&gr_lastpath, p) != 0) {
-				SEXP_free_r(&gr_lastpath);
-				SEXP_string_new_r(&gr_lastpath, p, strlen(p));
+		if (!SEXP_emptyp(&args->lastpath)) {
+			if (SEXP_strcmp(&args->lastpath, p) != 0) {
+				SEXP_free_r(&args->lastpath);
+				SEXP_string_new_r(&args->lastpath, p, strlen(p));
 			}
 		} else
-			SEXP_string_new_r(&gr_lastpath, p, strlen(p));
+			SEXP_string_new_r(&args->lastpath, p, strlen(p));
 
-		if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.7)) < 0) {
+		if (oval_schema_version_cmp(args->over, OVAL_SCHEMA_VERSION(5.7)) < 0) {
 			se_acl = NULL;
 		} else {
 			se_acl = has_extended_acl(st_path);
@@ -316,14 +328,14 @@ static int file_cb (const char *p, const char *f, void *ptr)
 
                 item = probe_item_create(OVAL_UNIX_FILE, NULL,
                                          "filepath", OVAL_DATATYPE_SEXP, se_filepath,
-                                         "path",     OVAL_DATATYPE_SEXP,  &gr_lastpath,
+                                         "path",     OVAL_DATATYPE_SEXP,  &args->lastpath,
                                          "filename", OVAL_DATATYPE_STRING, f == NULL ? "" : f,
                                          "type",     OVAL_DATATYPE_SEXP, se_filetype(st.st_mode),
                                          "group_id", OVAL_DATATYPE_SEXP, se_grp_id,
                                          "user_id",  OVAL_DATATYPE_SEXP, se_usr_id,
-                                         "a_time",   OVAL_DATATYPE_SEXP, get_atime(&st, &se_atime_mem),
-                                         "c_time",   OVAL_DATATYPE_SEXP, get_ctime(&st, &se_ctime_mem),
-                                         "m_time",   OVAL_DATATYPE_SEXP, get_mtime(&st, &se_mtime_mem),
+                                         "a_time",   OVAL_DATATYPE_SEXP, get_atime(&st, &se_atime_mem, args->over),
+                                         "c_time",   OVAL_DATATYPE_SEXP, get_ctime(&st, &se_ctime_mem, args->over),
+                                         "m_time",   OVAL_DATATYPE_SEXP, get_mtime(&st, &se_mtime_mem, args->over),
                                          "size",     OVAL_DATATYPE_SEXP, get_size(&st, &se_size_mem),
                                          "suid",     OVAL_DATATYPE_SEXP, MODEP(&st, S_ISUID),
                                          "sgid",     OVAL_DATATYPE_SEXP, MODEP(&st, S_ISGID),
@@ -362,11 +374,10 @@ static int file_cb (const char *p, const char *f, void *ptr)
         return (0);
 }
 
-static pthread_mutex_t __file_probe_mutex;
-
 void *probe_init (void)
 {
 	probe_setoption(PROBEOPT_OFFLINE_MODE_SUPPORTED, PROBE_OFFLINE_CHROOT);
+	probe_setoption(PROBEOPT_PERSISTENT_CACHE, NULL);
         /*
          * Initialize true/false global reference.
          */
@@ -402,22 +413,11 @@ void *probe_init (void)
         gr_t_port = SEXP_string_new (STRLEN_PAIR(STR_PORT));
 #endif
 
-	SEXP_init(&gr_lastpath);
-
 	/*
 	 * Initialize ID cache
 	 */
 	ID_cache_init(10000);
 
-        /*
-         * Initialize mutex.
-         */
-        switch (pthread_mutex_init (&__file_probe_mutex, NULL)) {
-        case 0:
-                return ((void *)&__file_probe_mutex);
-        default:
-                dI("Can't initialize mutex: errno=%u, %s.", errno, strerror (errno));
-        }
 #if 0
 	probe_setoption(PROBEOPT_VARREF_HANDLING, false, "path");
 	probe_setoption(PROBEOPT_VARREF_HANDLING, false, "filename");
@@ -427,7 +427,6 @@ void *probe_init (void)
 
 void probe_fini (void *arg)
 {
-        _A((void *)arg == (void *)&__file_probe_mutex);
 
         /*
          * Release global reference.
@@ -437,23 +436,15 @@ void probe_fini (void *arg)
                     gr_t_fifo, gr_t_sock, gr_t_char,
                     NULL);
 
-	if (!SEXP_emptyp(&gr_lastpath))
-		SEXP_free_r(&gr_lastpath);
-
 	/*
 	 * Free ID cache
 	 */
 	ID_cache_free();
 
-        /*
-         * Destroy mutex.
-         */
-        (void) pthread_mutex_destroy (&__file_probe_mutex);
-
         return;
 }
 
-int probe_main (probe_ctx *ctx, void *mutex)
+int probe_main (probe_ctx *ctx, void *arg)
 {
         SEXP_t *path, *filename, *behaviors, *filepath, *probe_in;
 	int err;
@@ -461,15 +452,8 @@ int probe_main (probe_ctx *ctx, void *mutex)
 	OVAL_FTS    *ofts;
 	OVAL_FTSENT *ofts_ent;
 
-        if (mutex == NULL) {
-                return PROBE_EINIT;
-	}
-
-        _A(mutex == &__file_probe_mutex);
-
         probe_in  = probe_ctx_getobject(ctx);
 
-	over = probe_obj_get_platform_schema_version(probe_in);
         path      = probe_obj_getent (probe_in, "path",      1);
         filename  = probe_obj_getent (probe_in, "filename",  1);
         behaviors = probe_obj_getent (probe_in, "behaviors", 1);
@@ -487,22 +471,10 @@ int probe_main (probe_ctx *ctx, void *mutex)
 
 	probe_filebehaviors_canonicalize(&behaviors);
 
-        switch (pthread_mutex_lock (&__file_probe_mutex)) {
-        case 0:
-                break;
-        default:
-                dI("Can't lock mutex(%p): %u, %s.", &__file_probe_mutex, errno, strerror (errno));
-
-		SEXP_free(path);
-		SEXP_free(filename);
-		SEXP_free(filepath);
-		SEXP_free(behaviors);
-
-                return PROBE_EFATAL;
-        }
-
         cbargs.ctx     = ctx;
 	cbargs.error   = 0;
+	cbargs.over    = probe_obj_get_platform_schema_version(probe_in);
+	SEXP_init(&cbargs.lastpath);
 
 	if ((ofts = oval_fts_open(path, filename, filepath, behaviors, probe_ctx_getresult(ctx))) != NULL) {
 		while ((ofts_ent = oval_fts_read(ofts)) != NULL) {
@@ -517,19 +489,13 @@ int probe_main (probe_ctx *ctx, void *mutex)
 
 	err = 0;
 
+	if (!SEXP_emptyp(&cbargs.lastpath))
+		SEXP_free_r(&cbargs.lastpath);
+
 	SEXP_free(path);
 	SEXP_free(filename);
 	SEXP_free(filepath);
 	SEXP_free(behaviors);
 
-        switch (pthread_mutex_unlock (&__file_probe_mutex)) {
-        case 0:
-                break;
-        default:
-                dI("Can't unlock mutex(%p): %u, %s.", &__file_probe_mutex, errno, strerror (errno));
-
-                return PROBE_EFATAL;
-        }
-
         return err;
 }
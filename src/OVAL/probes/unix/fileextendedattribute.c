@@ -36,7 +36,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
-#include <pthread.h>
 #include <errno.h>
 #include <limits.h>
 
@@ -75,12 +74,11 @@
 # error "Sorry, your OS isn't supported."
 #endif
 
-SEXP_t gr_lastpath;
-
 struct cbargs {
         probe_ctx *ctx;
 	int        error;
         SEXP_t    *attr_ent;
+        SEXP_t     lastpath;
 };
 
 static int file_cb (const char *p, const char *f, void *ptr)
@@ -131,13 +129,13 @@ static int file_cb (const char *p, const char *f, void *ptr)
         }
 
         /* update lastpath if needed */
-        if (!SEXP_emptyp(&gr_lastpath)) {
-                if (SEXP_strcmp(&gr_lastpath, p) != 0) {
-                        SEXP_free_r(&gr_lastpath);
-                        SEXP_string_new_r(&gr_lastpath, p, strlen(p));
+        if (!SEXP_emptyp(&args->lastpath)) {
+                if (SEXP_strcmp(&args->lastpath, p) != 0) {
+                        SEXP_free_r(&args->lastpath);
+                        SEXP_string_new_r(&args->lastpath, p, strlen(p));
                 }
         } else
-                SEXP_string_new_r(&gr_lastpath, p, strlen(p));
+                SEXP_string_new_r(&args->lastpath, p, strlen(p));
 
         i = 0;
         /* collect */
@@ -171,7 +169,7 @@ static int file_cb (const char *p, const char *f, void *ptr)
 
                                 item = probe_item_create(OVAL_UNIX_FILEEXTENDEDATTRIBUTE, NULL,
                                                          "filepath", OVAL_DATATYPE_STRING, f == NULL ? NULL : st_path,
-                                                         "path",     OVAL_DATATYPE_SEXP,  &gr_lastpath,
+                                                         "path",     OVAL_DATATYPE_SEXP,  &args->lastpath,
                                                          "filename", OVAL_DATATYPE_STRING, f == NULL ? "" : f,
                                                          "attribute_name", OVAL_DATATYPE_SEXP,   &xattr_name,
                                                          "value",          OVAL_DATATYPE_STRING, xattr_val,
@@ -204,23 +202,10 @@ static int file_cb (const char *p, const char *f, void *ptr)
         return (0);
 }
 
-static pthread_mutex_t __file_probe_mutex;
-
 void *probe_init (void)
 {
 	probe_setoption(PROBEOPT_OFFLINE_MODE_SUPPORTED, PROBE_OFFLINE_CHROOT);
 
-	SEXP_init(&gr_lastpath);
-
-        /*
-         * Initialize mutex.
-         */
-        switch (pthread_mutex_init (&__file_probe_mutex, NULL)) {
-        case 0:
-                return ((void *)&__file_probe_mutex);
-        default:
-                dI("Can't initialize mutex: errno=%u, %s.", errno, strerror (errno));
-        }
 #if 0
 	probe_setoption(PROBEOPT_VARREF_HANDLING, false, "path");
 	probe_setoption(PROBEOPT_VARREF_HANDLING, false, "filename");
@@ -228,22 +213,7 @@ void *probe_init (void)
         return (NULL);
 }
 
-void probe_fini (void *arg)
-{
-        _A((void *)arg == (void *)&__file_probe_mutex);
-
-	if (!SEXP_emptyp(&gr_lastpath))
-		SEXP_free_r(&gr_lastpath);
-
-        /*
-         * Destroy mutex.
-         */
-        (void) pthread_mutex_destroy (&__file_probe_mutex);
-
-        return;
-}
-
-int probe_main (probe_ctx *ctx, void *mutex)
+int probe_main (probe_ctx *ctx, void *arg)
 {
         SEXP_t *path, *filename, *behaviors;
         SEXP_t *filepath, *attribute_, *probe_in;
@@ -252,11 +222,6 @@ int probe_main (probe_ctx *ctx, void *mutex)
 	OVAL_FTS    *ofts;
 	OVAL_FTSENT *ofts_ent;
 
-        if (mutex == NULL)
-                return PROBE_EINIT;
-
-        _A(mutex == &__file_probe_mutex);
-
         probe_in  = probe_ctx_getobject(ctx);
 
         path       = probe_obj_getent (probe_in, "path",      1);
@@ -280,24 +245,10 @@ int probe_main (probe_ctx *ctx, void *mutex)
 
 	probe_filebehaviors_canonicalize(&behaviors);
 
-        switch (pthread_mutex_lock (&__file_probe_mutex)) {
-        case 0:
-                break;
-        default:
-                dI("Can't lock mutex(%p): %u, %s.", &__file_probe_mutex, errno, strerror (errno));
-
-		SEXP_free(path);
-		SEXP_free(filename);
-		SEXP_free(filepath);
-		SEXP_free(behaviors);
-                SEXP_free(attribute_);
-
-                return PROBE_EFATAL;
-        }
-
         cbargs.ctx      = ctx;
 	cbargs.error    = 0;
         cbargs.attr_ent = attribute_;
+        SEXP_init(&cbargs.lastpath);
 
 	if ((ofts = oval_fts_open(path, filename, filepath, behaviors, probe_ctx_getresult(ctx))) != NULL) {
 		while ((ofts_ent = oval_fts_read(ofts)) != NULL) {
@@ -309,20 +260,14 @@ int probe_main (probe_ctx *ctx, void *mutex)
 
 	err = 0;
 
+	if (!SEXP_emptyp(&cbargs.lastpath))
+		SEXP_free_r(&cbargs.lastpath);
+
 	SEXP_free(path);
 	SEXP_free(filename);
 	SEXP_free(filepath);
 	SEXP_free(behaviors);
         SEXP_free(attribute_);
 
-        switch (pthread_mutex_unlock (&__file_probe_mutex)) {
-        case 0:
-                break;
-        default:
-                dI("Can't unlock mutex(%p): %u, %s.", &__file_probe_mutex, errno, strerror (errno));
-
-                return PROBE_EFATAL;
-        }
-
         return err;
 }
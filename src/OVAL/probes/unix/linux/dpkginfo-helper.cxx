@@ -4,70 +4,48 @@
 
 #include <cstdio>
 #include <cstring>
+#include <cerrno>
 #include <iostream>
+#include <string>
+#include <vector>
+#include <map>
 #include <stdlib.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #include <apt-pkg/init.h>
 #include <apt-pkg/error.h>
-#include <apt-pkg/mmap.h>
-#include <apt-pkg/pkgcache.h>
-#include <apt-pkg/pkgrecords.h>
+#include <apt-pkg/fileutl.h>
+#include <apt-pkg/tagfile.h>
 
 #include "dpkginfo-helper.h"
 
 using namespace std;
 
-static int _init_done = 0;
-static pkgCache *cgCache = NULL;
-
-static int opencache (void) {
-        if (pkgInitConfig (*_config) == false) return 0;
-        if (pkgInitSystem (*_config, _system) == false) return 0;
-
-        FileFd *fd = new FileFd (_config->FindFile ("Dir::Cache::pkgcache"),
-                        FileFd::ReadOnly);
-
-        MMap *map = new MMap (*fd, MMap::Public|MMap::ReadOnly);
-        if (_error->PendingError () == true) {
-                _error->DumpErrors ();
-                return 0;
-        }
-
-        cgCache = new pkgCache (map);
-        if (0 == cgCache) return 0;
-        if (_error->PendingError () == true) {
-                _error->DumpErrors ();
-                return 0;
-        }
+/*
+ * Snapshot of the installed packages parsed from the dpkg status file.
+ * A snapshot isn't modified once it's published, so it can be read by
+ * any number of threads without locking. When the status file changes,
+ * a new snapshot is published and the old ones are kept until
+ * dpkginfo_fini(), because a lookup may still be using them.
+ */
+struct dpkginfo_db {
+        struct stat st; /* of the status file when it was parsed */
+        vector<struct dpkginfo_reply_t *> pkgs; /* in status file order */
+        map<string, vector<struct dpkginfo_reply_t *> > names;
+        struct dpkginfo_db *prev;
+};
 
-        return 1;
-}
+static int _init_done = 0;
+static string status_path;
+static struct dpkginfo_db *volatile cgDb = NULL;
+static pthread_mutex_t db_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-struct dpkginfo_reply_t * dpkginfo_get_by_name(const char *name, int *err)
+static struct dpkginfo_reply_t *newreply (const string &name, const string &arch, const string &evr)
 {
-        pkgCache &cache = *cgCache;
-        pkgRecords Recs (cache);
-        struct dpkginfo_reply_t *reply = NULL;
-
-        // Locate the package
-        pkgCache::PkgIterator Pkg = cache.FindPkg(name);
-        if (Pkg.end() == true) {
-                /* not found, clear error flag */
-                if (err) *err = 0;
-                return NULL;
-        }
-
-        pkgCache::VerIterator V1 = Pkg.CurrentVer();
-        if (V1.end() == true) {
-                /* not installed, clear error flag */
-                /* FIXME this should be different that not found */
-                if (err) *err = 0;
-                return NULL;
-        }
-        pkgRecords::Parser &P = Recs.Lookup(V1.FileList());
+        struct dpkginfo_reply_t *reply;
 
         /* split epoch, version and release */
-        string evr = V1.VerStr();
         string epoch, version, release;
         string::size_type version_start = 0, version_stop;
         string::size_type pos;
@@ -97,9 +75,8 @@ struct dpkginfo_reply_t * dpkginfo_get_by_name(const char *name, int *err)
         }
 
         reply = new(struct dpkginfo_reply_t);
-        memset(reply, 0, sizeof(struct dpkginfo_reply_t));
-        reply->name = strdup(Pkg.Name());
-        reply->arch = strdup(V1.Arch());
+        reply->name = strdup(name.c_str());
+        reply->arch = strdup(arch.c_str());
         reply->epoch = strdup(epoch.c_str());
         reply->release = strdup(release.c_str());
         reply->version = strdup(version.c_str());
@@ -108,29 +85,167 @@ struct dpkginfo_reply_t * dpkginfo_get_by_name(const char *name, int *err)
         return reply;
 }
 
-void * dpkginfo_free_reply(struct dpkginfo_reply_t *reply)
+static void freereply (struct dpkginfo_reply_t *reply)
+{
+        free(reply->name);
+        free(reply->arch);
+        free(reply->epoch);
+        free(reply->release);
+        free(reply->version);
+        free(reply->evr);
+        delete reply;
+}
+
+static void freedb (struct dpkginfo_db *db)
+{
+        for (size_t i = 0; i < db->pkgs.size(); ++i)
+                freereply(db->pkgs[i]);
+
+        delete db;
+}
+
+/* whether the Status field describes an installed package, as apt sees it */
+static bool installed (const string &status)
+{
+        string::size_type pos = status.find_last_of(" ");
+        string state = (pos == string::npos) ? status : status.substr(pos + 1);
+
+        return !(state.empty() || state == "not-installed" || state == "config-files");
+}
+
+static struct dpkginfo_db *readdb (const struct stat *st)
+{
+        FileFd fd (status_path, FileFd::ReadOnly);
+
+        if (_error->PendingError () == true) {
+                _error->DumpErrors ();
+                return NULL;
+        }
+
+        struct dpkginfo_db *db = new dpkginfo_db;
+        pkgTagFile tags (&fd);
+        pkgTagSection section;
+
+        db->st = *st;
+        db->prev = NULL;
+
+        while (tags.Step (section) == true) {
+                string name = section.FindS ("Package");
+
+                if (name.empty () || !installed (section.FindS ("Status")))
+                        continue;
+
+                struct dpkginfo_reply_t *reply = newreply (name,
+                                section.FindS ("Architecture"),
+                                section.FindS ("Version"));
+
+                db->pkgs.push_back (reply);
+                db->names[name].push_back (reply);
+        }
+
+        if (_error->PendingError () == true) {
+                _error->DumpErrors ();
+                freedb (db);
+                return NULL;
+        }
+
+        return db;
+}
+
+static bool samestat (const struct stat *a, const struct stat *b)
 {
-        if (reply) {
-                free(reply->name);
-                delete reply;
+        return a->st_ino == b->st_ino && a->st_dev == b->st_dev && a->st_size == b->st_size
+                && a->st_mtim.tv_sec == b->st_mtim.tv_sec
+                && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+/*
+ * Get the current snapshot, parsing the status file again if it was
+ * modified since the snapshot was taken.
+ */
+static struct dpkginfo_db *getdb (void)
+{
+        struct dpkginfo_db *db = cgDb;
+        struct stat st;
+
+        if (stat (status_path.c_str (), &st) != 0)
+                return NULL;
+
+        if (db != NULL && samestat (&db->st, &st))
+                return db;
+
+        pthread_mutex_lock (&db_mutex);
+
+        db = cgDb;
+
+        if (db == NULL || !samestat (&db->st, &st)) {
+                struct dpkginfo_db *newdb = readdb (&st);
+
+                if (newdb != NULL) {
+                        newdb->prev = db;
+                        __sync_synchronize ();
+                        cgDb = db = newdb;
+                }
         }
+
+        pthread_mutex_unlock (&db_mutex);
+
+        return db;
+}
+
+int dpkginfo_get_by_name(const char *name, struct dpkginfo_reply_t * const **replies)
+{
+        struct dpkginfo_db *db = getdb ();
+
+        if (db == NULL)
+                return -1;
+
+        map<string, vector<struct dpkginfo_reply_t *> >::const_iterator it = db->names.find (name);
+        if (it == db->names.end ()) {
+                /* not found or not installed */
+                return 0;
+        }
+
+        *replies = &it->second[0];
+        return (int)it->second.size ();
+}
+
+int dpkginfo_get_all(struct dpkginfo_reply_t * const **replies)
+{
+        struct dpkginfo_db *db = getdb ();
+
+        if (db == NULL)
+                return -1;
+
+        *replies = db->pkgs.empty () ? NULL : &db->pkgs[0];
+        return (int)db->pkgs.size ();
 }
 
 int dpkginfo_init()
 {
-        if (_init_done == 0)
-                if (opencache() != 1) {
-                        return -1;
-                }
+        if (_init_done == 0) {
+                if (pkgInitConfig (*_config) == false) return -1;
+                if (pkgInitSystem (*_config, _system) == false) return -1;
+
+                status_path = _config->FindFile ("Dir::State::status");
+                _init_done = 1;
+        }
 
         return 0;
 }
 
 int dpkginfo_fini()
 {
-        delete cgCache;
-        cgCache = NULL;
+        struct dpkginfo_db *db = cgDb;
+
+        while (db != NULL) {
+                struct dpkginfo_db *prev = db->prev;
+
+                freedb (db);
+                db = prev;
+        }
+
+        cgDb = NULL;
 
         return 0;
 }
-
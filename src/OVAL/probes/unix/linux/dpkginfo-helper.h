@@ -38,9 +38,23 @@ struct dpkginfo_reply_t {
 int dpkginfo_init();
 int dpkginfo_fini();
 
-struct dpkginfo_reply_t * dpkginfo_get_by_name(const char *name, int *err);
+/*
+ * The replies are owned by the helper and stay valid until
+ * dpkginfo_fini(). The dpkg status file is parsed when it's first
+ * needed and again only if it's modified; lookups need no locking.
+ */
 
-void * dpkginfo_free_reply(struct dpkginfo_reply_t *reply);
+/**
+ * Get the installed instances (one per architecture) of the package `name'.
+ * @return the number of replies, 0 if the package isn't installed, -1 on error
+ */
+int dpkginfo_get_by_name(const char *name, struct dpkginfo_reply_t * const **replies);
+
+/**
+ * Get all the installed packages, in the order of the status file.
+ * @return the number of replies, -1 on error
+ */
+int dpkginfo_get_all(struct dpkginfo_reply_t * const **replies);
 
 #ifdef __cplusplus
 }
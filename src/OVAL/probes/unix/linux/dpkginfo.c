@@ -54,6 +54,7 @@
 #include <seap.h>
 #include <probe-api.h>
 #include <alloc.h>
+#include <probe/entcmp.h>
 
 #include "common/debug_priv.h"
 #include "public/oval_schema_version.h"
@@ -62,7 +63,7 @@
 
 
 struct dpkginfo_global {
-        pthread_mutex_t mutex;
+        int init_done;
 };
 
 static struct dpkginfo_global g_dpkg;
@@ -70,28 +71,43 @@ static struct dpkginfo_global g_dpkg;
 
 void *probe_init(void)
 {
-        pthread_mutex_init (&(g_dpkg.mutex), NULL);
-        dpkginfo_init();
+        if (dpkginfo_init() == 0)
+                g_dpkg.init_done = 1;
 
         return ((void *)&g_dpkg);
 }
 
 void probe_fini (void *ptr)
 {
-        struct dpkginfo_global *d = (struct dpkginfo_global *)ptr;
-
         dpkginfo_fini();
-        pthread_mutex_destroy (&(d->mutex));
 
         return;
 }
 
+static void dpkginfo_additem(probe_ctx *ctx, const struct dpkginfo_reply_t *dpkginfo_reply, oval_datatype_t evr_string_type)
+{
+        SEXP_t *item;
+
+        dI("%s: element found version %s", dpkginfo_reply->name, dpkginfo_reply->evr);
+        item = probe_item_create (OVAL_LINUX_DPKG_INFO, NULL,
+                        "name", OVAL_DATATYPE_STRING, dpkginfo_reply->name,
+                        "arch", OVAL_DATATYPE_STRING, dpkginfo_reply->arch,
+                        "epoch", OVAL_DATATYPE_STRING, dpkginfo_reply->epoch,
+                        "release", OVAL_DATATYPE_STRING, dpkginfo_reply->release,
+                        "version", OVAL_DATATYPE_STRING, dpkginfo_reply->version,
+                        "evr", evr_string_type, dpkginfo_reply->evr,
+                        NULL);
+
+        probe_item_collect(ctx, item);
+}
+
 int probe_main (probe_ctx *ctx, void *arg)
 {
 	SEXP_t *val, *item, *ent, *obj;
         char *request_st = NULL;
-        struct dpkginfo_reply_t *dpkginfo_reply = NULL;
-        int errflag;
+        struct dpkginfo_reply_t * const *dpkginfo_reply = NULL;
+        oval_operation_t name_op;
+        int i, count;
 
 	obj = probe_ctx_getobject(ctx);
 	ent = probe_obj_getent(obj, "name", 1);
@@ -112,6 +128,8 @@ int probe_main (probe_ctx *ctx, void *arg)
         SEXP_free (val);
 
         if (request_st == NULL) {
+                SEXP_free (ent);
+
                 switch (errno) {
                 case EINVAL:
                         dI("%s: invalid value type", "name");
@@ -126,32 +144,30 @@ int probe_main (probe_ctx *ctx, void *arg)
                 }
         }
 
-        /* get info from debian apt cache */
-        pthread_mutex_lock (&(g_dpkg.mutex));
-        dpkginfo_reply = dpkginfo_get_by_name(request_st, &errflag);
-        pthread_mutex_unlock (&(g_dpkg.mutex));
-
-        if (dpkginfo_reply == NULL) {
-                switch (errflag) {
-		case 0: /* Not found */
-		{
-			dI("Package \"%s\" not found.", request_st);
-			break;
-		}
-		case -1: /* Error */
-		{
-			dI("dpkginfo_get_by_name failed.");
-			item = probe_item_create(OVAL_LINUX_DPKG_INFO, NULL,
-					"name", OVAL_DATATYPE_STRING, request_st,
-					NULL);
-			probe_item_setstatus (item, SYSCHAR_STATUS_ERROR);
-			probe_item_collect(ctx, item);
-			break;
-		}
-                }
+        name_op = probe_ent_getoperation(ent, OVAL_OPERATION_EQUALS);
+
+        /*
+         * Get info from the index of the dpkg status database. A name is
+         * looked up directly, other operations are matched against all
+         * the installed packages.
+         */
+        if (!g_dpkg.init_done)
+                count = -1;
+        else if (name_op == OVAL_OPERATION_EQUALS)
+                count = dpkginfo_get_by_name(request_st, &dpkginfo_reply);
+        else
+                count = dpkginfo_get_all(&dpkginfo_reply);
+
+        if (count < 0) {
+                dI("dpkginfo_get_by_name failed.");
+                item = probe_item_create(OVAL_LINUX_DPKG_INFO, NULL,
+                                "name", OVAL_DATATYPE_STRING, request_st,
+                                NULL);
+                probe_item_setstatus (item, SYSCHAR_STATUS_ERROR);
+                probe_item_collect(ctx, item);
+        } else if (count == 0) {
+                dI("Package \"%s\" not found.", request_st);
         } else { /* Ok */
-                int i;
-                int num_items = 1; /* FIXME */
 		oval_datatype_t evr_string_type;
 		oval_schema_version_t oval_version = probe_obj_get_platform_schema_version(obj);
 		if (oval_schema_version_cmp(oval_version, OVAL_SCHEMA_VERSION(5.11.1)) >= 0) {
@@ -160,20 +176,18 @@ int probe_main (probe_ctx *ctx, void *arg)
 			evr_string_type = OVAL_DATATYPE_EVR_STRING;
 		}
 
-                for (i = 0; i < num_items; ++i) {
-                        dI("%s: element found version %s", dpkginfo_reply->name, dpkginfo_reply->evr);
-                        item = probe_item_create (OVAL_LINUX_DPKG_INFO, NULL,
-                                        "name", OVAL_DATATYPE_STRING, dpkginfo_reply->name,
-                                        "arch", OVAL_DATATYPE_STRING, dpkginfo_reply->arch,
-                                        "epoch", OVAL_DATATYPE_STRING, dpkginfo_reply->epoch,
-                                        "release", OVAL_DATATYPE_STRING, dpkginfo_reply->release,
-                                        "version", OVAL_DATATYPE_STRING, dpkginfo_reply->version,
-					"evr", evr_string_type, dpkginfo_reply->evr,
-                                        NULL);
+                for (i = 0; i < count; ++i) {
+                        if (name_op != OVAL_OPERATION_EQUALS) {
+                                SEXP_t *name = SEXP_string_newf("%s", dpkginfo_reply[i]->name);
+                                oval_result_t res = probe_entobj_cmp(ent, name);
+
+                                SEXP_free(name);
 
-			probe_item_collect(ctx, item);
+                                if (res != OVAL_RESULT_TRUE)
+                                        continue;
+                        }
 
-                        dpkginfo_free_reply(dpkginfo_reply);
+                        dpkginfo_additem(ctx, dpkginfo_reply[i], evr_string_type);
                 }
         }
 
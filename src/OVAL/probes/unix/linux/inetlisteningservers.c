@@ -59,12 +59,24 @@
 #include <netdb.h>
 #include <arpa/inet.h>
 #include <regex.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
 
 #include "seap.h"
 #include "probe-api.h"
 #include "probe/entcmp.h"
 #include "alloc.h"
 #include "common/debug_priv.h"
+#include "probe/probe.h"
+#include "probe/option.h"
+#include "proctab.h"
+
+/* state of a listening TCP socket in /proc/net/tcp and sock_diag */
+#define TCP_STATE_LISTEN 0x0A
 
 /* This structure contains the information OVAL is asking or requesting */
 struct server_info {
@@ -82,222 +94,9 @@ struct result_info {
 	unsigned rport;
 };
 
-/* This structure is used to store information from scanning all runnning
- * processes. It will be used later to augment server info */
-typedef struct _lnode {
-  pid_t pid;            // process ID
-  uid_t uid;            // effective user ID
-  char *cmd;            // command run by user
-  unsigned long inode;  // inode of socket
-  struct _lnode* next;  // Next node pointer
-} lnode;
-
-/* This is the linked list head. Only data elements go here. */
-typedef struct {
-  lnode *head;          // List head
-  lnode *cur;           // Pointer to current node
-} llist;
-
 /* Local data */
 static struct server_info req;
 
-/* Function prototypes */
-static inline lnode *list_get_cur(llist *l) { return l->cur; }
-static void list_create(llist *l);
-static void list_append(llist *l, lnode *node);
-static void list_clear(llist* l);
-static lnode *list_find_inode(llist *l, unsigned long i);
-
-
-static void list_create(llist *l)
-{
-	l->head = NULL;
-	l->cur = NULL;
-}
-
-static void list_append(llist *l, lnode *node)
-{
-	lnode* newnode;
-
-	if (node == NULL || l == NULL)
-		return;
-
-	newnode = malloc(sizeof(lnode));
-	if (newnode == NULL)
-		return;
-
-	newnode->pid = node->pid;
-	newnode->uid = node->uid;
-	newnode->inode = node->inode;
-	// Take custody of the memory
-	newnode->cmd = node->cmd;
-	newnode->next = NULL;
-
-	// if we are at top, fix this up
-	if (l->head == NULL)
-		l->head = newnode;
-	else	// Otherwise add pointer to newnode
-		l->cur->next = newnode;
-
-	// make newnode current
-	l->cur = newnode;
-}
-
-static void list_clear(llist* l)
-{
-	lnode* nextnode;
-	register lnode* cur;
-
-	cur = l->head;
-	while (cur) {
-		nextnode=cur->next;
-		free(cur->cmd);
-		free(cur);
-		cur=nextnode;
-	}
-	l->head = NULL;
-	l->cur = NULL;
-}
-
-static lnode *list_find_inode(llist *l, unsigned long i)
-{
-        register lnode* cur;
-
-       	cur = l->head;	/* start at the beginning */
-	while (cur) {
-		if (cur->inode == i) {
-			l->cur = cur;
-			return cur;
-		} else
-			cur = cur->next;
-	}
-	return NULL;
-}
-
-static int collect_process_info(llist *l)
-{
-	DIR *d, *f;
-	struct dirent *ent;
-
-	d = opendir("/proc");
-	if (d == NULL)
-		return 1;
-
-	while (( ent = readdir(d) )) {
-		FILE *sf;
-		int pid, ppid;
-		char buf[100];
-		char *tmp, cmd[16], state, *text = NULL;
-		int fd, len, euid = 0;
-
-		// Skip non-process dir entries
-		if(*ent->d_name<'0' || *ent->d_name>'9')
-			continue;
-		errno = 0;
-		pid = strtol(ent->d_name, NULL, 10);
-		if (errno)
-			continue;
-
-		// Parse up the stat file for the proc
-		snprintf(buf, 32, "/proc/%d/stat", pid);
-		fd = open(buf, O_RDONLY, 0);
-		if (fd < 0)
-			continue;
-		len = read(fd, buf, sizeof buf - 1);
-		close(fd);
-		if (len < 40)
-			continue;
-		buf[len] = 0;
-		tmp = strrchr(buf, ')');
-		if (tmp)
-			*tmp = 0;
-		else
-			continue;
-		memset(cmd, 0, sizeof(cmd));
-		sscanf(buf, "%d (%15c", &ppid, cmd);
-		sscanf(tmp+2, "%c %d", &state, &ppid);
-
-		// Skip kthreads
-		if (pid == 2 || ppid == 2)
-			continue;
-
-		// Get the effective uid
-		snprintf(buf, 32, "/proc/%d/status", pid);
-		sf = fopen(buf, "rt");
-		if (sf) {
-			int line = 0;
-			__fsetlocking(sf, FSETLOCKING_BYCALLER);
-			while (fgets(buf, sizeof(buf), sf)) {
-				if (line == 0) {
-					line++;
-					continue;
-				}
-				if (memcmp(buf, "Uid:", 4) == 0) {
-					int id;
-					sscanf(buf, "Uid: %d %d",
-						&id, &euid);
-					break;
-				}
-			}
-			fclose(sf);
-		}
-
-		// Now lets get the inodes each process has open
-		snprintf(buf, 32, "/proc/%d/fd", pid);
-		f = opendir(buf);
-		if (f == NULL) {
-			// Process might have ended or we don;t have access - ignore it
-			free(text);
-			continue;
-		}
-		// For each file in the fd dir...
-		while (( ent = readdir(f) )) {
-			char line[256], ln[256], *s, *e;
-			unsigned long inode;
-			lnode node;
-			int lnlen;
-
-			if (ent->d_name[0] == '.')
-				continue;
-			snprintf(ln, 256, "%s/%s", buf, ent->d_name);
-			if ((lnlen = readlink(ln, line, sizeof(line)-1)) < 0)
-				continue;
-			line[lnlen] = 0;
-
-			// Only look at the socket entries
-			if (memcmp(line, "socket:", 7) == 0) {
-				// Type 1 sockets
-				s = strchr(line+7, '[');
-				if (s == NULL)
-					continue;
-				s++;
-				e = strchr(s, ']');
-				if (e == NULL)
-					continue;
-				*e = 0;
-			} else if (memcmp(line, "[0000]:", 7) == 0) {
-				// Type 2 sockets
-				s = line + 8;
-			} else
-				continue;
-			errno = 0;
-			inode = strtoul(s, NULL, 10);
-			if (errno)
-				continue;
-			node.pid = pid;
-			node.uid = euid;
-			node.cmd = strdup(cmd);
-			node.inode = inode;
-			// We make one entry for each socket inode
-			list_append(l, &node);
-		}
-		closedir(f);
-		free(text);
-	}
-	closedir(d);
-	return 0;
-}
-
 static int eval_data(const char *type, const char *local_address,
 	unsigned int local_port)
 {
@@ -327,15 +126,10 @@ static int eval_data(const char *type, const char *local_address,
 	return 1;
 }
 
-static void report_finding(struct result_info *res, llist *l, probe_ctx *ctx)
+static void report_finding(struct result_info *res, proctab_ent_t *n, probe_ctx *ctx)
 {
         SEXP_t *item;
         SEXP_t se_lport_mem, se_rport_mem, se_lfull_mem, se_ffull_mem, *se_uid_mem = NULL;
-	lnode *n = NULL;
-
-	if (l) {
-		n = list_get_cur(l);
-	}
 
 	if (n) {
                 item = probe_item_create(OVAL_LINUX_INET_LISTENING_SERVER, NULL,
@@ -344,13 +138,13 @@ static void report_finding(struct result_info *res, llist *l, probe_ctx *ctx)
 				 "local_port",           OVAL_DATATYPE_SEXP, SEXP_number_newu_64_r(&se_lport_mem, res->lport),
                                  "local_full_address",   OVAL_DATATYPE_SEXP,    SEXP_string_newf_r(&se_lfull_mem,
                                                                                                    "%s:%u", res->laddr, res->lport),
-                                 "program_name",         OVAL_DATATYPE_STRING,  n->cmd,
+                                 "program_name",         OVAL_DATATYPE_STRING,  n->comm,
                                  "foreign_address",      OVAL_DATATYPE_STRING,  res->raddr,
 				 "foreign_port",         OVAL_DATATYPE_SEXP, SEXP_number_newu_64_r(&se_rport_mem, res->rport),
                                  "foreign_full_address", OVAL_DATATYPE_SEXP,    SEXP_string_newf_r(&se_ffull_mem,
                                                                                                    "%s:%u", res->raddr, res->rport),
                                  "pid",                  OVAL_DATATYPE_INTEGER, (int64_t)n->pid,
-				 "user_id",              OVAL_DATATYPE_SEXP, se_uid_mem = SEXP_number_newu_64(n->uid),
+				 "user_id",              OVAL_DATATYPE_SEXP, se_uid_mem = SEXP_number_newu_64(n->euid != -1 ? (uid_t)n->euid : 0),
                                  NULL);
 	} else {
                 item = probe_item_create(OVAL_LINUX_INET_LISTENING_SERVER, NULL,
@@ -391,7 +185,7 @@ static void addr_convert(const char *src, char *dest, int size)
 }
 
 
-static int read_tcp(const char *proc, const char *type, llist *l, probe_ctx *ctx)
+static int read_tcp(const char *proc, const char *type, proctab_t *tab, probe_ctx *ctx)
 {
 	int line = 0;
 	FILE *f;
@@ -421,6 +215,9 @@ static int read_tcp(const char *proc, const char *type, llist *l, probe_ctx *ctx
 			&state, &txq, &rxq, &timer_run, &time_len, &retr,
 			&uid, &timeout, &inode, more);
 
+		if (state != TCP_STATE_LISTEN)
+			continue;
+
 		char src[NI_MAXHOST], dest[NI_MAXHOST];
 		addr_convert(local_addr, src, NI_MAXHOST);
 		addr_convert(rem_addr, dest, NI_MAXHOST);
@@ -432,18 +229,14 @@ static int read_tcp(const char *proc, const char *type, llist *l, probe_ctx *ctx
 			r.lport = local_port;
 			r.raddr = dest;
 			r.rport = rem_port;
-			if (list_find_inode(l, inode)) {
-				report_finding(&r, l, ctx);
-			} else {
-				report_finding(&r, NULL, ctx);
-			}
+			report_finding(&r, proctab_socket(tab, inode), ctx);
 		}
 	}
 	fclose(f);
 	return 0;
 }
 
-static int read_udp(const char *proc, const char *type, llist *l, probe_ctx *ctx)
+static int read_udp(const char *proc, const char *type, proctab_t *tab, probe_ctx *ctx)
 {
 	int line = 0;
 	FILE *f;
@@ -483,18 +276,14 @@ static int read_udp(const char *proc, const char *type, llist *l, probe_ctx *ctx
 			r.lport = local_port;
 			r.raddr = dest;
 			r.rport = rem_port;
-			if (list_find_inode(l, inode)) {
-				report_finding(&r, l, ctx);
-			} else {
-				report_finding(&r, NULL, ctx);
-			}
+			report_finding(&r, proctab_socket(tab, inode), ctx);
 		}
 	}
 	fclose(f);
 	return 0;
 }
 
-static int read_raw(const char *proc, const char *type, llist *l, probe_ctx *ctx)
+static int read_raw(const char *proc, const char *type, proctab_t *tab, probe_ctx *ctx)
 {
 	int line = 0;
 	FILE *f;
@@ -534,22 +323,107 @@ static int read_raw(const char *proc, const char *type, llist *l, probe_ctx *ctx
 			r.lport = local_port;
 			r.raddr = dest;
 			r.rport = rem_port;
-			if (list_find_inode(l, inode)) {
-				report_finding(&r, l, ctx);
-			} else {
-				report_finding(&r, NULL, ctx);
-			}
+			report_finding(&r, proctab_socket(tab, inode), ctx);
 		}
 	}
 	fclose(f);
 	return 0;
 }
 
+/*
+ * Ask the kernel for the sockets of one protocol and address family over
+ * NETLINK_SOCK_DIAG. The sockets come in binary form with their inode,
+ * so nothing has to be parsed from the text of /proc/net.
+ * @return 0 on success, -1 if no socket was reported and the caller
+ *         should read /proc/net instead, 1 on an error after some sockets
+ *         were reported
+ */
+static int read_diag(int fd, uint8_t family, uint8_t protocol, uint32_t states,
+		     const char *type, proctab_t *tab, probe_ctx *ctx)
+{
+	struct {
+		struct nlmsghdr nlh;
+		struct inet_diag_req_v2 r;
+	} msg;
+	struct sockaddr_nl nladdr;
+	long buf[32768 / sizeof(long)];
+	unsigned int reported = 0;
+	static uint32_t seq = 0;
+
+	memset(&nladdr, 0, sizeof nladdr);
+	nladdr.nl_family = AF_NETLINK;
+
+	memset(&msg, 0, sizeof msg);
+	msg.nlh.nlmsg_len   = sizeof msg;
+	msg.nlh.nlmsg_type  = SOCK_DIAG_BY_FAMILY;
+	msg.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	msg.nlh.nlmsg_seq   = __sync_add_and_fetch(&seq, 1);
+	msg.r.sdiag_family   = family;
+	msg.r.sdiag_protocol = protocol;
+	msg.r.idiag_states   = states;
+
+	if (sendto(fd, &msg, sizeof msg, 0, (struct sockaddr *)&nladdr, sizeof nladdr) < 0) {
+		dW("Can't send a sock_diag request: %s", strerror(errno));
+		return (-1);
+	}
+
+	for (;;) {
+		struct nlmsghdr *h;
+		ssize_t len;
+
+		len = recv(fd, buf, sizeof buf, 0);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			dW("Can't receive a sock_diag reply: %s", strerror(errno));
+			return (reported > 0 ? 1 : -1);
+		}
+		if (len == 0)
+			break;
+
+		for (h = (struct nlmsghdr *)buf; NLMSG_OK(h, (size_t)len); h = NLMSG_NEXT(h, len)) {
+			struct inet_diag_msg *m;
+			struct result_info r;
+			char src[NI_MAXHOST], dest[NI_MAXHOST];
+
+			if (h->nlmsg_seq != msg.nlh.nlmsg_seq)
+				continue;
+			if (h->nlmsg_type == NLMSG_DONE)
+				return (0);
+			if (h->nlmsg_type == NLMSG_ERROR) {
+				struct nlmsgerr *e = (struct nlmsgerr *)NLMSG_DATA(h);
+
+				/* e.g. the diag module for the protocol isn't available */
+				dI("sock_diag request for %s/%d failed: %s", type, family, strerror(-e->error));
+				return (reported > 0 ? 1 : -1);
+			}
+
+			m = (struct inet_diag_msg *)NLMSG_DATA(h);
+			inet_ntop(m->idiag_family, m->id.idiag_src, src, NI_MAXHOST);
+			inet_ntop(m->idiag_family, m->id.idiag_dst, dest, NI_MAXHOST);
+
+			r.proto = type;
+			r.laddr = src;
+			r.lport = ntohs(m->id.idiag_sport);
+			r.raddr = dest;
+			r.rport = ntohs(m->id.idiag_dport);
+			++reported;
+
+			dI("Have %s port: %s:%u", type, src, r.lport);
+			if (eval_data(type, src, r.lport))
+				report_finding(&r, proctab_socket(tab, m->idiag_inode), ctx);
+		}
+	}
+
+	return (0);
+}
+
 int probe_main(probe_ctx *ctx, void *arg)
 {
         SEXP_t *object;
-	int err;
-	llist ll;
+	int err, fd = -1;
+	proctab_t *tab;
+	probe_offline_flags offline_mode = PROBE_OFFLINE_NONE;
 
         object = probe_ctx_getobject(ctx);
 
@@ -572,8 +446,8 @@ int probe_main(probe_ctx *ctx, void *arg)
 	}
 
 	// Now start collecting the info
-	list_create(&ll);
-	if (collect_process_info(&ll)) {
+	tab = proctab_get(PROCTAB_STATUS | PROCTAB_SOCKETS);
+	if (tab == NULL) {
 		SEXP_t *msg;
 
 		msg = probe_msg_creat(OVAL_MESSAGE_LEVEL_ERROR, "Permission error.");
@@ -585,20 +459,36 @@ int probe_main(probe_ctx *ctx, void *arg)
 		goto cleanup;
 	}
 
+	/*
+	 * The sockets are read with sock_diag when it's available. The
+	 * text in /proc/net is the fallback, and it's always used in the
+	 * offline mode, where sock_diag would describe the host.
+	 */
+	probe_getoption(PROBEOPT_OFFLINE_MODE_SUPPORTED, NULL, &offline_mode);
+	if (offline_mode == PROBE_OFFLINE_NONE)
+		fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+
 	// Now we check the tcp socket list...
-	read_tcp("/proc/net/tcp", "tcp", &ll, ctx);
-	read_tcp("/proc/net/tcp6", "tcp", &ll, ctx);
+	if (fd == -1 || read_diag(fd, AF_INET, IPPROTO_TCP, 1 << TCP_STATE_LISTEN, "tcp", tab, ctx) < 0)
+		read_tcp("/proc/net/tcp", "tcp", tab, ctx);
+	if (fd == -1 || read_diag(fd, AF_INET6, IPPROTO_TCP, 1 << TCP_STATE_LISTEN, "tcp", tab, ctx) < 0)
+		read_tcp("/proc/net/tcp6", "tcp", tab, ctx);
 
 	// Next udp sockets...
-	read_udp("/proc/net/udp", "udp", &ll, ctx);
-	read_udp("/proc/net/udp6", "udp", &ll, ctx);
+	if (fd == -1 || read_diag(fd, AF_INET, IPPROTO_UDP, ~0U, "udp", tab, ctx) < 0)
+		read_udp("/proc/net/udp", "udp", tab, ctx);
+	if (fd == -1 || read_diag(fd, AF_INET6, IPPROTO_UDP, ~0U, "udp", tab, ctx) < 0)
+		read_udp("/proc/net/udp6", "udp", tab, ctx);
+
+	if (fd != -1)
+		close(fd);
 
 	// Next, raw sockets...not exactly part of standard yet. They
 	// can be used to send datagrams, so we will pretend they are udp
-	read_raw("/proc/net/raw", "udp", &ll, ctx);
-	read_raw("/proc/net/raw6", "udp", &ll, ctx);
+	read_raw("/proc/net/raw", "udp", tab, ctx);
+	read_raw("/proc/net/raw6", "udp", tab, ctx);
 
-	list_clear(&ll);
+	proctab_put(tab);
 
 	err = 0;
  cleanup:
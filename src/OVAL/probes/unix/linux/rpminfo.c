@@ -51,6 +51,8 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
@@ -58,6 +60,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <regex.h>
+#include <limits.h>
 
 /* RPM headers */
 #include "rpm-helper.h"
@@ -87,6 +90,18 @@ struct rpminfo_rep {
         char *evr;
         char *signature_keyid;
 	char extended_name[1024];
+	unsigned int offset; /**< database record of the header */
+};
+
+/*
+ * Package index. All the headers are read by the first request and the
+ * following requests are answered without accessing the database.
+ */
+struct rpminfo_index {
+	struct rpminfo_rep  *pkgs;  /**< in the database order */
+	struct rpminfo_rep **names; /**< sorted by the name */
+	size_t count;
+	bool   loaded;
 };
 
 #define RPMINFO_LOCK	RPM_MUTEX_LOCK(&g_rpm.mutex)
@@ -96,6 +111,7 @@ struct rpminfo_rep {
 static struct rpm_probe_global g_rpm;
 static const char g_keyid_regex_string[] = "Key ID [a-fA-F0-9]{16}";
 static regex_t g_keyid_regex;
+static struct rpminfo_index g_index;
 
 static void __rpminfo_rep_free (struct rpminfo_rep *ptr)
 {
@@ -162,103 +178,134 @@ static void pkgh2rep (Header h, struct rpminfo_rep *r)
         oscap_free (str);
 }
 
+static int rpminfo_namecmp(const void *a, const void *b)
+{
+	const struct rpminfo_rep *ra = *(struct rpminfo_rep * const *)a;
+	const struct rpminfo_rep *rb = *(struct rpminfo_rep * const *)b;
+	int cmp;
+
+	cmp = strcmp(ra->name, rb->name);
+	if (cmp != 0)
+		return (cmp);
+
+	return (ra->offset < rb->offset ? -1 : ra->offset > rb->offset);
+}
+
+/* must be called with the rpm mutex locked */
+static void rpminfo_index_load(void)
+{
+	rpmdbMatchIterator match;
+	Header pkgh;
+	size_t alloc = 0, i;
+
+	match = rpmtsInitIterator (g_rpm.rpmts, RPMDBI_PACKAGES, NULL, 0);
+
+	if (match != NULL) {
+		while ((pkgh = rpmdbNextIterator (match)) != NULL) {
+			if (g_index.count == alloc) {
+				alloc = alloc ? alloc * 2 : 1024;
+				g_index.pkgs = oscap_realloc (g_index.pkgs, sizeof (struct rpminfo_rep) * alloc);
+			}
+
+			pkgh2rep (pkgh, g_index.pkgs + g_index.count);
+			g_index.pkgs[g_index.count].offset = rpmdbGetIteratorOffset (match);
+			g_index.count++;
+		}
+
+		match = rpmdbFreeIterator (match);
+	}
+
+	g_index.names = oscap_alloc (sizeof (struct rpminfo_rep *) * (g_index.count + 1));
+
+	for (i = 0; i < g_index.count; ++i)
+		g_index.names[i] = g_index.pkgs + i;
+
+	qsort (g_index.names, g_index.count, sizeof (struct rpminfo_rep *), rpminfo_namecmp);
+
+	dI("Package index: %zu packages", g_index.count);
+	g_index.loaded = true;
+}
+
+static void rpminfo_index_free(void)
+{
+	size_t i;
+
+	for (i = 0; i < g_index.count; ++i)
+		__rpminfo_rep_free (g_index.pkgs + i);
+
+	oscap_free (g_index.pkgs);
+	oscap_free (g_index.names);
+	memset (&g_index, 0, sizeof g_index);
+}
+
 /*
  * req - Structure containing the name of the package.
- * rep - Pointer to rpminfo_rep structure pointer. An
- *       array of rpminfo_rep structures will be allocated
- *       here.
+ * rep - Pointer to an array of rpminfo_rep structure pointers
+ *       which will be allocated here. The structures belong
+ *       to the package index.
  *
  * The return value on error is -1. Otherwise the number of
- * rpminfo_rep structures allocated in *rep is returned.
+ * rpminfo_rep structure pointers stored in *rep is returned.
  */
-static int get_rpminfo (struct rpminfo_req *req, struct rpminfo_rep **rep)
+static int get_rpminfo (struct rpminfo_req *req, struct rpminfo_rep ***rep)
 {
-	rpmdbMatchIterator match;
-	Header pkgh;
-	int ret = 0, i;
+	regex_t re;
+	size_t lo, hi, i;
+	int ret = 0;
 
         RPMINFO_LOCK;
 
-        ret = -1;
+	if (!g_index.loaded)
+		rpminfo_index_load ();
+
+        RPMINFO_UNLOCK;
+
+	/* the index doesn't change once it's loaded */
+	(*rep) = oscap_realloc (*rep, sizeof (struct rpminfo_rep *) * (g_index.count + 1));
 
         switch (req->op) {
         case OVAL_OPERATION_EQUALS:
-                match = rpmtsInitIterator (g_rpm.rpmts, RPMTAG_NAME, (const void *)req->name, 0);
+		/* the first package with the name */
+		lo = 0;
+		hi = g_index.count;
 
-                if (match == NULL) {
-                        ret = 0;
-                        goto ret;
-                }
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+
+			if (strcmp (g_index.names[mid]->name, req->name) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
 
-                ret = rpmdbGetIteratorCount (match);
+		for (i = lo; i < g_index.count && strcmp (g_index.names[i]->name, req->name) == 0; ++i)
+			(*rep)[ret++] = g_index.names[i];
 
                 break;
 	case OVAL_OPERATION_NOT_EQUAL:
-                match = rpmtsInitIterator (g_rpm.rpmts, RPMDBI_PACKAGES, NULL, 0);
-                if (match == NULL) {
-                        ret = 0;
-                        goto ret;
-                }
-
-                if (rpmdbSetIteratorRE (match, RPMTAG_NAME, RPMMIRE_GLOB, "*") != 0)
-                {
-                        ret = -1;
-                        goto ret;
-                }
+		for (i = 0; i < g_index.count; ++i)
+			(*rep)[ret++] = g_index.pkgs + i;
 
                 break;
         case OVAL_OPERATION_PATTERN_MATCH:
-                match = rpmtsInitIterator (g_rpm.rpmts, RPMDBI_PACKAGES, NULL, 0);
-
-                if (match == NULL) {
-                        ret = 0;
-                        goto ret;
-                }
+		/* the same as RPMMIRE_REGEX */
+		if (regcomp (&re, req->name, REG_EXTENDED | REG_NOSUB) != 0) {
+			ret = -1;
+			break;
+		}
 
-                if (rpmdbSetIteratorRE (match, RPMTAG_NAME, RPMMIRE_REGEX,
-                                        (const char *)req->name) != 0)
-                {
-                        ret = -1;
-                        goto ret;
-                }
+		for (i = 0; i < g_index.count; ++i) {
+			if (regexec (&re, g_index.pkgs[i].name, 0, NULL, 0) == 0)
+				(*rep)[ret++] = g_index.pkgs + i;
+		}
 
+		regfree (&re);
                 break;
         default:
                 /* not supported */
                 ret = -1;
-                goto ret;
         }
 
-        if (ret != -1) {
-                /*
-                 * We can allocate all memory needed now because we know the number
-                 * of results.
-                 */
-                (*rep) = oscap_realloc (*rep, sizeof (struct rpminfo_rep) * ret);
-
-                for (i = 0; i < ret; ++i) {
-                        pkgh = rpmdbNextIterator (match);
-
-                        if (pkgh != NULL)
-                                pkgh2rep (pkgh, (*rep) + i);
-                        else {
-                                /* XXX: emit warning */
-                                break;
-                        }
-                }
-        } else {
-                ret = 0;
-
-                while ((pkgh = rpmdbNextIterator (match)) != NULL) {
-                        (*rep) = oscap_realloc (*rep, sizeof (struct rpminfo_rep) * ++ret);
-                        assume_r (*rep != NULL, -1);
-                        pkgh2rep (pkgh, (*rep) + (ret - 1));
-                }
-        }
-
-	match = rpmdbFreeIterator (match);
-ret:
-        RPMINFO_UNLOCK;
         return (ret);
 }
 
@@ -280,6 +327,26 @@ void *probe_init (void)
                 return (NULL);
         }
 
+	/*
+	 * The collected objects depend only on the package database,
+	 * so they can be reused by later scans until it changes.
+	 */
+	{
+		const char *db_files[] = { "Packages", "Packages.db", "rpmdb.sqlite" };
+		char *dbpath = rpmExpand("%{_dbpath}", NULL);
+		char  db_file[PATH_MAX];
+		size_t i;
+
+		probe_setoption(PROBEOPT_PERSISTENT_CACHE, dbpath);
+
+		for (i = 0; i < sizeof db_files / sizeof db_files[0]; ++i) {
+			snprintf(db_file, sizeof db_file, "%s/%s", dbpath, db_files[i]);
+			probe_setoption(PROBEOPT_PERSISTENT_CACHE, db_file);
+		}
+
+		free(dbpath);
+	}
+
         g_rpm.rpmts = rpmtsCreate();
         pthread_mutex_init (&(g_rpm.mutex), NULL);
 
@@ -295,6 +362,7 @@ void probe_fini (void *ptr)
 {
         struct rpm_probe_global *r = (struct rpm_probe_global *)ptr;
 
+        rpminfo_index_free();
         rpmtsFree(r->rpmts);
 	rpmFreeCrypto();
         rpmFreeRpmrc();
@@ -314,32 +382,15 @@ static int collect_rpm_files(SEXP_t *item, const struct rpminfo_rep *rep) {
 	rpmTag tag[2] = { RPMTAG_BASENAMES, RPMTAG_DIRNAMES };
 	int i, ret = 0;
 
-	ts = rpmtsInitIterator(g_rpm.rpmts, RPMDBI_PACKAGES, NULL, 0);
+	RPMINFO_LOCK;
+
+	/* the header of the package is read directly from its record */
+	ts = rpmtsInitIterator(g_rpm.rpmts, RPMDBI_PACKAGES, &rep->offset, sizeof(rep->offset));
 	if (ts == NULL) {
+		RPMINFO_UNLOCK;
 		return -1;
 	}
 
-	if (rpmdbSetIteratorRE(ts, RPMTAG_NAME, RPMMIRE_STRCMP, rep->name) != 0) {
-		ret = -1;
-		goto cleanup;
-	}
-	if (rpmdbSetIteratorRE(ts, RPMTAG_EPOCH, RPMMIRE_STRCMP, rep->epoch) != 0) {
-		ret = -1;
-		goto cleanup;
-	}
-	if (rpmdbSetIteratorRE(ts, RPMTAG_VERSION, RPMMIRE_STRCMP, rep->version) != 0) {
-		ret = -1;
-		goto cleanup;
-	}
-	if (rpmdbSetIteratorRE(ts, RPMTAG_RELEASE, RPMMIRE_STRCMP, rep->release) != 0) {
-		ret = -1;
-		goto cleanup;
-	}
-	if (rpmdbSetIteratorRE(ts, RPMTAG_ARCH, RPMMIRE_STRCMP, rep->arch) != 0) {
-		ret = -1;
-		goto cleanup;
-	}
-
 	while ((pkgh = rpmdbNextIterator(ts)) != NULL) {
 		/*
 		 * Inspect package files & directories
@@ -364,8 +415,9 @@ static int collect_rpm_files(SEXP_t *item, const struct rpminfo_rep *rep) {
 		}
 
 	}
-cleanup:
 	ts = rpmdbFreeIterator(ts);
+	RPMINFO_UNLOCK;
+
 	return ret;
 }
 
@@ -376,7 +428,7 @@ int probe_main (probe_ctx *ctx, void *arg)
 	int rpmret, i;
 
         struct rpminfo_req request_st;
-        struct rpminfo_rep *reply_st;
+        struct rpminfo_rep **reply_st;
 
 	if (g_rpm.rpmts == NULL) {
 		probe_cobj_set_flag(probe_ctx_getresult(ctx), SYSCHAR_FLAG_NOT_APPLICABLE);
@@ -468,7 +520,7 @@ int probe_main (probe_ctx *ctx, void *arg)
                         SEXP_t *name;
 
                         for (i = 0; i < rpmret; ++i) {
-				name = SEXP_string_newf("%s", reply_st[i].name);
+				name = SEXP_string_newf("%s", reply_st[i]->name);
 
 				if (probe_entobj_cmp(ent, name) != OVAL_RESULT_TRUE) {
 					SEXP_free(name);
@@ -477,12 +529,12 @@ int probe_main (probe_ctx *ctx, void *arg)
 
                                 item = probe_item_create(OVAL_LINUX_RPM_INFO, NULL,
                                                          "name",    OVAL_DATATYPE_SEXP, name,
-                                                         "arch",    OVAL_DATATYPE_STRING, reply_st[i].arch,
-                                                         "epoch",   OVAL_DATATYPE_STRING, reply_st[i].epoch,
-                                                         "release", OVAL_DATATYPE_STRING, reply_st[i].release,
-                                                         "version", OVAL_DATATYPE_STRING, reply_st[i].version,
-                                                         "evr",     OVAL_DATATYPE_EVR_STRING, reply_st[i].evr,
-                                                         "signature_keyid", OVAL_DATATYPE_STRING, reply_st[i].signature_keyid,
+                                                         "arch",    OVAL_DATATYPE_STRING, reply_st[i]->arch,
+                                                         "epoch",   OVAL_DATATYPE_STRING, reply_st[i]->epoch,
+                                                         "release", OVAL_DATATYPE_STRING, reply_st[i]->release,
+                                                         "version", OVAL_DATATYPE_STRING, reply_st[i]->version,
+                                                         "evr",     OVAL_DATATYPE_EVR_STRING, reply_st[i]->evr,
+                                                         "signature_keyid", OVAL_DATATYPE_STRING, reply_st[i]->signature_keyid,
                                                          NULL);
 
 				/* OVAL 5.10 added extended_name and filepaths behavior */
@@ -490,8 +542,8 @@ int probe_main (probe_ctx *ctx, void *arg)
 					SEXP_t *value, *bh_value;
 					value = probe_entval_from_cstr(
 							OVAL_DATATYPE_STRING,
-							reply_st[i].extended_name,
-							strlen(reply_st[i].extended_name)
+							reply_st[i]->extended_name,
+							strlen(reply_st[i]->extended_name)
 					);
 					probe_item_ent_add(item, "extended_name", NULL, value);
 					SEXP_free(value);
@@ -505,7 +557,7 @@ int probe_main (probe_ctx *ctx, void *arg)
 						if (bh_value != NULL) {
 							if (SEXP_strcmp(bh_value, "true") == 0) {
 								/* collect package files */
-								collect_rpm_files(item, &reply_st[i]);
+								collect_rpm_files(item, reply_st[i]);
 
 							}
 							SEXP_free(bh_value);
@@ -517,18 +569,18 @@ int probe_main (probe_ctx *ctx, void *arg)
 
 
 				SEXP_free(name);
-                                __rpminfo_rep_free (&(reply_st[i]));
 
 				if (probe_item_collect(ctx, item) < 0) {
 					SEXP_vfree(ent, NULL);
+					oscap_free (reply_st);
 					return PROBE_EUNKNOWN;
 				}
                         }
-
-                        oscap_free (reply_st);
                 }
         }
 
+        oscap_free (reply_st);
+
 	SEXP_vfree(ent, NULL);
         oscap_free(request_st.name);
 
@@ -34,10 +34,14 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <errno.h>
 #include <assert.h>
 #include <limits.h>
+#include <stdbool.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -48,6 +52,9 @@
 /* Individual RPM headers */
 #include <rpm/rpmfi.h>
 #include <rpm/rpmcli.h>
+#ifdef HAVE_RPM47
+#include <rpm/rpmpgp.h>
+#endif
 
 /* SEAP */
 #include <probe-api.h>
@@ -58,6 +65,8 @@
 
 #include <probe/probe.h>
 #include <probe/option.h>
+#include <crapi/crapi.h>
+#include <crapi/digest.h>
 
 struct rpmverify_res {
 	char *name;  /**< package name */
@@ -65,8 +74,8 @@ struct rpmverify_res {
 	const char *version;
 	const char *release;
 	const char *arch;
-	const char *file;  /**< filepath */
-	char extended_name[1024];
+	char *file;  /**< filepath */
+	const char *extended_name;
 	rpmVerifyAttrs vflags; /**< rpm verify flags */
 	rpmVerifyAttrs oflags; /**< rpm verify omit flags */
 	rpmfileAttrs   fflags; /**< rpm file flags */
@@ -93,6 +102,12 @@ struct rpmverify_res {
 
 static struct rpm_probe_global g_rpm;
 
+/*
+ * rpmVerifyFile() undoes prelinking before the digest is computed, so
+ * the digests are left to it when a prelink undo command is configured.
+ */
+static bool g_prelink_undo = false;
+
 #define RPMVERIFY_LOCK   RPM_MUTEX_LOCK(&g_rpm.mutex)
 
 #define RPMVERIFY_UNLOCK RPM_MUTEX_UNLOCK(&g_rpm.mutex)
@@ -126,11 +141,202 @@ static int adjust_filter(rpmdbMatchIterator iterator, SEXP_t *ent, rpmTag rpm_ta
 	return ret;
 }
 
-static int rpmverify_collect(probe_ctx *ctx,
-			     const char *file, oval_operation_t file_op,
-			     SEXP_t *name_ent, SEXP_t *epoch_ent, SEXP_t *version_ent, SEXP_t *release_ent, SEXP_t *arch_ent,
-			     uint64_t flags,
-			     int (*callback)(probe_ctx *, struct rpmverify_res *))
+#ifndef RPMVERIFY_WORKERS_MAX
+#define RPMVERIFY_WORKERS_MAX 4
+#endif
+
+struct rpmverify_pkg {
+	char *name;
+	char *epoch;
+	char *version;
+	char *release;
+	char *arch;
+	char  extended_name[1024];
+};
+
+struct rpmverify_file {
+	struct rpmverify_res res;
+	crapi_alg_t    digest_alg; /**< 0 if rpmVerifyFile() checked the digest */
+	unsigned char *digest;     /**< digest stored in the header */
+	size_t         digest_len;
+};
+
+/*
+ * Files selected by the header iteration. The digests are checked by
+ * rpmverify_worker() threads afterwards, without the rpm mutex held.
+ */
+struct rpmverify_batch {
+	struct rpmverify_pkg **pkgs;
+	size_t pkgcnt;
+
+	struct rpmverify_file *files;
+	size_t count;
+	size_t alloc;
+	size_t next; /**< next file to be digested */
+};
+
+static void rpmverify_batch_free(struct rpmverify_batch *b)
+{
+	size_t i;
+
+	for (i = 0; i < b->count; ++i) {
+		oscap_free(b->files[i].res.file);
+		oscap_free(b->files[i].digest);
+	}
+
+	for (i = 0; i < b->pkgcnt; ++i) {
+		free(b->pkgs[i]->name);
+		free(b->pkgs[i]->epoch);
+		free(b->pkgs[i]->version);
+		free(b->pkgs[i]->release);
+		free(b->pkgs[i]->arch);
+		oscap_free(b->pkgs[i]);
+	}
+
+	oscap_free(b->files);
+	oscap_free(b->pkgs);
+}
+
+#ifdef HAVE_RPM47
+static crapi_alg_t rpmverify_crapi_alg(int algo)
+{
+	switch (algo) {
+	case PGPHASHALGO_MD5:
+		return CRAPI_DIGEST_MD5;
+	case PGPHASHALGO_SHA1:
+		return CRAPI_DIGEST_SHA1;
+	case PGPHASHALGO_RIPEMD160:
+		return CRAPI_DIGEST_RMD160;
+	case PGPHASHALGO_SHA224:
+		return CRAPI_DIGEST_SHA224;
+	case PGPHASHALGO_SHA256:
+		return CRAPI_DIGEST_SHA256;
+	case PGPHASHALGO_SHA384:
+		return CRAPI_DIGEST_SHA384;
+	case PGPHASHALGO_SHA512:
+		return CRAPI_DIGEST_SHA512;
+	}
+
+	return (crapi_alg_t)0;
+}
+#endif
+
+/*
+ * Verify the file `fi' points to. The digest is left to the workers
+ * if rpm would check it, crapi supports its algorithm and prelinking
+ * doesn't have to be undone.
+ */
+static void rpmverify_file(struct rpmverify_file *f, rpmfi fi, rpmVerifyAttrs omit)
+{
+	rpmVerifyAttrs vomit = omit;
+
+	f->digest_alg = (crapi_alg_t)0;
+	f->digest     = NULL;
+	f->digest_len = 0;
+
+#ifdef HAVE_RPM47
+	if (!g_prelink_undo
+	    && !(omit & RPMVERIFY_FILEDIGEST)
+	    && (rpmfiVFlags(fi) & RPMVERIFY_FILEDIGEST)
+	    && !(f->res.fflags & RPMFILE_GHOST)
+	    && rpmfiFState(fi) == RPMFILE_STATE_NORMAL)
+	{
+		const unsigned char *digest;
+		pgpHashAlgo algo;
+		size_t len;
+
+		digest = rpmfiFDigest(fi, &algo, &len);
+
+		if (digest != NULL && (f->digest_alg = rpmverify_crapi_alg(algo)) != 0) {
+			f->digest = oscap_alloc(len);
+			f->digest_len = len;
+			memcpy(f->digest, digest, len);
+			vomit |= RPMVERIFY_FILEDIGEST;
+		}
+	}
+#endif
+
+	if (rpmVerifyFile(g_rpm.rpmts, fi, &f->res.vflags, vomit) != 0) {
+		f->res.vflags = RPMVERIFY_FAILURES;
+		f->digest_alg = (crapi_alg_t)0;
+	}
+}
+
+/* check the digest the way rpmVerifyFile() does */
+static void rpmverify_digest(struct rpmverify_file *f)
+{
+	unsigned char digest[128];
+	size_t len = sizeof digest;
+	struct stat st;
+	int fd;
+
+	/* only the digests of regular files are checked */
+	if (lstat(f->res.file, &st) != 0 || !S_ISREG(st.st_mode))
+		return;
+
+	fd = open(f->res.file, O_RDONLY);
+	if (fd == -1 || crapi_digest_fd(fd, f->digest_alg, digest, &len) != 0)
+		f->res.vflags |= RPMVERIFY_READFAIL | RPMVERIFY_FILEDIGEST;
+	else if (len != f->digest_len || memcmp(digest, f->digest, len) != 0)
+		f->res.vflags |= RPMVERIFY_FILEDIGEST;
+
+	if (fd != -1)
+		close(fd);
+}
+
+static void *rpmverify_worker(void *arg)
+{
+	struct rpmverify_batch *b = (struct rpmverify_batch *)arg;
+	size_t i;
+
+	while ((i = __sync_fetch_and_add(&b->next, 1)) < b->count) {
+		if (b->files[i].digest_alg != 0)
+			rpmverify_digest(b->files + i);
+	}
+
+	return (NULL);
+}
+
+static void rpmverify_digest_all(struct rpmverify_batch *b)
+{
+	pthread_t workers[RPMVERIFY_WORKERS_MAX];
+	size_t i, digests = 0;
+	long ncpu;
+	unsigned int n, nworkers;
+
+	for (i = 0; i < b->count; ++i) {
+		if (b->files[i].digest_alg != 0)
+			++digests;
+	}
+
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	nworkers = ncpu < 1 ? 1 : (ncpu > RPMVERIFY_WORKERS_MAX ? RPMVERIFY_WORKERS_MAX : (unsigned int)ncpu);
+	if (nworkers > digests)
+		nworkers = digests > 0 ? digests : 1;
+
+	/* the calling thread is one of the workers */
+	for (n = 1; n < nworkers; ++n) {
+		if (pthread_create(workers + n, NULL, rpmverify_worker, b) != 0) {
+			dW("Can't start a digest worker");
+			break;
+		}
+	}
+
+	rpmverify_worker(b);
+
+	while (--n > 0)
+		pthread_join(workers[n], NULL);
+}
+
+/*
+ * Select the files under the rpm mutex and verify everything but their
+ * digests. The digests are checked in parallel afterwards and the items
+ * are reported in the order of the header iteration.
+ */
+static int rpmverify_select(struct rpmverify_batch *b,
+			    const char *file, oval_operation_t file_op,
+			    SEXP_t *name_ent, SEXP_t *epoch_ent, SEXP_t *version_ent, SEXP_t *release_ent, SEXP_t *arch_ent,
+			    uint64_t flags)
 {
 	rpmdbMatchIterator match;
 	rpmVerifyAttrs omit = (rpmVerifyAttrs)(flags & RPMVERIFY_RPMATTRMASK);
@@ -187,19 +393,20 @@ static int rpmverify_collect(probe_ctx *ctx,
 		SEXP_t *ent;
 		rpmfi  fi;
 		rpmTag tag[2] = { RPMTAG_BASENAMES, RPMTAG_DIRNAMES };
-		struct rpmverify_res res;
+		struct rpmverify_pkg *pkg;
+		struct rpmverify_file *f;
 		errmsg_t rpmerr;
 		int i;
 
-		/*
-+SEXP_t *probe_ent_from_cstr(const char *name, oval_datatype_t type,
-+                            const char *value, size_t vallen)
-		 */
+		pkg = oscap_talloc(struct rpmverify_pkg);
+		memset(pkg, 0, sizeof(struct rpmverify_pkg));
+		b->pkgs = oscap_realloc(b->pkgs, sizeof(struct rpmverify_pkg *) * (b->pkgcnt + 1));
+		b->pkgs[b->pkgcnt++] = pkg;
 
 #define COMPARE_ENT(XXX) \
 		if (XXX ## _ent != NULL) { \
 			ent = probe_entval_from_cstr( \
-				probe_ent_getdatatype(XXX ## _ent), res.XXX, strlen(res.XXX) \
+				probe_ent_getdatatype(XXX ## _ent), pkg->XXX, strlen(pkg->XXX) \
 			); \
 			if (ent != NULL && probe_entobj_cmp(XXX ## _ent, ent) != OVAL_RESULT_TRUE) { \
 				SEXP_free(ent); \
@@ -208,21 +415,21 @@ static int rpmverify_collect(probe_ctx *ctx,
 			SEXP_free(ent); \
 		}
 
-		res.name = headerFormat(pkgh, "%{NAME}", &rpmerr);
+		pkg->name = headerFormat(pkgh, "%{NAME}", &rpmerr);
 		COMPARE_ENT(name);
 
-		res.epoch = headerFormat(pkgh, "%{EPOCH}", &rpmerr);
+		pkg->epoch = headerFormat(pkgh, "%{EPOCH}", &rpmerr);
 		COMPARE_ENT(epoch);
 
-		res.version = headerFormat(pkgh, "%{VERSION}", &rpmerr);
+		pkg->version = headerFormat(pkgh, "%{VERSION}", &rpmerr);
 		COMPARE_ENT(version);
-		res.release = headerFormat(pkgh, "%{RELEASE}", &rpmerr);
+		pkg->release = headerFormat(pkgh, "%{RELEASE}", &rpmerr);
 		COMPARE_ENT(release);
-		res.arch = headerFormat(pkgh, "%{ARCH}", &rpmerr);
+		pkg->arch = headerFormat(pkgh, "%{ARCH}", &rpmerr);
 		COMPARE_ENT(arch);
-		snprintf(res.extended_name, 1024, "%s-%s:%s-%s.%s", res.name,
-			oscap_streq(res.epoch, "(none)") ? "0" : res.epoch,
-			res.version, res.release, res.arch);
+		snprintf(pkg->extended_name, 1024, "%s-%s:%s-%s.%s", pkg->name,
+			oscap_streq(pkg->epoch, "(none)") ? "0" : pkg->epoch,
+			pkg->version, pkg->release, pkg->arch);
 
 		/*
 		 * Inspect package files & directories
@@ -231,43 +438,35 @@ static int rpmverify_collect(probe_ctx *ctx,
 		  fi = rpmfiNew(g_rpm.rpmts, pkgh, tag[i], 1);
 
 		  while (rpmfiNext(fi) != -1) {
-				res.file = oscap_strdup(rpmfiFN(fi));
-		    res.fflags = rpmfiFFlags(fi);
-		    res.oflags = omit;
-
-		    if (((res.fflags & RPMFILE_CONFIG) && (flags & RPMVERIFY_SKIP_CONFIG)) ||
-					((res.fflags & RPMFILE_GHOST)  && (flags & RPMVERIFY_SKIP_GHOST))) {
-					oscap_free(res.file);
-					continue;
-				}
+		    const char *fn = rpmfiFN(fi);
+		    rpmfileAttrs fflags = rpmfiFFlags(fi);
+
+		    if (((fflags & RPMFILE_CONFIG) && (flags & RPMVERIFY_SKIP_CONFIG)) ||
+			((fflags & RPMFILE_GHOST)  && (flags & RPMVERIFY_SKIP_GHOST)))
+			continue;
 
 		    switch(file_op) {
 		    case OVAL_OPERATION_EQUALS:
-					if (strcmp(res.file, file) != 0) {
-						oscap_free(res.file);
-						continue;
-					}
-		      break;
+			if (strcmp(fn, file) != 0)
+				continue;
+			break;
 		    case OVAL_OPERATION_NOT_EQUAL:
-					if (strcmp(res.file, file) == 0) {
-						oscap_free(res.file);
-						continue;
-					}
-		      break;
+			if (strcmp(fn, file) == 0)
+				continue;
+			break;
 		    case OVAL_OPERATION_PATTERN_MATCH:
-		      ret = pcre_exec(re, NULL, res.file, strlen(res.file), 0, 0, NULL, 0);
+		      ret = pcre_exec(re, NULL, fn, strlen(fn), 0, 0, NULL, 0);
 
 		      switch(ret) {
 		      case 0: /* match */
 			break;
 		      case -1:
 			/* mismatch */
-			oscap_free(res.file);
 			continue;
 		      default:
 			dE("pcre_exec() failed!");
 			ret = -1;
-			oscap_free(res.file);
+			rpmfiFree(fi);
 			goto ret;
 		      }
 		      break;
@@ -275,28 +474,37 @@ static int rpmverify_collect(probe_ctx *ctx,
 		      /* unsupported operation */
 		      dE("Operation \"%d\" on `filepath' not supported", file_op);
 		      ret = -1;
-					oscap_free(res.file);
+		      rpmfiFree(fi);
 		      goto ret;
 		    }
 
-		    if (rpmVerifyFile(g_rpm.rpmts, fi, &res.vflags, omit) != 0)
-		      res.vflags = RPMVERIFY_FAILURES;
-
-		    if (callback(ctx, &res) != 0) {
-			    ret = 0;
-					oscap_free(res.file);
-			    goto ret;
+		    if (b->count == b->alloc) {
+			    b->alloc = b->alloc ? b->alloc * 2 : 64;
+			    b->files = oscap_realloc(b->files, sizeof(struct rpmverify_file) * b->alloc);
 		    }
-			oscap_free(res.file);
+
+		    f = b->files + b->count++;
+		    f->res.name    = pkg->name;
+		    f->res.epoch   = pkg->epoch;
+		    f->res.version = pkg->version;
+		    f->res.release = pkg->release;
+		    f->res.arch    = pkg->arch;
+		    f->res.extended_name = pkg->extended_name;
+		    f->res.file    = oscap_strdup(fn);
+		    f->res.fflags  = fflags;
+		    f->res.oflags  = omit;
+
+		    rpmverify_file(f, fi, omit);
 		  }
 
 		  rpmfiFree(fi);
 		}
 	}
 
-	match = rpmdbFreeIterator (match);
 	ret   = 0;
 ret:
+	if (match != NULL)
+		match = rpmdbFreeIterator (match);
 	if (re != NULL)
 		pcre_free(re);
 
@@ -304,6 +512,33 @@ ret:
 	return (ret);
 }
 
+static int rpmverify_collect(probe_ctx *ctx,
+			     const char *file, oval_operation_t file_op,
+			     SEXP_t *name_ent, SEXP_t *epoch_ent, SEXP_t *version_ent, SEXP_t *release_ent, SEXP_t *arch_ent,
+			     uint64_t flags,
+			     int (*callback)(probe_ctx *, struct rpmverify_res *))
+{
+	struct rpmverify_batch batch;
+	size_t i;
+	int ret;
+
+	memset(&batch, 0, sizeof batch);
+
+	/* the files selected before an error are reported too */
+	ret = rpmverify_select(&batch, file, file_op,
+			       name_ent, epoch_ent, version_ent, release_ent, arch_ent, flags);
+
+	rpmverify_digest_all(&batch);
+
+	for (i = 0; i < batch.count; ++i) {
+		if (callback(ctx, &batch.files[i].res) != 0)
+			break;
+	}
+
+	rpmverify_batch_free(&batch);
+	return (ret);
+}
+
 void probe_preload ()
 {
 	rpmLibsPreload();
@@ -311,6 +546,8 @@ void probe_preload ()
 
 void *probe_init (void)
 {
+	char *prelink;
+
 	probe_setoption(PROBEOPT_OFFLINE_MODE_SUPPORTED, PROBE_OFFLINE_CHROOT);
 #ifdef HAVE_RPM46
 	rpmlogSetCallback(rpmErrorCb, NULL);
@@ -320,6 +557,16 @@ void *probe_init (void)
 		return (NULL);
 	}
 
+	/* the file digests are computed by crapi */
+	if (crapi_init (NULL) != 0) {
+		dE("crapi_init() failed");
+		return (NULL);
+	}
+
+	prelink = rpmExpand("%{?__prelink_undo_cmd}", NULL);
+	g_prelink_undo = prelink != NULL && *prelink != '\0';
+	free(prelink);
+
 	g_rpm.rpmts = rpmtsCreate();
 
 	pthread_mutex_init(&(g_rpm.mutex), NULL);
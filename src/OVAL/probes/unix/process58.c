@@ -103,7 +103,7 @@ extern char const *_cap_names[];
 #include "alloc.h"
 #include "common/debug_priv.h"
 #include <ctype.h>
-#include "common/oscap_buffer.h"
+#include "proctab.h"
 
 /* Convenience structure for the results being reported */
 struct result_info {
@@ -179,45 +179,6 @@ static void get_boot_time(void)
 	fclose(sf);
 }
 
-static int get_uids(int pid, struct result_info *r)
-{
-	char buf[100];
-	FILE *sf;
-
-	r->ruid = -1;
-	r->user_id = -1;
-	r->loginuid = -1;
-
-	snprintf(buf, sizeof(buf), "/proc/%d/status", pid);
-	sf = fopen(buf, "rt");
-	if (sf) {
-		int line = 0;
-		__fsetlocking(sf, FSETLOCKING_BYCALLER);
-		while (fgets(buf, sizeof(buf), sf)) {
-			if (line == 0) {
-				line++;
-				continue;
-			}
-			if (memcmp(buf, "Uid:", 4) == 0) {
-				sscanf(buf, "Uid: %d %d", &r->ruid, &r->user_id);
-				break;
-			}
-		}
-		fclose(sf);
-	}
-
-	snprintf(buf, sizeof(buf), "/proc/%d/loginuid", pid);
-	sf = fopen(buf, "rt");
-	if (sf) {
-		if (fscanf(sf, "%u", &r->loginuid) < 1) {
-			dW("fscanf failed from %s", buf);
-		}
-		fclose(sf);
-	}
-
-	return 0;
-}
-
 static char *convert_time(unsigned long long t, char *tbuf, int tb_size)
 {
 	unsigned d,h,m,s;
@@ -356,93 +317,133 @@ static int get_exec_shield_status(int pid) {
 	return ret;
 }
 
-/**
- * Parse /proc/%d/cmdline file
- * @param filepath Path to file ~ use preallocated buffer for the path
- * @param buffer output buffer with non-zero size
- * @return ps-like command info or NULL
- */
-static inline bool get_process_cmdline(const char* filepath, struct oscap_buffer* const buffer){
+static void check_process(proctab_ent_t *proc, SEXP_t *cmd_ent, SEXP_t *pid_ent, int max_cap_id, probe_ctx *ctx)
+{
+	SEXP_t *cmd_sexp, *pid_sexp;
+	char tty_dev[128];
+	unsigned sched_policy;
 
-	int fd = open(filepath, O_RDONLY, 0);
+	// Skip kthreads and processes which ended
+	if (!(proc->fields & PROCTAB_STAT) || proc->pid == 2 || proc->ppid == 2)
+		return;
 
-	if (fd < 0) {
-		return false;
-	}
+	dI("Have command: %s", proc->command);
+	cmd_sexp = SEXP_string_newf("%s", proc->command);
+	pid_sexp = SEXP_number_newu_32(proc->pid);
+	if ((cmd_sexp == NULL || probe_entobj_cmp(cmd_ent, cmd_sexp) == OVAL_RESULT_TRUE) &&
+	    (pid_sexp == NULL || probe_entobj_cmp(pid_ent, pid_sexp) == OVAL_RESULT_TRUE)
+	) {
+		struct result_info r;
+		unsigned long t = proc->utime/ticks + proc->stime/ticks;
+		char tbuf[32], sbuf[32], *selinux_domain_label, **posix_capabilities;
+		int tday,tyear;
+		time_t s_time;
+		struct tm *tm_proc, *now;
+		const char *fmt;
+
+		// Now get scheduler policy
+		sched_policy = sched_getscheduler(proc->pid);
+		switch (sched_policy) {
+			case SCHED_OTHER:
+				r.scheduling_class = "TS";
+				break;
+			case SCHED_BATCH:
+				r.scheduling_class = "B";
+				break;
+#ifdef SCHED_IDLE
+			case SCHED_IDLE:
+				r.scheduling_class = "#5";
+				break;
+#endif
+			case SCHED_FIFO:
+				r.scheduling_class = "FF";
+				break;
+			case SCHED_RR:
+				r.scheduling_class = "RR";
+				break;
+			default:
+				r.scheduling_class = "?";
+				break;
+		}
 
-	oscap_buffer_clear(buffer);
+		// Calculate the start time
+		s_time = time(NULL);
+		now = localtime(&s_time);
+		tyear = now->tm_year;
+		tday = now->tm_yday;
+		s_time = boot + (proc->start / ticks);
+		tm_proc = localtime(&s_time);
+
+		// Select format based on how long we've been running
+		//
+		// FROM THE SPEC:
+		// "This is the time of day the process started formatted in HH:MM:SS if
+		// the same day the process started or formatted as MMM_DD (Ex.: Feb_5)
+		// if process started the previous day or further in the past."
+		//
+		if (tday != tm_proc->tm_yday || tyear != tm_proc->tm_year)
+			fmt = "%b_%d";
+		else
+			fmt = "%H:%M:%S";
+		strftime(sbuf, sizeof(sbuf), fmt, tm_proc);
 
+		r.command_line = proc->command;
+		r.exec_time = convert_time(t, tbuf, sizeof(tbuf));
+		r.pid = proc->pid;
+		r.ppid = proc->ppid;
+		r.priority = proc->priority;
+		r.start_time = sbuf;
 
+		dev_to_tty(tty_dev, sizeof(tty_dev), (dev_t) proc->tty_nr, proc->pid, ABBREV_DEV);
+		r.tty = tty_dev;
 
-	for(;;) {
-		static const int chunk_size = 1024;
-		char chunk[chunk_size];
-		// Read data, store to buffer
-		ssize_t read_size = read(fd, chunk, chunk_size );
-		if (read_size < 0) {
-			close(fd);
-			return false;
-		}
-		oscap_buffer_append_binary_data(buffer, chunk, read_size);
+		r.exec_shield = (get_exec_shield_status(proc->pid) > 0);
 
-		// If reach end of file, then end the loop
-		if (chunk_size != read_size) {
-			break;
-		}
-	}
+		selinux_domain_label = get_selinux_label(proc->pid);
+		r.selinux_domain_label = selinux_domain_label;
 
-	close(fd);
+		posix_capabilities = get_posix_capability(proc->pid, max_cap_id);
+		r.posix_capability = posix_capabilities;
 
-	int length = oscap_buffer_get_length(buffer);
-	char* buffer_mem = oscap_buffer_get_raw(buffer);
+		r.session_id = proc->session;
 
-	if ( length == 0 ) { // empty file
-		return false;
-	} else {
+		r.ruid = proc->ruid;
+		r.user_id = proc->euid;
+		r.loginuid = proc->loginuid;
+		report_finding(&r, ctx);
 
-		// Skip multiple trailing zeros
-		int i = length - 1;
-		while ( (i > 0) && (buffer_mem[i] == '\0') ) {
-			--i;
-		}
+		if (selinux_domain_label != NULL)
+			free(selinux_domain_label);
 
-		// Program and args are separated by '\0'
-		// Replace them with spaces ' '
-		while( i >= 0 ){
-			char chr = buffer_mem[i];
-			if ( ( chr == '\0') || ( chr == '\n' ) ) {
-				buffer_mem[i] = ' ';
-			} else if ( !isprint(chr) ) { // "ps" replace non-printable characters with '.' (LC_ALL=C)
-				buffer_mem[i] = '.';
-			}
-			--i;
+		if (posix_capabilities != NULL) {
+			char **posix_capabilities_p = posix_capabilities;
+			while (*posix_capabilities_p)
+				free(*posix_capabilities_p++);
+			free(posix_capabilities);
 		}
 	}
-	return true;
+	SEXP_free(cmd_sexp);
+	SEXP_free(pid_sexp);
 }
 
-/**
- * Make "[%s] <defunct>" from cmd string - inplace
- * @param cmd_buffer @see read_process() > cmd_buffer
- * @return pointer to start of string
- */
-static inline char *make_defunc_str(char* const cmd_buffer){
-	static const char DEFUNC_STR[] = "] <defunct>";
-
-	size_t len = strlen(cmd_buffer);
-	memcpy(cmd_buffer + len, DEFUNC_STR, sizeof(DEFUNC_STR));
-	return cmd_buffer;
+/* the entity matches only the single value it has */
+static bool ent_single_value(SEXP_t *ent)
+{
+	return (ent != NULL
+		&& probe_ent_getoperation(ent, OVAL_OPERATION_EQUALS) == OVAL_OPERATION_EQUALS
+		&& !probe_ent_attrexists(ent, "var_ref"));
 }
 
 static int read_process(SEXP_t *cmd_ent, SEXP_t *pid_ent, probe_ctx *ctx)
 {
 	int err = 1, max_cap_id;
-	DIR *d;
-	struct dirent *ent;
+	size_t i, count;
+	proctab_t *tab;
+	proctab_ent_t *proc, **procs;
 	oval_schema_version_t oval_version;
 
-	d = opendir("/proc");
-	if (d == NULL)
+	tab = proctab_get(PROCTAB_CMDLINE | PROCTAB_STATUS);
+	if (tab == NULL)
 		return err;
 
 	// Get the time tick hertz
@@ -456,174 +457,36 @@ static int read_process(SEXP_t *cmd_ent, SEXP_t *pid_ent, probe_ctx *ctx)
 		max_cap_id = OVAL_5_11_MAX_CAP_ID;
 	}
 
-	struct oscap_buffer *cmdline_buffer = oscap_buffer_new();
-	
-	char cmd_buffer[1 + 15 + 11 + 1]; // Format:" [ cmd:15 ] <defunc>"
-	cmd_buffer[0] = '[';
-
-	// Scan the directories
-	while (( ent = readdir(d) )) {
-		int fd, len;
-		char buf[256];
-		char *tmp, state, tty_dev[128];
-		int pid, ppid, pgrp, session, tty_nr, tpgid;
-		unsigned flags, sched_policy;
-		unsigned long minflt, cminflt, majflt, cmajflt, uutime, ustime;
-		long cutime, cstime, priority, cnice, nthreads, itrealvalue;
-		unsigned long long start;
-		SEXP_t *cmd_sexp = NULL, *pid_sexp = NULL;
-
-		// Skip non-process58 dir entries
-		if(*ent->d_name<'0' || *ent->d_name>'9')
-			continue;
-		errno = 0;
-		pid = strtol(ent->d_name, NULL, 10);
-		if (errno || pid == 2) // skip err & kthreads
-			continue;
-
-		// Parse up the stat file for the proc
-		snprintf(buf, 32, "/proc/%d/stat", pid);
-		fd = open(buf, O_RDONLY, 0);
-		if (fd < 0)
-			continue;
-		len = read(fd, buf, sizeof buf - 1);
-		close(fd);
-		if (len < 40)
-			continue;
-		buf[len] = 0;
-		tmp = strrchr(buf, ')');
-		if (tmp)
-			*tmp = 0;
-		else
-			continue;
-		memset(cmd_buffer + 1, 0, sizeof(cmd_buffer)-1); // clear cmd after starting '['
-		sscanf(buf, "%d (%15c", &ppid, cmd_buffer + 1);
-		sscanf(tmp+2,	"%c %d %d %d %d %d "
-				"%u %lu %lu %lu %lu "
-				"%lu %lu %lu %ld %ld "
-				"%ld %ld %ld %llu",
-			&state, &ppid, &pgrp, &session, &tty_nr, &tpgid,
-			&flags, &minflt, &cminflt, &majflt, &cmajflt,
-			&uutime, &ustime, &cutime, &cstime, &priority,
-			&cnice, &nthreads, &itrealvalue, &start
-		);
-
-		// Skip kthreads
-		if (ppid == 2)
-			continue;
-
-		const char* cmd;
-		if (state == 'Z') { // zombie
-			cmd = make_defunc_str(cmd_buffer);
-		} else {
-			snprintf(buf, 32, "/proc/%d/cmdline", pid);
-			if (get_process_cmdline(buf, cmdline_buffer)) {
-				cmd = oscap_buffer_get_raw(cmdline_buffer); // use full cmdline
-			} else {
-				cmd = cmd_buffer + 1;
-			}
+	for (i = 0; (proc = proctab_ent(tab, i)) != NULL; ++i) {
+		if ((proc->fields & PROCTAB_STAT) && proc->pid != 2 && proc->ppid != 2) {
+			err = 0; // If we get this far, no permission problems
+			break;
 		}
+	}
 
+	if (ent_single_value(pid_ent)) {
+		int pid = -1;
 
-		err = 0; // If we get this far, no permission problems
-		dI("Have command: %s", cmd);
-		cmd_sexp = SEXP_string_newf("%s", cmd);
-		pid_sexp = SEXP_number_newu_32(pid);
-		if ((cmd_sexp == NULL || probe_entobj_cmp(cmd_ent, cmd_sexp) == OVAL_RESULT_TRUE) &&
-		    (pid_sexp == NULL || probe_entobj_cmp(pid_ent, pid_sexp) == OVAL_RESULT_TRUE)
-		) {
-			struct result_info r;
-			unsigned long t = uutime/ticks + ustime/ticks;
-			char tbuf[32], sbuf[32], *selinux_domain_label, **posix_capabilities;
-			int tday,tyear;
-			time_t s_time;
-			struct tm *proc, *now;
-			const char *fmt;
-
-			// Now get scheduler policy
-			sched_policy = sched_getscheduler(pid);
-			switch (sched_policy) {
-				case SCHED_OTHER:
-					r.scheduling_class = "TS";
-					break;
-				case SCHED_BATCH:
-					r.scheduling_class = "B";
-					break;
-#ifdef SCHED_IDLE
-				case SCHED_IDLE:
-					r.scheduling_class = "#5";
-					break;
-#endif
-				case SCHED_FIFO:
-					r.scheduling_class = "FF";
-					break;
-				case SCHED_RR:
-					r.scheduling_class = "RR";
-					break;
-				default:
-					r.scheduling_class = "?";
-					break;
-			}
-
-			// Calculate the start time
-			s_time = time(NULL);
-			now = localtime(&s_time);
-			tyear = now->tm_year;
-			tday = now->tm_yday;
-			s_time = boot + (start / ticks);
-			proc = localtime(&s_time);
-
-			// Select format based on how long we've been running
-			//
-			// FROM THE SPEC:
-			// "This is the time of day the process started formatted in HH:MM:SS if
-			// the same day the process started or formatted as MMM_DD (Ex.: Feb_5)
-			// if process started the previous day or further in the past."
-			//
-			if (tday != proc->tm_yday || tyear != proc->tm_year)
-				fmt = "%b_%d";
-			else
-				fmt = "%H:%M:%S";
-			strftime(sbuf, sizeof(sbuf), fmt, proc);
-
-			r.command_line = cmd;
-			r.exec_time = convert_time(t, tbuf, sizeof(tbuf));
-			r.pid = pid;
-			r.ppid = ppid;
-			r.priority = priority;
-			r.start_time = sbuf;
-
-			dev_to_tty(tty_dev, sizeof(tty_dev), (dev_t) tty_nr, pid, ABBREV_DEV);
-			r.tty = tty_dev;
-
-			r.exec_shield = (get_exec_shield_status(pid) > 0);
-
-			selinux_domain_label = get_selinux_label(pid);
-			r.selinux_domain_label = selinux_domain_label;
-
-			posix_capabilities = get_posix_capability(pid, max_cap_id);
-			r.posix_capability = posix_capabilities;
-
-			r.session_id = session;
+		PROBE_ENT_I32VAL(pid_ent, pid, pid = -1;, pid = -1;);
+		proc = proctab_pid(tab, pid);
+		if (proc != NULL)
+			check_process(proc, cmd_ent, pid_ent, max_cap_id, ctx);
+	} else if (ent_single_value(cmd_ent)) {
+		SEXP_t *cmd_val = probe_ent_getval(cmd_ent);
+		char *cmd = cmd_val != NULL ? SEXP_string_cstr(cmd_val) : NULL;
 
-			get_uids(pid, &r);
-			report_finding(&r, ctx);
+		count = cmd != NULL ? proctab_command(tab, cmd, &procs) : 0;
+		for (i = 0; i < count; ++i)
+			check_process(procs[i], cmd_ent, pid_ent, max_cap_id, ctx);
 
-			if (selinux_domain_label != NULL)
-				free(selinux_domain_label);
-
-			if (posix_capabilities != NULL) {
-				char **posix_capabilities_p = posix_capabilities;
-				while (*posix_capabilities_p)
-					free(*posix_capabilities_p++);
-				free(posix_capabilities);
-			}
-		}
-		SEXP_free(cmd_sexp);
-		SEXP_free(pid_sexp);
+		oscap_free(cmd);
+		SEXP_free(cmd_val);
+	} else {
+		for (i = 0; (proc = proctab_ent(tab, i)) != NULL; ++i)
+			check_process(proc, cmd_ent, pid_ent, max_cap_id, ctx);
 	}
-        closedir(d);
-	oscap_buffer_free(cmdline_buffer);
+
+	proctab_put(tab);
 	return err;
 }
 
@@ -37,6 +37,7 @@
 #include "common/_error.h"
 #include "common/debug_priv.h"
 #include "oval_cmp_basic_impl.h"
+#include "oval_pcre_cache_impl.h"
 
 oval_result_t oval_boolean_cmp(const bool state, const bool syschar, oval_operation_t operation)
 {
@@ -129,18 +130,18 @@ static oval_result_t strregcomp(const char *pattern, const char *test_str)
 	int ret;
 	oval_result_t result = OVAL_RESULT_ERROR;
 #if defined USE_REGEX_PCRE
-	pcre *re;
+	const oval_pcre_t *re;
 	const char *err;
 	int errofs;
 
-	re = pcre_compile(pattern, PCRE_UTF8, &err, &errofs, NULL);
+	re = oval_pcre_get(pattern, PCRE_UTF8, &err, &errofs);
 	if (re == NULL) {
 		dE("Unable to compile regex pattern, "
 			       "pcre_compile() returned error (offset: %d): '%s'.\n", errofs, err);
 		return OVAL_RESULT_ERROR;
 	}
 
-	ret = pcre_exec(re, NULL, test_str, strlen(test_str), 0, 0, NULL, 0);
+	ret = oval_pcre_exec(re, test_str, strlen(test_str), NULL, 0);
 	if (ret > -1 ) {
 		result = OVAL_RESULT_TRUE;
 	} else if (ret == -1) {
@@ -151,7 +152,7 @@ static oval_result_t strregcomp(const char *pattern, const char *test_str)
 		result = OVAL_RESULT_ERROR;
 	}
 
-	pcre_free(re);
+	oval_pcre_release(re);
 #elif defined USE_REGEX_POSIX
 	regex_t re;
 
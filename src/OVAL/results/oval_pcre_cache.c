@@ -0,0 +1,150 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#if defined USE_REGEX_PCRE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "common/alloc.h"
+#include "common/list.h"
+#include "common/debug_priv.h"
+#include "oval_pcre_cache_impl.h"
+
+#if defined(PCRE_STUDY_JIT_COMPILE)
+# define OVAL_PCRE_STUDY_OPTIONS PCRE_STUDY_JIT_COMPILE
+#else
+# define OVAL_PCRE_STUDY_OPTIONS 0
+#endif
+
+static struct oscap_htable *__pcre_cache = NULL;
+static pthread_rwlock_t     __pcre_cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_once_t       __pcre_cache_once = PTHREAD_ONCE_INIT;
+
+static void oval_pcre_free(oval_pcre_t *re)
+{
+	if (re == NULL)
+		return;
+#if defined(PCRE_STUDY_JIT_COMPILE)
+	pcre_free_study(re->extra);
+#else
+	pcre_free(re->extra);
+#endif
+	pcre_free(re->re);
+	oscap_free(re);
+}
+
+static void oval_pcre_cache_libfree(void)
+{
+	pthread_rwlock_wrlock(&__pcre_cache_lock);
+	oscap_htable_free(__pcre_cache, (oscap_destruct_func) oval_pcre_free);
+	__pcre_cache = NULL;
+	pthread_rwlock_unlock(&__pcre_cache_lock);
+}
+
+static void oval_pcre_cache_libinit(void)
+{
+	__pcre_cache = oscap_htable_new();
+	atexit(oval_pcre_cache_libfree);
+}
+
+/*
+ * The compile options are a part of the key.
+ */
+static char *oval_pcre_key(char *buf, size_t bufsize, const char *pattern, int options)
+{
+	size_t keysize;
+	char *key;
+
+	keysize = strlen(pattern) + 10;
+	key = keysize > bufsize ? oscap_alloc(keysize) : buf;
+	snprintf(key, keysize, "%08x%s", (unsigned int)options, pattern);
+
+	return key;
+}
+
+const oval_pcre_t *oval_pcre_get(const char *pattern, int options, const char **errptr, int *erroffset)
+{
+	oval_pcre_t *re, *old;
+	char keybuf[256], *key;
+
+	pthread_once(&__pcre_cache_once, oval_pcre_cache_libinit);
+	key = oval_pcre_key(keybuf, sizeof keybuf, pattern, options);
+
+	pthread_rwlock_rdlock(&__pcre_cache_lock);
+	re = __pcre_cache != NULL ? oscap_htable_get(__pcre_cache, key) : NULL;
+	pthread_rwlock_unlock(&__pcre_cache_lock);
+
+	if (re != NULL)
+		goto out;
+
+	re = oscap_talloc(oval_pcre_t);
+	re->re = pcre_compile(pattern, options, errptr, erroffset, NULL);
+	re->cached = 0;
+
+	if (re->re == NULL) {
+		oscap_free(re);
+		re = NULL;
+		goto out;
+	}
+
+	re->extra = pcre_study(re->re, OVAL_PCRE_STUDY_OPTIONS, errptr);
+
+	/*
+	 * Another thread might have added the same pattern in the
+	 * meantime. Its copy is used then and ours is thrown away.
+	 */
+	pthread_rwlock_wrlock(&__pcre_cache_lock);
+	old = __pcre_cache != NULL ? oscap_htable_get(__pcre_cache, key) : NULL;
+
+	if (old != NULL) {
+		oval_pcre_free(re);
+		re = old;
+	} else if (__pcre_cache != NULL && __pcre_cache->itemcount < OVAL_PCRE_CACHE_MAX) {
+		re->cached = 1;
+		oscap_htable_add(__pcre_cache, key, re);
+	} else {
+		dD("The regex cache is full, pattern \"%s\" is not cached.", pattern);
+	}
+	pthread_rwlock_unlock(&__pcre_cache_lock);
+out:
+	if (key != keybuf)
+		oscap_free(key);
+
+	return re;
+}
+
+int oval_pcre_exec(const oval_pcre_t *re, const char *subject, int length, int *ovector, int ovecsize)
+{
+	return pcre_exec(re->re, re->extra, subject, length, 0, 0, ovector, ovecsize);
+}
+
+void oval_pcre_release(const oval_pcre_t *re)
+{
+	if (re != NULL && !re->cached)
+		oval_pcre_free((oval_pcre_t *)re);
+}
+
+#endif /* USE_REGEX_PCRE */
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2017 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef OSCAP_OVAL_PCRE_CACHE_IMPL_H_
+#define OSCAP_OVAL_PCRE_CACHE_IMPL_H_
+
+#if defined USE_REGEX_PCRE
+#include <pcre.h>
+#include "../common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/*
+ * Process-wide cache of compiled regular expressions. Patterns
+ * are compiled and studied (using the JIT compiler if available)
+ * on first use and kept until exit.
+ */
+#ifndef OVAL_PCRE_CACHE_MAX
+#define OVAL_PCRE_CACHE_MAX 4096 /**< more patterns are compiled on each use */
+#endif
+
+typedef struct oval_pcre {
+	pcre       *re;
+	pcre_extra *extra;
+	int         cached;
+} oval_pcre_t;
+
+/**
+ * Get the compiled form of `pattern' compiled with `options'.
+ * The result has to be released using oval_pcre_release.
+ * @return NULL if the pattern can't be compiled; the error
+ *         message and offset are stored like pcre_compile does
+ */
+const oval_pcre_t *oval_pcre_get(const char *pattern, int options, const char **errptr, int *erroffset);
+
+/**
+ * Match `subject' against the compiled pattern, see pcre_exec.
+ */
+int oval_pcre_exec(const oval_pcre_t *re, const char *subject, int length, int *ovector, int ovecsize);
+
+void oval_pcre_release(const oval_pcre_t *re);
+
+OSCAP_HIDDEN_END;
+
+#endif /* USE_REGEX_PCRE */
+#endif
@@ -475,11 +475,20 @@ static oval_result_t eval_item(struct oval_syschar_model *syschar_model, struct
 {
 	struct oval_state_content_iterator *state_contents_itr;
 	struct oresults ste_ores;
+	struct oval_status_counter item_counter;
 	oval_operator_t operator;
 	oval_result_t result = OVAL_RESULT_ERROR;
+	size_t i, item_entity_count;
 
 	ores_clear(&ste_ores);
 
+	/* The existence check counts the status of all the item entities */
+	oval_status_counter_clear(&item_counter);
+	item_entity_count = oval_sysitem_get_sysent_count(cur_sysitem);
+	for (i = 0; i < item_entity_count; ++i)
+		oval_status_counter_add_status(&item_counter,
+				oval_sysent_get_status(oval_sysitem_get_sysent_at(cur_sysitem, (int)i)));
+
 	state_contents_itr = oval_state_get_contents(state);
 	while (oval_state_content_iterator_has_more(state_contents_itr)) {
 		struct oval_state_content *content;
@@ -489,10 +498,9 @@ static oval_result_t eval_item(struct oval_syschar_model *syschar_model, struct
 		oval_check_t entity_check;
 		oval_existence_t check_existence;
 		oval_result_t ste_ent_res;
-		struct oval_sysent_iterator *item_entities_itr;
 		struct oresults ent_ores;
-		struct oval_status_counter counter;
 		bool found_matching_item;
+		int pos;
 
 		if ((content = oval_state_content_iterator_next(state_contents_itr)) == NULL) {
 			oscap_seterr(OSCAP_EFAMILY_OVAL, "OVAL internal error: found NULL state content");
@@ -528,28 +536,13 @@ static oval_result_t eval_item(struct oval_syschar_model *syschar_model, struct
 
 		ores_clear(&ent_ores);
 		found_matching_item = false;
-		oval_status_counter_clear(&counter);
 
-		item_entities_itr = oval_sysitem_get_sysents(cur_sysitem);
-		while (oval_sysent_iterator_has_more(item_entities_itr)) {
+		for (pos = oval_sysitem_find_sysent(cur_sysitem, state_entity_name); pos != -1;
+		     pos = oval_sysitem_next_sysent(cur_sysitem, pos)) {
 			struct oval_sysent *item_entity;
 			oval_result_t ent_val_res;
-			char *item_entity_name;
-			oval_syschar_status_t item_status;
-
-			item_entity = oval_sysent_iterator_next(item_entities_itr);
-			if (item_entity == NULL) {
-				oscap_seterr(OSCAP_EFAMILY_OVAL, "OVAL internal error: found NULL sysent");
-				oval_sysent_iterator_free(item_entities_itr);
-				goto fail;
-			}
-			item_status = oval_sysent_get_status(item_entity);
-			oval_status_counter_add_status(&counter, item_status);
-
-			item_entity_name = oval_sysent_get_name(item_entity);
-			if (strcmp(item_entity_name, state_entity_name))
-				continue;
 
+			item_entity = oval_sysitem_get_sysent_at(cur_sysitem, pos);
 			found_matching_item = true;
 
 			/* copy mask attribute from state to item */
@@ -564,14 +557,11 @@ static oval_result_t eval_item(struct oval_syschar_model *syschar_model, struct
 						oval_sysent_get_value(item_entity),
 						oval_sysitem_get_id(cur_sysitem), oval_state_get_id(state));
 			}
-			if (((signed) ent_val_res) == -1) {
-				oval_sysent_iterator_free(item_entities_itr);
+			if (((signed) ent_val_res) == -1)
 				goto fail;
-			}
 
 			ores_add_res(&ent_ores, ent_val_res);
 		}
-		oval_sysent_iterator_free(item_entities_itr);
 
 		if (!found_matching_item)
 			dW("Entity name '%s' from state (id: '%s') not found in item (id: '%s').",
@@ -579,7 +569,7 @@ static oval_result_t eval_item(struct oval_syschar_model *syschar_model, struct
 
 		ste_ent_res = ores_get_result_bychk(&ent_ores, entity_check);
 		ores_add_res(&ste_ores, ste_ent_res);
-		oval_result_t cres = oval_status_counter_get_result(&counter, check_existence);
+		oval_result_t cres = oval_status_counter_get_result(&item_counter, check_existence);
 		ores_add_res(&ste_ores, cres);
 	}
 	oval_state_content_iterator_free(state_contents_itr);
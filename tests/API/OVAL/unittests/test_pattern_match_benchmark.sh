@@ -0,0 +1,83 @@
+#!/bin/bash
+
+# Benchmark of the pattern match operation over a synthetic system
+# characteristics model: every one of $TESTS states is compared with
+# each of the $ITEMS collected items, each state using its own pattern.
+
+set -e -o pipefail
+
+TESTS=${TESTS:-20}
+ITEMS=${ITEMS:-2000}
+
+name=$(basename $0 .sh)
+oval=$(mktemp ${name}.oval.XXXXXX)
+syschar=$(mktemp ${name}.syschar.XXXXXX)
+result=$(mktemp ${name}.out.XXXXXX)
+echo "result file: $result"
+stderr=$(mktemp ${name}.err.XXXXXX)
+echo "stderr file: $stderr"
+
+ns_common='xmlns:oval="http://oval.mitre.org/XMLSchema/oval-common-5" xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance"'
+
+{
+	echo '<?xml version="1.0" encoding="UTF-8"?>'
+	echo "<oval_definitions $ns_common xmlns:ind-def=\"http://oval.mitre.org/XMLSchema/oval-definitions-5#independent\" xmlns=\"http://oval.mitre.org/XMLSchema/oval-definitions-5\">"
+	echo '<generator><oval:product_name>cpe:/a:open-scap:oscap</oval:product_name><oval:schema_version>5.8</oval:schema_version><oval:timestamp>2017-01-01T00:00:00</oval:timestamp></generator>'
+	echo '<definitions><definition id="oval:x:def:1" version="1" class="compliance">'
+	echo '<metadata><title>pattern match benchmark</title><description>Many items compared with many patterns.</description></metadata>'
+	echo '<criteria operator="AND">'
+	for t in $(seq 1 $TESTS); do
+		echo "<criterion test_ref=\"oval:x:tst:$t\"/>"
+	done
+	echo '</criteria></definition></definitions>'
+	echo '<tests>'
+	for t in $(seq 1 $TESTS); do
+		echo "<ind-def:environmentvariable_test id=\"oval:x:tst:$t\" version=\"1\" check=\"all\" comment=\"Test $t.\">"
+		echo '<ind-def:object object_ref="oval:x:obj:1"/>'
+		echo "<ind-def:state state_ref=\"oval:x:ste:$t\"/>"
+		echo '</ind-def:environmentvariable_test>'
+	done
+	echo '</tests>'
+	echo '<objects><ind-def:environmentvariable_object id="oval:x:obj:1" version="1">'
+	echo '<ind-def:name operation="pattern match">^var_</ind-def:name>'
+	echo '</ind-def:environmentvariable_object></objects>'
+	echo '<states>'
+	for t in $(seq 1 $TESTS); do
+		echo "<ind-def:environmentvariable_state id=\"oval:x:ste:$t\" version=\"1\">"
+		echo "<ind-def:value operation=\"pattern match\">^/usr/(lib|lib64)/module-[0-9]+(/state-$t)?\$</ind-def:value>"
+		echo '</ind-def:environmentvariable_state>'
+	done
+	echo '</states></oval_definitions>'
+} > $oval
+
+{
+	echo '<?xml version="1.0" encoding="UTF-8"?>'
+	echo "<oval_system_characteristics $ns_common xmlns:ind-sys=\"http://oval.mitre.org/XMLSchema/oval-system-characteristics-5#independent\" xmlns=\"http://oval.mitre.org/XMLSchema/oval-system-characteristics-5\">"
+	echo '<generator><oval:product_name>cpe:/a:open-scap:oscap</oval:product_name><oval:schema_version>5.8</oval:schema_version><oval:timestamp>2017-01-01T00:00:00</oval:timestamp></generator>'
+	echo '<system_info><os_name>Linux</os_name><os_version>1</os_version><architecture>x86_64</architecture><primary_host_name>localhost</primary_host_name><interfaces/></system_info>'
+	echo '<collected_objects><object id="oval:x:obj:1" version="1" flag="complete">'
+	for i in $(seq 1 $ITEMS); do
+		echo "<reference item_ref=\"$i\"/>"
+	done
+	echo '</object></collected_objects>'
+	echo '<system_data>'
+	for i in $(seq 1 $ITEMS); do
+		echo "<ind-sys:environmentvariable_item id=\"$i\" status=\"exists\"><ind-sys:name>var_$i</ind-sys:name><ind-sys:value>/usr/lib/module-$i</ind-sys:value></ind-sys:environmentvariable_item>"
+	done
+	echo '</system_data></oval_system_characteristics>'
+} > $syschar
+
+echo "Analysing $ITEMS items against $TESTS patterns."
+start=$(date +%s.%N)
+$OSCAP oval analyse --results $result $oval $syschar 2> $stderr
+end=$(date +%s.%N)
+awk "BEGIN { printf \"elapsed: %.3f s\\n\", $end - $start }"
+
+[ -f $stderr ]; [ ! -s $stderr ]; rm $stderr
+[ -f $result ]
+
+assert_exists 1 '/oval_results/results/system/definitions/definition[@result="true"]'
+assert_exists $TESTS '/oval_results/results/system/tests/test[@result="true"]'
+assert_exists $((TESTS * ITEMS)) '/oval_results/results/system/tests/test/tested_item[@result="true"]'
+
+rm $oval $syschar $result
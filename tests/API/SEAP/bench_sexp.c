@@ -0,0 +1,463 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sexp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../bench.h"
+
+/*
+ * Benchmarks of the S-exp library. The correctness of the measured
+ * code is checked by the test_api_sexp_* programs, these only print
+ * the times. All the benchmarks are run with the default sizes if no
+ * name is given.
+ * Usage: bench_sexp [name [count] [length]]
+ */
+
+static unsigned int arg_u (int argc, char *argv[], int i, unsigned int def, unsigned int min)
+{
+	unsigned int n = def;
+
+	if (argc > i)
+		n = (unsigned int)strtoul (argv[i], NULL, 10);
+
+	return (n < min ? min : n);
+}
+
+static char *sb_flatten (strbuf_t *sb, size_t *len)
+{
+	char *buf;
+
+	*len = strbuf_length (sb);
+	buf  = malloc (*len);
+	strbuf_copy (sb, buf, *len);
+
+	return (buf);
+}
+
+/* a value shaped like a probe item with a single entity */
+static SEXP_t *item_new (unsigned int i)
+{
+	SEXP_t *item, *attrs, *ent, *v[6];
+	char path[64];
+
+	v[0] = SEXP_string_newf ("file_item");
+	v[1] = SEXP_string_newf (":id");
+	v[2] = SEXP_number_newu_32 (i);
+	attrs = SEXP_list_new (v[0], v[1], v[2], NULL);
+	item  = SEXP_list_new (attrs, NULL);
+	SEXP_vfree (v[0], v[1], v[2], attrs, NULL);
+
+	snprintf (path, sizeof path, "/usr/lib/module-%u/file-%u.so", i % 97, i);
+
+	v[0] = SEXP_string_newf ("filepath");
+	v[1] = SEXP_string_new (path, strlen (path));
+	v[2] = SEXP_number_newu_64 ((uint64_t)i * 4096 * 1024 * 1024);
+	v[3] = SEXP_number_newi_64 (-(int64_t)i);
+	v[4] = SEXP_number_newb (i % 2);
+	v[5] = SEXP_number_newf (0.25 + (i % 1000));
+
+	ent = SEXP_list_new (v[0], v[1], v[2], v[3], v[4], v[5], NULL);
+	SEXP_list_add (item, ent);
+	SEXP_free (ent);
+	SEXP_vfree (v[0], v[1], v[2], v[3], v[4], v[5], NULL);
+
+	return (item);
+}
+
+static SEXP_t *tree_new (unsigned int count)
+{
+	SEXP_t *tree, *item;
+	unsigned int i;
+
+	tree = SEXP_list_new (NULL);
+
+	for (i = 0; i < count; ++i) {
+		item = item_new (i);
+		SEXP_list_add (tree, item);
+		SEXP_free (item);
+	}
+
+	return (tree);
+}
+
+/* binary: encoding and decoding of items in the text and binary transport formats */
+
+static int bench_binary (int argc, char *argv[])
+{
+	unsigned int count = arg_u (argc, argv, 1, 20000, 1);
+	SEXP_t *tree, *t_res, *b_res;
+	SEXP_psetup_t *psetup;
+	SEXP_pstate_t *pstate = NULL;
+	strbuf_t *sb;
+	char  *t_buf, *b_buf;
+	size_t t_len, b_len;
+	double t0, t_enc, t_dec, b_enc, b_dec;
+	int ret;
+
+	tree = tree_new (count);
+
+	t0 = bench_now ();
+	sb = strbuf_new (SEAP_STRBUF_MAX);
+	SEXP_sbprintf_t (tree, sb);
+	t_enc = bench_now () - t0;
+	t_buf = sb_flatten (sb, &t_len);
+	strbuf_free (sb);
+
+	psetup = SEXP_psetup_new ();
+	t0 = bench_now ();
+	t_res = SEXP_parse (psetup, t_buf, t_len, &pstate);
+	t_dec = bench_now () - t0;
+	SEXP_psetup_free (psetup);
+
+	t0 = bench_now ();
+	sb = strbuf_new (SEAP_STRBUF_MAX);
+	SEXP_sbprintf_b (tree, sb);
+	b_enc = bench_now () - t0;
+	b_buf = sb_flatten (sb, &b_len);
+	strbuf_free (sb);
+
+	t0 = bench_now ();
+	b_res = SEXP_bin_parse (b_buf, b_len, NULL);
+	b_dec = bench_now () - t0;
+
+	printf ("items: %u\n", count);
+	printf ("text:   %zu bytes, encode %.4fs, decode %.4fs\n", t_len, t_enc, t_dec);
+	printf ("binary: %zu bytes, encode %.4fs, decode %.4fs\n", b_len, b_enc, b_dec);
+
+	ret = (t_res != NULL && b_res != NULL ? 0 : 1);
+
+	SEXP_free (tree);
+	SEXP_free (t_res);
+	SEXP_free (b_res);
+	free (t_buf);
+	free (b_buf);
+
+	return (ret);
+}
+
+/* arena: construction of items with the regular allocator and with an arena */
+
+static double arena_run (SEXP_arena_t *arena, unsigned int count)
+{
+	SEXP_arena_t *prev;
+	SEXP_t *tree;
+	double t0;
+
+	t0   = bench_now ();
+	prev = SEXP_arena_switch (arena);
+	tree = tree_new (count);
+
+	SEXP_free (tree);
+	SEXP_arena_switch (prev);
+	SEXP_arena_free (arena);
+
+	return (bench_now () - t0);
+}
+
+static int bench_arena (int argc, char *argv[])
+{
+	unsigned int count = arg_u (argc, argv, 1, 100000, 1);
+	double h_time, a_time;
+
+	h_time = arena_run (NULL, count);
+	a_time = arena_run (SEXP_arena_new (), count);
+
+	printf ("items: %u\n", count);
+	printf ("regular: %.4fs, %.0f items/s\n", h_time, count / h_time);
+	printf ("arena:   %.4fs, %.0f items/s\n", a_time, count / a_time);
+
+	return (0);
+}
+
+/* IDcache: hashing of items for the first time and again */
+
+/* ((item :id "") (ent_0 "value_0") (ent_1 "value_1") ...) */
+static SEXP_t *item_build (unsigned int entcnt, unsigned int seed)
+{
+	SEXP_t *item, *r0, *r1, *r2, *r3;
+	unsigned int i;
+
+	r0 = SEXP_string_new ("item", 4);
+	r1 = SEXP_string_new (":id", 3);
+	r2 = SEXP_string_new ("", 0);
+	r3 = SEXP_list_new (r0, r1, r2, NULL);
+	item = SEXP_list_new (r3, NULL);
+	SEXP_vfree (r0, r1, r2, r3, NULL);
+
+	for (i = 0; i < entcnt; ++i) {
+		r0 = SEXP_string_newf ("ent_%u", i);
+		r1 = SEXP_string_newf ("value_%u_%u", i, seed);
+		r2 = SEXP_list_new (r0, r1, NULL);
+		SEXP_list_add (item, r2);
+		SEXP_vfree (r0, r1, r2, NULL);
+	}
+
+	return (item);
+}
+
+static double IDcache_run (SEXP_t **items, unsigned int count)
+{
+	SEXP_ID_t sum = 0;
+	unsigned int i;
+	double t0;
+
+	t0 = bench_now ();
+
+	for (i = 0; i < count; ++i)
+		sum ^= SEXP_ID_v (items[i]);
+
+	return (sum != 0 ? bench_now () - t0 : 0);
+}
+
+static int bench_IDcache (int argc, char *argv[])
+{
+	unsigned int count  = arg_u (argc, argv, 1, 20000, 1);
+	unsigned int entcnt = arg_u (argc, argv, 2, 16, 0);
+	double f_time, c_time;
+	SEXP_t **items;
+	unsigned int i;
+
+	items = malloc (sizeof (SEXP_t *) * count);
+
+	for (i = 0; i < count; ++i)
+		items[i] = item_build (entcnt, i);
+
+	f_time = IDcache_run (items, count);
+	c_time = IDcache_run (items, count);
+
+	printf ("items: %u, entities: %u\n", count, entcnt);
+	printf ("first:  %.4fs\n", f_time);
+	printf ("cached: %.4fs\n", c_time);
+
+	for (i = 0; i < count; ++i)
+		SEXP_free (items[i]);
+
+	free (items);
+
+	return (0);
+}
+
+/*
+ * scan: parsing of printed items and of a text with quoted, simple and
+ * length prefixed strings, with the scanner chosen by SEXP_SCAN
+ */
+
+static double scan_run (char *buf, size_t len, unsigned int rounds)
+{
+	SEXP_psetup_t *psetup;
+	SEXP_pstate_t *pstate;
+	SEXP_t *res;
+	double t0;
+	unsigned int i;
+
+	t0 = bench_now ();
+
+	for (i = 0; i < rounds; ++i) {
+		pstate = NULL;
+		psetup = SEXP_psetup_new ();
+		res = SEXP_parse (psetup, buf, len, &pstate);
+		SEXP_psetup_free (psetup);
+		SEXP_free (res);
+	}
+
+	return ((double)len * rounds / (bench_now () - t0) / (1024 * 1024));
+}
+
+static char *scan_text_new (unsigned int count, size_t *len)
+{
+	strbuf_t *sb;
+	char str[64], num[32];
+	unsigned int i, l;
+
+	sb = strbuf_new (SEAP_STRBUF_MAX);
+	strbuf_addc (sb, '(');
+
+	for (i = 0; i < count; ++i) {
+		strbuf_add (sb, i % 8 ? " " : "\n\t", i % 8 ? 1 : 2);
+		l = snprintf (str, sizeof str, "string_%u_%u", i, i * 2654435761U);
+
+		switch (i % 3) {
+		case 0: /* simple */
+			strbuf_add (sb, str, l);
+			break;
+		case 1: /* quoted */
+			strbuf_addc (sb, '"');
+			strbuf_add (sb, str, l);
+			strbuf_add (sb, " \\\"x\\\"", 6);
+			strbuf_addc (sb, '"');
+			break;
+		default: /* length prefixed */
+			snprintf (num, sizeof num, "%u:", l);
+			strbuf_add (sb, num, strlen (num));
+			strbuf_add (sb, str, l);
+		}
+	}
+
+	strbuf_addc (sb, ')');
+
+	{
+		char *buf = sb_flatten (sb, len);
+		strbuf_free (sb);
+		return (buf);
+	}
+}
+
+static int bench_scan (int argc, char *argv[])
+{
+	unsigned int count = arg_u (argc, argv, 1, 20000, 1);
+	SEXP_t *tree;
+	strbuf_t *sb;
+	char *i_buf, *t_buf;
+	size_t i_len, t_len;
+	const char *scan;
+
+	tree = tree_new (count);
+	sb = strbuf_new (SEAP_STRBUF_MAX);
+	SEXP_sbprintf_t (tree, sb);
+	i_buf = sb_flatten (sb, &i_len);
+	strbuf_free (sb);
+	SEXP_free (tree);
+
+	t_buf = scan_text_new (count, &t_len);
+	scan  = getenv ("SEXP_SCAN");
+
+	printf ("scanner: %s\n", scan != NULL ? scan : "default");
+	printf ("items: %zu bytes, %.1f MiB/s\n", i_len, scan_run (i_buf, i_len, 5));
+	printf ("text:  %zu bytes, %.1f MiB/s\n", t_len, scan_run (t_buf, t_len, 5));
+
+	free (i_buf);
+	free (t_buf);
+
+	return (0);
+}
+
+/*
+ * flatlist: indexed access and sorting of lists built as a chain of
+ * list blocks (SEXP_list_add only) and as a single block
+ * (SEXP_list_reserve)
+ */
+
+static int numcmp (const SEXP_t *a, const SEXP_t *b)
+{
+	uint32_t na = SEXP_number_getu_32 (a);
+	uint32_t nb = SEXP_number_getu_32 (b);
+
+	return (na < nb ? -1 : (na > nb ? 1 : 0));
+}
+
+static SEXP_t *list_build (unsigned int length, unsigned int seed, bool flat)
+{
+	SEXP_t *list, *memb;
+	unsigned int i;
+
+	list = SEXP_list_new (NULL);
+
+	for (i = 0; i < length; ++i) {
+		memb = SEXP_number_newu_32 ((i * 2654435761U + seed) % 1000003);
+		SEXP_list_add (list, memb);
+		SEXP_free (memb);
+
+		if (flat && i == 0)
+			SEXP_list_reserve (list, length);
+	}
+
+	return (list);
+}
+
+static double flatlist_run (unsigned int count, unsigned int length, bool flat, double *s_time)
+{
+	SEXP_t **lists, *memb;
+	unsigned int i, j, k;
+	uint64_t sum = 0;
+	double t0, t1;
+
+	lists = malloc (sizeof (SEXP_t *) * count);
+
+	for (i = 0; i < count; ++i)
+		lists[i] = list_build (length, i, flat);
+
+	/* look up the members by index, like probe_obj_getent() does */
+	t0 = bench_now ();
+
+	for (k = 0; k < 4; ++k) {
+		for (i = 0; i < count; ++i) {
+			for (j = 1; j <= length; ++j) {
+				memb = SEXP_list_nth (lists[i], j);
+				sum += SEXP_number_getu_32 (memb);
+				SEXP_free (memb);
+			}
+		}
+	}
+
+	t1 = bench_now ();
+
+	for (i = 0; i < count; ++i)
+		SEXP_list_sort (lists[i], numcmp);
+
+	*s_time = bench_now () - t1;
+
+	for (i = 0; i < count; ++i)
+		SEXP_free (lists[i]);
+
+	free (lists);
+
+	return (sum > 0 ? t1 - t0 : 0);
+}
+
+static int bench_flatlist (int argc, char *argv[])
+{
+	unsigned int count  = arg_u (argc, argv, 1, 20000, 1);
+	unsigned int length = arg_u (argc, argv, 2, 48, 2);
+	double c_time, f_time, cs_time, fs_time;
+
+	c_time = flatlist_run (count, length, false, &cs_time);
+	f_time = flatlist_run (count, length, true,  &fs_time);
+
+	printf ("lists: %u, length: %u\n", count, length);
+	printf ("chain: nth %.4fs, sort %.4fs\n", c_time, cs_time);
+	printf ("flat:  nth %.4fs, sort %.4fs\n", f_time, fs_time);
+
+	return (0);
+}
+
+static const struct {
+	const char *name;
+	int (*func) (int argc, char *argv[]);
+} benchmarks[] = {
+	{ "arena",    bench_arena    },
+	{ "binary",   bench_binary   },
+	{ "flatlist", bench_flatlist },
+	{ "IDcache",  bench_IDcache  },
+	{ "scan",     bench_scan     }
+};
+
+int main (int argc, char *argv[])
+{
+	size_t i;
+	int ret = 0;
+
+	setbuf (stdout, NULL);
+
+	for (i = 0; i < sizeof benchmarks / sizeof benchmarks[0]; ++i) {
+		if (argc > 1 && strcmp (argv[1], benchmarks[i].name) != 0)
+			continue;
+
+		printf ("== %s\n", benchmarks[i].name);
+
+		if (benchmarks[i].func (argc > 1 ? argc - 1 : 1, argv + (argc > 1 ? 1 : 0)) != 0)
+			ret = 1;
+
+		if (argc > 1)
+			return (ret);
+	}
+
+	if (argc > 1) {
+		fprintf (stderr, "unknown benchmark: %s\n", argv[1]);
+		return (2);
+	}
+
+	return (ret);
+}
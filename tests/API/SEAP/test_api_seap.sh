@@ -476,6 +476,17 @@ function test_api_seap_concurency {
     return $ret_val
 }
 
+function test_api_sexp_scan {
+    local ret_val=0;
+
+    ./test_api_sexp_scan
+    ret_val=$[$ret_val+$?]
+    SEXP_SCAN=scalar ./test_api_sexp_scan
+    ret_val=$[$ret_val+$?]
+
+    return $ret_val
+}
+
 function test_api_strto {
     ./test_api_strto
 }
@@ -493,6 +504,13 @@ test_run "test_api_seap_list"                 ./test_api_seap_list
 test_run "test_api_seap_number_expression"    ./test_api_seap_number
 test_run "test_api_seap_string_expression"    ./test_api_seap_string
 test_run "test_api_SEXP_deepcmp"              ./test_api_SEXP_deepcmp
+test_run "test_api_seap_binary"               ./test_api_seap_binary
+test_run "test_api_sexp_arena"                ./test_api_sexp_arena
+test_run "test_api_sexp_flatlist"             ./test_api_sexp_flatlist
+test_run "test_api_sexp_atom"                 ./test_api_sexp_atom
+test_run "test_api_sexp_IDcache"              ./test_api_sexp_IDcache
+test_run "test_api_sexp_scan"                 test_api_sexp_scan
+test_run "test_api_seap_msgattr"              ./test_api_seap_msgattr
 test_run "test_api_strto"                     ./test_api_strto
 
 test_exit
@@ -0,0 +1,148 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sexp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/*
+ * Round-trip test of the binary transport format. The formats are
+ * benchmarked by `bench_sexp binary'.
+ * Usage: test_api_seap_binary [item count]
+ */
+
+static SEXP_t *item_new (unsigned int i)
+{
+	SEXP_t *item, *attrs, *ent, *v[6];
+	char path[64];
+
+	v[0] = SEXP_string_newf ("file_item");
+	v[1] = SEXP_string_newf (":id");
+	v[2] = SEXP_number_newu_32 (i);
+	attrs = SEXP_list_new (v[0], v[1], v[2], NULL);
+	item  = SEXP_list_new (attrs, NULL);
+	SEXP_vfree (v[0], v[1], v[2], attrs, NULL);
+
+	snprintf (path, sizeof path, "/usr/lib/module-%u/file-%u.so", i % 97, i);
+
+	v[0] = SEXP_string_newf ("filepath");
+	v[1] = SEXP_string_new (path, strlen (path));
+	v[2] = SEXP_number_newu_64 ((uint64_t)i * 4096 * 1024 * 1024);
+	v[3] = SEXP_number_newi_64 (-(int64_t)i);
+	v[4] = SEXP_number_newb (i % 2);
+	v[5] = SEXP_number_newf (0.25 + (i % 1000));
+
+	SEXP_datatype_set (v[1], "string");
+
+	ent = SEXP_list_new (v[0], v[1], v[2], v[3], v[4], v[5], NULL);
+	SEXP_list_add (item, ent);
+	SEXP_free (ent);
+	SEXP_vfree (v[0], v[1], v[2], v[3], v[4], v[5], NULL);
+
+	return (item);
+}
+
+static char *sb_flatten (strbuf_t *sb, size_t *len)
+{
+	char *buf;
+
+	*len = strbuf_length (sb);
+	buf  = malloc (*len);
+	strbuf_copy (sb, buf, *len);
+
+	return (buf);
+}
+
+int main (int argc, char *argv[])
+{
+	SEXP_t *tree, *item, *t_res, *b_res, *s_exp;
+	SEXP_psetup_t *psetup;
+	SEXP_pstate_t *pstate = NULL;
+	strbuf_t *sb;
+	char  *t_buf, *b_buf;
+	size_t t_len, b_len, used;
+	unsigned int i, count = 1000;
+
+	if (argc > 1)
+		count = (unsigned int)strtoul (argv[1], NULL, 10);
+
+	tree = SEXP_list_new (NULL);
+
+	for (i = 0; i < count; ++i) {
+		item = item_new (i);
+		SEXP_list_add (tree, item);
+		SEXP_free (item);
+	}
+
+	/* text */
+	sb = strbuf_new (SEAP_STRBUF_MAX);
+	if (SEXP_sbprintf_t (tree, sb) != 0)
+		return (1);
+	t_buf = sb_flatten (sb, &t_len);
+	strbuf_free (sb);
+
+	psetup = SEXP_psetup_new ();
+	t_res = SEXP_parse (psetup, t_buf, t_len, &pstate);
+	SEXP_psetup_free (psetup);
+
+	if (t_res == NULL || SEXP_list_length (t_res) != 1)
+		return (1);
+
+	/* binary */
+	sb = strbuf_new (SEAP_STRBUF_MAX);
+	if (SEXP_sbprintf_b (tree, sb) != 0)
+		return (1);
+	b_buf = sb_flatten (sb, &b_len);
+	strbuf_free (sb);
+
+	if (!SEXP_bin_framep (b_buf, b_len))
+		return (1);
+
+	b_res = SEXP_bin_parse (b_buf, b_len, &used);
+
+	if (b_res == NULL || used != b_len)
+		return (1);
+
+	/*
+	 * Numbers are narrowed on input, so the decoded trees are
+	 * compared with each other rather than with the original.
+	 */
+	s_exp = SEXP_list_first (t_res);
+
+	if (!SEXP_deepcmp (s_exp, b_res)) {
+		printf ("round-trip mismatch\n");
+		return (1);
+	}
+
+	SEXP_vfree (s_exp, t_res, b_res, NULL);
+
+	/* incomplete and malformed frames */
+	if (SEXP_bin_parse (b_buf, b_len - 1, NULL) != NULL || errno != EAGAIN)
+		return (1);
+
+	b_buf[5] = 0x7f; /* invalid tag */
+
+	if (SEXP_bin_parse (b_buf, b_len, NULL) != NULL || errno != EILSEQ)
+		return (1);
+
+	/* doubles survive without the loss of precision */
+	s_exp = SEXP_number_newf (1.0 / 3.0);
+	sb = strbuf_new (SEAP_STRBUF_MAX);
+	SEXP_sbprintf_b (s_exp, sb);
+	free (b_buf);
+	b_buf = sb_flatten (sb, &b_len);
+	strbuf_free (sb);
+	b_res = SEXP_bin_parse (b_buf, b_len, NULL);
+
+	if (b_res == NULL || SEXP_number_getf (b_res) != 1.0 / 3.0)
+		return (1);
+
+	SEXP_vfree (s_exp, b_res, tree, NULL);
+	free (t_buf);
+	free (b_buf);
+
+	return (0);
+}
@@ -459,5 +459,56 @@ int main (void)
 		SEXP_vfree (r0, r1, r3, NULL);
         }
 
+        {
+                /* pop all the members of a list of several list blocks */
+                SEXP_t *l1, *l2, *r0;
+                uint32_t i, n = 40;
+
+                printf("//pop\n");
+                l1 = SEXP_list_new(NULL);
+
+                for (i = 0; i < n; ++i) {
+                        SEXP_list_add(l1, r0 = SEXP_number_newu_32(i));
+                        SEXP_free(r0);
+                }
+
+                /* the rest of the list shares the list blocks */
+                l2 = SEXP_list_rest(l1);
+
+                for (i = 0; i < n; ++i) {
+                        r0 = SEXP_list_pop(l1);
+
+                        if (r0 == NULL || SEXP_number_getu_32(r0) != i) {
+                                printf("pop: %"PRIu32": wrong member\n", i);
+                                return (1);
+                        }
+
+                        SEXP_free(r0);
+
+                        if (SEXP_list_length(l1) != n - i - 1) {
+                                printf("pop: %"PRIu32": wrong length\n", i);
+                                return (1);
+                        }
+                }
+
+                if (SEXP_list_pop(l1) != NULL) {
+                        printf("pop: not empty\n");
+                        return (1);
+                }
+
+                for (i = 1; i < n; ++i) {
+                        r0 = SEXP_list_nth(l2, i);
+
+                        if (r0 == NULL || SEXP_number_getu_32(r0) != i) {
+                                printf("pop: %"PRIu32": rest modified\n", i);
+                                return (1);
+                        }
+
+                        SEXP_free(r0);
+                }
+
+                SEXP_vfree(l1, l2, NULL);
+        }
+
         return (0);
 }
@@ -0,0 +1,140 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <seap.h>
+
+/*
+ * Round-trip test of the message attributes. Messages with valued and
+ * unvalued attributes are sent through a pipe, some of them back to back,
+ * and the received attributes are looked up by their names.
+ */
+
+#define FAIL(ret, ...)                                        \
+        do {                                                  \
+                fprintf (stderr, "FAIL: " __VA_ARGS__);       \
+                exit (ret);                                   \
+        } while (0)
+
+#define MSG_COUNT 4
+
+static SEAP_msg_t *msg_new (unsigned int i)
+{
+        SEAP_msg_t *msg;
+        SEXP_t *r0;
+
+        msg = SEAP_msg_new ();
+        SEAP_msg_set (msg, r0 = SEXP_string_newf ("message %u", i));
+        SEXP_free (r0);
+
+        SEAP_msgattr_set (msg, "reply-id", r0 = SEXP_number_newu_32 (i));
+        SEXP_free (r0);
+        SEAP_msgattr_set (msg, "x", r0 = SEXP_string_newf ("value %u", i));
+        SEXP_free (r0);
+        SEAP_msgattr_set (msg, "flag", NULL);
+
+        return (msg);
+}
+
+static void msg_check (SEAP_msg_t *msg, unsigned int i)
+{
+        SEXP_t *r0;
+        char buf[32];
+
+        if (!SEAP_msgattr_exists (msg, "reply-id") ||
+            !SEAP_msgattr_exists (msg, "x") ||
+            !SEAP_msgattr_exists (msg, "flag"))
+                FAIL(1, "message %u: missing attribute\n", i);
+
+        if (SEAP_msgattr_exists (msg, "reply") || SEAP_msgattr_exists (msg, "id"))
+                FAIL(1, "message %u: unexpected attribute\n", i);
+
+        r0 = SEAP_msgattr_get (msg, "reply-id");
+
+        if (r0 == NULL || SEXP_number_getu_32 (r0) != i)
+                FAIL(1, "message %u: wrong reply-id\n", i);
+
+        SEXP_free (r0);
+        r0 = SEAP_msgattr_get (msg, "x");
+        snprintf (buf, sizeof buf, "value %u", i);
+
+        if (r0 == NULL || SEXP_strcmp (r0, buf) != 0)
+                FAIL(1, "message %u: wrong x\n", i);
+
+        SEXP_free (r0);
+
+        if (SEAP_msgattr_get (msg, "flag") != NULL ||
+            SEAP_msgattr_get (msg, "reply") != NULL)
+                FAIL(1, "message %u: unexpected value\n", i);
+
+        r0 = SEAP_msg_get (msg);
+        snprintf (buf, sizeof buf, "message %u", i);
+
+        if (r0 == NULL || SEXP_strcmp (r0, buf) != 0)
+                FAIL(1, "message %u: wrong content\n", i);
+
+        SEXP_free (r0);
+}
+
+int main (void)
+{
+        SEAP_CTX_t *ctx;
+        SEAP_msg_t *msg;
+        unsigned int i;
+        int pfd[2], sd;
+
+        setbuf (stdout, NULL);
+
+        if (pipe (pfd) != 0)
+                FAIL(1, "pipe\n");
+
+        ctx = SEAP_CTX_new ();
+        sd  = SEAP_openfd2 (ctx, pfd[0], pfd[1], 0);
+
+        if (sd < 0)
+                FAIL(1, "SEAP_openfd2\n");
+
+        /* one message at a time, then all the messages back to back */
+        for (i = 0; i < MSG_COUNT; ++i) {
+                msg = msg_new (i);
+
+                if (SEAP_sendmsg (ctx, sd, msg) != 0)
+                        FAIL(1, "SEAP_sendmsg\n");
+
+                SEAP_msg_free (msg);
+
+                if (SEAP_recvmsg (ctx, sd, &msg) != 0)
+                        FAIL(1, "SEAP_recvmsg\n");
+
+                msg_check (msg, i);
+                SEAP_msg_free (msg);
+        }
+
+        for (i = 0; i < MSG_COUNT; ++i) {
+                msg = msg_new (i);
+
+                if (SEAP_sendmsg (ctx, sd, msg) != 0)
+                        FAIL(1, "SEAP_sendmsg\n");
+
+                SEAP_msg_free (msg);
+        }
+
+        for (i = 0; i < MSG_COUNT; ++i) {
+                if (SEAP_recvmsg (ctx, sd, &msg) != 0)
+                        FAIL(1, "SEAP_recvmsg\n");
+
+                msg_check (msg, i);
+                SEAP_msg_free (msg);
+        }
+
+        SEAP_close (ctx, sd);
+        SEAP_CTX_free (ctx);
+
+        printf ("messages: %u\n", 2 * MSG_COUNT);
+
+        return (0);
+}
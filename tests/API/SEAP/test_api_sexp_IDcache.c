@@ -0,0 +1,142 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sexp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Test of the IDs cached in S-exp lists. Items shaped like probe items
+ * are hashed, modified in various ways and hashed again; the IDs have
+ * to match the IDs of items built with the same contents from scratch.
+ * The cache is benchmarked by `bench_sexp IDcache'.
+ */
+
+/* ((item :id "") (ent_0 "value_0") (ent_1 "value_1") ...) */
+static SEXP_t *item_build (unsigned int entcnt, unsigned int seed)
+{
+	SEXP_t *item, *r0, *r1, *r2, *r3;
+	unsigned int i;
+
+	r0 = SEXP_string_new ("item", 4);
+	r1 = SEXP_string_new (":id", 3);
+	r2 = SEXP_string_new ("", 0);
+	r3 = SEXP_list_new (r0, r1, r2, NULL);
+	item = SEXP_list_new (r3, NULL);
+	SEXP_vfree (r0, r1, r2, r3, NULL);
+
+	for (i = 0; i < entcnt; ++i) {
+		r0 = SEXP_string_newf ("ent_%u", i);
+		r1 = SEXP_string_newf ("value_%u_%u", i, seed);
+		r2 = SEXP_list_new (r0, r1, NULL);
+		SEXP_list_add (item, r2);
+		SEXP_vfree (r0, r1, r2, NULL);
+	}
+
+	return (item);
+}
+
+static int check_ID (const char *what, const SEXP_t *item, const SEXP_t *expected)
+{
+	if (SEXP_ID_v (item) != SEXP_ID_v (expected) ||
+	    SEXP_ID_v2 (item) != SEXP_ID_v2 (expected) || !SEXP_deepcmp (item, expected)) {
+		printf ("%s: ID differs\n", what);
+		return (-1);
+	}
+
+	return (0);
+}
+
+static int test_IDcache (void)
+{
+	SEXP_t *item, *other, *name, *ent, *r0, *r1;
+	SEXP_ID_t id;
+
+	item  = item_build (5, 1);
+	other = item_build (5, 2);
+	id    = SEXP_ID_v (item);
+
+	if (SEXP_ID_v (item) != id || id == SEXP_ID_v (other) || SEXP_deepcmp (item, other)) {
+		printf ("cached ID differs\n");
+		return (-1);
+	}
+
+	/* modify a nested list through a reference, like probe_item_attr_add() */
+	name = SEXP_listref_first (item);
+	r0 = SEXP_string_new ("42", 2);
+	r1 = SEXP_list_replace (name, 3, r0);
+	SEXP_vfree (name, r0, r1, NULL);
+
+	r0 = item_build (5, 1);
+	name = SEXP_listref_first (r0);
+	r1 = SEXP_string_new ("42", 2);
+	SEXP_free (SEXP_list_replace (name, 3, r1));
+	SEXP_vfree (name, r1, NULL);
+
+	if (SEXP_ID_v (item) == id || check_ID ("nested replace", item, r0) != 0)
+		return (-1);
+
+	SEXP_free (r0);
+
+	/* a nested list rehashed on its own after the item */
+	id  = SEXP_ID_v (item);
+	ent = SEXP_listref_nth (item, 3);
+	r0  = SEXP_string_new ("x", 1);
+	SEXP_list_add (ent, r0);
+	SEXP_ID_v (ent);
+	SEXP_vfree (ent, r0, NULL);
+
+	if (SEXP_ID_v (item) == id) {
+		printf ("nested add: stale ID\n");
+		return (-1);
+	}
+
+	/* a shared nested list copied on write */
+	ent = SEXP_list_nth (item, 2);
+	id  = SEXP_ID_v (item);
+	r0  = SEXP_listref_nth (item, 2);
+	r1  = SEXP_string_new ("y", 1);
+	SEXP_list_add (r0, r1);
+	SEXP_vfree (r0, r1, NULL);
+
+	if (SEXP_ID_v (item) == id || SEXP_list_length (ent) != 2) {
+		printf ("nested copy: stale ID\n");
+		return (-1);
+	}
+
+	SEXP_free (ent);
+
+	/* top level modifications */
+	id = SEXP_ID_v (other);
+	r0 = SEXP_list_pop (other);
+	r1 = SEXP_list_new (r0, NULL);
+
+	if (SEXP_ID_v (other) == id) {
+		printf ("pop: stale ID\n");
+		return (-1);
+	}
+
+	SEXP_list_add (r1, other);
+	SEXP_vfree (r0, other, NULL);
+	other = item_build (5, 2);
+	r0 = SEXP_list_pop (other);
+	SEXP_free (r0);
+	r0 = SEXP_list_nth (r1, 2);
+
+	if (check_ID ("pop", r0, other) != 0)
+		return (-1);
+
+	SEXP_vfree (item, other, r0, r1, NULL);
+
+	return (0);
+}
+
+int main (void)
+{
+	if (test_IDcache () != 0)
+		return (1);
+
+	return (0);
+}
@@ -0,0 +1,114 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sexp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Test of the S-exp value arena. Items are constructed with the
+ * regular allocator and with an arena, the values which outlive the
+ * arena have to be the same. A detached copy of an item mustn't
+ * depend on the arena. The allocators are benchmarked by
+ * `bench_sexp arena'.
+ * Usage: test_api_sexp_arena [item count]
+ */
+
+static SEXP_t *item_new (unsigned int i)
+{
+	SEXP_t *item, *attrs, *ent, *v[6];
+	char path[64];
+
+	v[0] = SEXP_string_newf ("file_item");
+	v[1] = SEXP_string_newf (":id");
+	v[2] = SEXP_number_newu_32 (i);
+	attrs = SEXP_list_new (v[0], v[1], v[2], NULL);
+	item  = SEXP_list_new (attrs, NULL);
+	SEXP_vfree (v[0], v[1], v[2], attrs, NULL);
+
+	snprintf (path, sizeof path, "/usr/lib/module-%u/file-%u.so", i % 97, i);
+
+	v[0] = SEXP_string_newf ("filepath");
+	v[1] = SEXP_string_new (path, strlen (path));
+	v[2] = SEXP_number_newu_64 ((uint64_t)i * 4096);
+	v[3] = SEXP_number_newi_64 (-(int64_t)i);
+	v[4] = SEXP_number_newb (i % 2);
+	v[5] = SEXP_number_newf (0.25 + (i % 1000));
+
+	ent = SEXP_list_new (v[0], v[1], v[2], v[3], v[4], v[5], NULL);
+	SEXP_list_add (item, ent);
+	SEXP_free (ent);
+	SEXP_vfree (v[0], v[1], v[2], v[3], v[4], v[5], NULL);
+
+	return (item);
+}
+
+static void build (SEXP_arena_t *arena, unsigned int count, SEXP_t **keep, SEXP_t **copy)
+{
+	SEXP_arena_t *prev;
+	SEXP_t *tree, *item, *r0;
+	unsigned int i;
+
+	prev = SEXP_arena_switch (arena);
+	tree = SEXP_list_new (NULL);
+
+	for (i = 0; i < count; ++i) {
+		item = item_new (i);
+		SEXP_list_add (tree, item);
+		SEXP_free (item);
+	}
+
+	/* keep one item alive after the arena is gone */
+	*keep = SEXP_list_nth (tree, count / 2 + 1);
+
+	/* and a copy of another one, which is checked after the arena is gone */
+	r0 = SEXP_list_nth (tree, count / 2);
+	*copy = SEXP_arena_detach (r0);
+
+	SEXP_vfree (r0, tree, NULL);
+	SEXP_arena_switch (prev);
+	SEXP_arena_free (arena);
+}
+
+int main (int argc, char *argv[])
+{
+	SEXP_t *h_item, *a_item, *h_copy, *a_copy, *r0, *r1;
+	unsigned int count = 2000;
+
+	if (argc > 1)
+		count = (unsigned int)strtoul (argv[1], NULL, 10);
+	if (count < 2)
+		count = 2;
+
+	build (NULL, count, &h_item, &h_copy);
+	build (SEXP_arena_new (), count, &a_item, &a_copy);
+
+	if (h_item == NULL || a_item == NULL ||
+	    h_copy == NULL || a_copy == NULL)
+		return (1);
+
+	/* the values allocated from the arena are still valid */
+	if (!SEXP_deepcmp (h_item, a_item)) {
+		printf ("arena value mismatch\n");
+		return (1);
+	}
+
+	r0 = SEXP_list_last (a_item);
+	r1 = SEXP_list_last (r0);
+
+	if (r1 == NULL || SEXP_number_getf (r1) != 0.25 + ((count / 2) % 1000)) {
+		printf ("arena value corrupted\n");
+		return (1);
+	}
+
+	if (!SEXP_deepcmp (h_copy, a_copy)) {
+		printf ("detached value mismatch\n");
+		return (1);
+	}
+
+	SEXP_vfree (h_item, a_item, h_copy, a_copy, r0, r1, NULL);
+
+	return (0);
+}
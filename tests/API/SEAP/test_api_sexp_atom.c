@@ -0,0 +1,110 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sexp.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Test of interned S-exp strings. Interned strings of the same contents
+ * share the value, compare and hash the same way as regular strings and
+ * aren't tied to the arena that was current when they were created.
+ */
+
+static int test_atom (const char *str)
+{
+	SEXP_t *a0, *a1, *s0;
+
+	a0 = SEXP_string_atom (str);
+	a1 = SEXP_string_atom (str);
+	s0 = SEXP_string_new (str, strlen (str));
+
+	if (a0 == NULL || a1 == NULL || s0 == NULL) {
+		printf ("\"%s\": NULL\n", str);
+		return (-1);
+	}
+	if (strlen (str) < 256 && !SEXP_eq (a0, a1)) {
+		printf ("\"%s\": not interned\n", str);
+		return (-1);
+	}
+	if (SEXP_strcmp (a0, str) != 0 || SEXP_string_cmp (a0, s0) != 0 || !SEXP_deepcmp (a0, s0)) {
+		printf ("\"%s\": compares differently\n", str);
+		return (-1);
+	}
+	if (SEXP_ID_v (a0) != SEXP_ID_v (s0) || SEXP_ID_v2 (a0) != SEXP_ID_v2 (s0)) {
+		printf ("\"%s\": different ID\n", str);
+		return (-1);
+	}
+
+	SEXP_vfree (a0, a1, s0, NULL);
+
+	return (0);
+}
+
+int main (void)
+{
+	char long_str[300];
+	SEXP_arena_t *arena;
+	SEXP_t *a0, *a1, *l0, *l1;
+	int i;
+
+	setbuf (stdout, NULL);
+
+	memset (long_str, 'x', sizeof long_str - 1);
+	long_str[sizeof long_str - 1] = '\0';
+
+	if (test_atom ("") != 0 || test_atom ("name") != 0 || test_atom (":datatype") != 0 ||
+	    test_atom ("12345678") != 0 || test_atom (long_str) != 0)
+		return (1);
+
+	/* different strings */
+	a0 = SEXP_string_atom ("path");
+	a1 = SEXP_string_atom ("pat");
+
+	if (SEXP_eq (a0, a1) || SEXP_string_cmp (a0, a1) <= 0 || SEXP_ID_v (a0) == SEXP_ID_v (a1)) {
+		printf ("different atoms are equal\n");
+		return (1);
+	}
+
+	/* lists of interned and regular strings have the same ID */
+	l0 = SEXP_list_new (a0, a1, NULL);
+	SEXP_vfree (a0, a1, NULL);
+	a0 = SEXP_string_new ("path", 4);
+	a1 = SEXP_string_new ("pat", 3);
+	l1 = SEXP_list_new (a0, a1, NULL);
+	SEXP_vfree (a0, a1, NULL);
+
+	if (SEXP_ID_v (l0) != SEXP_ID_v (l1) || !SEXP_deepcmp (l0, l1)) {
+		printf ("lists differ\n");
+		return (1);
+	}
+
+	SEXP_vfree (l0, l1, NULL);
+
+	/* an atom created in an arena outlives it */
+	arena = SEXP_arena_new ();
+	SEXP_arena_switch (arena);
+
+	for (i = 0; i < 100; ++i) {
+		char name[32];
+
+		snprintf (name, sizeof name, "arena_name_%d", i);
+		a0 = SEXP_string_atom (name);
+		SEXP_free (a0);
+	}
+
+	SEXP_arena_switch (NULL);
+	SEXP_arena_free (arena);
+
+	a0 = SEXP_string_atom ("arena_name_42");
+
+	if (SEXP_strcmp (a0, "arena_name_42") != 0) {
+		printf ("atom freed with the arena\n");
+		return (1);
+	}
+
+	SEXP_free (a0);
+
+	return (0);
+}
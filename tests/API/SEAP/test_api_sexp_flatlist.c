@@ -0,0 +1,131 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sexp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Test of flat S-exp lists. Lists of the same members are built as
+ * a chain of list blocks (SEXP_list_add only) and as a single block
+ * (SEXP_list_reserve) and the results are compared. The layouts are
+ * benchmarked by `bench_sexp flatlist'.
+ */
+
+static int numcmp (const SEXP_t *a, const SEXP_t *b)
+{
+	uint32_t na = SEXP_number_getu_32 (a);
+	uint32_t nb = SEXP_number_getu_32 (b);
+
+	return (na < nb ? -1 : (na > nb ? 1 : 0));
+}
+
+static SEXP_t *list_build (unsigned int length, unsigned int seed, bool flat)
+{
+	SEXP_t *list, *memb;
+	unsigned int i;
+
+	list = SEXP_list_new (NULL);
+
+	for (i = 0; i < length; ++i) {
+		memb = SEXP_number_newu_32 ((i * 2654435761U + seed) % 1000003);
+		SEXP_list_add (list, memb);
+		SEXP_free (memb);
+
+		if (flat && i == 0)
+			SEXP_list_reserve (list, length);
+	}
+
+	return (list);
+}
+
+static int list_sorted (const SEXP_t *list)
+{
+	SEXP_t *prev = NULL, *memb;
+	int ret = 1;
+
+	SEXP_list_foreach (memb, list) {
+		if (prev != NULL && numcmp (prev, memb) > 0)
+			ret = 0;
+		SEXP_free (prev);
+		prev = SEXP_ref (memb);
+	}
+
+	SEXP_free (prev);
+	return (ret);
+}
+
+static int test_flat (void)
+{
+	SEXP_t *chain, *flat, *copy, *rest, *r0, *r1;
+	unsigned int i;
+
+	chain = list_build (100, 1, false);
+	flat  = list_build (100, 1, false);
+
+	/* flatten a list built as a chain */
+	if (SEXP_list_reserve (flat, 0) != flat || !SEXP_deepcmp (chain, flat)) {
+		printf ("flattened list differs\n");
+		return (-1);
+	}
+
+	/* a shared list gets a private copy, the other reference isn't changed */
+	copy = SEXP_ref (flat);
+	SEXP_list_reserve (copy, 200);
+	r0 = SEXP_number_newu_32 (7);
+	SEXP_list_add (copy, r0);
+	SEXP_free (r0);
+
+	if (SEXP_list_length (flat) != 100 || SEXP_list_length (copy) != 101) {
+		printf ("shared list modified\n");
+		return (-1);
+	}
+
+	for (i = 1; i <= 100; ++i) {
+		r0 = SEXP_list_nth (chain, i);
+		r1 = SEXP_list_nth (copy, i);
+
+		if (r0 == NULL || r1 == NULL || numcmp (r0, r1) != 0) {
+			printf ("member %u differs\n", i);
+			return (-1);
+		}
+
+		SEXP_vfree (r0, r1, NULL);
+	}
+
+	/* a rest list doesn't include the skipped member */
+	rest = SEXP_list_rest (chain);
+	SEXP_list_reserve (rest, 0);
+	r0 = SEXP_list_nth (chain, 2);
+	r1 = SEXP_list_first (rest);
+
+	if (SEXP_list_length (rest) != 99 || numcmp (r0, r1) != 0) {
+		printf ("rest list differs\n");
+		return (-1);
+	}
+
+	SEXP_vfree (r0, r1, NULL);
+
+	/* both layouts are sorted the same way */
+	SEXP_list_sort (chain, numcmp);
+	SEXP_list_sort (copy, numcmp);
+
+	if (!list_sorted (chain) || !list_sorted (copy)) {
+		printf ("list not sorted\n");
+		return (-1);
+	}
+
+	SEXP_vfree (chain, flat, copy, rest, NULL);
+
+	return (0);
+}
+
+int main (void)
+{
+	if (test_flat () != 0)
+		return (1);
+
+	return (0);
+}
@@ -0,0 +1,279 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sexp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Test of the parser scanners. Texts with quoted, simple
+ * and length prefixed strings separated by whitespace of random length
+ * and texts of probe items printed in the transport format are parsed
+ * both at once and in chunks of random length. The results have to be
+ * the same as the expected trees. The scanner implementation is chosen
+ * by the SEXP_SCAN environment variable. The scanners are benchmarked
+ * by `bench_sexp scan'.
+ */
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd (uint32_t n)
+{
+	rnd_state = rnd_state * 1103515245 + 12345;
+	return ((rnd_state >> 8) % n);
+}
+
+static char *sb_flatten (strbuf_t *sb, size_t *len)
+{
+	char *buf;
+
+	*len = strbuf_length (sb);
+	buf  = malloc (*len);
+	strbuf_copy (sb, buf, *len);
+
+	return (buf);
+}
+
+/* parse `buf' in chunks of random length, or at once if `maxchunk' is 0 */
+static SEXP_t *parse (char *buf, size_t len, size_t maxchunk)
+{
+	SEXP_psetup_t *psetup;
+	SEXP_pstate_t *pstate = NULL;
+	SEXP_t *res = NULL;
+	size_t off, n;
+
+	psetup = SEXP_psetup_new ();
+
+	for (off = 0; off < len; off += n) {
+		n = (maxchunk > 0 ? 1 + rnd (maxchunk) : len);
+
+		if (n > len - off)
+			n = len - off;
+
+		res = SEXP_parse (psetup, buf + off, n, &pstate);
+
+		if (res != NULL && off + n != len) {
+			SEXP_free (res);
+			res = NULL;
+			break;
+		}
+	}
+
+	SEXP_psetup_free (psetup);
+
+	return (res);
+}
+
+static void add_space (strbuf_t *sb)
+{
+	static const char space[] = " \t\n\r\v\f";
+	uint32_t n = (rnd (4) == 0 ? rnd (80) : 0);
+
+	/* VT and FF don't end a simple string */
+	strbuf_addc (sb, space[rnd (4)]);
+
+	while (n-- > 0)
+		strbuf_addc (sb, space[rnd (sizeof space - 1)]);
+}
+
+/*
+ * Text with strings written in all the ways the parser understands
+ * and the list of the strings it's expected to be parsed to.
+ */
+static char *text_new (unsigned int count, SEXP_t **expected, size_t *len)
+{
+	static const char si_chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-:/.=@";
+	static const char dq_chars[] = "abcdefghijklmnop0123456789 ()[]{}|#'\"\\\n\t\r\a\b\v\f\0\x80\xff";
+	strbuf_t *sb;
+	SEXP_t *s_exp;
+	char str[256], num[32];
+	unsigned int i, j, l;
+
+	sb = strbuf_new (SEAP_STRBUF_MAX);
+	*expected = SEXP_list_new (NULL);
+
+	strbuf_addc (sb, '(');
+
+	for (i = 0; i < count; ++i) {
+		add_space (sb);
+		l = (rnd (8) == 0 ? rnd (sizeof str) : rnd (24));
+
+		switch (rnd (3)) {
+		case 0: /* simple */
+			str[0] = si_chars[rnd (52)];
+			for (j = 1; j <= l && j < sizeof str; ++j)
+				str[j] = si_chars[rnd (sizeof si_chars - 1)];
+			l = j;
+			strbuf_add (sb, str, l);
+			break;
+		case 1: /* quoted */
+			strbuf_addc (sb, '"');
+			for (j = 0; j < l; ++j) {
+				str[j] = dq_chars[rnd (sizeof dq_chars - 1)];
+
+				switch (str[j]) {
+				case '"':  strbuf_add (sb, "\\\"", 2); break;
+				case '\\': strbuf_add (sb, "\\\\", 2); break;
+				case '\0': strbuf_add (sb, "\\0", 2);  break;
+				case '\n': strbuf_add (sb, "\\n", 2);  break;
+				case '\t': strbuf_add (sb, "\\t", 2);  break;
+				case '\v': strbuf_add (sb, "\\v", 2);  break;
+				default:
+					strbuf_addc (sb, str[j]);
+				}
+			}
+			strbuf_addc (sb, '"');
+			break;
+		default: /* length prefixed */
+			for (j = 0; j < l; ++j)
+				str[j] = (char)rnd (256);
+			snprintf (num, sizeof num, "%u:", l);
+			strbuf_add (sb, num, strlen (num));
+			strbuf_add (sb, str, l);
+		}
+
+		s_exp = SEXP_string_new (str, l);
+		SEXP_list_add (*expected, s_exp);
+		SEXP_free (s_exp);
+	}
+
+	add_space (sb);
+	strbuf_addc (sb, ')');
+
+	{
+		char *buf = sb_flatten (sb, len);
+		strbuf_free (sb);
+		return (buf);
+	}
+}
+
+static SEXP_t *item_new (unsigned int i)
+{
+	SEXP_t *item, *attrs, *ent, *v[6];
+	char path[96];
+
+	v[0] = SEXP_string_newf ("rpmverifyfile_item");
+	v[1] = SEXP_string_newf (":id");
+	v[2] = SEXP_number_newu_32 (i);
+	attrs = SEXP_list_new (v[0], v[1], v[2], NULL);
+	item  = SEXP_list_new (attrs, NULL);
+	SEXP_vfree (v[0], v[1], v[2], attrs, NULL);
+
+	snprintf (path, sizeof path, "/usr/share/doc/package-%u/examples/file name %u.txt", i % 97, i);
+
+	v[0] = SEXP_string_newf ("filepath");
+	v[1] = SEXP_string_new (path, strlen (path));
+	v[2] = SEXP_number_newu_64 ((uint64_t)i * 4096 * 1024 * 1024);
+	v[3] = SEXP_number_newi_64 (-(int64_t)i * 1000003);
+	v[4] = SEXP_number_newb (i % 2);
+	v[5] = SEXP_number_newf (0.25 + (i % 1000));
+
+	ent = SEXP_list_new (v[0], v[1], v[2], v[3], v[4], v[5], NULL);
+	SEXP_list_add (item, ent);
+	SEXP_free (ent);
+	SEXP_vfree (v[0], v[1], v[2], v[3], v[4], v[5], NULL);
+
+	v[0] = SEXP_string_newf ("size_differs");
+	v[1] = SEXP_string_newf ("pass");
+	ent  = SEXP_list_new (v[0], v[1], NULL);
+	SEXP_list_add (item, ent);
+	SEXP_vfree (ent, v[0], v[1], NULL);
+
+	return (item);
+}
+
+/*
+ * Numbers are narrowed on input, so the parsed tree is printed
+ * again and compared with the text it was parsed from.
+ */
+static int items_check (const char *buf, size_t len, SEXP_t *res)
+{
+	strbuf_t *sb;
+	SEXP_t *s_exp;
+	char *out;
+	size_t out_len;
+	int ret;
+
+	if (res == NULL || SEXP_list_length (res) != 1)
+		return (-1);
+
+	s_exp = SEXP_list_first (res);
+	sb = strbuf_new (SEAP_STRBUF_MAX);
+	SEXP_sbprintf_t (s_exp, sb);
+	out = sb_flatten (sb, &out_len);
+	ret = (out_len == len && memcmp (out, buf, len) == 0 ? 0 : -1);
+
+	strbuf_free (sb);
+	SEXP_free (s_exp);
+	free (out);
+
+	return (ret);
+}
+
+static int test_scan (void)
+{
+	SEXP_t *expected, *res, *s_exp, *tree, *item;
+	strbuf_t *sb;
+	char *buf;
+	size_t len, chunk;
+	unsigned int round, i;
+
+	for (round = 0; round < 50; ++round) {
+		buf = text_new (1 + rnd (200), &expected, &len);
+
+		for (chunk = 0; chunk <= 64; chunk = (chunk == 0 ? 1 : chunk * 2)) {
+			res   = parse (buf, len, chunk);
+			s_exp = (res != NULL ? SEXP_list_first (res) : NULL);
+
+			if (s_exp == NULL || !SEXP_deepcmp (s_exp, expected)) {
+				printf ("text %u differs (chunk %zu)\n", round, chunk);
+				fwrite (buf, 1, len, stdout);
+				return (-1);
+			}
+
+			SEXP_vfree (s_exp, res, NULL);
+		}
+
+		SEXP_free (expected);
+		free (buf);
+	}
+
+	tree = SEXP_list_new (NULL);
+
+	for (i = 0; i < 200; ++i) {
+		item = item_new (i);
+		SEXP_list_add (tree, item);
+		SEXP_free (item);
+	}
+
+	sb = strbuf_new (SEAP_STRBUF_MAX);
+	SEXP_sbprintf_t (tree, sb);
+	buf = sb_flatten (sb, &len);
+	strbuf_free (sb);
+	SEXP_free (tree);
+
+	for (chunk = 0; chunk <= 256; chunk = (chunk == 0 ? 1 : chunk * 4)) {
+		res = parse (buf, len, chunk);
+
+		if (items_check (buf, len, res) != 0) {
+			printf ("items differ (chunk %zu)\n", chunk);
+			return (-1);
+		}
+
+		SEXP_free (res);
+	}
+
+	free (buf);
+
+	return (0);
+}
+
+int main (void)
+{
+	if (test_scan () != 0)
+		return (1);
+
+	return (0);
+}
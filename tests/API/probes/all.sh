@@ -5,4 +5,5 @@
 test_init "test_api_probes.log"
 test_run "fts test" $srcdir/fts.sh
 test_run "probe api smoke test" ./test_api_probes_smoke
+test_run "probe api entity matcher test" ./test_api_probes_entmatch
 test_exit
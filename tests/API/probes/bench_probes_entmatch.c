@@ -0,0 +1,75 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <seap.h>
+#include <probe-api.h>
+#include "OVAL/probes/probe/entcmp.h"
+#include "../../bench.h"
+
+/*
+ * Benchmark of the precompiled object entity matchers. File names are
+ * matched with a pattern the way the file probes match the directory
+ * entries, both by probe_entobj_cmp() and by a matcher. The results
+ * are checked by test_api_probes_entmatch.
+ * Usage: bench_probes_entmatch [name count]
+ */
+
+int main (int argc, char *argv[])
+{
+        SEXP_t *attrs, *ent, *r0, *sname;
+        probe_entmatch_t *m;
+        char name[64];
+        unsigned int i, count = 20000, c0 = 0, c1 = 0;
+        double t0, t1, t2;
+
+        setbuf (stdout, NULL);
+
+        if (argc > 1)
+                count = (unsigned int)strtoul (argv[1], NULL, 10);
+
+        /* (filename :operation pattern_match) "^lib.*\.so(\.[0-9]+)*$" */
+        r0    = SEXP_number_newi_32 (OVAL_OPERATION_PATTERN_MATCH);
+        attrs = probe_attr_creat ("operation", r0, NULL);
+        SEXP_free (r0);
+        r0    = SEXP_string_newf ("^lib.*\\.so(\\.[0-9]+)*$");
+        ent   = probe_ent_creat1 ("filename", attrs, r0);
+        probe_ent_setdatatype (ent, OVAL_DATATYPE_STRING);
+        SEXP_vfree (r0, attrs, NULL);
+
+        t0 = bench_now ();
+
+        for (i = 0; i < count; ++i) {
+                snprintf (name, sizeof name, i % 3 ? "lib%u.so.%u" : "file%u.txt", i, i % 7);
+                sname = SEXP_string_newf ("%s", name);
+
+                if (probe_entobj_cmp (ent, sname) == OVAL_RESULT_TRUE)
+                        ++c0;
+
+                SEXP_free (sname);
+        }
+
+        t1 = bench_now ();
+        m  = probe_entmatch_new (ent);
+
+        for (i = 0; i < count; ++i) {
+                snprintf (name, sizeof name, i % 3 ? "lib%u.so.%u" : "file%u.txt", i, i % 7);
+
+                if (probe_entmatch_cstr (m, name) == OVAL_RESULT_TRUE)
+                        ++c1;
+        }
+
+        t2 = bench_now ();
+
+        probe_entmatch_free (m);
+        SEXP_free (ent);
+
+        printf ("names: %u, matched: %u/%u\n", count, c0, c1);
+        printf ("entobj_cmp: %.4fs\n", t1 - t0);
+        printf ("entmatch:   %.4fs\n", t2 - t1);
+
+        return (0);
+}
@@ -0,0 +1,279 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <seap.h>
+#include <probe-api.h>
+#include "OVAL/probes/probe/entcmp.h"
+
+/*
+ * Test of the precompiled object entity matchers. Entities of various
+ * datatypes, operations and var_checks are matched against a set of
+ * values both by probe_entobj_cmp() and by the matchers and the results
+ * have to be the same. The matchers are benchmarked by
+ * bench_probes_entmatch.
+ */
+
+#define FAIL(ret, ...)                                        \
+        do {                                                  \
+                fprintf (stderr, "FAIL: " __VA_ARGS__);       \
+                exit (ret);                                   \
+        } while (0)
+
+static const char *str_vals[] = {
+        "sha1", "SHA1", "md5", "sha256", "sha-1", "", "a b",
+        "1.2.3", "1.10", "0:1.2-3", "1:1.2-3", "10.0.0.1", "10.0.0.0/8",
+        "fe80::1", "0a1B", "/etc/passwd", "passwd", "x\xc3\xa1y", NULL
+};
+
+static const oval_operation_t ops[] = {
+        OVAL_OPERATION_EQUALS,
+        OVAL_OPERATION_NOT_EQUAL,
+        OVAL_OPERATION_CASE_INSENSITIVE_EQUALS,
+        OVAL_OPERATION_CASE_INSENSITIVE_NOT_EQUAL,
+        OVAL_OPERATION_GREATER_THAN,
+        OVAL_OPERATION_LESS_THAN_OR_EQUAL,
+        OVAL_OPERATION_PATTERN_MATCH,
+        OVAL_OPERATION_SUBSET_OF
+};
+
+static const oval_datatype_t dtypes[] = {
+        OVAL_DATATYPE_STRING,
+        OVAL_DATATYPE_VERSION,
+        OVAL_DATATYPE_EVR_STRING,
+        OVAL_DATATYPE_IPV4ADDR,
+        OVAL_DATATYPE_BINARY,
+        OVAL_DATATYPE_INTEGER
+};
+
+static const oval_check_t checks[] = {
+        OVAL_CHECK_ALL,
+        OVAL_CHECK_AT_LEAST_ONE,
+        OVAL_CHECK_NONE_SATISFY,
+        OVAL_CHECK_ONLY_ONE
+};
+
+/* version and address comparisons abort on some of the operations */
+static bool op_valid (oval_datatype_t dtype, oval_operation_t op)
+{
+        switch (dtype) {
+        case OVAL_DATATYPE_VERSION:
+        case OVAL_DATATYPE_EVR_STRING:
+        case OVAL_DATATYPE_IPV4ADDR:
+                return (op == OVAL_OPERATION_EQUALS ||
+                        op == OVAL_OPERATION_NOT_EQUAL ||
+                        op == OVAL_OPERATION_GREATER_THAN ||
+                        op == OVAL_OPERATION_LESS_THAN_OR_EQUAL ||
+                        (op == OVAL_OPERATION_SUBSET_OF && dtype == OVAL_DATATYPE_IPV4ADDR));
+        default:
+                return (true);
+        }
+}
+
+/*
+ * (name :operation op) val, or ((name :var_ref id :var_check chk) (val ...))
+ * if `var' is set
+ */
+static SEXP_t *ent_new (oval_datatype_t dtype, oval_operation_t op, SEXP_t *vals, bool var, oval_check_t chk)
+{
+        SEXP_t *attrs, *ent, *r0, *r1, *r2, *r3;
+
+        r0 = SEXP_number_newi_32 (op);
+
+        if (var) {
+                r1 = SEXP_string_newf ("oval:test:var:1");
+                r2 = SEXP_number_newi_32 (chk);
+                r3 = SEXP_number_newu (0);
+                attrs = probe_attr_creat ("operation", r0, "var_ref", r1,
+                                          "var_check", r2, "val_idx", r3, NULL);
+                ent = probe_ent_creat1 ("test", attrs, vals);
+                SEXP_vfree (r1, r2, r3, NULL);
+        } else {
+                attrs = probe_attr_creat ("operation", r0, NULL);
+                ent = probe_ent_creat1 ("test", attrs, NULL);
+                r1 = SEXP_list_join (ent, vals);
+                SEXP_free (ent);
+                ent = r1;
+        }
+
+        probe_ent_setdatatype (ent, dtype);
+        SEXP_vfree (r0, attrs, NULL);
+
+        return (ent);
+}
+
+static unsigned int check_ent (SEXP_t *ent, SEXP_t *candidates)
+{
+        probe_entmatch_t *m;
+        SEXP_t *val;
+        oval_result_t r0, r1, r2;
+        unsigned int n = 0;
+
+        m = probe_entmatch_new (ent);
+
+        SEXP_list_foreach (val, candidates) {
+                r0 = probe_entobj_cmp (ent, val);
+                r1 = probe_entmatch_sexp (m, val);
+
+                if (r0 != r1) {
+                        SEXP_fprintfa (stderr, ent);
+                        SEXP_fprintfa (stderr, val);
+                        FAIL(1, "\nentmatch_sexp: %d != %d\n", r1, r0);
+                }
+
+                if (SEXP_stringp (val)) {
+                        char *str = SEXP_string_cstr (val);
+
+                        r2 = probe_entmatch_cstr (m, str);
+                        free (str);
+
+                        if (r0 != r2) {
+                                SEXP_fprintfa (stderr, ent);
+                                SEXP_fprintfa (stderr, val);
+                                FAIL(1, "\nentmatch_cstr: %d != %d\n", r2, r0);
+                        }
+                }
+
+                ++n;
+        }
+
+        probe_entmatch_free (m);
+
+        return (n);
+}
+
+static unsigned int test_entmatch (void)
+{
+        SEXP_t *candidates, *vals, *ent, *r0;
+        const char *patterns[] = { "^sha[0-9]+$", "a", "(", "^$", "\\d\\.\\d", NULL };
+        unsigned int i, d, o, c, n = 0;
+
+        candidates = SEXP_list_new (NULL);
+
+        for (i = 0; str_vals[i] != NULL; ++i) {
+                r0 = SEXP_string_newf ("%s", str_vals[i]);
+                SEXP_list_add (candidates, r0);
+                SEXP_free (r0);
+        }
+
+        r0 = SEXP_number_newi_32 (10);
+        SEXP_list_add (candidates, r0);
+        SEXP_free (r0);
+
+        for (d = 0; d < sizeof dtypes / sizeof dtypes[0]; ++d) {
+                for (o = 0; o < sizeof ops / sizeof ops[0]; ++o) {
+                        if (!op_valid (dtypes[d], ops[o]))
+                                continue;
+
+                        /* single values */
+                        for (i = 0; str_vals[i] != NULL; ++i) {
+                                vals = SEXP_list_new (r0 = SEXP_string_newf ("%s", str_vals[i]), NULL);
+                                ent  = ent_new (dtypes[d], ops[o], vals, false, OVAL_CHECK_ALL);
+                                n += check_ent (ent, candidates);
+                                SEXP_vfree (r0, vals, ent, NULL);
+                        }
+
+                        if (dtypes[d] == OVAL_DATATYPE_INTEGER) {
+                                vals = SEXP_list_new (r0 = SEXP_number_newi_32 (10), NULL);
+                                ent  = ent_new (dtypes[d], ops[o], vals, false, OVAL_CHECK_ALL);
+                                n += check_ent (ent, candidates);
+                                SEXP_vfree (r0, vals, ent, NULL);
+                        }
+
+                        /* two values without var_ref are an error */
+                        vals = SEXP_list_new (NULL);
+                        SEXP_list_add (vals, r0 = SEXP_string_newf ("sha1"));
+                        SEXP_free (r0);
+                        SEXP_list_add (vals, r0 = SEXP_string_newf ("md5"));
+                        SEXP_free (r0);
+                        ent = ent_new (dtypes[d], ops[o], vals, false, OVAL_CHECK_ALL);
+                        n += check_ent (ent, candidates);
+                        SEXP_free (ent);
+
+                        /* variable values */
+                        for (c = 0; c < sizeof checks / sizeof checks[0]; ++c) {
+                                ent = ent_new (dtypes[d], ops[o], vals, true, checks[c]);
+                                n += check_ent (ent, candidates);
+                                SEXP_free (ent);
+                        }
+
+                        SEXP_free (vals);
+
+                        vals = SEXP_list_new (NULL);
+                        ent = ent_new (dtypes[d], ops[o], vals, true, OVAL_CHECK_ALL);
+                        n += check_ent (ent, candidates);
+                        SEXP_vfree (vals, ent, NULL);
+                }
+        }
+
+        for (i = 0; patterns[i] != NULL; ++i) {
+                vals = SEXP_list_new (r0 = SEXP_string_newf ("%s", patterns[i]), NULL);
+                ent  = ent_new (OVAL_DATATYPE_STRING, OVAL_OPERATION_PATTERN_MATCH, vals, false, OVAL_CHECK_ALL);
+                n += check_ent (ent, candidates);
+                SEXP_vfree (r0, ent, NULL);
+
+                SEXP_list_add (vals, r0 = SEXP_string_newf ("^md"));
+                SEXP_free (r0);
+
+                for (c = 0; c < sizeof checks / sizeof checks[0]; ++c) {
+                        ent = ent_new (OVAL_DATATYPE_STRING, OVAL_OPERATION_PATTERN_MATCH, vals, true, checks[c]);
+                        n += check_ent (ent, candidates);
+                        SEXP_free (ent);
+                }
+
+                SEXP_free (vals);
+        }
+
+        SEXP_free (candidates);
+
+        return (n);
+}
+
+int main (void)
+{
+        SEXP_t *vals, *ent, *r0, *sname;
+        probe_entmatch_t *m;
+        char name[64];
+        unsigned int i, count = 1000, c0 = 0, c1 = 0;
+
+        setbuf (stdout, NULL);
+
+        printf ("matched values: %u\n", test_entmatch ());
+
+        /* a filename entity, the way the file probes match the directory entries */
+        vals = SEXP_list_new (r0 = SEXP_string_newf ("^lib.*\\.so(\\.[0-9]+)*$"), NULL);
+        ent  = ent_new (OVAL_DATATYPE_STRING, OVAL_OPERATION_PATTERN_MATCH, vals, false, OVAL_CHECK_ALL);
+        SEXP_vfree (r0, vals, NULL);
+
+        for (i = 0; i < count; ++i) {
+                snprintf (name, sizeof name, i % 3 ? "lib%u.so.%u" : "file%u.txt", i, i % 7);
+                sname = SEXP_string_newf ("%s", name);
+
+                if (probe_entobj_cmp (ent, sname) == OVAL_RESULT_TRUE)
+                        ++c0;
+
+                SEXP_free (sname);
+        }
+
+        m = probe_entmatch_new (ent);
+
+        for (i = 0; i < count; ++i) {
+                snprintf (name, sizeof name, i % 3 ? "lib%u.so.%u" : "file%u.txt", i, i % 7);
+
+                if (probe_entmatch_cstr (m, name) == OVAL_RESULT_TRUE)
+                        ++c1;
+        }
+
+        probe_entmatch_free (m);
+        SEXP_free (ent);
+
+        if (c0 != c1)
+                FAIL(1, "matched names: %u != %u\n", c1, c0);
+
+        printf ("names: %u, matched: %u\n", count, c0);
+
+        return (0);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <time.h>
+
+/*
+ * Helpers of the benchmark programs. The benchmarks are built by
+ * `make bench' in their directories and aren't run by `make check'.
+ */
+
+/* monotonic time in seconds */
+static inline double bench_now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((double)ts.tv_sec + (double)ts.tv_nsec / 1e9);
+}
+
+#endif /* BENCH_H */
@@ -0,0 +1,44 @@
+#!/bin/bash
+
+set -e -o pipefail
+
+name=$(basename $0 .sh)
+tmpdir=$(mktemp -t -d "${name}.XXXXXX")
+tpl=${srcdir}/${name}.xml.tpl
+input=${tmpdir}/${name}.xml
+result=${tmpdir}/${name}.results.xml
+echo "Temp dir: $tmpdir"
+
+# prepare the environment, files much larger than a page
+for i in $(seq 1 5000); do
+	echo "key_$i = value"
+	echo "# comment line $i"
+done > ${tmpdir}/large
+
+for i in $(seq 1 10000); do
+	echo "line $i"
+done > ${tmpdir}/utf8
+printf '\xc3\xa9\xc3\xa4\xc3\xbc\n' >> ${tmpdir}/utf8
+
+# the content after a null byte is not searched
+cat ${tmpdir}/large > ${tmpdir}/nul
+printf '\0key_0\n' >> ${tmpdir}/nul
+
+sed "s@%PATH%@${tmpdir}@" $tpl > $input
+
+echo "Evaluating content."
+$OSCAP oval eval --results $result $input || [ $? == 2 ]
+echo "Validating results."
+$OSCAP oval validate-xml --results $result
+echo "Testing syschar values."
+syschar=/oval_results/results/system/oval_system_characteristics
+for obj in 1 2 3 4; do
+	[ "$($XPATH $result 'string('$syschar'/collected_objects/object[@id="oval:x:obj:'$obj'"]/@flag)')" == "complete" ]
+done
+[ "$($XPATH $result 'count('$syschar'/collected_objects/object[@id="oval:x:obj:1"]/reference)')" == "5000" ]
+[ "$($XPATH $result 'count('$syschar'/collected_objects/object[@id="oval:x:obj:2"]/reference)')" == "1" ]
+[ "$($XPATH $result 'count('$syschar'/collected_objects/object[@id="oval:x:obj:4"]/reference)')" == "5000" ]
+[ "$($XPATH $result 'string('$syschar'/system_data/*[local-name()="textfilecontent_item"][@id='$syschar'/collected_objects/object[@id="oval:x:obj:2"]/reference/@item_ref]/*[local-name()="subexpression"])')" == "5000" ]
+[ "$($XPATH $result 'string('$syschar'/system_data/*[local-name()="textfilecontent_item"][@id='$syschar'/collected_objects/object[@id="oval:x:obj:3"]/reference/@item_ref]/*[local-name()="subexpression"])')" == "ä" ]
+
+rm -rf $tmpdir
@@ -118,6 +118,7 @@ static struct oscap_module OVAL_EVAL = {
         "   --oval-id <id> \r\t\t\t\t - ID of the OVAL component ref in the datastream to use.\n"
         "                  \r\t\t\t\t   (only applicable for source datastreams)\n"
 	"   --probe-root <dir>\r\t\t\t\t - Change the root directory before scanning the system.\n"
+	"   --probe-cache <dir>\r\t\t\t\t - Reuse objects collected by previous scans stored in the directory.\n"
 	"   --verbose <verbosity_level>\r\t\t\t\t - Turn on verbose mode at specified verbosity level.\n"
 	"   --verbose-log-file <file>\r\t\t\t\t - Write verbose information into file.\n",
     .opt_parser = getopt_oval_eval,
@@ -351,6 +352,10 @@ int app_evaluate_oval(const struct oscap_action *action)
 		goto cleanup;
 	}
 
+	if (!set_probe_cache(action)) {
+		goto cleanup;
+	}
+
 	/* create a new OVAL session */
 	if ((session = oval_session_new(action->f_oval)) == NULL) {
 		oscap_print_error();
@@ -544,6 +549,7 @@ enum oval_opt {
     OVAL_OPT_OVAL_ID,
     OVAL_OPT_OUTPUT = 'o',
 	OVAL_OPT_PROBE_ROOT,
+	OVAL_OPT_PROBE_CACHE,
 	OVAL_OPT_VERBOSE,
 	OVAL_OPT_VERBOSE_LOG_FILE
 };
@@ -565,6 +571,7 @@ bool getopt_oval_eval(int argc, char **argv, struct oscap_action *action)
 		{ "oval-id",    required_argument, NULL, OVAL_OPT_OVAL_ID},
 		{ "skip-valid",	no_argument, &action->validate, 0 },
 		{ "probe-root", required_argument, NULL, OVAL_OPT_PROBE_ROOT},
+		{ "probe-cache", required_argument, NULL, OVAL_OPT_PROBE_CACHE},
 		{ "verbose", required_argument, NULL, OVAL_OPT_VERBOSE },
 		{ "verbose-log-file", required_argument, NULL, OVAL_OPT_VERBOSE_LOG_FILE },
 		{ "fetch-remote-resources", no_argument, &action->remote_resources, 1},
@@ -582,6 +589,7 @@ bool getopt_oval_eval(int argc, char **argv, struct oscap_action *action)
 		case OVAL_OPT_DATASTREAM_ID: action->f_datastream_id = optarg;	break;
 		case OVAL_OPT_OVAL_ID: action->f_oval_id = optarg;	break;
 		case OVAL_OPT_PROBE_ROOT: action->probe_root = optarg; break;
+		case OVAL_OPT_PROBE_CACHE: action->probe_cache = optarg; break;
 		case OVAL_OPT_VERBOSE:
 			action->verbosity_level = optarg;
 			break;
@@ -392,6 +392,19 @@ bool check_verbose_options(struct oscap_action *action)
 	return true;
 }
 
+bool set_probe_cache(const struct oscap_action *action)
+{
+	if (action->probe_cache == NULL)
+		return true;
+
+	/* the probes inherit the environment */
+	if (setenv("OSCAP_PROBE_CACHE_DIR", action->probe_cache, 1) != 0) {
+		fprintf(stderr, "Failed to set the OSCAP_PROBE_CACHE_DIR environment variable.\n");
+		return false;
+	}
+	return true;
+}
+
 void download_reporting_callback(bool warning, const char *format, ...)
 {
 	FILE *dest = stderr;
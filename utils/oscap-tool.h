@@ -152,6 +152,7 @@ struct oscap_action {
 	int export_variables;
         int list_dynamic;
 	char *probe_root;
+	char *probe_cache;
 	char *verbosity_level;
 };
 
@@ -164,6 +165,7 @@ int oscap_module_call(struct oscap_action *action);
 
 void oscap_print_error(void);
 bool check_verbose_options(struct oscap_action *action);
+bool set_probe_cache(const struct oscap_action *action);
 void download_reporting_callback(bool warning, const char *format, ...);
 
 extern struct oscap_module OSCAP_ROOT_MODULE;
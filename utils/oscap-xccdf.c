@@ -166,6 +166,7 @@ static struct oscap_module XCCDF_EVAL = {
 	"                   \r\t\t\t\t   (only applicable when datastream-id AND xccdf-id are not specified)\n"
 	"   --remediate \r\t\t\t\t - Automatically execute XCCDF fix elements for failed rules.\n"
 	"               \r\t\t\t\t   Use of this option is always at your own risk.\n"
+	"   --probe-cache <dir>\r\t\t\t\t - Reuse objects collected by previous scans stored in the directory.\n"
 	"   --verbose <verbosity_level>\r\t\t\t\t - Turn on verbose mode at specified verbosity level.\n"
 	"   --verbose-log-file <file>\r\t\t\t\t - Write verbose informations into file.\n",
     .opt_parser = getopt_xccdf,
@@ -454,6 +455,9 @@ int app_evaluate_xccdf(const struct oscap_action *action)
 	if (!oscap_set_verbose(action->verbosity_level, action->f_verbose_log, false)) {
 		goto cleanup;
 	}
+	if (!set_probe_cache(action)) {
+		goto cleanup;
+	}
 
 	/* syslog message */
 	syslog(priority, "Evaluation started. Content: %s, Profile: %s.", action->f_xccdf, action->profile);
@@ -924,7 +928,8 @@ enum oval_opt {
     XCCDF_OPT_OUTPUT = 'o',
     XCCDF_OPT_RESULT_ID = 'i',
 	XCCDF_OPT_VERBOSE,
-	XCCDF_OPT_VERBOSE_LOG_FILE
+	XCCDF_OPT_VERBOSE_LOG_FILE,
+	XCCDF_OPT_PROBE_CACHE
 };
 
 bool getopt_xccdf(int argc, char **argv, struct oscap_action *action)
@@ -956,6 +961,7 @@ bool getopt_xccdf(int argc, char **argv, struct oscap_action *action)
 		{"sce-template", 	required_argument, NULL, XCCDF_OPT_SCE_TEMPLATE},
 		{ "verbose", required_argument, NULL, XCCDF_OPT_VERBOSE },
 		{ "verbose-log-file", required_argument, NULL, XCCDF_OPT_VERBOSE_LOG_FILE },
+		{ "probe-cache", required_argument, NULL, XCCDF_OPT_PROBE_CACHE },
 	// flags
 		{"force",		no_argument, &action->force, 1},
 		{"oval-results",	no_argument, &action->oval_results, 1},
@@ -1008,6 +1014,9 @@ bool getopt_xccdf(int argc, char **argv, struct oscap_action *action)
 		case XCCDF_OPT_VERBOSE_LOG_FILE:
 			action->f_verbose_log = optarg;
 			break;
+		case XCCDF_OPT_PROBE_CACHE:
+			action->probe_cache = optarg;
+			break;
 		case 0: break;
 		default: return oscap_module_usage(action->module, stderr, NULL);
 		}